@@ -51,7 +51,10 @@ public class DeployToPakEditor : ModuleRules
                 "Engine",
                 "Slate",
                 "SlateCore",
-                "Http"
+                "Http",
+                "AssetRegistry",
+                "Json",
+                "PakLoader"
 				// ... add private dependencies that you statically link with here ...	
 			}
             );
@@ -13,6 +13,15 @@
 #include "SOutputLogDialog.h"
 #include "CookContentMenu.h"
 #include "CookContentActions.h"
+#include "MultiPlatformDeploy.h"
+#include "PakManifest.h"
+#include "PakContents.h"
+#include "PakChannels.h"
+#include "CookStats.h"
+#include "DeployProfiler.h"
+#include "PakCompression.h"
+#include "PakUploader.h"
+#include "Async.h"
 #include "CoreMisc.h"
 #include "EditorStyleSet.h"
 #include "Settings/EditorSettings.h"
@@ -102,6 +111,220 @@ static TArray<FString> GetAllBlueprintNames()
 	return Names;;
 }
 
+static FString GetMapsToCook()
+{
+	TArray<FString> MapFiles = GetAllMapNames();
+	//IFileManager::Get().FindFilesRecursive(MapFiles, FPaths::GameContentDir(), TEXT(".umap"), true, false);
+	FString MapsToCook;
+	FString Sep = "";
+	for (int32 i = 0; i < MapFiles.Num(); i++)
+	{
+		MapsToCook += Sep;
+		Sep = "+";
+		MapsToCook +=MapFiles[i];
+	}
+	return MapsToCook;
+}
+
+static FString GetDirsToCook()
+{
+	TArray<FString> BlueprintFiles = GetAllBlueprintNames();
+	FString DirsToCook;
+	FString Sep = "";
+	TSet<FString> Dirs;
+	for (int32 i = 0; i < BlueprintFiles.Num(); i++)
+	{
+		FString Dir = FPaths::GetPath(BlueprintFiles[i]);
+		if (!Dir.StartsWith(TEXT("/Game/")))
+		{
+			UE_LOG(CookContentActions, Error, TEXT("Error: asset %s is not under the Content folder - it will not be included."), *BlueprintFiles[i]);
+			continue;
+		}
+		Dir = Dir.RightChop(6); // Remove leading "/Game/"
+		bool bExists = false;
+		Dirs.Add(Dir, &bExists);
+		if (!bExists)
+		{
+			DirsToCook += Sep;
+			Sep = "+";
+			DirsToCook += Dir;
+		}
+	}
+	return DirsToCook;
+}
+
+static FString GetProjectPath()
+{
+	return FPaths::IsProjectFilePathSet() ? FPaths::ConvertRelativePathToFull(FPaths::GetProjectFilePath()) : FPaths::RootDir() / FApp::GetGameName() / FApp::GetGameName() + TEXT(".uproject");
+}
+
+/** Longest package list passed to the cook commandlet; the engine truncates command lines at 16k characters */
+static const int32 MaxCookPackageListLength = 12 * 1024;
+
+FString FCookContentActionCallbacks::GetCookCommandLine(const FString& TargetPlatform)
+{
+	if (FDeployToPakEditorModule::Get().GetCookDependenciesOnly())
+	{
+		// Cook exactly the packages the pak needs rather than every asset in their directories
+		TArray<FName> Packages;
+		if (FPakContents::GetPackages(Packages))
+		{
+			TArray<FString> PackageNames;
+			int32 Length = 0;
+			for (const FName& Package : Packages)
+			{
+				Length += Package.GetStringLength() + 1;
+				if (Length > MaxCookPackageListLength)
+				{
+					// The cooker follows the references of what it cooks, so the roots alone still get the same set
+					UE_LOG(CookContentActions, Log, TEXT("%d packages don't fit on the cook command line - passing only the configured assets"), Packages.Num());
+					PackageNames.Reset();
+					GetMapsToCook().ParseIntoArray(PackageNames, TEXT("+"), true);
+					for (const FString& Blueprint : GetAllBlueprintNames())
+					{
+						PackageNames.Add(FPackageName::ObjectPathToPackageName(Blueprint));
+					}
+					break;
+				}
+				PackageNames.Add(Package.ToString());
+			}
+			const FString PackageList = FString::Join(PackageNames, TEXT("+"));
+			return FString::Printf(TEXT("\"%s\" -run=Cook -targetplatform=%s -map=\"%s\" -compressed -iterate -stdout -FORCELOGFLUSH -skipeditorcontent"),
+				*GetProjectPath(), *TargetPlatform, *PackageList);
+		}
+	}
+	// \Engine\Binaries\Win64\UE4Editor-Cmd.exe E:\Tango2\TestPak\TestPak.uproject -run=Cook  -TargetPlatform=WindowsNoEditor -fileopenlog -unversioned -iterate -cookall -compress -skipeditorcontent
+	return FString::Printf(TEXT("\"%s\" -run=Cook -targetplatform=%s -maps=\"%s\" -cookdir=\"%s\" -compressed -iterate -stdout -FORCELOGFLUSH -skipeditorcontent"),
+		*GetProjectPath(), *TargetPlatform, *GetMapsToCook(), *GetDirsToCook());
+}
+
+FString FCookContentActionCallbacks::GetPakFilename(const FString& TargetPlatform)
+{
+	FString VersionTag;
+	if (TargetPlatform != TEXT("Editor"))
+	{
+		VersionTag = FString("_") + ENGINE_COOKED_VERSION_STRING;
+	}
+	return FPaths::ConvertRelativePathToFull(FPaths::GameSavedDir() / "Cooked" / FApp::GetGameName() + "-" + TargetPlatform + VersionTag + "-Content.pak");
+}
+
+bool FCookContentActionCallbacks::CreatePakPlaceholder(const FString& TargetPlatform)
+{
+	// hack: create a file at the top level to ensure unrealpak doesn't try to change the mount point
+	FString ContentFolder = TargetPlatform == TEXT("Editor")
+		? FPaths::GameContentDir()
+		: FPaths::ConvertRelativePathToFull(FPaths::GameSavedDir() / "Cooked" / TargetPlatform / FApp::GetGameName() / "Content/");
+	FString PlaceHolder = ContentFolder + TEXT("unrealpakPlaceholder");
+	if (!FFileHelper::SaveStringToFile(TEXT("force unrealpak to include the folder that contains this"),
+		*PlaceHolder))
+	{
+		UE_LOG(CookContentActions, Error, TEXT("failed to create placeholder :( %s"), *PlaceHolder);
+		return false;
+	}
+	return true;
+}
+
+void FCookContentActionCallbacks::GetPakCommandLine(const FString& TargetPlatform, const FOnPakCommandLine& OnReady)
+{
+#if PLATFORM_WINDOWS
+	const FString Executable = TEXT("cmd.exe");
+#elif PLATFORM_LINUX
+	const FString Executable = TEXT("/bin/bash");
+#else
+	const FString Executable = TEXT("/bin/sh");
+#endif
+	FString CurrentPlatform; // hack
+#if PLATFORM_WINDOWS
+	CurrentPlatform = "Win64";
+#elif PLATFORM_LINUX
+	CurrentPlatform = "Linux";
+#else
+	CurrentPlatform = "Mac";
+#endif
+	const FString U4PakPath = FPaths::ConvertRelativePathToFull(FPaths::EngineDir() / "Binaries" / CurrentPlatform / "UnrealPak");
+	FString ContentFolder;
+	if (TargetPlatform == TEXT("Editor"))
+	{
+		ContentFolder = FPaths::ConvertRelativePathToFull(FPaths::GameContentDir());
+	}
+	else
+	{
+		ContentFolder = FPaths::ConvertRelativePathToFull(FPaths::GameSavedDir() / "Cooked" / TargetPlatform  / FApp::GetGameName() / "Content/");
+	}
+	const FString FullPakFilename = GetPakFilename(TargetPlatform);
+
+	// Settings and the Asset Registry are read here on the game thread; the worker only touches files
+	const FPakChannels::FPlanSettings Settings;
+	const FPakCompressionPolicy Compression;
+	const int32 MaxPatchPaks = FDeployToPakEditorModule::Get().GetMaxPatchPaks();
+	AsyncTask(ENamedThreads::AnyThread, [TargetPlatform, OnReady, Executable, U4PakPath, ContentFolder, FullPakFilename, Settings, Compression, MaxPatchPaks]()
+	{
+		// Only pak what the configured assets need, split into channels, and of each pak only what changed since it was last deployed
+		TArray<FPakChannels::FPak> Paks;
+		FPakChannels::Plan(Settings, ContentFolder, FullPakFilename, Paks);
+		// The paks are made one after the other by a script, which stops at the first that fails
+#if PLATFORM_WINDOWS
+		const FString ScriptFilename = FPaths::GetPath(FullPakFilename) / FPaths::GetBaseFilename(FullPakFilename) + TEXT(".bat");
+		FString Script;
+#else
+		const FString ScriptFilename = FPaths::GetPath(FullPakFilename) / FPaths::GetBaseFilename(FullPakFilename) + TEXT(".sh");
+		FString Script = TEXT("set -e") LINE_TERMINATOR;
+#endif
+		int32 PaksToMake = 0;
+		bool bFailed = false;
+		for (const FPakChannels::FPak& Pak : Paks)
+		{
+			if (Pak.FullPakFilename.IsEmpty())
+			{
+				continue;
+			}
+			FString PakFilename;
+			FString ResponseFile;
+			const EPakPrepareResult Prepared = FPakManifest::Prepare(ContentFolder, Pak.Filenames, Pak.FullPakFilename, Compression, false, MaxPatchPaks, PakFilename, ResponseFile);
+			if (Prepared != EPakPrepareResult::Ready)
+			{
+				bFailed |= Prepared == EPakPrepareResult::Failed;
+				continue;
+			}
+			// Compression is chosen per file in the response file
+			Script += FString::Printf(TEXT("\"%s\" \"%s\" -create=\"%s\"") LINE_TERMINATOR, *U4PakPath, *PakFilename, *ResponseFile);
+#if PLATFORM_WINDOWS
+			Script += TEXT("if errorlevel 1 exit /b 1") LINE_TERMINATOR;
+#endif
+			PaksToMake++;
+		}
+		EPakPrepareResult Result = bFailed ? EPakPrepareResult::Failed : PaksToMake > 0 ? EPakPrepareResult::Ready : EPakPrepareResult::Nothing;
+		if (Result == EPakPrepareResult::Ready && !FPakChannels::WriteManifest(FullPakFilename, Paks))
+		{
+			Result = EPakPrepareResult::Failed;
+		}
+		if (Result == EPakPrepareResult::Ready && !FFileHelper::SaveStringToFile(Script, *ScriptFilename))
+		{
+			UE_LOG(CookContentActions, Error, TEXT("Failed to write %s"), *ScriptFilename);
+			Result = EPakPrepareResult::Failed;
+		}
+		FString CommandLine;
+		if (Result == EPakPrepareResult::Ready)
+		{
+			UE_LOG(CookContentActions, Log, TEXT("Making %d of %d paks for %s"), PaksToMake, Paks.Num(), *TargetPlatform);
+#if PLATFORM_WINDOWS
+			CommandLine = FString::Printf(TEXT("/c \"\"%s\"\""), *ScriptFilename);
+#else
+			CommandLine = FString::Printf(TEXT("\"%s\""), *ScriptFilename);
+#endif
+		}
+		AsyncTask(ENamedThreads::GameThread, [OnReady, Result, Executable, CommandLine]()
+		{
+			OnReady.ExecuteIfBound(Result, Executable, CommandLine);
+		});
+	});
+}
+
+void FCookContentActionCallbacks::RebuildFullPaks()
+{
+	FPakManifest::Reset();
+}
+
 
 void FCookContentActionCallbacks::CookContent(const FName InPlatformInfoName)
 {
@@ -109,14 +332,7 @@ void FCookContentActionCallbacks::CookContent(const FName InPlatformInfoName)
 	if (!PlatformInfo)
 	{
 		// Editor mode	
-		// hack: create a file at the top level to ensure unrealpak doesn't try to change the mount point
-		FString ContentFolder = FPaths::GameContentDir();
-		FString PlaceHolder = ContentFolder + TEXT("unrealpakPlaceholder");
-		if (!FFileHelper::SaveStringToFile(TEXT("force unrealpak to include the folder that contains this"),
-			*PlaceHolder))
-		{
-			UE_LOG(CookContentActions, Error, TEXT("failed to create placeholder :( %s"), *PlaceHolder);
-		}
+		CreatePakPlaceholder(InPlatformInfoName.ToString());
 		CreatePakTask(InPlatformInfoName.ToString(), LOCTEXT("PackingContentTaskName", "Editor"), LOCTEXT("PakingContentTaskName", "Packaging content"), LOCTEXT("PakingTaskName", "Packing"), FEditorStyle::GetBrush(TEXT("MainFrame.CookContent")));
 		return;
 	}
@@ -164,47 +380,12 @@ void FCookContentActionCallbacks::CookContent(const FName InPlatformInfoName)
 	{
 		OptionalParams += TEXT(" -UseDebugParamForEditorExe");
 	}
-	TArray<FString> MapFiles = GetAllMapNames();
-	//IFileManager::Get().FindFilesRecursive(MapFiles, FPaths::GameContentDir(), TEXT(".umap"), true, false);
-	FString MapsToCook;
-	FString Sep = "";
-	for (int32 i = 0; i < MapFiles.Num(); i++)
-	{
-		MapsToCook += Sep;
-		Sep = "+";
-		MapsToCook +=MapFiles[i];
-	}
-	TArray<FString> BlueprintFiles = GetAllBlueprintNames();
-	FString DirsToCook;
-	Sep = "";
-	TSet<FString> Dirs;
-	for (int32 i = 0; i < BlueprintFiles.Num(); i++)
-	{
-		FString Dir = FPaths::GetPath(BlueprintFiles[i]);
-		if (!Dir.StartsWith(TEXT("/Game/")))
-		{
-			UE_LOG(CookContentActions, Error, TEXT("Error: asset %s is not under the Content folder - it will not be included."), *BlueprintFiles[i]);
-			continue;
-		}
-		Dir = Dir.RightChop(6); // Remove leading "/Game/"
-		bool bExists = false;
-		Dirs.Add(Dir, &bExists);
-		if (!bExists)
-		{
-			DirsToCook += Sep;
-			Sep = "+";
-			DirsToCook += Dir;
-		}
-	}
-
 	FString TargetPlatformInfoName = PlatformInfo->TargetPlatformName.ToString();
-	FString ProjectPath = FPaths::IsProjectFilePathSet() ? FPaths::ConvertRelativePathToFull(FPaths::GetProjectFilePath()) : FPaths::RootDir() / FApp::GetGameName() / FApp::GetGameName() + TEXT(".uproject");
+	FString ProjectPath = GetProjectPath();
 	
 	if (true)
 	{
-		// \Engine\Binaries\Win64\UE4Editor-Cmd.exe E:\Tango2\TestPak\TestPak.uproject -run=Cook  -TargetPlatform=WindowsNoEditor -fileopenlog -unversioned -iterate -cookall -compress -skipeditorcontent
-		FString CommandLine = FString::Printf(TEXT("\"%s\" -run=Cook -targetplatform=%s -maps=\"%s\" -cookdir=\"%s\" -compressed -iterate -stdout -FORCELOGFLUSH -skipeditorcontent"),
-			*ProjectPath, *TargetPlatformInfoName, *MapsToCook, *DirsToCook);
+		FString CommandLine = GetCookCommandLine(TargetPlatformInfoName);
 		UE_LOG(CookContentActions, Log, TEXT("Editor cook command line: %s"), *CommandLine);
 		CreateEditorTask(CommandLine, TargetPlatformInfoName,
 			PlatformInfo->DisplayName,
@@ -218,7 +399,7 @@ void FCookContentActionCallbacks::CookContent(const FName InPlatformInfoName)
 			GetUATCompilationFlags(),
 			FApp::IsEngineInstalled() ? TEXT(" -installed") : TEXT(""),
 			*ProjectPath,
-			*MapsToCook,
+			*GetMapsToCook(),
 			*FUnrealEdMisc::Get().GetExecutableForCommandlets(),
 			*OptionalParams
 			);
@@ -236,53 +417,56 @@ bool FCookContentActionCallbacks::CookContentCanExecute(const FName PlatformInfo
 	return true;
 }
 
+void FCookContentActionCallbacks::CookContentForDeployPlatforms()
+{
+	FMultiPlatformDeploy::Start(FDeployToPakEditorModule::Get().GetDeployPlatforms());
+}
+
+bool FCookContentActionCallbacks::CookContentForDeployPlatformsCanExecute()
+{
+	return FDeployToPakEditorModule::Get().GetDeployPlatforms().Num() > 0 && !FMultiPlatformDeploy::IsRunning();
+}
+
 /* FCookContentActionCallbacks implementation
  *****************************************************************************/
 
 void FCookContentActionCallbacks::CreatePakTask(const FString& TargetPlatform, const FText& PlatformDisplayName, const FText& TaskName, const FText &TaskShortName, const FSlateBrush* TaskIcon)
 {
-#if PLATFORM_WINDOWS
-	FString CmdExe = TEXT("cmd.exe");
-#elif PLATFORM_LINUX
-	FString CmdExe = TEXT("/bin/bash");
-#else
-	FString CmdExe = TEXT("/bin/sh");
-#endif
-	FString CurrentPlatform; // hack
-#if PLATFORM_WINDOWS
-	CurrentPlatform = "Win64";
-#elif PLATFORM_LINUX
-	CurrentPlatform = "Linux";
-#else
-	CurrentPlatform = "Mac";
-#endif
-	FString U4PakPath = FPaths::ConvertRelativePathToFull(FPaths::EngineDir() / "Binaries" / CurrentPlatform / "UnrealPak");
-	FGameProjectGenerationModule& GameProjectModule = FModuleManager::LoadModuleChecked<FGameProjectGenerationModule>(TEXT("GameProjectGeneration"));
-	bool bHavCode = GameProjectModule.Get().ProjectHasCodeFiles();
-	FString GameName = FApp::GetGameName();
-	FString ContentFolder;
-	FString OutputFile;
-	FString VersionTag;
-	if (TargetPlatform == TEXT("Editor"))
+	FDeployProfiler::BeginPak(TargetPlatform);
+	GetPakCommandLine(TargetPlatform, FOnPakCommandLine::CreateStatic(&FCookContentActionCallbacks::HandlePakCommandLine, TargetPlatform, PlatformDisplayName, TaskName, TaskShortName, TaskIcon));
+}
+
+void FCookContentActionCallbacks::HandlePakCommandLine(EPakPrepareResult Result, const FString& CmdExe, const FString& FullCommandLine, FString TargetPlatform, FText PlatformDisplayName, FText TaskName, FText TaskShortName, const FSlateBrush* TaskIcon)
+{
+	if (Result == EPakPrepareResult::Nothing)
 	{
-		ContentFolder = FPaths::ConvertRelativePathToFull(FPaths::GameContentDir());
+		FDeployProfiler::Finish(TargetPlatform, PlatformDisplayName);
+		FFormatNamedArguments Arguments;
+		Arguments.Add(TEXT("Platform"), PlatformDisplayName);
+		FNotificationInfo Info(FText::Format(LOCTEXT("PakUnchangedNotification", "Content for {Platform} is unchanged since the last pak"), Arguments));
+		Info.Image = TaskIcon;
+		Info.ExpireDuration = 3.0f;
+		FSlateNotificationManager::Get().AddNotification(Info);
+		return;
 	}
-	else
+	if (Result == EPakPrepareResult::Failed)
 	{
-		ContentFolder = FPaths::ConvertRelativePathToFull(FPaths::GameSavedDir() / "Cooked" / TargetPlatform  / GameName / "Content/");
-		//FString ResponseFile = FPaths::ConvertRelativePathToFull(FPaths::GameSavedDir() / "Content-Pak.txt");
-		VersionTag = FString("_") + ENGINE_COOKED_VERSION_STRING;
+		FDeployProfiler::EndPak(TargetPlatform, false, TArray<FString>());
+		FFormatNamedArguments Arguments;
+		Arguments.Add(TEXT("Platform"), PlatformDisplayName);
+		FNotificationInfo Info(FText::Format(LOCTEXT("PakPrepareFailedNotification", "Preparing the paks for {Platform} failed - see the Output Log"), Arguments));
+		Info.Image = TaskIcon;
+		Info.ExpireDuration = 5.0f;
+		Info.Hyperlink = FSimpleDelegate::CreateStatic(&FCookContentActionCallbacks::HandleUatHyperlinkNavigate);
+		Info.HyperlinkText = LOCTEXT("ShowOutputLogHyperlink", "Show Output Log");
+		TSharedPtr<SNotificationItem> NotificationItem = FSlateNotificationManager::Get().AddNotification(Info);
+		if (NotificationItem.IsValid())
+		{
+			NotificationItem->SetCompletionState(SNotificationItem::CS_Fail);
+		}
+		GEditor->PlayEditorSound(TEXT("/Engine/EditorSounds/Notifications/CompileFailed_Cue.CompileFailed_Cue"));
+		return;
 	}
-	OutputFile = FPaths::GameSavedDir() / "Cooked" / GameName + "-" + TargetPlatform + VersionTag + "-Content.pak";
-
-	FString CommandLine = FString::Printf(TEXT("\"%s\" -create=\"%s\" -compress"), *OutputFile, *ContentFolder);
-#if PLATFORM_WINDOWS
-	FString FullCommandLine = FString::Printf(TEXT("/c \"\"%s\" %s\""), *U4PakPath, *CommandLine);
-#else
-	FString FullCommandLine = FString::Printf(TEXT("\"%s\" %s"), *U4PakPath, *CommandLine);
-#endif	
-
-
 	UE_LOG(CookContentActions, Log, TEXT("Pak command: %s"), *FullCommandLine);
 	TSharedPtr<FMonitoredProcess> PakProcess(new FMonitoredProcess(CmdExe, FullCommandLine, true));
 
@@ -398,11 +582,13 @@ void FCookContentActionCallbacks::CreateEditorTask(const FString& CommandLine, c
 	Data.bProjectHasCode = false;
 	UatProcess->OnCanceled().BindStatic(&FCookContentActionCallbacks::HandleUatProcessCanceled, NotificationItemPtr, PlatformDisplayName, TaskShortName, Data);
 	UatProcess->OnCompleted().BindStatic(&FCookContentActionCallbacks::HandleUatProcessCompleted, true, NotificationItemPtr, InPlatformName, PlatformDisplayName, TaskShortName, Data);
-	UatProcess->OnOutput().BindStatic(&FCookContentActionCallbacks::HandleUatProcessOutput, NotificationItemPtr, PlatformDisplayName, TaskShortName);
+	UatProcess->OnOutput().BindStatic(&FCookContentActionCallbacks::HandleCookProcessOutput, InPlatformName, NotificationItemPtr, PlatformDisplayName, TaskShortName);
 
 	TWeakPtr<FMonitoredProcess> UatProcessPtr(UatProcess);
 	FEditorDelegates::OnShutdownPostPackagesSaved.Add(FSimpleDelegate::CreateStatic(&FCookContentActionCallbacks::HandleUatCancelButtonClicked, UatProcessPtr));
 
+	FCookStats::Begin(InPlatformName, FDeployToPakEditorModule::Get().GetCookDependenciesOnly());
+	FDeployProfiler::BeginCook(InPlatformName);
 	if (UatProcess->Launch())
 	{
 		GEditor->PlayEditorSound(TEXT("/Engine/EditorSounds/Notifications/CompileStart_Cue.CompileStart_Cue"));
@@ -726,33 +912,6 @@ private:
 TStatId RunOnMainThread::StatId;
 
 
-class FFileUploader
-{
-	TSharedPtr<SNotificationItem> NotificationItem;
-public:
-	FFileUploader(const TSharedPtr<SNotificationItem>& InNotificationItem) : NotificationItem(InNotificationItem) {}
-	void HandleHttpUploadFileComplete(FHttpRequestPtr HttpRequest, FHttpResponsePtr HttpResponse, bool bSucceeded)
-	{		
-		if (!bSucceeded || (HttpResponse.IsValid() && HttpResponse->GetResponseCode() != 200))
-		{
-			UE_LOG(CookContentActions, Error, TEXT("Upload to %s failed: %d"), *HttpRequest->GetURL(), HttpResponse.IsValid() ? HttpResponse->GetResponseCode() : -1);
-			GEditor->PlayEditorSound(TEXT("/Engine/EditorSounds/Notifications/CompileFailed_Cue.CompileFailed_Cue"));
-			NotificationItem->SetText(LOCTEXT("HttpUploadPakFailedNotification", "Failed to upload Pak file!"));
-			NotificationItem->SetCompletionState(SNotificationItem::CS_Fail);	
-			FPlatformProcess::ExploreFolder(*FPaths::ConvertRelativePathToFull(FPaths::GameSavedDir() / "Cooked"));
-		}
-		else
-		{		
-			UE_LOG(CookContentActions, Log, TEXT("Completed upload of %s"), *HttpRequest->GetURL());
-			GEditor->PlayEditorSound(TEXT("/Engine/EditorSounds/Notifications/CompileSuccess_Cue.CompileSuccess_Cue"));
-			NotificationItem->SetText(LOCTEXT("HttpUploadPakSucceededNotification", "Completed uploading Pak file!"));
-			NotificationItem->SetCompletionState(SNotificationItem::CS_Success);
-		}
-		NotificationItem->ExpireAndFadeout();
-		delete this;
-	}
-};
-
 TSharedPtr<SNotificationItem> FCookContentActionCallbacks::CreateNotificationItem(FText PlatformDisplayName, FText TaskName)
 {
 	// create notification item
@@ -790,6 +949,58 @@ TSharedPtr<SNotificationItem> FCookContentActionCallbacks::CreateNotificationIte
 
 
 
+bool FCookContentActionCallbacks::UploadPak(const FString& TargetPlatform, const FText& PlatformDisplayName, const FOnPakUploaded& OnUploaded)
+{
+	FString UploadURL = FDeployToPakEditorModule::Get().GetPakFileUploadURL();
+	const UGeneralProjectSettings& ProjectSettings = *GetDefault<UGeneralProjectSettings>();
+	const FString& CompanyName = ProjectSettings.CompanyName;
+	TArray<FString> Filenames;
+	FPakChannels::GetFilesToDeploy(GetPakFilename(TargetPlatform), Filenames);
+	const TArray<FDeployToPakAsset>& Assets = FDeployToPakEditorModule::Get().GetAssets();
+	FString AssetsToUpload = "{\"Assets\":[";
+	FString Sep = "";
+	for (int32 i = 0; i < Assets.Num(); i++)
+	{
+		AssetsToUpload += Sep;
+		Sep = ",";
+		FString Sep2;
+		AssetsToUpload += "{\"Maps\":[";
+		Sep2 = "";
+		for (int32 j = 0; j < Assets[i].Maps.Num(); j++)
+		{
+			AssetsToUpload += Sep2;
+			AssetsToUpload += "\"";
+			AssetsToUpload += FPackageName::ObjectPathToPackageName(Assets[i].Maps[j].ToString());
+			AssetsToUpload += "\"";
+
+			Sep2 = ",";
+		}
+		AssetsToUpload += "],";
+		AssetsToUpload += "\"Blueprints\":[";
+		Sep2 = "";
+		for (int32 j = 0; j < Assets[i].Blueprints.Num(); j++)
+		{
+			AssetsToUpload += Sep2;
+			AssetsToUpload += "\"";
+			AssetsToUpload += Assets[i].Blueprints[j].ToString();
+			AssetsToUpload += "\"";
+			Sep2 = ",";
+		}
+		AssetsToUpload += "]}";
+	}
+	AssetsToUpload += "]}";
+	const FString Query = "assets=" + FGenericPlatformHttp::UrlEncode(AssetsToUpload) + "&author=" + FGenericPlatformHttp::UrlEncode(CompanyName);
+	if (!FPakUploader::Start(Filenames, TEXT("http://") + UploadURL, Query, GetPakFilename(TargetPlatform), TargetPlatform, PlatformDisplayName, OnUploaded))
+	{
+		if (!IsRunningCommandlet())
+		{
+			FPlatformProcess::ExploreFolder(*FPaths::ConvertRelativePathToFull(FPaths::GameSavedDir() / "Cooked"));
+		}
+		return false;
+	}
+	return true;
+}
+
 DECLARE_CYCLE_STAT(TEXT("Requesting FCookContentActionCallbacks::HandleUatProcessCompleted message dialog to present the error message"), STAT_FCookContentActionCallbacks_HandleUatProcessCompleted_DialogMessage, STATGROUP_TaskGraphTasks);
 void FCookContentActionCallbacks::HandleUatProcessCompleted(int32 ReturnCode, bool LaunchPakTask, TWeakPtr<SNotificationItem> NotificationItemPtr, FString TargetPlatform, FText PlatformDisplayName, FText TaskName, EventData Event)
 {
@@ -802,14 +1013,11 @@ void FCookContentActionCallbacks::HandleUatProcessCompleted(int32 ReturnCode, bo
 		bool Failed = false;
 		if (LaunchPakTask)
 		{			
-			// hack: create a file at the top level to ensure unrealpak doesn't try to change the mount point
-			FString ContentFolder = FPaths::ConvertRelativePathToFull(FPaths::GameSavedDir() / "Cooked" / TargetPlatform / FApp::GetGameName() / "Content/");
-			FString PlaceHolder = ContentFolder + TEXT("unrealpakPlaceholder");
-			if (!FFileHelper::SaveStringToFile(TEXT("force unrealpak to include the folder that contains this"),
-				*PlaceHolder))
+			FCookStats::End(TargetPlatform, true);
+			FDeployProfiler::EndCook(TargetPlatform, true);
+			if (!CreatePakPlaceholder(TargetPlatform))
 			{
 				Failed = true;
-				UE_LOG(CookContentActions, Log, TEXT("failed to create placeholder :( %s"), *PlaceHolder);
 			}
 			else
 			{
@@ -821,67 +1029,24 @@ void FCookContentActionCallbacks::HandleUatProcessCompleted(int32 ReturnCode, bo
 		}
 		else
 		{
-			FString UploadURL = FDeployToPakEditorModule::Get().GetPakFileUploadURL();
-			FString Author = FDeployToPakEditorModule::Get().GetAuthor();
-			const UGeneralProjectSettings& ProjectSettings = *GetDefault<UGeneralProjectSettings>();
-			const FString& CompanyName = ProjectSettings.CompanyName;
-			if (UploadURL.Len() > 0)
+			TArray<FString> PakFilenames;
+			FPakChannels::GetPaksToDeploy(GetPakFilename(TargetPlatform), PakFilenames);
+			FDeployProfiler::EndPak(TargetPlatform, true, PakFilenames);
+			if (!FPakChannels::Finalize(GetPakFilename(TargetPlatform)))
+			{
+				Failed = true;
+			}
+			else if (FDeployToPakEditorModule::Get().GetPakFileUploadURL().Len() > 0)
 			{
 				RunOnMainThread* DoUpload = new RunOnMainThread([=]() -> void 
 				{
-					FString EngineVersionTag;
-					if (TargetPlatform != "Editor")
-					{
-						EngineVersionTag = FString("_")+FString(ENGINE_COOKED_VERSION_STRING);
-					}
-					FString Basefilename = FString(FApp::GetGameName()) + TEXT("-") + TargetPlatform + EngineVersionTag + TEXT("-Content.pak");
-					FString Filename = FPaths::ConvertRelativePathToFull(FPaths::GameSavedDir() / "Cooked" / Basefilename);
-					TArray<uint8> Bytes;
-					FFileHelper::LoadFileToArray(Bytes, *Filename);
-					TSharedRef<IHttpRequest> Request = (&FHttpModule::Get())->CreateRequest();
-					Request->OnProcessRequestComplete().BindRaw(new FFileUploader(CreateNotificationItem(PlatformDisplayName, LOCTEXT("PakingContentTaskName", "Upload Pak file"))), &FFileUploader::HandleHttpUploadFileComplete);
-					const TArray<FDeployToPakAsset>& Assets = FDeployToPakEditorModule::Get().GetAssets();
-					FString AssetsToUpload = "{\"Assets\":[";
-					FString Sep = "";
-					for (int32 i = 0; i < Assets.Num(); i++)
-					{
-						AssetsToUpload += Sep;
-                                                Sep = ",";
-						FString Sep2;
-                                                AssetsToUpload += "{\"Maps\":[";
-						Sep2 = "";
-						for (int32 j = 0; j < Assets[i].Maps.Num(); j++)
-						{
-							AssetsToUpload += Sep2;
-                                                        AssetsToUpload += "\"";
-							AssetsToUpload += FPackageName::ObjectPathToPackageName(Assets[i].Maps[j].ToString());
-                                                        AssetsToUpload += "\"";
-
-							Sep2 = ",";
-						}
-						AssetsToUpload += "],";
-                                                AssetsToUpload += "\"Blueprints\":[";
-						Sep2 = "";
-						for (int32 j = 0; j < Assets[i].Blueprints.Num(); j++)
-						{
-							AssetsToUpload += Sep2;
-                                                        AssetsToUpload += "\"";
-							AssetsToUpload += Assets[i].Blueprints[j].ToString();
-                                                        AssetsToUpload += "\"";
-							Sep2 = ",";
-						}
-                                                AssetsToUpload += "]}";
-					}
-                                        AssetsToUpload += "]}";
-					Request->SetURL(TEXT("http://") + UploadURL / Basefilename + "?assets="+ FGenericPlatformHttp::UrlEncode(AssetsToUpload)+"&author="+ FGenericPlatformHttp::UrlEncode(CompanyName));
-					Request->SetVerb("POST");
-					Request->SetHeader("Content-Type", "application/octet-stream");
-					Request->SetContent(Bytes);
-					Request->ProcessRequest();
+					UploadPak(TargetPlatform, PlatformDisplayName);
 				});
 			}
 			else
 			{
+				FPakChannels::Commit(GetPakFilename(TargetPlatform));
+				FDeployProfiler::Finish(TargetPlatform, PlatformDisplayName);
 				FPlatformProcess::ExploreFolder(*FPaths::ConvertRelativePathToFull(FPaths::GameSavedDir() / "Cooked"));
 			}
 		}
@@ -900,6 +1065,15 @@ void FCookContentActionCallbacks::HandleUatProcessCompleted(int32 ReturnCode, bo
 		}
 		//		FMessageLog("PackagingResults").Info(FText::Format(LOCTEXT("UatProcessSuccessMessageLog", "{TaskName} for {Platform} completed successfully"), Arguments));
 	}
+	if (LaunchPakTask)
+	{
+		FCookStats::End(TargetPlatform, false);
+		FDeployProfiler::EndCook(TargetPlatform, false);
+	}
+	else
+	{
+		FDeployProfiler::EndPak(TargetPlatform, false, TArray<FString>());
+	}
 	TGraphTask<FCookContentActionsNotificationTask>::CreateTask().ConstructAndDispatchWhenReady(
 		NotificationItemPtr,
 		SNotificationItem::CS_Fail,
@@ -932,6 +1106,13 @@ void FCookContentActionCallbacks::HandleUatProcessCompleted(int32 ReturnCode, bo
 }
 
 
+void FCookContentActionCallbacks::HandleCookProcessOutput(FString Output, FString TargetPlatform, TWeakPtr<SNotificationItem> NotificationItemPtr, FText PlatformDisplayName, FText TaskName)
+{
+	FCookStats::HandleOutput(TargetPlatform, Output);
+	FDeployProfiler::HandleCookOutput(TargetPlatform, Output);
+	HandleUatProcessOutput(Output, NotificationItemPtr, PlatformDisplayName, TaskName);
+}
+
 void FCookContentActionCallbacks::HandleUatProcessOutput(FString Output, TWeakPtr<SNotificationItem> NotificationItemPtr, FText PlatformDisplayName, FText TaskName)
 {
 	if (!Output.IsEmpty() && !Output.Equals("\r"))
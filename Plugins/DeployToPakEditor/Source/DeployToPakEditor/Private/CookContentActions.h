@@ -12,6 +12,14 @@
 #include "ISourceControlProvider.h"
 #include "Settings/ProjectPackagingSettings.h"
 #include "Http.h"
+#include "PakUploader.h"
+#include "PakManifest.h"
+
+/**
+ * Called on the game thread with the UnrealPak command GetPakCommandLine made. The command is only set for Ready;
+ * Nothing means no pak changed, Failed that a pak or the manifest couldn't be prepared.
+ */
+DECLARE_DELEGATE_ThreeParams(FOnPakCommandLine, EPakPrepareResult /*Result*/, const FString& /*Executable*/, const FString& /*CommandLine*/);
 
 /**
  * Implementation of cook content action callback
@@ -27,6 +35,38 @@ public:
 	/** Checks whether a menu action for cooking the project's content can execute. */
 	static bool CookContentCanExecute(const FName PlatformInfoName);
 
+	/** Cooks and paks the project's content for every platform in the Deploy Platforms setting, several at a time. */
+	static void CookContentForDeployPlatforms();
+
+	/** Checks whether a multi-platform deploy can start: platforms are configured and no other one is running. */
+	static bool CookContentForDeployPlatformsCanExecute();
+
+	/** Command line for UE4Editor-Cmd that cooks the configured maps and blueprints for a target platform. */
+	static FString GetCookCommandLine(const FString& TargetPlatform);
+
+	/** Full path of the full pak of a target platform ("Editor" for uncooked content); its channel paks, patch paks and manifest are named after it. */
+	static FString GetPakFilename(const FString& TargetPlatform);
+
+	/** Makes sure UnrealPak keeps the Content folder as the mount point; returns false if the placeholder couldn't be written. */
+	static bool CreatePakPlaceholder(const FString& TargetPlatform);
+
+	/**
+	 * Executable and command line that run UnrealPak on the cooked (or, for "Editor", uncooked) content of a target platform,
+	 * once per pak of its channels (see FPakChannels), and writes the manifest of the paks.
+	 * Makes patch paks of the files changed since each pak was last deployed where possible.
+	 * Scanning and hashing the content takes a while, so it runs on a worker and OnReady is called on the game thread.
+	 */
+	static void GetPakCommandLine(const FString& TargetPlatform, const FOnPakCommandLine& OnReady);
+
+	/** Makes the next pak of every platform a full pak rather than a patch. */
+	static void RebuildFullPaks();
+
+	/**
+	 * Uploads the new paks of a target platform and their manifest to the Pak File Upload Folder URL, with a notification of its own.
+	 * Returns false if the upload couldn't start; otherwise OnUploaded is called when it ends.
+	 */
+	static bool UploadPak(const FString& TargetPlatform, const FText& PlatformDisplayName, const FOnPakUploaded& OnUploaded = FOnPakUploaded());
+
 protected:
 
 
@@ -86,9 +126,15 @@ private:
 	// Handles the completion of a packager process.
 	static void HandleUatProcessCompleted(int32 ReturnCode, bool LaunchPakTask, TWeakPtr<class SNotificationItem> NotificationItemPtr, FString TargetPlatform, FText PlatformDisplayName, FText TaskName, EventData Event);
 
+	// Launches UnrealPak once GetPakCommandLine is done, for CreatePakTask.
+	static void HandlePakCommandLine(EPakPrepareResult Result, const FString& CmdExe, const FString& FullCommandLine, FString TargetPlatform, FText PlatformDisplayName, FText TaskName, FText TaskShortName, const FSlateBrush* TaskIcon);
+
 	// Handles packager process output.
 	static void HandleUatProcessOutput(FString Output, TWeakPtr<class SNotificationItem> NotificationItemPtr, FText PlatformDisplayName, FText TaskName);
 
+	// Handles cook commandlet output, counting the cooked packages before passing it on to HandleUatProcessOutput.
+	static void HandleCookProcessOutput(FString Output, FString TargetPlatform, TWeakPtr<class SNotificationItem> NotificationItemPtr, FText PlatformDisplayName, FText TaskName);
+
 private:
 	static TSharedPtr<class SNotificationItem> CreateNotificationItem(FText PlatformDisplayName,  FText TaskName);
 
@@ -9,6 +9,7 @@
 #include "InstalledPlatformInfo.h"
 #include "PlatformInfo.h"
 #include "GameProjectGenerationModule.h"
+#include "EditorStyleSet.h"
 
 
 #define LOCTEXT_NAMESPACE "FCookContentMenu"
@@ -52,6 +53,23 @@ public:
 
 		VanillaPlatforms.Add(EditorPlatform);
 
+		MenuBuilder.AddMenuEntry(
+			LOCTEXT("CookDeployPlatforms", "All Deploy Platforms"),
+			LOCTEXT("CookDeployPlatformsTooltip", "Cook and pak your game content for every platform in the Deploy Platforms setting, several at a time"),
+			FSlateIcon(FEditorStyle::GetStyleSetName(), "MainFrame.CookContent"),
+			FUIAction(
+				FExecuteAction::CreateStatic(&FCookContentActionCallbacks::CookContentForDeployPlatforms),
+				FCanExecuteAction::CreateStatic(&FCookContentActionCallbacks::CookContentForDeployPlatformsCanExecute)
+				)
+			);
+		MenuBuilder.AddMenuEntry(
+			LOCTEXT("RebuildFullPaks", "Rebuild Full Paks"),
+			LOCTEXT("RebuildFullPaksTooltip", "Make the next pak of every platform a full pak instead of a patch with the files changed since the last one"),
+			FSlateIcon(),
+			FUIAction(FExecuteAction::CreateStatic(&FCookContentActionCallbacks::RebuildFullPaks))
+			);
+		MenuBuilder.AddMenuSeparator();
+
 		VanillaPlatforms.Sort([](const PlatformInfo::FVanillaPlatformEntry& One, const PlatformInfo::FVanillaPlatformEntry& Two) -> bool
 		{
 			if (One.PlatformInfo->DisplayName.CompareTo(EditorPlatform.PlatformInfo->DisplayName) == 0) return true;
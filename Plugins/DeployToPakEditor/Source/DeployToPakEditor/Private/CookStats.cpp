@@ -0,0 +1,118 @@
+// Copyright 1998-2016 Epic Games, Inc. All Rights Reserved.
+
+#include "DeployToPakEditorPrivatePCH.h"
+#include "CookStats.h"
+
+DEFINE_LOG_CATEGORY_STATIC(CookStats, Log, All);
+
+FCriticalSection FCookStats::CooksCritical;
+TMap<FString, FCookStats::FCook> FCookStats::Cooks;
+
+static const TCHAR* GetModeName(bool bDependenciesOnly)
+{
+	return bDependenciesOnly ? TEXT("Dependencies") : TEXT("Directories");
+}
+
+void FCookStats::Begin(const FString& TargetPlatform, bool bDependenciesOnly)
+{
+	FCook Cook;
+	Cook.bDependenciesOnly = bDependenciesOnly;
+	Cook.StartTime = FPlatformTime::Seconds();
+	Cook.StartDate = FDateTime::UtcNow();
+	FScopeLock Lock(&CooksCritical);
+	Cooks.Add(TargetPlatform, Cook);
+}
+
+void FCookStats::HandleOutput(const FString& TargetPlatform, const FString& Output)
+{
+	// The cook commandlet reports progress as "Cooked packages <n> Packages Remain <n> Total <n>"
+	static const FString CookedPrefix(TEXT("Cooked packages "));
+	const int32 Start = Output.Find(CookedPrefix, ESearchCase::CaseSensitive);
+	if (Start == INDEX_NONE)
+	{
+		return;
+	}
+	const int32 CookedPackages = FCString::Atoi(*Output + Start + CookedPrefix.Len());
+	FScopeLock Lock(&CooksCritical);
+	FCook* Cook = Cooks.Find(TargetPlatform);
+	if (Cook != nullptr)
+	{
+		Cook->CookedPackages = FMath::Max(Cook->CookedPackages, CookedPackages);
+	}
+}
+
+void FCookStats::End(const FString& TargetPlatform, bool bSucceeded)
+{
+	FCook Cook;
+	{
+		FScopeLock Lock(&CooksCritical);
+		if (!Cooks.RemoveAndCopyValue(TargetPlatform, Cook))
+		{
+			return;
+		}
+	}
+	const double Seconds = FPlatformTime::Seconds() - Cook.StartTime;
+	if (!bSucceeded)
+	{
+		UE_LOG(CookStats, Log, TEXT("Cook of %s failed after %.1fs"), *TargetPlatform, Seconds);
+		return;
+	}
+	if (Cook.CookedPackages < 0)
+	{
+		Cook.CookedPackages = CountCookedPackages(TargetPlatform, Cook.StartDate);
+	}
+
+	// Find the last cook of this platform made the other way before adding this one
+	const FString CsvFilename = FPaths::ConvertRelativePathToFull(FPaths::GameSavedDir() / TEXT("Cooked") / TEXT("CookStats.csv"));
+	FString Csv;
+	FFileHelper::LoadFileToString(Csv, *CsvFilename);
+	TArray<FString> Lines;
+	Csv.ParseIntoArrayLines(Lines);
+	int32 OtherPackages = -1;
+	double OtherSeconds = 0;
+	for (const FString& Line : Lines)
+	{
+		TArray<FString> Fields;
+		Line.ParseIntoArray(Fields, TEXT(","), false);
+		if (Fields.Num() == 5 && Fields[1] == TargetPlatform && Fields[2] == GetModeName(!Cook.bDependenciesOnly))
+		{
+			OtherPackages = FCString::Atoi(*Fields[3]);
+			OtherSeconds = FCString::Atod(*Fields[4]);
+		}
+	}
+
+	if (Lines.Num() == 0)
+	{
+		Csv = TEXT("Date,Platform,CookSet,Packages,Seconds") LINE_TERMINATOR;
+	}
+	else if (!Csv.EndsWith(LINE_TERMINATOR))
+	{
+		Csv += LINE_TERMINATOR;
+	}
+	Csv += FString::Printf(TEXT("%s,%s,%s,%d,%.1f") LINE_TERMINATOR, *Cook.StartDate.ToIso8601(), *TargetPlatform, GetModeName(Cook.bDependenciesOnly), Cook.CookedPackages, Seconds);
+	FFileHelper::SaveStringToFile(Csv, *CsvFilename);
+
+	UE_LOG(CookStats, Log, TEXT("Cooked %d packages for %s in %.1fs (%s cook set)"), Cook.CookedPackages, *TargetPlatform, Seconds, GetModeName(Cook.bDependenciesOnly));
+	if (OtherPackages >= 0)
+	{
+		UE_LOG(CookStats, Log, TEXT("  last %s cook set: %d packages in %.1fs, so %+d packages and %+.1fs now"),
+			GetModeName(!Cook.bDependenciesOnly), OtherPackages, OtherSeconds, Cook.CookedPackages - OtherPackages, Seconds - OtherSeconds);
+	}
+}
+
+int32 FCookStats::CountCookedPackages(const FString& TargetPlatform, const FDateTime& Since)
+{
+	const FString CookedDir = FPaths::ConvertRelativePathToFull(FPaths::GameSavedDir() / TEXT("Cooked") / TargetPlatform);
+	TArray<FString> Filenames;
+	IFileManager::Get().FindFilesRecursive(Filenames, *CookedDir, TEXT("*.uasset"), true, false);
+	IFileManager::Get().FindFilesRecursive(Filenames, *CookedDir, TEXT("*.umap"), true, false, false);
+	int32 Count = 0;
+	for (const FString& Filename : Filenames)
+	{
+		if (IFileManager::Get().GetTimeStamp(*Filename) >= Since)
+		{
+			Count++;
+		}
+	}
+	return Count;
+}
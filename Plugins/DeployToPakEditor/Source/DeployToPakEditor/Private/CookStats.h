@@ -0,0 +1,41 @@
+// Copyright 1998-2016 Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "Engine.h"
+
+/**
+ * Measures each cook: how many packages the cook commandlet cooked and how long it took. Results are appended
+ * to Saved/Cooked/CookStats.csv with the way the cook set was chosen (the configured assets' dependencies or
+ * whole directories), and each cook is compared in the log against the last one of the platform made the
+ * other way. Platforms are tracked separately, so cooks may run in parallel.
+ */
+class FCookStats
+{
+public:
+	/** Call when the cook of TargetPlatform starts */
+	static void Begin(const FString& TargetPlatform, bool bDependenciesOnly);
+
+	/** Feed each line the cook commandlet prints */
+	static void HandleOutput(const FString& TargetPlatform, const FString& Output);
+
+	/** Call when the cook of TargetPlatform ends, to log and record it */
+	static void End(const FString& TargetPlatform, bool bSucceeded);
+
+private:
+	struct FCook
+	{
+		bool bDependenciesOnly;
+		double StartTime;
+		FDateTime StartDate;
+		int32 CookedPackages;
+
+		FCook() : bDependenciesOnly(false), StartTime(0), CookedPackages(-1) {}
+	};
+
+	/** Counts the packages under the cooked Content folder written since the cook started */
+	static int32 CountCookedPackages(const FString& TargetPlatform, const FDateTime& Since);
+
+	static FCriticalSection CooksCritical;
+	static TMap<FString, FCook> Cooks;
+};
@@ -0,0 +1,325 @@
+// Copyright 1998-2016 Epic Games, Inc. All Rights Reserved.
+
+#include "DeployToPakEditorPrivatePCH.h"
+#include "DeployProfiler.h"
+#include "PakManifest.h"
+#include "SNotificationList.h"
+#include "NotificationManager.h"
+#include "EditorStyleSet.h"
+#include "Async.h"
+
+#define LOCTEXT_NAMESPACE "DeployProfiler"
+
+DEFINE_LOG_CATEGORY_STATIC(DeployProfiler, Log, All);
+
+/** Deploys the baseline is the median of */
+static const int32 BaselineDeploys = 5;
+/** A stage regressed if it took this much longer than its baseline... */
+static const double RegressionRatio = 1.25;
+/** ...and at least this many seconds longer, so short stages don't flag on noise */
+static const double MinRegressionSeconds = 10.0;
+/** The pak regressed if it grew by this much over its baseline */
+static const double PakGrowthRatio = 1.1;
+
+static const TCHAR* StageNames[] = { TEXT("CookStartup"), TEXT("Shaders"), TEXT("Cooking"), TEXT("Saving"), TEXT("Pak"), TEXT("Upload") };
+static_assert(ARRAY_COUNT(StageNames) == (int32)EDeployStage::Count, "A stage is missing a name");
+
+FCriticalSection FDeployProfiler::DeploysCritical;
+TMap<FString, FDeployProfiler::FDeploy> FDeployProfiler::Deploys;
+TMap<FString, FDeployProfiler::FDeploy> FDeployProfiler::Finished;
+
+void FDeployProfiler::BeginCook(const FString& TargetPlatform)
+{
+	BeginStage(TargetPlatform, true);
+}
+
+void FDeployProfiler::HandleCookOutput(const FString& TargetPlatform, const FString& Output)
+{
+	EDeployStage Stage;
+	if (Output.Contains(TEXT("LogShaderCompilers"), ESearchCase::CaseSensitive))
+	{
+		Stage = EDeployStage::Shaders;
+	}
+	else if (Output.Contains(TEXT("LogSavePackage"), ESearchCase::CaseSensitive))
+	{
+		Stage = EDeployStage::Saving;
+	}
+	else if (Output.Contains(TEXT("LogCook"), ESearchCase::CaseSensitive))
+	{
+		Stage = EDeployStage::Cooking;
+	}
+	else
+	{
+		return;
+	}
+	const double Now = FPlatformTime::Seconds();
+	FScopeLock Lock(&DeploysCritical);
+	FDeploy* Deploy = Deploys.Find(TargetPlatform);
+	if (Deploy == nullptr)
+	{
+		return;
+	}
+	// The time since the last classified line went into producing this one; start up lasts until the cook's first line
+	Deploy->Seconds[(int32)(Deploy->CookStage == EDeployStage::CookStartup ? EDeployStage::CookStartup : Stage)] += Now - Deploy->StageStartTime;
+	Deploy->StageStartTime = Now;
+	Deploy->CookStage = Stage;
+}
+
+void FDeployProfiler::EndCook(const FString& TargetPlatform, bool bSucceeded)
+{
+	FScopeLock Lock(&DeploysCritical);
+	FDeploy* Deploy = Deploys.Find(TargetPlatform);
+	if (Deploy != nullptr)
+	{
+		// Whatever the cook did after its last classified line, it was still in that stage
+		EndStage(TargetPlatform, Deploy->CookStage, bSucceeded);
+	}
+}
+
+void FDeployProfiler::BeginPak(const FString& TargetPlatform)
+{
+	BeginStage(TargetPlatform, false);
+}
+
+void FDeployProfiler::EndPak(const FString& TargetPlatform, bool bSucceeded, const TArray<FString>& PakFilenames)
+{
+	FScopeLock Lock(&DeploysCritical);
+	FDeploy* Deploy = EndStage(TargetPlatform, EDeployStage::Pak, bSucceeded);
+	if (Deploy == nullptr)
+	{
+		return;
+	}
+	Deploy->PakBytes = 0;
+	Deploy->PakFiles = 0;
+	Deploy->bPatch = false;
+	for (const FString& PakFilename : PakFilenames)
+	{
+		Deploy->PakBytes += FMath::Max<int64>(IFileManager::Get().FileSize(*PakFilename), 0);
+		Deploy->bPatch |= FPakManifest::IsPatchPak(PakFilename);
+		// UnrealPak was given one line per file in the response file next to the pak, see FPakManifest::Prepare
+		FString Response;
+		if (FFileHelper::LoadFileToString(Response, *(FPaths::GetPath(PakFilename) / FPaths::GetBaseFilename(PakFilename) + TEXT(".txt"))))
+		{
+			TArray<FString> Lines;
+			Deploy->PakFiles += Response.ParseIntoArrayLines(Lines);
+		}
+	}
+}
+
+void FDeployProfiler::BeginUpload(const FString& TargetPlatform)
+{
+	BeginStage(TargetPlatform, false);
+}
+
+void FDeployProfiler::EndUpload(const FString& TargetPlatform, bool bSucceeded, int64 SentBytes)
+{
+	FScopeLock Lock(&DeploysCritical);
+	FDeploy* Deploy = EndStage(TargetPlatform, EDeployStage::Upload, bSucceeded);
+	if (Deploy != nullptr)
+	{
+		Deploy->UploadBytes = SentBytes;
+	}
+}
+
+void FDeployProfiler::BeginStage(const FString& TargetPlatform, bool bNewDeploy)
+{
+	FScopeLock Lock(&DeploysCritical);
+	FDeploy* Deploy = bNewDeploy ? nullptr : Deploys.Find(TargetPlatform);
+	if (Deploy == nullptr)
+	{
+		Deploy = &Deploys.Add(TargetPlatform, FDeploy());
+	}
+	Deploy->StageStartTime = FPlatformTime::Seconds();
+}
+
+FDeployProfiler::FDeploy* FDeployProfiler::EndStage(const FString& TargetPlatform, EDeployStage Stage, bool bSucceeded)
+{
+	FDeploy* Deploy = Deploys.Find(TargetPlatform);
+	if (Deploy == nullptr)
+	{
+		return nullptr;
+	}
+	if (!bSucceeded)
+	{
+		UE_LOG(DeployProfiler, Log, TEXT("%s failed for %s; the deploy is left out of the history"), StageNames[(int32)Stage], *TargetPlatform);
+		Deploys.Remove(TargetPlatform);
+		return nullptr;
+	}
+	const double Now = FPlatformTime::Seconds();
+	Deploy->Seconds[(int32)Stage] += Now - Deploy->StageStartTime;
+	Deploy->StageStartTime = Now;
+	return Deploy;
+}
+
+static double GetMedian(TArray<double>& Values)
+{
+	Values.Sort();
+	const int32 Middle = Values.Num() / 2;
+	return Values.Num() % 2 == 1 ? Values[Middle] : (Values[Middle - 1] + Values[Middle]) / 2;
+}
+
+void FDeployProfiler::Finish(const FString& TargetPlatform, const FText& PlatformDisplayName)
+{
+	FDeploy Deploy;
+	{
+		FScopeLock Lock(&DeploysCritical);
+		if (!Deploys.RemoveAndCopyValue(TargetPlatform, Deploy))
+		{
+			return;
+		}
+	}
+	double TotalSeconds = 0;
+	FString Breakdown;
+	for (int32 Stage = 0; Stage < (int32)EDeployStage::Count; Stage++)
+	{
+		TotalSeconds += Deploy.Seconds[Stage];
+		Breakdown += FString::Printf(TEXT(" %s %.1fs"), StageNames[Stage], Deploy.Seconds[Stage]);
+	}
+	UE_LOG(DeployProfiler, Log, TEXT("Deployed %s in %.1fs:%s; pak %d files, %lld bytes, %lld bytes uploaded"),
+		*TargetPlatform, TotalSeconds, *Breakdown, Deploy.PakFiles, Deploy.PakBytes, Deploy.UploadBytes);
+
+	// Columns: Date, one per stage, Total, PakFiles, PakBytes, UploadBytes, Patch
+	const FString CsvFilename = FPaths::ConvertRelativePathToFull(FPaths::GameSavedDir() / TEXT("Cooked") / TEXT("DeployHistory") / TargetPlatform + TEXT(".csv"));
+	FString Csv;
+	FFileHelper::LoadFileToString(Csv, *CsvFilename);
+	TArray<FString> Lines;
+	Csv.ParseIntoArrayLines(Lines);
+	const int32 PakBytesColumn = 1 + (int32)EDeployStage::Count + 2;
+	const int32 PatchColumn = PakBytesColumn + 2;
+	const int32 NumColumns = PatchColumn + 1;
+	TArray<TArray<double>> History;
+	History.SetNum(NumColumns);
+	// A patch pak only holds what changed, so its size is compared with the patches before it and a full pak with
+	// full paks. Lines written before the Patch column don't say which they were, so only their stages count.
+	TArray<double> PakSizes;
+	for (int32 Line = Lines.Num() - 1, Found = 0; Line > 0 && (Found < BaselineDeploys || PakSizes.Num() < BaselineDeploys); Line--)
+	{
+		TArray<FString> Fields;
+		Lines[Line].ParseIntoArray(Fields, TEXT(","), false);
+		if (Fields.Num() != NumColumns && Fields.Num() != NumColumns - 1)
+		{
+			continue;
+		}
+		if (Fields.Num() == NumColumns && (FCString::Atoi(*Fields[PatchColumn]) != 0) == Deploy.bPatch && PakSizes.Num() < BaselineDeploys)
+		{
+			const double Value = FCString::Atod(*Fields[PakBytesColumn]);
+			if (Value > 0)
+			{
+				PakSizes.Add(Value);
+			}
+		}
+		if (Found >= BaselineDeploys)
+		{
+			continue;
+		}
+		// Stages a deploy skipped (no cook for Editor content, no upload URL) don't make their baseline
+		for (int32 Column = 1; Column < PakBytesColumn; Column++)
+		{
+			const double Value = FCString::Atod(*Fields[Column]);
+			if (Value > 0)
+			{
+				History[Column].Add(Value);
+			}
+		}
+		Found++;
+	}
+
+	TArray<FString> Regressions;
+	for (int32 Stage = 0; Stage < (int32)EDeployStage::Count; Stage++)
+	{
+		TArray<double>& Values = History[1 + Stage];
+		const double Seconds = Deploy.Seconds[Stage];
+		if (Values.Num() == 0 || Seconds <= 0)
+		{
+			continue;
+		}
+		const double Baseline = GetMedian(Values);
+		if (Seconds > Baseline * RegressionRatio && Seconds - Baseline > MinRegressionSeconds)
+		{
+			Regressions.Add(FString::Printf(TEXT("%s %.0fs (usually %.0fs)"), StageNames[Stage], Seconds, Baseline));
+		}
+	}
+	if (PakSizes.Num() > 0 && Deploy.PakBytes > 0)
+	{
+		const double Baseline = GetMedian(PakSizes);
+		if (Deploy.PakBytes > Baseline * PakGrowthRatio)
+		{
+			Regressions.Add(FString::Printf(TEXT("%s %.1f MB (usually %.1f MB)"), Deploy.bPatch ? TEXT("patch pak") : TEXT("pak"),
+				Deploy.PakBytes / (1024.0 * 1024.0), Baseline / (1024.0 * 1024.0)));
+		}
+	}
+
+	FString Header(TEXT("Date"));
+	for (const TCHAR* StageName : StageNames)
+	{
+		Header += FString(TEXT(",")) + StageName;
+	}
+	Header += TEXT(",Total,PakFiles,PakBytes,UploadBytes,Patch");
+	if (Lines.Num() == 0)
+	{
+		Csv = Header + LINE_TERMINATOR;
+	}
+	else
+	{
+		// Histories from before the Patch column get the new header; their lines keep one column less
+		Lines[0] = Header;
+		Csv = FString::Join(Lines, LINE_TERMINATOR) + LINE_TERMINATOR;
+	}
+	Csv += FDateTime::Now().ToIso8601();
+	for (int32 Stage = 0; Stage < (int32)EDeployStage::Count; Stage++)
+	{
+		Csv += FString::Printf(TEXT(",%.1f"), Deploy.Seconds[Stage]);
+	}
+	Csv += FString::Printf(TEXT(",%.1f,%d,%lld,%lld,%d") LINE_TERMINATOR, TotalSeconds, Deploy.PakFiles, Deploy.PakBytes, Deploy.UploadBytes, Deploy.bPatch ? 1 : 0);
+	if (!FFileHelper::SaveStringToFile(Csv, *CsvFilename))
+	{
+		UE_LOG(DeployProfiler, Error, TEXT("Failed to write %s"), *CsvFilename);
+	}
+
+	{
+		FScopeLock Lock(&DeploysCritical);
+		Deploy.Regressions = Regressions;
+		Finished.Add(TargetPlatform, Deploy);
+	}
+	if (Regressions.Num() == 0)
+	{
+		return;
+	}
+	const FString Summary = FString::Join(Regressions, TEXT(", "));
+	UE_LOG(DeployProfiler, Warning, TEXT("Deploy of %s regressed against the last %d deploys: %s; see %s"), *TargetPlatform, BaselineDeploys, *Summary, *CsvFilename);
+	if (IsRunningCommandlet())
+	{
+		return;
+	}
+	FFormatNamedArguments Arguments;
+	Arguments.Add(TEXT("Platform"), PlatformDisplayName);
+	Arguments.Add(TEXT("Summary"), FText::FromString(Summary));
+	const FText Message = FText::Format(LOCTEXT("DeployRegressed", "Deploying {Platform} took longer than usual: {Summary}"), Arguments);
+	AsyncTask(ENamedThreads::GameThread, [Message]()
+	{
+		FNotificationInfo Info(Message);
+		Info.Image = FEditorStyle::GetBrush(TEXT("MainFrame.CookContent"));
+		Info.ExpireDuration = 10.0f;
+		Info.bFireAndForget = true;
+		FSlateNotificationManager::Get().AddNotification(Info);
+	});
+}
+
+bool FDeployProfiler::GetFinished(const FString& TargetPlatform, FDeploy& OutDeploy)
+{
+	FScopeLock Lock(&DeploysCritical);
+	const FDeploy* Deploy = Finished.Find(TargetPlatform);
+	if (!Deploy)
+	{
+		return false;
+	}
+	OutDeploy = *Deploy;
+	return true;
+}
+
+const TCHAR* FDeployProfiler::GetStageName(EDeployStage Stage)
+{
+	return StageNames[(int32)Stage];
+}
+
+#undef LOCTEXT_NAMESPACE
@@ -0,0 +1,98 @@
+// Copyright 1998-2016 Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "Engine.h"
+
+/** Stages the time of a deploy is split into */
+enum class EDeployStage : uint8
+{
+	/** Cook commandlet start up: engine init and asset registry scan, until the cook reports its first package */
+	CookStartup,
+	/** Shader compilation during the cook */
+	Shaders,
+	/** Loading and cooking packages */
+	Cooking,
+	/** Saving cooked packages */
+	Saving,
+	/** UnrealPak, compression included */
+	Pak,
+	/** Upload of the pak */
+	Upload,
+	Count,
+};
+
+/**
+ * Times each stage of a platform's deploy, from the output of the cook commandlet and the start and end of the
+ * pak and upload, and records the pak's size and file count. Cook output is attributed by log category: the time
+ * up to a LogShaderCompilers line counts as shader compilation, up to a LogSavePackage line as saving, up to other
+ * LogCook lines as cooking, and everything before the first LogCook line as start up.
+ *
+ * Finish appends the deploy to Saved/Cooked/DeployHistory/<platform>.csv and compares each stage against the
+ * median of the platform's last deploys; stages that took much longer, or a pak that grew much larger than the last
+ * paks of its kind (full or patch), are logged and shown in a notification (outside commandlets). A failed stage
+ * drops the deploy, so only complete deploys make the history.
+ * Platforms are tracked separately, and the Handle and End calls may come from process threads.
+ */
+class FDeployProfiler
+{
+public:
+	struct FDeploy
+	{
+		double Seconds[(int32)EDeployStage::Count];
+		/** When the current stage, or for the cook the last output line, started */
+		double StageStartTime;
+		/** Stage the cook is in, by its last classified output line */
+		EDeployStage CookStage;
+		int32 PakFiles;
+		int64 PakBytes;
+		int64 UploadBytes;
+		/** Whether the deploy made a patch pak rather than a full pak */
+		bool bPatch;
+		/** Stages, and the pak size, that regressed against the history; filled in by Finish */
+		TArray<FString> Regressions;
+
+		FDeploy() : StageStartTime(0), CookStage(EDeployStage::CookStartup), PakFiles(0), PakBytes(0), UploadBytes(0), bPatch(false)
+		{
+			FMemory::Memzero(Seconds);
+		}
+	};
+
+	/** Call when the cook of TargetPlatform starts; starts a new deploy */
+	static void BeginCook(const FString& TargetPlatform);
+
+	/** Feed each line the cook commandlet prints */
+	static void HandleCookOutput(const FString& TargetPlatform, const FString& Output);
+
+	static void EndCook(const FString& TargetPlatform, bool bSucceeded);
+
+	/** Call when UnrealPak starts; starts a new deploy if TargetPlatform wasn't cooked first */
+	static void BeginPak(const FString& TargetPlatform);
+
+	/** Call when UnrealPak ends, with the paks it made */
+	static void EndPak(const FString& TargetPlatform, bool bSucceeded, const TArray<FString>& PakFilenames);
+
+	static void BeginUpload(const FString& TargetPlatform);
+
+	static void EndUpload(const FString& TargetPlatform, bool bSucceeded, int64 SentBytes);
+
+	/** Logs the deploy of TargetPlatform, adds it to the platform's history and flags regressions */
+	static void Finish(const FString& TargetPlatform, const FText& PlatformDisplayName);
+
+	/** The last deploy of TargetPlatform that Finish recorded; returns false if there is none */
+	static bool GetFinished(const FString& TargetPlatform, FDeploy& OutDeploy);
+
+	/** Name of Stage, as in the history columns */
+	static const TCHAR* GetStageName(EDeployStage Stage);
+
+private:
+	/** Starts a stage timed as a whole, creating the deploy if needed */
+	static void BeginStage(const FString& TargetPlatform, bool bNewDeploy);
+	/** Adds the time since the stage started to Stage and returns the deploy, or drops it if the stage failed; call with DeploysCritical held */
+	static FDeploy* EndStage(const FString& TargetPlatform, EDeployStage Stage, bool bSucceeded);
+
+	static FCriticalSection DeploysCritical;
+	static TMap<FString, FDeploy> Deploys;
+	/** Deploys Finish recorded, by platform */
+	static TMap<FString, FDeploy> Finished;
+};
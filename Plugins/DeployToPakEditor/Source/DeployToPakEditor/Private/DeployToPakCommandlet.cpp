@@ -0,0 +1,116 @@
+// Copyright 1998-2016 Epic Games, Inc. All Rights Reserved.
+
+#include "DeployToPakEditorPrivatePCH.h"
+#include "DeployToPakCommandlet.h"
+#include "MultiPlatformDeploy.h"
+#include "CookContentActions.h"
+#include "PakChannels.h"
+#include "DeployProfiler.h"
+#include "Json.h"
+
+DEFINE_LOG_CATEGORY_STATIC(DeployToPak, Log, All);
+
+UDeployToPakCommandlet::UDeployToPakCommandlet(const FObjectInitializer& ObjectInitializer)
+	: Super(ObjectInitializer)
+{
+	LogToConsole = true;
+}
+
+int32 UDeployToPakCommandlet::Main(const FString& Params)
+{
+	TArray<FName> Platforms;
+	FString PlatformList;
+	if (FParse::Value(*Params, TEXT("Platforms="), PlatformList))
+	{
+		TArray<FString> PlatformNames;
+		PlatformList.ParseIntoArray(PlatformNames, TEXT("+"), true);
+		for (const FString& PlatformName : PlatformNames)
+		{
+			Platforms.Add(FName(*PlatformName));
+		}
+	}
+	else
+	{
+		Platforms = FDeployToPakEditorModule::Get().GetDeployPlatforms();
+	}
+	int32 MaxJobs = 0;
+	FParse::Value(*Params, TEXT("MaxJobs="), MaxJobs);
+	const bool bUpload = !FParse::Param(*Params, TEXT("NoUpload"));
+	FString ReportFilename = FPaths::GameSavedDir() / TEXT("Cooked") / TEXT("DeployReport.json");
+	FParse::Value(*Params, TEXT("Report="), ReportFilename);
+	ReportFilename = FPaths::ConvertRelativePathToFull(ReportFilename);
+
+	const double StartTime = FPlatformTime::Seconds();
+	bool bFinished = false;
+	TArray<FMultiPlatformDeploy::FPlatformResult> Results;
+	const bool bStarted = FMultiPlatformDeploy::Start(Platforms, MaxJobs, bUpload, FMultiPlatformDeploy::FOnFinished::CreateLambda(
+		[&bFinished, &Results](const TArray<FMultiPlatformDeploy::FPlatformResult>& InResults)
+		{
+			Results = InResults;
+			bFinished = true;
+		}));
+
+	// There is no engine loop in a commandlet: tick what the deploy relies on (its scheduler, the uploads and the HTTP manager are tickers)
+	double LastTime = StartTime;
+	while (bStarted && !bFinished)
+	{
+		const double Now = FPlatformTime::Seconds();
+		FTicker::GetCoreTicker().Tick(Now - LastTime);
+		FTaskGraphInterface::Get().ProcessThreadUntilIdle(ENamedThreads::GameThread);
+		LastTime = Now;
+		FPlatformProcess::Sleep(0.001f);
+	}
+	const double Seconds = FPlatformTime::Seconds() - StartTime;
+
+	bool bSucceeded = bStarted;
+	TArray<TSharedPtr<FJsonValue>> PlatformValues;
+	for (const FMultiPlatformDeploy::FPlatformResult& Result : Results)
+	{
+		bSucceeded &= Result.Result == TEXT("done");
+		TSharedRef<FJsonObject> Platform = MakeShareable(new FJsonObject());
+		Platform->SetStringField(TEXT("platform"), Result.TargetPlatform);
+		Platform->SetStringField(TEXT("result"), Result.Result);
+		Platform->SetNumberField(TEXT("returnCode"), Result.ReturnCode);
+		Platform->SetNumberField(TEXT("cookSeconds"), Result.CookSeconds);
+		Platform->SetNumberField(TEXT("pakSeconds"), Result.PakSeconds);
+		Platform->SetNumberField(TEXT("uploadSeconds"), Result.UploadSeconds);
+		// Only complete deploys are profiled
+		FDeployProfiler::FDeploy Deploy;
+		if (FDeployProfiler::GetFinished(Result.TargetPlatform, Deploy))
+		{
+			TSharedRef<FJsonObject> Stages = MakeShareable(new FJsonObject());
+			for (int32 Stage = 0; Stage < (int32)EDeployStage::Count; Stage++)
+			{
+				Stages->SetNumberField(FDeployProfiler::GetStageName((EDeployStage)Stage), Deploy.Seconds[Stage]);
+			}
+			Platform->SetObjectField(TEXT("stages"), Stages);
+			Platform->SetNumberField(TEXT("pakFiles"), Deploy.PakFiles);
+			Platform->SetNumberField(TEXT("pakBytes"), Deploy.PakBytes);
+			Platform->SetBoolField(TEXT("patch"), Deploy.bPatch);
+			Platform->SetNumberField(TEXT("uploadBytes"), Deploy.UploadBytes);
+			TArray<TSharedPtr<FJsonValue>> Regressions;
+			for (const FString& Regression : Deploy.Regressions)
+			{
+				Regressions.Add(MakeShareable(new FJsonValueString(Regression)));
+			}
+			Platform->SetArrayField(TEXT("regressions"), Regressions);
+		}
+		Platform->SetStringField(TEXT("manifest"), FPakChannels::GetManifestFilename(FCookContentActionCallbacks::GetPakFilename(Result.TargetPlatform)));
+		PlatformValues.Add(MakeShareable(new FJsonValueObject(Platform)));
+	}
+
+	TSharedRef<FJsonObject> Report = MakeShareable(new FJsonObject());
+	Report->SetStringField(TEXT("project"), FApp::GetGameName());
+	Report->SetBoolField(TEXT("succeeded"), bSucceeded);
+	Report->SetNumberField(TEXT("seconds"), Seconds);
+	Report->SetArrayField(TEXT("platforms"), PlatformValues);
+	FString Text;
+	TSharedRef<TJsonWriter<>> Writer = TJsonWriterFactory<>::Create(&Text);
+	if (!FJsonSerializer::Serialize(Report, Writer) || !FFileHelper::SaveStringToFile(Text, *ReportFilename, FFileHelper::EEncodingOptions::ForceUTF8WithoutBOM))
+	{
+		UE_LOG(DeployToPak, Error, TEXT("Failed to write %s"), *ReportFilename);
+		return 1;
+	}
+	UE_LOG(DeployToPak, Display, TEXT("Deploy %s in %.1fs; report in %s"), bSucceeded ? TEXT("succeeded") : TEXT("failed"), Seconds, *ReportFilename);
+	return bSucceeded ? 0 : 1;
+}
@@ -0,0 +1,35 @@
+// Copyright 1998-2016 Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+#include "Engine.h"
+#include "Commandlets/Commandlet.h"
+
+#include "DeployToPakCommandlet.generated.h"
+
+/**
+* Cooks, paks and uploads the project's content for build machines, without an editor window, the way Deploy to
+* Pak for the Deploy Platforms does from the menu and with the same Deploy Content to Pak settings:
+*
+*   UE4Editor-Cmd <Project> -run=DeployToPak [-Platforms=WindowsNoEditor+Android_ETC2] [-MaxJobs=0] [-NoUpload]
+*     [-Report=<json>]
+*
+* Platforms default to the Deploy Platforms setting and MaxJobs to Max Parallel Jobs. Platforms cook and pak in
+* parallel and each uploads as soon as its pak is made; the cook output, pak and upload progress go to the log.
+* The result of every platform, with its cook, pak and upload time, the stage breakdown and pak size the deploy
+* history records and any regressions against it, is written as JSON to Saved/Cooked/DeployReport.json:
+*
+*   { "project": "Game", "succeeded": true, "seconds": 512.3,
+*     "platforms": [ { "platform": "WindowsNoEditor", "result": "done", "returnCode": 0, "cookSeconds": 301.2,
+*       "pakSeconds": 40.5, "uploadSeconds": 12.1, "stages": { "CookStartup": 20.1, ... }, "pakFiles": 3,
+*       "pakBytes": 123456, "patch": false, "uploadBytes": 2345, "regressions": [], "manifest": "<path of the pak manifest>" } ] }
+*
+* Returns 0 if every platform deployed.
+*/
+UCLASS()
+class UDeployToPakCommandlet : public UCommandlet
+{
+	GENERATED_UCLASS_BODY()
+
+public:
+	virtual int32 Main(const FString& Params) override;
+};
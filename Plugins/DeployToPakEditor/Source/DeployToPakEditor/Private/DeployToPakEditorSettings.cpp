@@ -3,8 +3,12 @@
 #include "DeployToPakEditorSettings.h"
 
 UDeployToPakEditorSettings::UDeployToPakEditorSettings(class FObjectInitializer const &Init) :
-	UDeveloperSettings(Init), PakFileUploadFolderURL("")
+	UDeveloperSettings(Init), PakFileUploadFolderURL(""), MaxParallelJobs(0), MemoryPerCookMB(4096), MaxPatchPaks(8), bPakDependenciesOnly(true), bPakPerChannel(true), MaxPakSizeMB(0), bCookDependenciesOnly(true), DefaultCompression(EPakCompression::Zlib), UploadChunkMB(8), ParallelUploads(4)
 {
+	// Media and cooked audio are compressed already, so zlib only costs CPU at load
+	CompressionRules.Add(FPakCompressionRule(TEXT(""), TEXT("bk2"), EPakCompression::None));
+	CompressionRules.Add(FPakCompressionRule(TEXT(""), TEXT("mp4"), EPakCompression::None));
+	CompressionRules.Add(FPakCompressionRule(TEXT("SoundWave"), TEXT(""), EPakCompression::None));
 }
 
 void UDeployToPakEditorSettings::PostInitProperties()
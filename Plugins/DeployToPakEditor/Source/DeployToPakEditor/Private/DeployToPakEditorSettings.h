@@ -10,6 +10,9 @@ struct FDeployToPakAsset
 {
 	GENERATED_USTRUCT_BODY()
 public:
+	/** Name of the channel these assets are paked and downloaded as (letters and digits); defaults to Channel<index> */
+	UPROPERTY(EditAnywhere, Category = "Deploy Content to Pak")
+		FString Name;
 	/** Include these Maps */
 	UPROPERTY(EditAnywhere, Category = "Deploy Content to Pak", meta = (AllowedClasses = "World"))
 		TArray<FStringAssetReference> Maps;
@@ -19,6 +22,36 @@ public:
 	
 };
 
+/** How files are stored in a pak */
+UENUM()
+enum class EPakCompression : uint8
+{
+	/** Stored as is: best for data that is compressed already, and fastest to load */
+	None,
+	/** zlib, in 64KB blocks */
+	Zlib,
+};
+
+/** Chooses the compression of the files in a pak that match it */
+USTRUCT()
+struct FPakCompressionRule
+{
+	GENERATED_USTRUCT_BODY()
+public:
+	/** Class of the package's asset, e.g. SoundWave, Texture2D or FileMediaSource; empty to match any */
+	UPROPERTY(EditAnywhere, Category = "Deploy Content to Pak")
+		FString AssetClass;
+	/** File extension without the dot, e.g. uasset, ubulk or bk2; empty to match any */
+	UPROPERTY(EditAnywhere, Category = "Deploy Content to Pak")
+		FString Extension;
+	UPROPERTY(EditAnywhere, Category = "Deploy Content to Pak")
+		EPakCompression Compression;
+
+	FPakCompressionRule() : Compression(EPakCompression::None) {}
+	FPakCompressionRule(const FString& InAssetClass, const FString& InExtension, EPakCompression InCompression)
+		: AssetClass(InAssetClass), Extension(InExtension), Compression(InCompression) {}
+};
+
 
 /**
  *
@@ -39,6 +72,80 @@ public:
 	UPROPERTY(config, EditAnywhere, Category = "Deploy Content to Pak")
 		TArray<FDeployToPakAsset> Assets;
 
+	/**
+	 * Platforms cooked and paked by "All Deploy Platforms", e.g. WindowsNoEditor, Android_ASTC, Android_ETC2, LinuxNoEditor
+	 */
+	UPROPERTY(config, EditAnywhere, Category = "Deploy Content to Pak")
+		TArray<FName> DeployPlatforms;
+
+	/**
+	 * How many cook or pak jobs may run at once when deploying several platforms (0 to pick from cores and memory)
+	 */
+	UPROPERTY(config, EditAnywhere, Category = "Deploy Content to Pak", meta = (ClampMin = "0"))
+		int32 MaxParallelJobs;
+
+	/**
+	 * Physical memory a cook is expected to take; no further cook starts while less than this is free
+	 */
+	UPROPERTY(config, EditAnywhere, Category = "Deploy Content to Pak", meta = (ClampMin = "0"))
+		int32 MemoryPerCookMB;
+
+	/**
+	 * Only cook the configured Maps and Blueprints and the assets they reference, rather than every asset in their directories
+	 */
+	UPROPERTY(config, EditAnywhere, Category = "Deploy Content to Pak")
+		bool bCookDependenciesOnly;
+
+	/**
+	 * Only pak the configured Maps and Blueprints and the assets they reference, rather than the whole Content folder
+	 */
+	UPROPERTY(config, EditAnywhere, Category = "Deploy Content to Pak")
+		bool bPakDependenciesOnly;
+
+	/**
+	 * Make a pak per entry of Assets, with the packages several entries need in a Common pak, plus a .json manifest
+	 * listing the paks of each channel; needs Pak Dependencies Only
+	 */
+	UPROPERTY(config, EditAnywhere, Category = "Deploy Content to Pak")
+		bool bPakPerChannel;
+
+	/**
+	 * Largest pak to make, before compression; bigger channels are split over several paks (0 for no limit)
+	 */
+	UPROPERTY(config, EditAnywhere, Category = "Deploy Content to Pak", meta = (ClampMin = "0"))
+		int32 MaxPakSizeMB;
+
+	/**
+	 * Patch paks to make on top of a full pak before the next full pak (0 to always make full paks)
+	 */
+	UPROPERTY(config, EditAnywhere, Category = "Deploy Content to Pak", meta = (ClampMin = "0"))
+		int32 MaxPatchPaks;
+
+	/**
+	 * Compression of the files in paks, by asset class or extension; the first matching rule wins.
+	 * Run the PakCompression commandlet to see what each choice gains for the cooked content.
+	 */
+	UPROPERTY(config, EditAnywhere, Category = "Deploy Content to Pak")
+		TArray<FPakCompressionRule> CompressionRules;
+
+	/**
+	 * Compression of files no rule matches
+	 */
+	UPROPERTY(config, EditAnywhere, Category = "Deploy Content to Pak")
+		EPakCompression DefaultCompression;
+
+	/**
+	 * Size of the parts paks are uploaded in; memory used by an upload is this times Parallel Uploads
+	 */
+	UPROPERTY(config, EditAnywhere, Category = "Deploy Content to Pak", meta = (ClampMin = "1"))
+		int32 UploadChunkMB;
+
+	/**
+	 * Parts of a pak uploaded at once
+	 */
+	UPROPERTY(config, EditAnywhere, Category = "Deploy Content to Pak", meta = (ClampMin = "1"))
+		int32 ParallelUploads;
+
 	UPROPERTY()
 		FString Author;
 
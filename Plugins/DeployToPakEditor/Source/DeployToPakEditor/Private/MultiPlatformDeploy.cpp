@@ -0,0 +1,488 @@
+// Copyright 1998-2016 Epic Games, Inc. All Rights Reserved.
+
+#include "DeployToPakEditorPrivatePCH.h"
+#include "MultiPlatformDeploy.h"
+#include "CookContentActions.h"
+#include "PakChannels.h"
+#include "CookStats.h"
+#include "DeployProfiler.h"
+#include "SNotificationList.h"
+#include "NotificationManager.h"
+#include "EditorStyleSet.h"
+#include "UnrealEd.h"
+#include "UnrealEdMisc.h"
+#include "PlatformInfo.h"
+#include "GameProjectGenerationModule.h"
+#include "AnalyticsEventAttribute.h"
+
+#define LOCTEXT_NAMESPACE "MultiPlatformDeploy"
+
+DEFINE_LOG_CATEGORY_STATIC(MultiPlatformDeploy, Log, All);
+
+TSharedPtr<FMultiPlatformDeploy, ESPMode::ThreadSafe> FMultiPlatformDeploy::Current;
+
+static double GetAvailablePhysicalMB()
+{
+	return FPlatformMemory::GetStats().AvailablePhysical / (1024.0 * 1024.0);
+}
+
+FMultiPlatformDeploy::FMultiPlatformDeploy()
+	: StartTime(FPlatformTime::Seconds())
+	, bProjectHasCode(false)
+	, MaxParallelJobs(0)
+	, bUpload(true)
+{
+}
+
+bool FMultiPlatformDeploy::Start(const TArray<FName>& PlatformInfoNames, int32 MaxParallelJobs, bool bUpload, const FOnFinished& OnFinished)
+{
+	if (Current.IsValid())
+	{
+		UE_LOG(MultiPlatformDeploy, Warning, TEXT("A deploy is already running"));
+		return false;
+	}
+
+	TSharedPtr<FMultiPlatformDeploy, ESPMode::ThreadSafe> Deploy = MakeShareable(new FMultiPlatformDeploy());
+	for (const FName& PlatformInfoName : PlatformInfoNames)
+	{
+		TSharedPtr<FJob> Job = MakeShareable(new FJob());
+		if (PlatformInfoName == FName(TEXT("Editor")))
+		{
+			Job->TargetPlatform = PlatformInfoName.ToString();
+			Job->DisplayName = LOCTEXT("Editor", "Editor (Uncooked)");
+			Job->bCook = false;
+		}
+		else
+		{
+			const PlatformInfo::FPlatformInfo* const PlatformInfo = PlatformInfo::FindPlatformInfo(PlatformInfoName);
+			if (!PlatformInfo)
+			{
+				UE_LOG(MultiPlatformDeploy, Error, TEXT("Unknown deploy platform %s - skipping it"), *PlatformInfoName.ToString());
+				continue;
+			}
+			Job->TargetPlatform = PlatformInfo->TargetPlatformName.ToString();
+			Job->DisplayName = PlatformInfo->DisplayName;
+		}
+		if (Deploy->Jobs.ContainsByPredicate([&Job](const TSharedPtr<FJob>& Other) { return Other->TargetPlatform == Job->TargetPlatform; }))
+		{
+			continue;
+		}
+		Deploy->Jobs.Add(Job);
+	}
+	if (Deploy->Jobs.Num() == 0)
+	{
+		UE_LOG(MultiPlatformDeploy, Error, TEXT("No deploy platforms to cook - add some to Deploy Platforms in the Deploy Content to Pak settings"));
+		return false;
+	}
+
+	FGameProjectGenerationModule& GameProjectModule = FModuleManager::LoadModuleChecked<FGameProjectGenerationModule>(TEXT("GameProjectGeneration"));
+	Deploy->bProjectHasCode = GameProjectModule.Get().ProjectHasCodeFiles();
+	Deploy->MaxParallelJobs = MaxParallelJobs;
+	Deploy->bUpload = bUpload;
+	Deploy->OnFinished = OnFinished;
+
+	if (!IsRunningCommandlet())
+	{
+		FNotificationInfo Info(LOCTEXT("DeployStarting", "Deploying content..."));
+		Info.Image = FEditorStyle::GetBrush(TEXT("MainFrame.CookContent"));
+		Info.bFireAndForget = false;
+		Info.ExpireDuration = 10.0f;
+		Info.Hyperlink = FSimpleDelegate::CreateStatic(&FMultiPlatformDeploy::HandleHyperlinkNavigate);
+		Info.HyperlinkText = LOCTEXT("ShowOutputLogHyperlink", "Show Output Log");
+		Info.ButtonDetails.Add(
+			FNotificationButtonInfo(
+				LOCTEXT("DeployCancel", "Cancel"),
+				LOCTEXT("DeployCancelToolTip", "Cancels cooking, paking and uploading for all platforms."),
+				FSimpleDelegate::CreateThreadSafeSP(Deploy.ToSharedRef(), &FMultiPlatformDeploy::Cancel)
+			)
+		);
+		Deploy->NotificationItem = FSlateNotificationManager::Get().AddNotification(Info);
+		if (Deploy->NotificationItem.IsValid())
+		{
+			Deploy->NotificationItem->SetCompletionState(SNotificationItem::CS_Pending);
+		}
+		GEditor->PlayEditorSound(TEXT("/Engine/EditorSounds/Notifications/CompileStart_Cue.CompileStart_Cue"));
+	}
+
+	UE_LOG(MultiPlatformDeploy, Log, TEXT("Deploying %d platforms, %d jobs at a time"), Deploy->Jobs.Num(), Deploy->GetMaxParallelJobs());
+	for (const TSharedPtr<FJob>& Job : Deploy->Jobs)
+	{
+		FEditorAnalytics::ReportEvent(TEXT("Editor.Deploy.Start"), Job->DisplayName.ToString(), Deploy->bProjectHasCode);
+	}
+
+	Deploy->ShutdownHandle = FEditorDelegates::OnShutdownPostPackagesSaved.AddThreadSafeSP(Deploy.ToSharedRef(), &FMultiPlatformDeploy::Cancel);
+	Deploy->TickHandle = FTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateThreadSafeSP(Deploy.ToSharedRef(), &FMultiPlatformDeploy::Tick), 0.25f);
+	Current = Deploy;
+	Deploy->Tick(0);
+	return true;
+}
+
+int32 FMultiPlatformDeploy::GetMaxParallelJobs() const
+{
+	int32 MaxJobs = MaxParallelJobs > 0 ? MaxParallelJobs : FDeployToPakEditorModule::Get().GetMaxParallelJobs();
+	if (MaxJobs > 0)
+	{
+		return MaxJobs;
+	}
+	// Cooks are multithreaded themselves, so leave each a couple of cores; memory usually runs out first
+	MaxJobs = FPlatformMisc::NumberOfCores() / 2;
+	const int32 MemoryPerCookMB = FDeployToPakEditorModule::Get().GetMemoryPerCookMB();
+	if (MemoryPerCookMB > 0)
+	{
+		MaxJobs = FMath::Min(MaxJobs, (int32)(FPlatformMemory::GetStats().TotalPhysical / (1024 * 1024) / MemoryPerCookMB));
+	}
+	return FMath::Max(MaxJobs, 1);
+}
+
+bool FMultiPlatformDeploy::Tick(float DeltaTime)
+{
+	const double Now = FPlatformTime::Seconds();
+	bool bChanged = false;
+
+	for (const TSharedPtr<FJob>& Job : Jobs)
+	{
+		if (!Job->Process.IsValid() || !Job->bProcessFinished)
+		{
+			continue;
+		}
+		Job->Process.Reset();
+		bChanged = true;
+		const bool bSucceeded = Job->ReturnCode == 0 && !bCanceling;
+		if (Job->Stage == EStage::Cooking)
+		{
+			Job->CookSeconds = Now - Job->StageStartTime;
+			FCookStats::End(Job->TargetPlatform, bSucceeded);
+			FDeployProfiler::EndCook(Job->TargetPlatform, bSucceeded);
+			if (bSucceeded && FCookContentActionCallbacks::CreatePakPlaceholder(Job->TargetPlatform))
+			{
+				UE_LOG(MultiPlatformDeploy, Log, TEXT("Cooked %s in %.1fs"), *Job->TargetPlatform, Job->CookSeconds);
+				Job->Stage = EStage::WaitingToPak;
+			}
+			else
+			{
+				Job->Stage = bCanceling ? EStage::Canceled : EStage::Failed;
+			}
+		}
+		else if (Job->Stage == EStage::Paking)
+		{
+			Job->PakSeconds = Now - Job->StageStartTime;
+			TArray<FString> PakFilenames;
+			FPakChannels::GetPaksToDeploy(FCookContentActionCallbacks::GetPakFilename(Job->TargetPlatform), PakFilenames);
+			FDeployProfiler::EndPak(Job->TargetPlatform, bSucceeded, PakFilenames);
+			if (bSucceeded)
+			{
+				UE_LOG(MultiPlatformDeploy, Log, TEXT("Paked %s in %.1fs"), *Job->TargetPlatform, Job->PakSeconds);
+				Job->Stage = EStage::Done;
+				if (bUpload && FDeployToPakEditorModule::Get().GetPakFileUploadURL().Len() > 0)
+				{
+					const int32 JobIndex = Jobs.IndexOfByKey(Job);
+					Job->Stage = EStage::Uploading;
+					Job->StageStartTime = Now;
+					if (!FCookContentActionCallbacks::UploadPak(Job->TargetPlatform, Job->DisplayName, FOnPakUploaded::CreateThreadSafeSP(AsShared(), &FMultiPlatformDeploy::HandleUploadFinished, JobIndex)))
+					{
+						Job->Stage = EStage::Failed;
+					}
+				}
+				else
+				{
+					FPakChannels::Commit(FCookContentActionCallbacks::GetPakFilename(Job->TargetPlatform));
+					FDeployProfiler::Finish(Job->TargetPlatform, Job->DisplayName);
+				}
+			}
+			else
+			{
+				Job->Stage = bCanceling ? EStage::Canceled : EStage::Failed;
+			}
+		}
+		if (Job->Stage == EStage::Failed)
+		{
+			UE_LOG(MultiPlatformDeploy, Error, TEXT("Deploying %s failed with code %d"), *Job->TargetPlatform, Job->ReturnCode);
+		}
+	}
+
+	int32 Running = 0;
+	int32 Uploading = 0;
+	for (const TSharedPtr<FJob>& Job : Jobs)
+	{
+		if (bCanceling && (Job->Stage == EStage::Waiting || Job->Stage == EStage::WaitingToPak))
+		{
+			Job->Stage = EStage::Canceled;
+			bChanged = true;
+		}
+		if (Job->Stage == EStage::Cooking || Job->Stage == EStage::PreparingPak || Job->Stage == EStage::Paking)
+		{
+			Running++;
+		}
+		Uploading += Job->Stage == EStage::Uploading ? 1 : 0;
+	}
+
+	// Pak what has been cooked before cooking more: paks are quick and each one finishes a platform
+	const int32 MaxJobs = GetMaxParallelJobs();
+	for (int32 i = 0; i < Jobs.Num() && Running < MaxJobs; i++)
+	{
+		if (Jobs[i]->Stage == EStage::WaitingToPak || (Jobs[i]->Stage == EStage::Waiting && !Jobs[i]->bCook))
+		{
+			StartPak(*Jobs[i]);
+			Running++;
+			bChanged = true;
+		}
+	}
+
+	// A cook takes a while to grow to its full size, so count the ones started this tick against free memory
+	const int32 MemoryPerCookMB = FDeployToPakEditorModule::Get().GetMemoryPerCookMB();
+	double FreeMB = GetAvailablePhysicalMB();
+	for (int32 i = 0; i < Jobs.Num() && Running < MaxJobs; i++)
+	{
+		if (Jobs[i]->Stage != EStage::Waiting || !Jobs[i]->bCook)
+		{
+			continue;
+		}
+		if (Running > 0 && FreeMB < MemoryPerCookMB)
+		{
+			UE_LOG(MultiPlatformDeploy, Verbose, TEXT("Waiting for memory to cook %s (%.0f MB free)"), *Jobs[i]->TargetPlatform, FreeMB);
+			break;
+		}
+		StartCook(*Jobs[i]);
+		Running++;
+		FreeMB -= MemoryPerCookMB;
+		bChanged = true;
+	}
+
+	if (Running == 0 && Uploading == 0)
+	{
+		Finish();
+		return false;
+	}
+	// Refresh the elapsed times about once a second
+	if (bChanged || FMath::FloorToInt(Now) != FMath::FloorToInt(Now - DeltaTime))
+	{
+		UpdateNotification();
+	}
+	return true;
+}
+
+void FMultiPlatformDeploy::StartCook(FJob& Job)
+{
+	const FString CommandLine = FCookContentActionCallbacks::GetCookCommandLine(Job.TargetPlatform);
+	UE_LOG(MultiPlatformDeploy, Log, TEXT("Cooking %s: %s"), *Job.TargetPlatform, *CommandLine);
+	FCookStats::Begin(Job.TargetPlatform, FDeployToPakEditorModule::Get().GetCookDependenciesOnly());
+	FDeployProfiler::BeginCook(Job.TargetPlatform);
+	LaunchProcess(Job, EStage::Cooking, FUnrealEdMisc::Get().GetExecutableForCommandlets(), CommandLine);
+}
+
+void FMultiPlatformDeploy::StartPak(FJob& Job)
+{
+	if (!Job.bCook && !FCookContentActionCallbacks::CreatePakPlaceholder(Job.TargetPlatform))
+	{
+		Job.Stage = EStage::Failed;
+		return;
+	}
+	const int32 JobIndex = Jobs.IndexOfByPredicate([&Job](const TSharedPtr<FJob>& Other) { return Other.Get() == &Job; });
+	Job.Stage = EStage::PreparingPak;
+	Job.StageStartTime = FPlatformTime::Seconds();
+	FDeployProfiler::BeginPak(Job.TargetPlatform);
+	FCookContentActionCallbacks::GetPakCommandLine(Job.TargetPlatform, FOnPakCommandLine::CreateThreadSafeSP(AsShared(), &FMultiPlatformDeploy::HandlePakCommandLine, JobIndex));
+}
+
+void FMultiPlatformDeploy::LaunchProcess(FJob& Job, EStage Stage, const FString& Executable, const FString& CommandLine)
+{
+	const int32 JobIndex = Jobs.IndexOfByPredicate([&Job](const TSharedPtr<FJob>& Other) { return Other.Get() == &Job; });
+	Job.Stage = Stage;
+	Job.StageStartTime = FPlatformTime::Seconds();
+	Job.ReturnCode = 0;
+	Job.bProcessFinished = false;
+	Job.Process = MakeShareable(new FMonitoredProcess(Executable, CommandLine, true));
+	Job.Process->OnCompleted().BindThreadSafeSP(AsShared(), &FMultiPlatformDeploy::HandleProcessCompleted, JobIndex);
+	Job.Process->OnCanceled().BindThreadSafeSP(AsShared(), &FMultiPlatformDeploy::HandleProcessCanceled, JobIndex);
+	Job.Process->OnOutput().BindThreadSafeSP(AsShared(), &FMultiPlatformDeploy::HandleProcessOutput, JobIndex);
+	if (!Job.Process->Launch())
+	{
+		UE_LOG(MultiPlatformDeploy, Error, TEXT("Failed to launch %s for %s"), *Executable, *Job.TargetPlatform);
+		Job.Process.Reset();
+		Job.Stage = EStage::Failed;
+	}
+}
+
+void FMultiPlatformDeploy::UpdateNotification()
+{
+	if (!NotificationItem.IsValid())
+	{
+		return;
+	}
+	const double Now = FPlatformTime::Seconds();
+	FString Text = TEXT("Deploying content:");
+	for (const TSharedPtr<FJob>& Job : Jobs)
+	{
+		FString State;
+		switch (Job->Stage)
+		{
+		case EStage::Waiting:		State = TEXT("waiting"); break;
+		case EStage::Cooking:		State = FString::Printf(TEXT("cooking (%.0fs)"), Now - Job->StageStartTime); break;
+		case EStage::WaitingToPak:	State = TEXT("cooked, waiting to pak"); break;
+		case EStage::PreparingPak:	State = FString::Printf(TEXT("preparing to pak (%.0fs)"), Now - Job->StageStartTime); break;
+		case EStage::Paking:		State = FString::Printf(TEXT("paking (%.0fs)"), Now - Job->StageStartTime); break;
+		case EStage::Uploading:		State = FString::Printf(TEXT("uploading (%.0fs)"), Now - Job->StageStartTime); break;
+		case EStage::Done:			State = TEXT("done"); break;
+		case EStage::Failed:		State = TEXT("failed"); break;
+		case EStage::Canceled:		State = TEXT("canceled"); break;
+		}
+		Text += FString::Printf(TEXT("\n%s: %s"), *Job->DisplayName.ToString(), *State);
+	}
+	NotificationItem->SetText(FText::FromString(Text));
+}
+
+void FMultiPlatformDeploy::Finish()
+{
+	FTicker::GetCoreTicker().RemoveTicker(TickHandle);
+	FEditorDelegates::OnShutdownPostPackagesSaved.Remove(ShutdownHandle);
+
+	int32 Succeeded = 0;
+	FString Summary;
+	TArray<FPlatformResult> Results;
+	UE_LOG(MultiPlatformDeploy, Log, TEXT("Deploy finished in %.1fs:"), FPlatformTime::Seconds() - StartTime);
+	for (const TSharedPtr<FJob>& Job : Jobs)
+	{
+		const bool bDone = Job->Stage == EStage::Done;
+		Succeeded += bDone ? 1 : 0;
+		const TCHAR* Result = bDone ? TEXT("done") : Job->Stage == EStage::Canceled ? TEXT("canceled") : TEXT("failed");
+		UE_LOG(MultiPlatformDeploy, Log, TEXT("  %-24s %-8s cook %7.1fs  pak %7.1fs  upload %7.1fs"), *Job->TargetPlatform, Result, Job->CookSeconds, Job->PakSeconds, Job->UploadSeconds);
+		Summary += FString::Printf(TEXT("\n%s: %s, cook %.0fs, pak %.0fs"), *Job->DisplayName.ToString(), Result, Job->CookSeconds, Job->PakSeconds);
+		Summary += Job->UploadSeconds > 0 ? FString::Printf(TEXT(", upload %.0fs"), Job->UploadSeconds) : FString();
+
+		FPlatformResult& PlatformResult = Results[Results.AddDefaulted()];
+		PlatformResult.TargetPlatform = Job->TargetPlatform;
+		PlatformResult.Result = Result;
+		PlatformResult.ReturnCode = Job->ReturnCode;
+		PlatformResult.CookSeconds = Job->CookSeconds;
+		PlatformResult.PakSeconds = Job->PakSeconds;
+		PlatformResult.UploadSeconds = Job->UploadSeconds;
+
+		TArray<FAnalyticsEventAttribute> ParamArray;
+		ParamArray.Add(FAnalyticsEventAttribute(TEXT("CookTime"), Job->CookSeconds));
+		ParamArray.Add(FAnalyticsEventAttribute(TEXT("PakTime"), Job->PakSeconds));
+		ParamArray.Add(FAnalyticsEventAttribute(TEXT("UploadTime"), Job->UploadSeconds));
+		FEditorAnalytics::ReportEvent(FString(TEXT("Editor.Deploy.")) + (bDone ? TEXT("Completed") : Job->Stage == EStage::Canceled ? TEXT("Canceled") : TEXT("Failed")),
+			Job->DisplayName.ToString(), bProjectHasCode, ParamArray);
+	}
+
+	if (NotificationItem.IsValid())
+	{
+		FFormatNamedArguments Arguments;
+		Arguments.Add(TEXT("Succeeded"), Succeeded);
+		Arguments.Add(TEXT("Total"), Jobs.Num());
+		Arguments.Add(TEXT("Summary"), FText::FromString(Summary));
+		NotificationItem->SetText(FText::Format(LOCTEXT("DeployFinished", "Deployed {Succeeded} of {Total} platforms{Summary}"), Arguments));
+		NotificationItem->SetCompletionState(Succeeded == Jobs.Num() ? SNotificationItem::CS_Success : SNotificationItem::CS_Fail);
+		NotificationItem->ExpireAndFadeout();
+	}
+	if (!IsRunningCommandlet())
+	{
+		GEditor->PlayEditorSound(Succeeded == Jobs.Num()
+			? TEXT("/Engine/EditorSounds/Notifications/CompileSuccess_Cue.CompileSuccess_Cue")
+			: TEXT("/Engine/EditorSounds/Notifications/CompileFailed_Cue.CompileFailed_Cue"));
+		if (Succeeded > 0 && (!bUpload || FDeployToPakEditorModule::Get().GetPakFileUploadURL().Len() == 0))
+		{
+			FPlatformProcess::ExploreFolder(*FPaths::ConvertRelativePathToFull(FPaths::GameSavedDir() / "Cooked"));
+		}
+	}
+
+	// May release the last reference to this
+	const FOnFinished FinishedDelegate = OnFinished;
+	Current.Reset();
+	FinishedDelegate.ExecuteIfBound(Results);
+}
+
+void FMultiPlatformDeploy::Cancel()
+{
+	bCanceling = true;
+	for (const TSharedPtr<FJob>& Job : Jobs)
+	{
+		TSharedPtr<FMonitoredProcess> Process = Job->Process;
+		if (Process.IsValid())
+		{
+			Process->Cancel(true);
+		}
+		if (Job->Stage == EStage::Uploading)
+		{
+			FPakUploader::CancelUploads(Job->TargetPlatform);
+		}
+	}
+}
+
+void FMultiPlatformDeploy::HandleProcessCompleted(int32 ReturnCode, int32 JobIndex)
+{
+	// Hashing the new paks for the manifest takes a while, so do it here on the process thread rather than in Tick
+	if (ReturnCode == 0 && Jobs[JobIndex]->Stage == EStage::Paking && !FPakChannels::Finalize(FCookContentActionCallbacks::GetPakFilename(Jobs[JobIndex]->TargetPlatform)))
+	{
+		ReturnCode = 1;
+	}
+	Jobs[JobIndex]->ReturnCode = ReturnCode;
+	Jobs[JobIndex]->bProcessFinished = true;
+}
+
+void FMultiPlatformDeploy::HandleProcessCanceled(int32 JobIndex)
+{
+	Jobs[JobIndex]->ReturnCode = -1;
+	Jobs[JobIndex]->bProcessFinished = true;
+}
+
+void FMultiPlatformDeploy::HandleProcessOutput(FString Output, int32 JobIndex)
+{
+	if (!Output.IsEmpty() && !Output.Equals("\r"))
+	{
+		UE_LOG(MultiPlatformDeploy, Log, TEXT("%s: %s"), *Jobs[JobIndex]->TargetPlatform, *Output);
+		FCookStats::HandleOutput(Jobs[JobIndex]->TargetPlatform, Output);
+		FDeployProfiler::HandleCookOutput(Jobs[JobIndex]->TargetPlatform, Output);
+	}
+}
+
+void FMultiPlatformDeploy::HandlePakCommandLine(EPakPrepareResult Result, const FString& Executable, const FString& CommandLine, int32 JobIndex)
+{
+	FJob& Job = *Jobs[JobIndex];
+	if (bCanceling || Result == EPakPrepareResult::Failed)
+	{
+		FDeployProfiler::EndPak(Job.TargetPlatform, false, TArray<FString>());
+		Job.PakSeconds = FPlatformTime::Seconds() - Job.StageStartTime;
+		Job.Stage = bCanceling ? EStage::Canceled : EStage::Failed;
+		if (!bCanceling)
+		{
+			UE_LOG(MultiPlatformDeploy, Error, TEXT("Preparing the paks of %s failed"), *Job.TargetPlatform);
+		}
+		return;
+	}
+	if (Result == EPakPrepareResult::Nothing)
+	{
+		UE_LOG(MultiPlatformDeploy, Log, TEXT("Nothing to pak for %s"), *Job.TargetPlatform);
+		FDeployProfiler::Finish(Job.TargetPlatform, Job.DisplayName);
+		Job.Stage = EStage::Done;
+		return;
+	}
+	UE_LOG(MultiPlatformDeploy, Log, TEXT("Paking %s: %s"), *Job.TargetPlatform, *CommandLine);
+	// The pak time includes working out what to pak
+	const double PakStartTime = Job.StageStartTime;
+	LaunchProcess(Job, EStage::Paking, Executable, CommandLine);
+	Job.StageStartTime = PakStartTime;
+}
+
+void FMultiPlatformDeploy::HandleUploadFinished(bool bSucceeded, int64 SentBytes, int32 JobIndex)
+{
+	FJob& Job = *Jobs[JobIndex];
+	Job.UploadSeconds = FPlatformTime::Seconds() - Job.StageStartTime;
+	Job.Stage = bSucceeded ? EStage::Done : bCanceling ? EStage::Canceled : EStage::Failed;
+	if (bSucceeded)
+	{
+		UE_LOG(MultiPlatformDeploy, Log, TEXT("Uploaded %s in %.1fs, %lld bytes sent"), *Job.TargetPlatform, Job.UploadSeconds, SentBytes);
+	}
+	else if (!bCanceling)
+	{
+		UE_LOG(MultiPlatformDeploy, Error, TEXT("Uploading %s failed"), *Job.TargetPlatform);
+	}
+}
+
+void FMultiPlatformDeploy::HandleHyperlinkNavigate()
+{
+	FGlobalTabmanager::Get()->InvokeTab(FName("OutputLog"));
+}
+
+
+#undef LOCTEXT_NAMESPACE
@@ -0,0 +1,123 @@
+// Copyright 1998-2016 Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "Engine.h"
+#include "PakManifest.h"
+
+class FMonitoredProcess;
+class SNotificationItem;
+
+/**
+ * Cooks and paks content for several platforms at once. Each platform gets a cook job followed by a pak job;
+ * jobs run as separate processes, at most MaxParallelJobs of them together (by default as many as the cores
+ * and physical memory allow), and a new cook only starts while MemoryPerCookMB is free. Finished cooks are
+ * paked before further cooks start, so the first platforms are ready early. Paks are uploaded as soon as they are
+ * made, while other platforms cook; uploads don't count against MaxParallelJobs, but the deploy lasts until they
+ * end. Progress of every platform shows in a single notification and the cook, pak and upload time of each
+ * platform is logged when all are done. In a commandlet there is no notification, sound or folder to show.
+ */
+class FMultiPlatformDeploy : public TSharedFromThis<FMultiPlatformDeploy, ESPMode::ThreadSafe>
+{
+public:
+	/** How the deploy of a platform went */
+	struct FPlatformResult
+	{
+		FString TargetPlatform;
+		/** "done", "failed" or "canceled" */
+		FString Result;
+		/** Exit code of the process that failed */
+		int32 ReturnCode;
+		double CookSeconds;
+		double PakSeconds;
+		double UploadSeconds;
+
+		FPlatformResult() : ReturnCode(0), CookSeconds(0), PakSeconds(0), UploadSeconds(0) {}
+	};
+
+	DECLARE_DELEGATE_OneParam(FOnFinished, const TArray<FPlatformResult>& /*Results*/);
+
+	/**
+	 * Starts deploying the given platforms; returns false if a deploy is already running or no platform is known.
+	 *
+	 * @param MaxParallelJobs - Overrides the Max Parallel Jobs setting if above 0.
+	 * @param bUpload - False to leave the paks on disk even if an upload URL is set.
+	 * @param OnFinished - Called once every platform is done, failed or canceled, unless Start returns false.
+	 */
+	static bool Start(const TArray<FName>& PlatformInfoNames, int32 MaxParallelJobs = 0, bool bUpload = true, const FOnFinished& OnFinished = FOnFinished());
+
+	static bool IsRunning()
+	{
+		return Current.IsValid();
+	}
+
+private:
+	enum class EStage
+	{
+		Waiting,
+		Cooking,
+		WaitingToPak,
+		/** Working out what to pak on a worker, see FCookContentActionCallbacks::GetPakCommandLine */
+		PreparingPak,
+		Paking,
+		Uploading,
+		Done,
+		Failed,
+		Canceled,
+	};
+
+	struct FJob
+	{
+		FString TargetPlatform;
+		FText DisplayName;
+		/** False for the uncooked Editor content, which is paked as is */
+		bool bCook;
+		EStage Stage;
+		TSharedPtr<FMonitoredProcess> Process;
+		/** Set by the process callbacks, which run on the process monitoring thread */
+		FThreadSafeBool bProcessFinished;
+		int32 ReturnCode;
+		double StageStartTime;
+		double CookSeconds;
+		double PakSeconds;
+		double UploadSeconds;
+
+		FJob() : bCook(true), Stage(EStage::Waiting), ReturnCode(0), StageStartTime(0), CookSeconds(0), PakSeconds(0), UploadSeconds(0) {}
+	};
+
+	FMultiPlatformDeploy();
+
+	/** Number of jobs allowed to run together */
+	int32 GetMaxParallelJobs() const;
+
+	bool Tick(float DeltaTime);
+	void StartCook(FJob& Job);
+	void StartPak(FJob& Job);
+	/** Launches Job's process, moving it to Stage; fails the job if the process can't be launched */
+	void LaunchProcess(FJob& Job, EStage Stage, const FString& Executable, const FString& CommandLine);
+	void UpdateNotification();
+	void Finish();
+	void Cancel();
+
+	void HandleProcessCompleted(int32 ReturnCode, int32 JobIndex);
+	void HandleProcessCanceled(int32 JobIndex);
+	void HandleProcessOutput(FString Output, int32 JobIndex);
+	void HandlePakCommandLine(EPakPrepareResult Result, const FString& Executable, const FString& CommandLine, int32 JobIndex);
+	void HandleUploadFinished(bool bSucceeded, int64 SentBytes, int32 JobIndex);
+	static void HandleHyperlinkNavigate();
+
+	TArray<TSharedPtr<FJob>> Jobs;
+	TSharedPtr<SNotificationItem> NotificationItem;
+	FDelegateHandle TickHandle;
+	FDelegateHandle ShutdownHandle;
+	FThreadSafeBool bCanceling;
+	double StartTime;
+	bool bProjectHasCode;
+	/** Set by Start */
+	int32 MaxParallelJobs;
+	bool bUpload;
+	FOnFinished OnFinished;
+
+	/** The deploy in progress; only one runs at a time */
+	static TSharedPtr<FMultiPlatformDeploy, ESPMode::ThreadSafe> Current;
+};
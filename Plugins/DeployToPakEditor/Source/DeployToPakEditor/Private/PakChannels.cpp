@@ -0,0 +1,292 @@
+// Copyright 1998-2016 Epic Games, Inc. All Rights Reserved.
+
+#include "DeployToPakEditorPrivatePCH.h"
+#include "PakChannels.h"
+#include "PakContents.h"
+#include "PakManifest.h"
+#include "Json.h"
+
+DEFINE_LOG_CATEGORY_STATIC(PakChannels, Log, All);
+
+/** Channel of a deploy that isn't split into channels */
+static const TCHAR* ContentChannel = TEXT("Content");
+
+FPakChannels::FPlanSettings::FPlanSettings()
+{
+	FDeployToPakEditorModule& Module = FDeployToPakEditorModule::Get();
+	bDependenciesOnly = Module.GetPakDependenciesOnly();
+	bPerChannel = Module.GetPakPerChannel();
+	MaxPakBytes = (int64)Module.GetMaxPakSizeMB() * 1024 * 1024;
+	if (bDependenciesOnly && bPerChannel)
+	{
+		FPakContents::GetChannelPackages(ChannelPackages);
+	}
+	else if (bDependenciesOnly)
+	{
+		FPakContents::GetPackages(AllPackages.Packages, &AllPackages.Reasons);
+	}
+}
+
+void FPakChannels::Plan(const FPlanSettings& Settings, const FString& ContentFolder, const FString& FullPakFilename, TArray<FPak>& OutPaks)
+{
+	OutPaks.Reset();
+	const FString Folder = FPaths::GetPath(FullPakFilename);
+	const FString BaseName = FPaths::GetBaseFilename(FullPakFilename);
+	const FString ReportFilename = Folder / BaseName + TEXT("-Contents.txt");
+	// Keeps the Content folder as the mount point of every pak, see FCookContentActionCallbacks::CreatePakPlaceholder
+	const FString Placeholder = ContentFolder / TEXT("unrealpakPlaceholder");
+	const bool bHavePlaceholder = FPaths::FileExists(Placeholder);
+
+	TArray<FPakContents::FChannel> Channels;
+	if (!Settings.bDependenciesOnly || !Settings.bPerChannel || !FPakContents::GatherChannels(Settings.ChannelPackages, ContentFolder, ReportFilename, Channels))
+	{
+		FPak& Pak = OutPaks[OutPaks.AddDefaulted()];
+		Pak.Channel = ContentChannel;
+		Pak.FullPakFilename = FullPakFilename;
+		if (!Settings.bDependenciesOnly || !FPakContents::Gather(Settings.AllPackages, ContentFolder, ReportFilename, Pak.Filenames))
+		{
+			IFileManager::Get().FindFilesRecursive(Pak.Filenames, *ContentFolder, TEXT("*"), true, false);
+		}
+		return;
+	}
+
+	const int64 MaxPakBytes = Settings.MaxPakBytes;
+	for (const FPakContents::FChannel& Channel : Channels)
+	{
+		if (Channel.PackageFiles.Num() == 0)
+		{
+			OutPaks[OutPaks.AddDefaulted()].Channel = Channel.Name;
+			continue;
+		}
+		int32 Part = 0;
+		int64 PakBytes = 0;
+		for (const TArray<FString>& Files : Channel.PackageFiles)
+		{
+			int64 PackageBytes = 0;
+			for (const FString& Filename : Files)
+			{
+				PackageBytes += IFileManager::Get().FileSize(*Filename);
+			}
+			// A package never spans paks, so one larger than the limit gets a pak of its own
+			if (Part == 0 || (MaxPakBytes > 0 && PakBytes > 0 && PakBytes + PackageBytes > MaxPakBytes))
+			{
+				Part++;
+				PakBytes = 0;
+				FPak& Pak = OutPaks[OutPaks.AddDefaulted()];
+				Pak.Channel = Channel.Name;
+				Pak.FullPakFilename = Folder / BaseName + TEXT("-") + Channel.Name + (Part > 1 ? FString::Printf(TEXT("-%d"), Part) : FString()) + TEXT(".pak");
+				if (bHavePlaceholder)
+				{
+					Pak.Filenames.Add(Placeholder);
+				}
+			}
+			OutPaks.Last().Filenames.Append(Files);
+			PakBytes += PackageBytes;
+		}
+		if (Part > 1)
+		{
+			UE_LOG(PakChannels, Log, TEXT("Channel %s (%lld bytes) is split over %d paks"), *Channel.Name, Channel.Bytes, Part);
+		}
+	}
+}
+
+bool FPakChannels::WriteManifest(const FString& FullPakFilename, const TArray<FPak>& Paks)
+{
+	// Paks this deploy doesn't touch keep the size and hash they were listed with last time
+	TMap<FString, TSharedPtr<FJsonObject>> LastItems;
+	TSharedPtr<FJsonObject> LastManifest = LoadManifest(FullPakFilename);
+	const TArray<TSharedPtr<FJsonValue>>* LastItemValues = nullptr;
+	if (LastManifest.IsValid() && LastManifest->TryGetArrayField(TEXT("items"), LastItemValues))
+	{
+		for (const TSharedPtr<FJsonValue>& Value : *LastItemValues)
+		{
+			const TSharedPtr<FJsonObject>* Item = nullptr;
+			FString URL;
+			if (Value->TryGetObject(Item) && (*Item)->TryGetStringField(TEXT("url"), URL))
+			{
+				LastItems.Add(URL, *Item);
+			}
+		}
+	}
+
+	const bool bHaveCommon = Paks.ContainsByPredicate([](const FPak& Pak) { return Pak.Channel == FPakContents::CommonChannel; });
+	TArray<TSharedPtr<FJsonValue>> Items;
+	TArray<TSharedPtr<FJsonValue>> Channels;
+	for (int32 Index = 0; Index < Paks.Num(); Index++)
+	{
+		const FPak& Pak = Paks[Index];
+		TSharedPtr<FJsonObject> Channel;
+		if (Index == 0 || Paks[Index - 1].Channel != Pak.Channel)
+		{
+			Channel = MakeShareable(new FJsonObject());
+			Channel->SetStringField(TEXT("name"), Pak.Channel);
+			if (bHaveCommon && Pak.Channel != FPakContents::CommonChannel)
+			{
+				TArray<TSharedPtr<FJsonValue>> Requires;
+				Requires.Add(MakeShareable(new FJsonValueString(FPakContents::CommonChannel)));
+				Channel->SetArrayField(TEXT("requires"), Requires);
+			}
+			Channel->SetArrayField(TEXT("paks"), TArray<TSharedPtr<FJsonValue>>());
+			Channels.Add(MakeShareable(new FJsonValueObject(Channel)));
+		}
+		else
+		{
+			Channel = Channels.Last()->AsObject();
+		}
+
+		if (Pak.FullPakFilename.IsEmpty())
+		{
+			continue;
+		}
+		TArray<TSharedPtr<FJsonValue>> ChannelPaks = Channel->GetArrayField(TEXT("paks"));
+		TArray<FString> PakFilenames;
+		FPakManifest::GetPaks(Pak.FullPakFilename, PakFilenames);
+		const FString PakToMake = FPakManifest::IsPending(Pak.FullPakFilename) ? FPakManifest::GetPakToDeploy(Pak.FullPakFilename) : FString();
+		for (const FString& PakFilename : PakFilenames)
+		{
+			const FString Name = FPaths::GetCleanFilename(PakFilename);
+			ChannelPaks.Add(MakeShareable(new FJsonValueString(Name)));
+			TSharedPtr<FJsonObject> Item = MakeShareable(new FJsonObject());
+			Item->SetStringField(TEXT("url"), Name);
+			const TSharedPtr<FJsonObject>* LastItem = LastItems.Find(Name);
+			const int64 Size = IFileManager::Get().FileSize(*PakFilename);
+			if (PakFilename == PakToMake)
+			{
+				// Filled in by Finalize once UnrealPak made it
+			}
+			else if (LastItem != nullptr && (int64)(*LastItem)->GetNumberField(TEXT("size")) == Size)
+			{
+				Item->SetNumberField(TEXT("size"), (double)Size);
+				Item->SetStringField(TEXT("sha1"), (*LastItem)->GetStringField(TEXT("sha1")));
+			}
+			else if (Size > 0)
+			{
+				Item->SetNumberField(TEXT("size"), (double)Size);
+				Item->SetStringField(TEXT("sha1"), FPakManifest::HashFile(PakFilename));
+			}
+			else
+			{
+				UE_LOG(PakChannels, Error, TEXT("%s is missing; clients of channel %s won't be able to mount it"), *PakFilename, *Pak.Channel);
+			}
+			Items.Add(MakeShareable(new FJsonValueObject(Item)));
+		}
+		Channel->SetArrayField(TEXT("paks"), ChannelPaks);
+	}
+
+	TSharedRef<FJsonObject> Manifest = MakeShareable(new FJsonObject());
+	Manifest->SetArrayField(TEXT("items"), Items);
+	Manifest->SetArrayField(TEXT("channels"), Channels);
+	UE_LOG(PakChannels, Log, TEXT("%s: %d paks in %d channels"), *FPaths::GetCleanFilename(GetManifestFilename(FullPakFilename)), Items.Num(), Channels.Num());
+	return SaveManifest(FullPakFilename, Manifest);
+}
+
+bool FPakChannels::Finalize(const FString& FullPakFilename)
+{
+	TSharedPtr<FJsonObject> Manifest = LoadManifest(FullPakFilename);
+	const TArray<TSharedPtr<FJsonValue>>* Items = nullptr;
+	if (!Manifest.IsValid() || !Manifest->TryGetArrayField(TEXT("items"), Items))
+	{
+		UE_LOG(PakChannels, Error, TEXT("Can't read %s"), *GetManifestFilename(FullPakFilename));
+		return false;
+	}
+	const FString Folder = FPaths::GetPath(FullPakFilename);
+	for (const TSharedPtr<FJsonValue>& Value : *Items)
+	{
+		TSharedPtr<FJsonObject> Item = Value->AsObject();
+		if (!Item.IsValid() || Item->HasField(TEXT("sha1")))
+		{
+			continue;
+		}
+		const FString PakFilename = Folder / Item->GetStringField(TEXT("url"));
+		const FString Hash = FPakManifest::HashFile(PakFilename);
+		if (Hash.IsEmpty())
+		{
+			UE_LOG(PakChannels, Error, TEXT("UnrealPak didn't make %s"), *PakFilename);
+			return false;
+		}
+		Item->SetNumberField(TEXT("size"), (double)IFileManager::Get().FileSize(*PakFilename));
+		Item->SetStringField(TEXT("sha1"), Hash);
+	}
+	return SaveManifest(FullPakFilename, Manifest.ToSharedRef());
+}
+
+void FPakChannels::GetPaksToDeploy(const FString& FullPakFilename, TArray<FString>& OutPakFilenames)
+{
+	OutPakFilenames.Reset();
+	TArray<FString> FullPaks;
+	GetFullPaks(FullPakFilename, FullPaks);
+	for (const FString& FullPak : FullPaks)
+	{
+		if (FPakManifest::IsPending(FullPak))
+		{
+			OutPakFilenames.Add(FPakManifest::GetPakToDeploy(FullPak));
+		}
+	}
+}
+
+void FPakChannels::GetFilesToDeploy(const FString& FullPakFilename, TArray<FString>& OutFilenames)
+{
+	GetPaksToDeploy(FullPakFilename, OutFilenames);
+	OutFilenames.Add(GetManifestFilename(FullPakFilename));
+}
+
+void FPakChannels::Commit(const FString& FullPakFilename)
+{
+	TArray<FString> FullPaks;
+	GetFullPaks(FullPakFilename, FullPaks);
+	for (const FString& FullPak : FullPaks)
+	{
+		FPakManifest::Commit(FullPak);
+	}
+}
+
+FString FPakChannels::GetManifestFilename(const FString& FullPakFilename)
+{
+	return FPaths::GetPath(FullPakFilename) / FPaths::GetBaseFilename(FullPakFilename) + TEXT(".json");
+}
+
+void FPakChannels::GetFullPaks(const FString& FullPakFilename, TArray<FString>& OutPakFilenames)
+{
+	OutPakFilenames.Reset();
+	TSharedPtr<FJsonObject> Manifest = LoadManifest(FullPakFilename);
+	const TArray<TSharedPtr<FJsonValue>>* Items = nullptr;
+	if (!Manifest.IsValid() || !Manifest->TryGetArrayField(TEXT("items"), Items))
+	{
+		// Deploys paked before there were manifests were a single pak
+		OutPakFilenames.Add(FullPakFilename);
+		return;
+	}
+	for (const TSharedPtr<FJsonValue>& Value : *Items)
+	{
+		TSharedPtr<FJsonObject> Item = Value->AsObject();
+		if (Item.IsValid() && !FPakManifest::IsPatchPak(Item->GetStringField(TEXT("url"))))
+		{
+			OutPakFilenames.Add(FPaths::GetPath(FullPakFilename) / Item->GetStringField(TEXT("url")));
+		}
+	}
+}
+
+TSharedPtr<FJsonObject> FPakChannels::LoadManifest(const FString& FullPakFilename)
+{
+	FString Text;
+	TSharedPtr<FJsonObject> Manifest;
+	if (FFileHelper::LoadFileToString(Text, *GetManifestFilename(FullPakFilename)))
+	{
+		TSharedRef<TJsonReader<>> Reader = TJsonReaderFactory<>::Create(Text);
+		FJsonSerializer::Deserialize(Reader, Manifest);
+	}
+	return Manifest;
+}
+
+bool FPakChannels::SaveManifest(const FString& FullPakFilename, const TSharedRef<FJsonObject>& Manifest)
+{
+	FString Text;
+	TSharedRef<TJsonWriter<>> Writer = TJsonWriterFactory<>::Create(&Text);
+	const FString Filename = GetManifestFilename(FullPakFilename);
+	if (!FJsonSerializer::Serialize(Manifest, Writer) || !FFileHelper::SaveStringToFile(Text, *Filename, FFileHelper::EEncodingOptions::ForceUTF8WithoutBOM))
+	{
+		UE_LOG(PakChannels, Error, TEXT("Failed to write %s"), *Filename);
+		return false;
+	}
+	return true;
+}
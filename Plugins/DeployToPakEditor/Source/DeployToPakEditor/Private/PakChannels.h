@@ -0,0 +1,104 @@
+// Copyright 1998-2016 Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "Engine.h"
+#include "PakContents.h"
+
+/**
+ * Lays a platform's deploy out as several paks, so clients download only the channels they use and a change only
+ * invalidates the paks it touches. Each entry of the Assets setting is a channel with a pak of its own,
+ * <pak name>-<channel>.pak; packages several channels need go to <pak name>-Common.pak. A channel larger than
+ * Max Pak Size MB is split over <pak name>-<channel>-2.pak and so on. Every pak keeps its own patch history
+ * (see FPakManifest). Because the split is by size in package order, a channel that grows can push packages into
+ * the next pak, which then gets a full pak rather than a patch.
+ *
+ * The layout is published as <pak name>.json next to the paks, and uploaded last:
+ *
+ *   {
+ *     "items": [ { "url": "Game-Windows-Content-Common.pak", "size": 1234, "sha1": "..." }, ... ],
+ *     "channels": [
+ *       { "name": "Common", "paks": [ "Game-Windows-Content-Common.pak", "Game-Windows-Content-Common_1_P.pak" ] },
+ *       { "name": "Maps", "requires": [ "Common" ], "paks": [ "Game-Windows-Content-Maps.pak" ] },
+ *       { "name": "Empty", "requires": [ "Common" ], "paks": [] }
+ *     ]
+ *   }
+ *
+ * "items" makes it an update catalog for UAsyncTaskCheckForUpdates as well; "paks" are in mount order. A channel
+ * whose assets have no files of their own is listed with no paks, so acquiring it only needs what it requires.
+ * Clients acquire channels with UAsyncTaskAcquireContentSet::AcquireChannels.
+ *
+ * Without channels (Pak Per Channel or Pak Dependencies Only off, or no Assets) the deploy is the one pak it always
+ * was, listed as the single channel "Content".
+ */
+class FPakChannels
+{
+public:
+	/** One pak of a deploy */
+	struct FPak
+	{
+		/** Channel the pak belongs to */
+		FString Channel;
+		/** Name of the pak; its patches are named after it. Empty for a channel without files, which has no pak. */
+		FString FullPakFilename;
+		/** Full paths of the files that belong in the pak */
+		TArray<FString> Filenames;
+	};
+
+	/**
+	 * What Plan takes from the settings and the Asset Registry. Made on the game thread, which the Asset Registry
+	 * needs, so Plan itself can run on a worker.
+	 */
+	struct FPlanSettings
+	{
+		bool bDependenciesOnly;
+		bool bPerChannel;
+		/** 0 for no limit */
+		int64 MaxPakBytes;
+		/** Packages of all configured assets together, when only dependencies are paked into one pak */
+		FPakContents::FAssetPackages AllPackages;
+		/** Packages of each entry of the Assets setting, when only dependencies are paked per channel */
+		TArray<FPakContents::FAssetPackages> ChannelPackages;
+
+		/** Reads the Deploy Content to Pak settings and looks up the packages they need */
+		FPlanSettings();
+	};
+
+	/**
+	 * Splits the content of a deploy into paks. Only reads files, so it can run on any thread.
+	 *
+	 * @param Settings - The settings and packages to plan with, made on the game thread.
+	 * @param ContentFolder - The cooked (or uncooked) Content folder to pak.
+	 * @param FullPakFilename - Name of the platform's pak, which the paks and the manifest are named after.
+	 * @param OutPaks - The paks, Common first, then the channels in the order of the Assets setting; a channel without
+	 *   files gets one entry without a pak.
+	 */
+	static void Plan(const FPlanSettings& Settings, const FString& ContentFolder, const FString& FullPakFilename, TArray<FPak>& OutPaks);
+
+	/**
+	 * Writes the manifest listing the paks of each channel as they will be once the paks FPakManifest::Prepare chose
+	 * are deployed. Sizes and hashes of paks that are still to be made are filled in by Finalize.
+	 */
+	static bool WriteManifest(const FString& FullPakFilename, const TArray<FPak>& Paks);
+
+	/** Adds the size and SHA1 of the paks UnrealPak just made to the manifest; returns false if one is missing */
+	static bool Finalize(const FString& FullPakFilename);
+
+	/** The paks made for this deploy, which aren't deployed yet */
+	static void GetPaksToDeploy(const FString& FullPakFilename, TArray<FString>& OutPakFilenames);
+
+	/** The paks to deploy followed by the manifest, which goes last so it never names a pak that isn't there yet */
+	static void GetFilesToDeploy(const FString& FullPakFilename, TArray<FString>& OutFilenames);
+
+	/** Commits the pak manifest of every pak of the deploy, once the deploy is done */
+	static void Commit(const FString& FullPakFilename);
+
+	static FString GetManifestFilename(const FString& FullPakFilename);
+
+private:
+	/** Loads the manifest of FullPakFilename as a JSON object */
+	static TSharedPtr<class FJsonObject> LoadManifest(const FString& FullPakFilename);
+	static bool SaveManifest(const FString& FullPakFilename, const TSharedRef<class FJsonObject>& Manifest);
+	/** Full paths of the full paks, without their patches, the manifest lists */
+	static void GetFullPaks(const FString& FullPakFilename, TArray<FString>& OutPakFilenames);
+};
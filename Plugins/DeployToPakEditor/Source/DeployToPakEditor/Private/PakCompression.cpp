@@ -0,0 +1,76 @@
+// Copyright 1998-2016 Epic Games, Inc. All Rights Reserved.
+
+#include "DeployToPakEditorPrivatePCH.h"
+#include "PakCompression.h"
+#include "AssetRegistryModule.h"
+
+FPakCompressionPolicy::FPakCompressionPolicy()
+	: FPakCompressionPolicy(FDeployToPakEditorModule::Get().GetCompressionRules(), FDeployToPakEditorModule::Get().GetDefaultCompression())
+{
+}
+
+FPakCompressionPolicy::FPakCompressionPolicy(const TArray<FPakCompressionRule>& InRules, EPakCompression InDefaultCompression)
+	: Rules(InRules)
+	, DefaultCompression(InDefaultCompression)
+	, bNeedsAssetClass(false)
+{
+	for (const FPakCompressionRule& Rule : Rules)
+	{
+		bNeedsAssetClass |= Rule.AssetClass.Len() > 0;
+	}
+	if (bNeedsAssetClass)
+	{
+		IAssetRegistry& AssetRegistry = FModuleManager::LoadModuleChecked<FAssetRegistryModule>(TEXT("AssetRegistry")).Get();
+		if (AssetRegistry.IsLoadingAssets())
+		{
+			AssetRegistry.SearchAllAssets(true);
+		}
+		TArray<FAssetData> Assets;
+		AssetRegistry.GetAssetsByPath(FName(TEXT("/Game")), Assets, true);
+		for (const FAssetData& Asset : Assets)
+		{
+			if (!AssetClasses.Contains(Asset.PackageName))
+			{
+				AssetClasses.Add(Asset.PackageName, Asset.AssetClass.ToString());
+			}
+		}
+	}
+}
+
+EPakCompression FPakCompressionPolicy::Choose(const FString& ContentFolder, const FString& Filename) const
+{
+	const FString Extension = FPaths::GetExtension(Filename);
+	FString AssetClass;
+	FString RelativePath = FPaths::GetPath(Filename) / FPaths::GetBaseFilename(Filename);
+	if (bNeedsAssetClass && FPaths::MakePathRelativeTo(RelativePath, *ContentFolder))
+	{
+		const FString* Found = AssetClasses.Find(FName(*(TEXT("/Game/") + RelativePath)));
+		AssetClass = Found != nullptr ? *Found : FString();
+	}
+	for (const FPakCompressionRule& Rule : Rules)
+	{
+		if ((Rule.Extension.Len() == 0 || Rule.Extension == Extension) && (Rule.AssetClass.Len() == 0 || Rule.AssetClass == AssetClass))
+		{
+			return Rule.Compression;
+		}
+	}
+	return DefaultCompression;
+}
+
+FString FPakCompressionPolicy::GetAssetClass(const FString& ContentFolder, const FString& Filename)
+{
+	FString RelativePath = FPaths::GetPath(Filename) / FPaths::GetBaseFilename(Filename);
+	if (!FPaths::MakePathRelativeTo(RelativePath, *ContentFolder))
+	{
+		return FString();
+	}
+	IAssetRegistry& AssetRegistry = FModuleManager::LoadModuleChecked<FAssetRegistryModule>(TEXT("AssetRegistry")).Get();
+	TArray<FAssetData> Assets;
+	AssetRegistry.GetAssetsByPackageName(FName(*(TEXT("/Game/") + RelativePath)), Assets);
+	return Assets.Num() > 0 ? Assets[0].AssetClass.ToString() : FString();
+}
+
+const TCHAR* FPakCompressionPolicy::GetResponseFileFlags(EPakCompression Compression)
+{
+	return Compression == EPakCompression::Zlib ? TEXT(" -compress") : TEXT("");
+}
@@ -0,0 +1,37 @@
+// Copyright 1998-2016 Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "Engine.h"
+#include "DeployToPakEditorSettings.h"
+
+/**
+ * Applies the compression rules of UDeployToPakEditorSettings to the files of a Content folder. A file's asset
+ * class is the class of the asset in its package, looked up in the Asset Registry; side files (.ubulk, ...) share
+ * the class of their package. The classes are read when the policy is made, which must be on the game thread;
+ * Choose then runs on any thread.
+ */
+class FPakCompressionPolicy
+{
+public:
+	/** Uses the rules from the settings */
+	FPakCompressionPolicy();
+	FPakCompressionPolicy(const TArray<FPakCompressionRule>& InRules, EPakCompression InDefaultCompression);
+
+	/** Compression for Filename, a file under ContentFolder */
+	EPakCompression Choose(const FString& ContentFolder, const FString& Filename) const;
+
+	/** Class name of the asset in the package Filename belongs to; empty if it isn't a package or isn't known */
+	static FString GetAssetClass(const FString& ContentFolder, const FString& Filename);
+
+	/** UnrealPak response file flags for a file stored with Compression */
+	static const TCHAR* GetResponseFileFlags(EPakCompression Compression);
+
+private:
+	TArray<FPakCompressionRule> Rules;
+	EPakCompression DefaultCompression;
+	/** Whether any rule looks at asset classes, which takes an Asset Registry lookup per file */
+	bool bNeedsAssetClass;
+	/** Class of the asset of each /Game package, if a rule needs them */
+	TMap<FName, FString> AssetClasses;
+};
@@ -0,0 +1,184 @@
+// Copyright 1998-2016 Epic Games, Inc. All Rights Reserved.
+
+#include "DeployToPakEditorPrivatePCH.h"
+#include "PakCompressionCommandlet.h"
+#include "PakCompression.h"
+#include "AssetRegistryModule.h"
+
+DEFINE_LOG_CATEGORY_STATIC(PakCompression, Log, All);
+
+/** Paks compress files in blocks of this size */
+static const int32 PakCompressionBlockSize = 64 * 1024;
+
+/** Decompression is timed over this many passes, as a single pass of a small file is too short to measure */
+static const int32 DecompressPasses = 3;
+
+UPakCompressionCommandlet::UPakCompressionCommandlet(const FObjectInitializer& ObjectInitializer)
+	: Super(ObjectInitializer)
+{
+	LogToConsole = true;
+}
+
+int32 UPakCompressionCommandlet::Main(const FString& Params)
+{
+	FString Platform;
+	if (!FParse::Value(*Params, TEXT("Platform="), Platform))
+	{
+		const TArray<FName>& DeployPlatforms = FDeployToPakEditorModule::Get().GetDeployPlatforms();
+		Platform = DeployPlatforms.Num() > 0 ? DeployPlatforms[0].ToString() : FString(TEXT("WindowsNoEditor"));
+	}
+	int32 SampleMB = 64;
+	float ReadMBps = 50;
+	float CpuScale = 1;
+	FParse::Value(*Params, TEXT("SampleMB="), SampleMB);
+	FParse::Value(*Params, TEXT("ReadMBps="), ReadMBps);
+	FParse::Value(*Params, TEXT("CpuScale="), CpuScale);
+
+	const FString ContentFolder = FPaths::ConvertRelativePathToFull(FPaths::GameSavedDir() / TEXT("Cooked") / Platform / FApp::GetGameName() / TEXT("Content/"));
+	TArray<FString> Filenames;
+	IFileManager::Get().FindFilesRecursive(Filenames, *ContentFolder, TEXT("*"), true, false);
+	if (Filenames.Num() == 0)
+	{
+		UE_LOG(PakCompression, Error, TEXT("No cooked content in %s - cook %s first"), *ContentFolder, *Platform);
+		return 1;
+	}
+	IAssetRegistry& AssetRegistry = FModuleManager::LoadModuleChecked<FAssetRegistryModule>(TEXT("AssetRegistry")).Get();
+	AssetRegistry.SearchAllAssets(true);
+
+	// Group by asset class and extension, the two things rules match on, and sample each group in a random order
+	TMap<FString, TArray<FString>> Groups;
+	for (const FString& Filename : Filenames)
+	{
+		FString AssetClass = FPakCompressionPolicy::GetAssetClass(ContentFolder, Filename);
+		Groups.FindOrAdd(FString::Printf(TEXT("%s,%s"), AssetClass.Len() > 0 ? *AssetClass : TEXT("-"), *FPaths::GetExtension(Filename))).Add(Filename);
+	}
+	Groups.KeySort(TLess<FString>());
+
+	const FPakCompressionPolicy Policy;
+	const EPakCompression Choices[] = { EPakCompression::None, EPakCompression::Zlib };
+	const UEnum* CompressionEnum = FindObject<UEnum>(ANY_PACKAGE, TEXT("EPakCompression"), true);
+	FRandomStream Random(0);
+	FString Csv = TEXT("AssetClass,Extension,Files,SampledFiles,SampledMB,Compression,Ratio,DecompressMBps,LoadMsPerMB,Fastest,Policy\n");
+	UE_LOG(PakCompression, Display, TEXT("%-28s %-6s %6s %5s %-6s %6s %10s %9s  %s"), TEXT("Asset class"), TEXT("Ext"), TEXT("Files"), TEXT("MB"), TEXT("Codec"), TEXT("Ratio"), TEXT("Dec MB/s"), TEXT("ms/MB"), TEXT(""));
+	for (TPair<FString, TArray<FString>>& Group : Groups)
+	{
+		TArray<FString>& Files = Group.Value;
+		for (int32 i = Files.Num() - 1; i > 0; i--)
+		{
+			Files.Swap(i, Random.RandRange(0, i));
+		}
+
+		FSample Samples[ARRAY_COUNT(Choices)];
+		int32 SampledFiles = 0;
+		for (const FString& Filename : Files)
+		{
+			if (Samples[0].RawBytes >= (int64)SampleMB * 1024 * 1024)
+			{
+				break;
+			}
+			TArray<uint8> Data;
+			if (!FFileHelper::LoadFileToArray(Data, *Filename))
+			{
+				continue;
+			}
+			for (int32 Choice = 0; Choice < ARRAY_COUNT(Choices); Choice++)
+			{
+				Measure(Data, Choices[Choice], Samples[Choice]);
+			}
+			SampledFiles++;
+		}
+		if (SampledFiles == 0)
+		{
+			continue;
+		}
+
+		// Time to get one MB of content off the device and decompressed
+		double LoadMsPerMB[ARRAY_COUNT(Choices)];
+		int32 Fastest = 0;
+		for (int32 Choice = 0; Choice < ARRAY_COUNT(Choices); Choice++)
+		{
+			const FSample& Sample = Samples[Choice];
+			const double Ratio = (double)Sample.StoredBytes / Sample.RawBytes;
+			const double DecompressSecondsPerMB = Sample.DecompressSeconds / (Sample.RawBytes / (1024.0 * 1024.0));
+			LoadMsPerMB[Choice] = (Ratio / ReadMBps + DecompressSecondsPerMB * CpuScale) * 1000;
+			Fastest = LoadMsPerMB[Choice] < LoadMsPerMB[Fastest] ? Choice : Fastest;
+		}
+
+		FString AssetClass;
+		FString Extension;
+		Group.Key.Split(TEXT(","), &AssetClass, &Extension);
+		const EPakCompression PolicyChoice = Policy.Choose(ContentFolder, Files[0]);
+		for (int32 Choice = 0; Choice < ARRAY_COUNT(Choices); Choice++)
+		{
+			const FSample& Sample = Samples[Choice];
+			const FString Name = CompressionEnum != nullptr ? CompressionEnum->GetEnumName((int32)Choices[Choice]) : FString::FromInt((int32)Choices[Choice]);
+			const double Ratio = (double)Sample.StoredBytes / Sample.RawBytes;
+			const double DecompressMBps = Sample.DecompressSeconds > 0 ? Sample.RawBytes / Sample.DecompressSeconds / (1024 * 1024) : 0;
+			const bool bIsPolicy = Choices[Choice] == PolicyChoice;
+			Csv += FString::Printf(TEXT("%s,%s,%d,%d,%.2f,%s,%.3f,%.1f,%.2f,%d,%d\n"), *AssetClass, *Extension, Files.Num(), SampledFiles,
+				Sample.RawBytes / (1024.0 * 1024.0), *Name, Ratio, DecompressMBps, LoadMsPerMB[Choice], Choice == Fastest ? 1 : 0, bIsPolicy ? 1 : 0);
+			UE_LOG(PakCompression, Display, TEXT("%-28s %-6s %6d %5.0f %-6s %6.3f %10.1f %9.2f  %s%s"), *AssetClass, *Extension, Files.Num(),
+				Sample.RawBytes / (1024.0 * 1024.0), *Name, Ratio, DecompressMBps, LoadMsPerMB[Choice],
+				Choice == Fastest ? TEXT("fastest ") : TEXT(""), bIsPolicy ? TEXT("(policy)") : TEXT(""));
+		}
+		if (Choices[Fastest] != PolicyChoice)
+		{
+			UE_LOG(PakCompression, Warning, TEXT("%s .%s loads faster on the target device with a different compression than the policy gives it"), *AssetClass, *Extension);
+		}
+	}
+
+	FString Output = FPaths::GameSavedDir() / TEXT("PakCompression") / Platform + TEXT("-") + FDateTime::Now().ToString() + TEXT(".csv");
+	FParse::Value(*Params, TEXT("Output="), Output);
+	if (!FFileHelper::SaveStringToFile(Csv, *Output))
+	{
+		UE_LOG(PakCompression, Error, TEXT("Couldn't write %s"), *Output);
+		return 1;
+	}
+	UE_LOG(PakCompression, Log, TEXT("Wrote %s"), *Output);
+	return 0;
+}
+
+void UPakCompressionCommandlet::Measure(const TArray<uint8>& Data, EPakCompression Compression, FSample& InOutSample)
+{
+	InOutSample.RawBytes += Data.Num();
+	if (Compression == EPakCompression::None)
+	{
+		InOutSample.StoredBytes += Data.Num();
+		return;
+	}
+
+	const ECompressionFlags Flags = COMPRESS_ZLIB;
+	TArray<TArray<uint8>> Blocks;
+	for (int32 Offset = 0; Offset < Data.Num(); Offset += PakCompressionBlockSize)
+	{
+		const int32 Size = FMath::Min(PakCompressionBlockSize, Data.Num() - Offset);
+		TArray<uint8>& Block = Blocks[Blocks.AddDefaulted()];
+		int32 CompressedSize = FCompression::CompressMemoryBound(Flags, Size);
+		Block.SetNumUninitialized(CompressedSize);
+		if (!FCompression::CompressMemory(Flags, Block.GetData(), CompressedSize, Data.GetData() + Offset, Size) || CompressedSize >= Size)
+		{
+			// Blocks that don't shrink are stored as they are
+			Block.Empty();
+			InOutSample.StoredBytes += Size;
+			continue;
+		}
+		Block.SetNum(CompressedSize);
+		InOutSample.StoredBytes += CompressedSize;
+	}
+
+	TArray<uint8> Uncompressed;
+	Uncompressed.SetNumUninitialized(PakCompressionBlockSize);
+	const double Start = FPlatformTime::Seconds();
+	for (int32 Pass = 0; Pass < DecompressPasses; Pass++)
+	{
+		for (int32 Index = 0; Index < Blocks.Num(); Index++)
+		{
+			const int32 Size = FMath::Min(PakCompressionBlockSize, Data.Num() - Index * PakCompressionBlockSize);
+			if (Blocks[Index].Num() > 0)
+			{
+				FCompression::UncompressMemory(Flags, Uncompressed.GetData(), Size, Blocks[Index].GetData(), Blocks[Index].Num());
+			}
+		}
+	}
+	InOutSample.DecompressSeconds += (FPlatformTime::Seconds() - Start) / DecompressPasses;
+}
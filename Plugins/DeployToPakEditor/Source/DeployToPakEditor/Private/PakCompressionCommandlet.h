@@ -0,0 +1,42 @@
+// Copyright 1998-2016 Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+#include "Engine.h"
+#include "Commandlets/Commandlet.h"
+#include "DeployToPakEditorSettings.h"
+
+#include "PakCompressionCommandlet.generated.h"
+
+/**
+* Samples the cooked content of a platform and reports, for each asset class and extension, the compression ratio
+* and decompression throughput of every EPakCompression choice, to tune the CompressionRules setting:
+*
+*   UE4Editor-Cmd <Project> -run=PakCompression [-Platform=WindowsNoEditor] [-SampleMB=64] [-ReadMBps=50]
+*     [-CpuScale=1] [-Output=<csv>]
+*
+* Files are compressed in the 64KB blocks paks use. ReadMBps is the storage (or download) speed of the target
+* device and CpuScale how many times slower its CPU decompresses than this machine, so the estimated load time
+* per MB of content and the fastest choice reflect that device. Results go to the log and to a CSV in
+* Saved/PakCompression.
+*/
+UCLASS()
+class UPakCompressionCommandlet : public UCommandlet
+{
+	GENERATED_UCLASS_BODY()
+
+public:
+	virtual int32 Main(const FString& Params) override;
+
+private:
+	struct FSample
+	{
+		int64 RawBytes;
+		int64 StoredBytes;
+		double DecompressSeconds;
+
+		FSample() : RawBytes(0), StoredBytes(0), DecompressSeconds(0) {}
+	};
+
+	/** Stores Data with Compression the way UnrealPak would and times reading it back */
+	static void Measure(const TArray<uint8>& Data, EPakCompression Compression, FSample& InOutSample);
+};
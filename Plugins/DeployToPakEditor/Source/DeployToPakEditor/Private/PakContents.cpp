@@ -0,0 +1,323 @@
+// Copyright 1998-2016 Epic Games, Inc. All Rights Reserved.
+
+#include "DeployToPakEditorPrivatePCH.h"
+#include "PakContents.h"
+#include "AssetRegistryModule.h"
+
+DEFINE_LOG_CATEGORY_STATIC(PakContents, Log, All);
+
+static const FString GameRoot(TEXT("/Game/"));
+/** Why a file that isn't a package is in the pak, for the report */
+static const TCHAR* OtherFileReason = TEXT("not a package (movie or other file loaded by path)");
+
+const TCHAR* FPakContents::CommonChannel = TEXT("Common");
+
+FString FPakContents::GetChannelName(int32 Channel)
+{
+	const TArray<FDeployToPakAsset>& Assets = FDeployToPakEditorModule::Get().GetAssets();
+	FString Name;
+	if (Assets.IsValidIndex(Channel))
+	{
+		// The name ends up in pak file names and URLs
+		for (TCHAR Character : Assets[Channel].Name)
+		{
+			if (FChar::IsAlnum(Character))
+			{
+				Name.AppendChar(Character);
+			}
+		}
+	}
+	if (Name.IsEmpty() || Name == CommonChannel)
+	{
+		Name = FString::Printf(TEXT("Channel%d"), Channel);
+	}
+	return Name;
+}
+
+bool FPakContents::GetPackages(TArray<FName>& OutPackages, TMap<FName, FString>* OutReasons, int32 Channel)
+{
+	// Why each package is in the pak, by package name; the roots are queued first
+	TMap<FName, FString> Reasons;
+	TArray<FName> Queue;
+	const TArray<FDeployToPakAsset>& Assets = FDeployToPakEditorModule::Get().GetAssets();
+	for (int32 i = 0; i < Assets.Num(); i++)
+	{
+		if (Channel != INDEX_NONE && i != Channel)
+		{
+			continue;
+		}
+		for (const FStringAssetReference& Map : Assets[i].Maps)
+		{
+			const FName PackageName(*FPackageName::ObjectPathToPackageName(Map.ToString()));
+			if (!Reasons.Contains(PackageName))
+			{
+				Reasons.Add(PackageName, FString::Printf(TEXT("map of asset set %d"), i));
+				Queue.Add(PackageName);
+			}
+		}
+		for (const FStringAssetReference& Blueprint : Assets[i].Blueprints)
+		{
+			const FName PackageName(*FPackageName::ObjectPathToPackageName(Blueprint.ToString()));
+			if (!Reasons.Contains(PackageName))
+			{
+				Reasons.Add(PackageName, FString::Printf(TEXT("blueprint of asset set %d"), i));
+				Queue.Add(PackageName);
+			}
+		}
+	}
+	if (Queue.Num() == 0)
+	{
+		return false;
+	}
+
+	IAssetRegistry& AssetRegistry = FModuleManager::LoadModuleChecked<FAssetRegistryModule>(TEXT("AssetRegistry")).Get();
+	if (AssetRegistry.IsLoadingAssets())
+	{
+		AssetRegistry.SearchAllAssets(true);
+	}
+
+	// Breadth first, so each package is explained by its shortest path from a root
+	for (int32 Index = 0; Index < Queue.Num(); Index++)
+	{
+		const FName PackageName = Queue[Index];
+		const FString PackageString = PackageName.ToString();
+		const EAssetRegistryDependencyType::Type Types[] = { EAssetRegistryDependencyType::Hard, EAssetRegistryDependencyType::Soft };
+		for (EAssetRegistryDependencyType::Type Type : Types)
+		{
+			TArray<FName> Dependencies;
+			AssetRegistry.GetDependencies(PackageName, Dependencies, Type);
+			for (const FName& Dependency : Dependencies)
+			{
+				if (Reasons.Contains(Dependency) || !Dependency.ToString().StartsWith(GameRoot))
+				{
+					continue;
+				}
+				Reasons.Add(Dependency, FString::Printf(TEXT("%s reference from %s"), Type == EAssetRegistryDependencyType::Hard ? TEXT("hard") : TEXT("soft"), *PackageString));
+				Queue.Add(Dependency);
+			}
+		}
+	}
+	OutPackages = MoveTemp(Queue);
+	if (OutReasons != nullptr)
+	{
+		*OutReasons = MoveTemp(Reasons);
+	}
+	return true;
+}
+
+void FPakContents::GetChannelPackages(TArray<FAssetPackages>& OutAssetPackages)
+{
+	OutAssetPackages.Reset();
+	const int32 NumAssets = FDeployToPakEditorModule::Get().GetAssets().Num();
+	for (int32 Asset = 0; Asset < NumAssets; Asset++)
+	{
+		FAssetPackages AssetPackages;
+		if (GetPackages(AssetPackages.Packages, &AssetPackages.Reasons, Asset))
+		{
+			AssetPackages.Channel = GetChannelName(Asset);
+			OutAssetPackages.Add(MoveTemp(AssetPackages));
+		}
+	}
+}
+
+bool FPakContents::Gather(const FAssetPackages& AssetPackages, const FString& ContentFolder, const FString& ReportFilename, TArray<FString>& OutFilenames)
+{
+	const double StartTime = FPlatformTime::Seconds();
+	const TArray<FName>& Queue = AssetPackages.Packages;
+	const TMap<FName, FString>& Reasons = AssetPackages.Reasons;
+	if (Queue.Num() == 0)
+	{
+		return false;
+	}
+
+	TMap<FString, TArray<FString>> FilesByPackage;
+	TArray<FString> OtherFiles;
+	int64 AllBytes = 0;
+	GetFilesByPackage(ContentFolder, FilesByPackage, OtherFiles, AllBytes);
+
+	FString Report = TEXT("Package\tBytes\tReason") LINE_TERMINATOR;
+	int64 PakBytes = 0;
+	int32 Missing = 0;
+	for (const FName& PackageName : Queue)
+	{
+		const FString PackageString = PackageName.ToString();
+		const TArray<FString>* Files = FilesByPackage.Find(PackageString);
+		int64 Bytes = 0;
+		if (Files != nullptr)
+		{
+			for (const FString& Filename : *Files)
+			{
+				Bytes += IFileManager::Get().FileSize(*Filename);
+				OutFilenames.Add(Filename);
+			}
+		}
+		else
+		{
+			// Editor-only packages are left out of cooks, so this isn't always an error
+			UE_LOG(PakContents, Warning, TEXT("%s (%s) has no file in %s"), *PackageString, *Reasons[PackageName], *ContentFolder);
+			Missing++;
+		}
+		PakBytes += Bytes;
+		Report += FString::Printf(TEXT("%s\t%lld\t%s") LINE_TERMINATOR, *PackageString, Bytes, *Reasons[PackageName]);
+	}
+	for (const FString& Filename : OtherFiles)
+	{
+		const int64 Bytes = IFileManager::Get().FileSize(*Filename);
+		OutFilenames.Add(Filename);
+		PakBytes += Bytes;
+		Report += FString::Printf(TEXT("%s\t%lld\t%s") LINE_TERMINATOR, *Filename, Bytes, OtherFileReason);
+	}
+
+	// Keeps the Content folder as the pak's mount point, see FCookContentActionCallbacks::CreatePakPlaceholder
+	const FString Placeholder = ContentFolder / TEXT("unrealpakPlaceholder");
+	if (FPaths::FileExists(Placeholder))
+	{
+		OutFilenames.Add(Placeholder);
+	}
+
+	if (!FFileHelper::SaveStringToFile(Report, *ReportFilename))
+	{
+		UE_LOG(PakContents, Error, TEXT("Failed to write %s"), *ReportFilename);
+	}
+	UE_LOG(PakContents, Log, TEXT("Pak contents: %d packages (%d without files) and %d other files, %lld of %lld bytes in %s, found in %.2fs; see %s"),
+		Queue.Num(), Missing, OtherFiles.Num(), PakBytes, AllBytes, *ContentFolder, FPlatformTime::Seconds() - StartTime, *ReportFilename);
+	return true;
+}
+
+void FPakContents::GetFilesByPackage(const FString& ContentFolder, TMap<FString, TArray<FString>>& OutFilesByPackage, TArray<FString>& OutOtherFiles, int64& OutAllBytes)
+{
+	// A package is a .uasset or .umap plus any side files (.ubulk, .uexp, ...) of the same name
+	TArray<FString> AllFilenames;
+	IFileManager::Get().FindFilesRecursive(AllFilenames, *ContentFolder, TEXT("*"), true, false);
+	OutAllBytes = 0;
+	TSet<FString> Packages;
+	for (const FString& Filename : AllFilenames)
+	{
+		FString RelativePath = FPaths::GetPath(Filename) / FPaths::GetBaseFilename(Filename);
+		FPaths::MakePathRelativeTo(RelativePath, *ContentFolder);
+		const FString PackageName = GameRoot + RelativePath;
+		OutFilesByPackage.FindOrAdd(PackageName).Add(Filename);
+		OutAllBytes += IFileManager::Get().FileSize(*Filename);
+		const FString Extension = FPaths::GetExtension(Filename, true);
+		if (Extension == FPackageName::GetAssetPackageExtension() || Extension == FPackageName::GetMapPackageExtension())
+		{
+			Packages.Add(PackageName);
+		}
+	}
+	// The placeholder is added by the callers themselves
+	const FString Placeholder = ContentFolder / TEXT("unrealpakPlaceholder");
+	for (auto It = OutFilesByPackage.CreateIterator(); It; ++It)
+	{
+		if (!Packages.Contains(It.Key()))
+		{
+			for (const FString& Filename : It.Value())
+			{
+				if (!FPaths::IsSamePath(Filename, Placeholder))
+				{
+					OutOtherFiles.Add(Filename);
+				}
+			}
+			It.RemoveCurrent();
+		}
+	}
+	OutOtherFiles.Sort();
+}
+
+bool FPakContents::GatherChannels(const TArray<FAssetPackages>& AssetPackages, const FString& ContentFolder, const FString& ReportFilename, TArray<FChannel>& OutChannels)
+{
+	const double StartTime = FPlatformTime::Seconds();
+
+	// Channel of each package, by index into Names; INDEX_NONE once a second channel reaches it
+	TArray<FString> Names;
+	TArray<FName> Order;
+	TMap<FName, int32> ChannelOfPackage;
+	TMap<FName, FString> Reasons;
+	for (const FAssetPackages& Asset : AssetPackages)
+	{
+		const int32 Channel = Names.AddUnique(Asset.Channel);
+		for (const FName& Package : Asset.Packages)
+		{
+			int32* Found = ChannelOfPackage.Find(Package);
+			if (Found == nullptr)
+			{
+				ChannelOfPackage.Add(Package, Channel);
+				Reasons.Add(Package, Asset.Reasons[Package]);
+				Order.Add(Package);
+			}
+			else if (*Found != Channel)
+			{
+				*Found = INDEX_NONE;
+			}
+		}
+	}
+	if (Order.Num() == 0)
+	{
+		return false;
+	}
+
+	TMap<FString, TArray<FString>> FilesByPackage;
+	TArray<FString> OtherFiles;
+	int64 AllBytes = 0;
+	GetFilesByPackage(ContentFolder, FilesByPackage, OtherFiles, AllBytes);
+
+	// Common goes first, so a client mounting a channel finds what it shares already there
+	TArray<FChannel> Channels;
+	Channels.SetNum(Names.Num() + 1);
+	Channels[0].Name = CommonChannel;
+	for (int32 Channel = 0; Channel < Names.Num(); Channel++)
+	{
+		Channels[Channel + 1].Name = Names[Channel];
+	}
+	FString Report = TEXT("Package\tBytes\tChannel\tReason") LINE_TERMINATOR;
+	int32 Missing = 0;
+	for (const FName& PackageName : Order)
+	{
+		const FString PackageString = PackageName.ToString();
+		FChannel& Channel = Channels[ChannelOfPackage[PackageName] + 1];
+		const TArray<FString>* Files = FilesByPackage.Find(PackageString);
+		int64 Bytes = 0;
+		if (Files != nullptr)
+		{
+			for (const FString& Filename : *Files)
+			{
+				Bytes += IFileManager::Get().FileSize(*Filename);
+			}
+			Channel.PackageFiles.Add(*Files);
+			Channel.Bytes += Bytes;
+		}
+		else
+		{
+			// Editor-only packages are left out of cooks, so this isn't always an error
+			UE_LOG(PakContents, Warning, TEXT("%s (%s) has no file in %s"), *PackageString, *Reasons[PackageName], *ContentFolder);
+			Missing++;
+		}
+		Report += FString::Printf(TEXT("%s\t%lld\t%s\t%s") LINE_TERMINATOR, *PackageString, Bytes, *Channel.Name, *Reasons[PackageName]);
+	}
+	// Any channel may load them, so they are shared
+	for (const FString& Filename : OtherFiles)
+	{
+		const int64 Bytes = IFileManager::Get().FileSize(*Filename);
+		Channels[0].PackageFiles.Add(TArray<FString>({ Filename }));
+		Channels[0].Bytes += Bytes;
+		Report += FString::Printf(TEXT("%s\t%lld\t%s\t%s") LINE_TERMINATOR, *Filename, Bytes, *Channels[0].Name, OtherFileReason);
+	}
+
+	OutChannels.Reset();
+	for (int32 Index = 0; Index < Channels.Num(); Index++)
+	{
+		FChannel& Channel = Channels[Index];
+		if (Index > 0 || Channel.PackageFiles.Num() > 0)
+		{
+			UE_LOG(PakContents, Log, TEXT("Channel %s: %d packages, %lld bytes"), *Channel.Name, Channel.PackageFiles.Num(), Channel.Bytes);
+			OutChannels.Add(MoveTemp(Channel));
+		}
+	}
+
+	if (!FFileHelper::SaveStringToFile(Report, *ReportFilename))
+	{
+		UE_LOG(PakContents, Error, TEXT("Failed to write %s"), *ReportFilename);
+	}
+	UE_LOG(PakContents, Log, TEXT("Pak contents: %d packages (%d without files) and %d other files in %d channels, of %lld bytes in %s, found in %.2fs; see %s"),
+		Order.Num(), Missing, OtherFiles.Num(), OutChannels.Num(), AllBytes, *ContentFolder, FPlatformTime::Seconds() - StartTime, *ReportFilename);
+	return true;
+}
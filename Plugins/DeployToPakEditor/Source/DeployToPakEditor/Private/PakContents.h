@@ -0,0 +1,91 @@
+// Copyright 1998-2016 Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "Engine.h"
+
+/**
+ * Works out which files a pak needs: the packages of the configured Maps and Blueprints plus everything they
+ * reference, directly or indirectly, through hard or soft references in the Asset Registry. Only packages under
+ * /Game go in the pak; engine and script packages come with the game itself. Files under the Content folder that
+ * aren't packages (movies such as Content/Movies/*.mp4 or *.bk2, and other files loaded by path) can't be found
+ * through references, so they always go in.
+ *
+ * Each entry of the Assets setting is a channel. GatherChannels splits the packages by the channels that need
+ * them: a package only one channel reaches goes with that channel, one several channels reach goes to Common,
+ * and so do the files that aren't packages.
+ */
+class FPakContents
+{
+public:
+	/** Name of the channel holding the packages several channels need */
+	static const TCHAR* CommonChannel;
+
+	/** Packages of the configured assets, as GetPackages finds them */
+	struct FAssetPackages
+	{
+		/** Channel of the entry of the Assets setting they were found for; empty for all entries together */
+		FString Channel;
+		/** Roots first */
+		TArray<FName> Packages;
+		/** Why each package was included */
+		TMap<FName, FString> Reasons;
+	};
+
+	/** The packages of one channel */
+	struct FChannel
+	{
+		FString Name;
+		/** Files of each package, packages in the order they were found; a file that isn't a package is an entry of its own */
+		TArray<TArray<FString>> PackageFiles;
+		int64 Bytes;
+
+		FChannel() : Bytes(0) {}
+	};
+
+	/**
+	 * Collects the files under ContentFolder that hold the configured assets and their dependencies, and writes a
+	 * report listing each included package, its size and why it was included. Only reads files, so it can run on
+	 * any thread.
+	 *
+	 * @param AssetPackages - The packages of all entries of the Assets setting together, from GetPackages.
+	 * @param ContentFolder - The cooked (or uncooked) Content folder the files are taken from.
+	 * @param ReportFilename - Where to write the report.
+	 * @param OutFilenames - Full paths of the files to pak.
+	 * @return false if no assets are configured, in which case the whole folder should be paked.
+	 */
+	static bool Gather(const FAssetPackages& AssetPackages, const FString& ContentFolder, const FString& ReportFilename, TArray<FString>& OutFilenames);
+
+	/**
+	 * Like Gather, but split into channels: Common first (if any package is shared), then one per distinct channel
+	 * name in the order of the Assets setting. Entries with the same name make one channel. A channel without files is
+	 * kept, so clients see it exists; Common is only there if a package is shared or a file isn't a package.
+	 *
+	 * @param AssetPackages - The packages of each entry of the Assets setting, from GetChannelPackages.
+	 * @return false if no assets are configured.
+	 */
+	static bool GatherChannels(const TArray<FAssetPackages>& AssetPackages, const FString& ContentFolder, const FString& ReportFilename, TArray<FChannel>& OutChannels);
+
+	/**
+	 * Finds the configured assets' packages and every /Game package they reference, roots first. Uses the Asset
+	 * Registry, so only call it on the game thread.
+	 *
+	 * @param OutReasons - If set, receives why each package was included.
+	 * @param Channel - Index of the one entry of the Assets setting to start from, or INDEX_NONE for all of them.
+	 * @return false if no assets are configured.
+	 */
+	static bool GetPackages(TArray<FName>& OutPackages, TMap<FName, FString>* OutReasons = nullptr, int32 Channel = INDEX_NONE);
+
+	/** GetPackages for each entry of the Assets setting that has any, with its channel name. Game thread only, like GetPackages. */
+	static void GetChannelPackages(TArray<FAssetPackages>& OutAssetPackages);
+
+	/** Name of the channel of an entry of the Assets setting: its Name reduced to letters and digits, or Channel<index> */
+	static FString GetChannelName(int32 Channel);
+
+private:
+	/**
+	 * Finds the files of each package under ContentFolder, by package name, and the files that don't belong to a
+	 * package (no .uasset or .umap of the same name) in OutOtherFiles.
+	 */
+	static void GetFilesByPackage(const FString& ContentFolder, TMap<FString, TArray<FString>>& OutFilesByPackage, TArray<FString>& OutOtherFiles, int64& OutAllBytes);
+};
@@ -0,0 +1,256 @@
+// Copyright 1998-2016 Epic Games, Inc. All Rights Reserved.
+
+#include "DeployToPakEditorPrivatePCH.h"
+#include "PakManifest.h"
+#include "PakCompression.h"
+#include "SecureHash.h"
+
+DEFINE_LOG_CATEGORY_STATIC(PakManifest, Log, All);
+
+static const TCHAR* ManifestExtension = TEXT(".manifest");
+static const TCHAR* PendingExtension = TEXT(".manifest.pending");
+
+static FString GetPatchPakFilename(const FString& FullPakFilename, int32 Patch)
+{
+	return FPaths::GetPath(FullPakFilename) / FPaths::GetBaseFilename(FullPakFilename) + FString::Printf(TEXT("_%d_P.pak"), Patch);
+}
+
+EPakPrepareResult FPakManifest::Prepare(const FString& ContentFolder, const TArray<FString>& Filenames, const FString& FullPakFilename, const FPakCompressionPolicy& Compression, bool bFull, int32 MaxPatches, FString& OutPakFilename, FString& OutResponseFile)
+{
+	FManifest Last;
+	const bool bHaveLast = Load(FullPakFilename + ManifestExtension, Last) && FPaths::FileExists(FullPakFilename);
+
+	FManifest Next;
+	TArray<FString> Changed;
+	double HashSeconds = 0;
+	for (const FString& Filename : Filenames)
+	{
+		FString RelativePath = Filename;
+		FPaths::MakePathRelativeTo(RelativePath, *ContentFolder);
+		FEntry Entry;
+		Entry.Size = IFileManager::Get().FileSize(*Filename);
+		Entry.TimeStamp = IFileManager::Get().GetTimeStamp(*Filename);
+
+		// Iterative cooks leave unchanged files alone, so only hash the ones that were touched
+		const FEntry* LastEntry = Last.Files.Find(RelativePath);
+		if (LastEntry != nullptr && LastEntry->Size == Entry.Size && LastEntry->TimeStamp == Entry.TimeStamp)
+		{
+			Entry.Hash = LastEntry->Hash;
+		}
+		else
+		{
+			const double Start = FPlatformTime::Seconds();
+			Entry.Hash = HashFile(Filename);
+			HashSeconds += FPlatformTime::Seconds() - Start;
+		}
+		if (LastEntry == nullptr || LastEntry->Hash != Entry.Hash)
+		{
+			Changed.Add(Filename);
+		}
+		Next.Files.Add(RelativePath, Entry);
+	}
+
+	int32 Deleted = 0;
+	for (const TPair<FString, FEntry>& Pair : Last.Files)
+	{
+		if (!Next.Files.Contains(Pair.Key))
+		{
+			Deleted++;
+		}
+	}
+
+	if (!bHaveLast || bFull || Deleted > 0 || Last.Patch >= MaxPatches)
+	{
+		if (bHaveLast && !bFull)
+		{
+			UE_LOG(PakManifest, Log, TEXT("Making a full pak: %s"), Deleted > 0 ? TEXT("files were deleted since the last pak") : TEXT("the patch limit was reached"));
+		}
+		Next.Patch = 0;
+		Next.PakFilename = FullPakFilename;
+		Changed = Filenames;
+	}
+	else
+	{
+		if (Changed.Num() == 0)
+		{
+			UE_LOG(PakManifest, Log, TEXT("No content changed since %s"), *Last.PakFilename);
+			// A pak made for a deploy that never finished is no longer needed
+			IFileManager::Get().Delete(*(FullPakFilename + PendingExtension));
+			OutPakFilename = Last.PakFilename;
+			return EPakPrepareResult::Nothing;
+		}
+		Next.Patch = Last.Patch + 1;
+		Next.PakFilename = GetPatchPakFilename(FullPakFilename, Next.Patch);
+		// The placeholder keeps the Content folder as the pak's mount point, as it does for the full pak
+		const FString Placeholder = ContentFolder / TEXT("unrealpakPlaceholder");
+		if (FPaths::FileExists(Placeholder))
+		{
+			Changed.AddUnique(Placeholder);
+		}
+	}
+	UE_LOG(PakManifest, Log, TEXT("%s: %d of %d files (%.1fs hashing)"), *FPaths::GetCleanFilename(Next.PakFilename), Changed.Num(), Filenames.Num(), HashSeconds);
+
+	FString Response;
+	int32 Compressed = 0;
+	for (const FString& Filename : Changed)
+	{
+		const EPakCompression FileCompression = Compression.Choose(ContentFolder, Filename);
+		Compressed += FileCompression != EPakCompression::None ? 1 : 0;
+		Response += FString::Printf(TEXT("\"%s\" \"%s\"%s") LINE_TERMINATOR, *Filename, *Filename, FPakCompressionPolicy::GetResponseFileFlags(FileCompression));
+	}
+	UE_LOG(PakManifest, Log, TEXT("%d of %d files compressed"), Compressed, Changed.Num());
+	OutResponseFile = FPaths::GetPath(FullPakFilename) / FPaths::GetBaseFilename(Next.PakFilename) + TEXT(".txt");
+	if (!FFileHelper::SaveStringToFile(Response, *OutResponseFile) || !Save(FullPakFilename + PendingExtension, Next))
+	{
+		UE_LOG(PakManifest, Error, TEXT("Failed to write %s"), *OutResponseFile);
+		return EPakPrepareResult::Failed;
+	}
+	OutPakFilename = Next.PakFilename;
+	return EPakPrepareResult::Ready;
+}
+
+void FPakManifest::Commit(const FString& FullPakFilename)
+{
+	const FString Pending = FullPakFilename + PendingExtension;
+	FManifest Manifest;
+	if (!Load(Pending, Manifest))
+	{
+		return;
+	}
+	if (!IFileManager::Get().Move(*(FullPakFilename + ManifestExtension), *Pending))
+	{
+		UE_LOG(PakManifest, Error, TEXT("Failed to update the manifest of %s"), *FullPakFilename);
+		return;
+	}
+	if (Manifest.Patch == 0)
+	{
+		// A new full pak replaces every earlier patch
+		TArray<FString> Patches;
+		IFileManager::Get().FindFiles(Patches, *(FPaths::GetPath(FullPakFilename) / FPaths::GetBaseFilename(FullPakFilename) + TEXT("_*_P.pak")), true, false);
+		for (const FString& Patch : Patches)
+		{
+			IFileManager::Get().Delete(*(FPaths::GetPath(FullPakFilename) / Patch));
+		}
+	}
+}
+
+FString FPakManifest::GetPakToDeploy(const FString& FullPakFilename)
+{
+	FManifest Manifest;
+	if (Load(FullPakFilename + PendingExtension, Manifest) || Load(FullPakFilename + ManifestExtension, Manifest))
+	{
+		return Manifest.PakFilename;
+	}
+	return FullPakFilename;
+}
+
+bool FPakManifest::IsPending(const FString& FullPakFilename)
+{
+	return FPaths::FileExists(FullPakFilename + PendingExtension);
+}
+
+void FPakManifest::GetPaks(const FString& FullPakFilename, TArray<FString>& OutPakFilenames)
+{
+	OutPakFilenames.Reset();
+	OutPakFilenames.Add(FullPakFilename);
+	FManifest Manifest;
+	if (Load(FullPakFilename + PendingExtension, Manifest) || Load(FullPakFilename + ManifestExtension, Manifest))
+	{
+		for (int32 Patch = 1; Patch <= Manifest.Patch; Patch++)
+		{
+			OutPakFilenames.Add(GetPatchPakFilename(FullPakFilename, Patch));
+		}
+	}
+}
+
+bool FPakManifest::IsPatchPak(const FString& PakFilename)
+{
+	const FString Name = FPaths::GetBaseFilename(PakFilename);
+	if (!Name.EndsWith(TEXT("_P")))
+	{
+		return false;
+	}
+	const FString Rest = Name.LeftChop(2);
+	int32 Separator = INDEX_NONE;
+	return Rest.FindLastChar(TEXT('_'), Separator) && Rest.Mid(Separator + 1).IsNumeric();
+}
+
+void FPakManifest::Reset()
+{
+	const FString CookedDir = FPaths::ConvertRelativePathToFull(FPaths::GameSavedDir() / TEXT("Cooked"));
+	TArray<FString> Manifests;
+	IFileManager::Get().FindFiles(Manifests, *(CookedDir / TEXT("*.manifest")), true, false);
+	for (const FString& Manifest : Manifests)
+	{
+		IFileManager::Get().Delete(*(CookedDir / Manifest));
+	}
+	UE_LOG(PakManifest, Log, TEXT("Forgot %d pak manifests; the next pak of each platform will be a full pak"), Manifests.Num());
+}
+
+bool FPakManifest::Load(const FString& Filename, FManifest& OutManifest)
+{
+	FString Text;
+	if (!FFileHelper::LoadFileToString(Text, *Filename))
+	{
+		return false;
+	}
+	TArray<FString> Lines;
+	Text.ParseIntoArrayLines(Lines);
+	OutManifest = FManifest();
+	for (const FString& Line : Lines)
+	{
+		TArray<FString> Fields;
+		Line.ParseIntoArray(Fields, TEXT("\t"), false);
+		if (Fields.Num() == 2 && Fields[0] == TEXT("Pak"))
+		{
+			OutManifest.PakFilename = Fields[1];
+		}
+		else if (Fields.Num() == 2 && Fields[0] == TEXT("Patch"))
+		{
+			OutManifest.Patch = FCString::Atoi(*Fields[1]);
+		}
+		else if (Fields.Num() == 4)
+		{
+			FEntry Entry;
+			Entry.Hash = Fields[0];
+			Entry.Size = FCString::Atoi64(*Fields[1]);
+			Entry.TimeStamp = FDateTime(FCString::Atoi64(*Fields[2]));
+			OutManifest.Files.Add(Fields[3], Entry);
+		}
+	}
+	return OutManifest.PakFilename.Len() > 0;
+}
+
+bool FPakManifest::Save(const FString& Filename, const FManifest& Manifest)
+{
+	FString Text = FString::Printf(TEXT("Pak\t%s") LINE_TERMINATOR TEXT("Patch\t%d") LINE_TERMINATOR, *Manifest.PakFilename, Manifest.Patch);
+	for (const TPair<FString, FEntry>& Pair : Manifest.Files)
+	{
+		Text += FString::Printf(TEXT("%s\t%lld\t%lld\t%s") LINE_TERMINATOR, *Pair.Value.Hash, Pair.Value.Size, Pair.Value.TimeStamp.GetTicks(), *Pair.Key);
+	}
+	return FFileHelper::SaveStringToFile(Text, *Filename, FFileHelper::EEncodingOptions::ForceUTF8WithoutBOM);
+}
+
+FString FPakManifest::HashFile(const FString& Filename)
+{
+	TUniquePtr<FArchive> Reader(IFileManager::Get().CreateFileReader(*Filename));
+	if (!Reader)
+	{
+		return FString();
+	}
+	FSHA1 Hasher;
+	TArray<uint8> Buffer;
+	Buffer.SetNumUninitialized(1024 * 1024);
+	int64 Remaining = Reader->TotalSize();
+	while (Remaining > 0)
+	{
+		const int32 Size = (int32)FMath::Min<int64>(Remaining, Buffer.Num());
+		Reader->Serialize(Buffer.GetData(), Size);
+		Hasher.Update(Buffer.GetData(), Size);
+		Remaining -= Size;
+	}
+	Hasher.Final();
+	FSHAHash Hash;
+	Hasher.GetHash(Hash.Hash);
+	return Hash.ToString();
+}
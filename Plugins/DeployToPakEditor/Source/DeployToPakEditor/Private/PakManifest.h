@@ -0,0 +1,88 @@
+// Copyright 1998-2016 Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "Engine.h"
+
+/** Outcome of preparing a pak */
+enum class EPakPrepareResult : uint8
+{
+	/** Nothing changed since the last pak, so there is nothing to pak */
+	Nothing,
+	/** A pak is ready to be made */
+	Ready,
+	/** Preparing the pak failed */
+	Failed,
+};
+
+/**
+ * Remembers the content hash of every file that went into the last deployed pak of a platform, so the next one
+ * can be a patch pak holding only the files that are new or changed since. Patch paks are named
+ * <pak name>_<N>_P.pak and mount above the full pak and earlier patches on the client.
+ *
+ * The manifest sits next to the full pak as <pak name>.manifest. Prepare writes the manifest of the pak about to
+ * be made as <pak name>.manifest.pending, and Commit makes it current once that pak is deployed; a failed pak or
+ * upload leaves the old manifest, so the next patch still carries the changes.
+ */
+class FPakManifest
+{
+public:
+	/**
+	 * Works out the files the next pak for FullPakFilename has to hold and writes the UnrealPak response file listing them.
+	 * The pak is a full one if there is no manifest yet, bFull is set, files were deleted (a patch can't remove them)
+	 * or MaxPatches patches have been made since the last full pak.
+	 *
+	 * @param ContentFolder - The cooked (or uncooked) Content folder to pak.
+	 * @param Filenames - Full paths of the files under ContentFolder that belong in the pak.
+	 * @param FullPakFilename - Name of the full pak of the platform.
+	 * @param Compression - Chooses how each file is stored.
+	 * @param OutPakFilename - The pak to create, either FullPakFilename or the next patch pak.
+	 * @param OutResponseFile - The response file to pass to UnrealPak -create=.
+	 * @return Nothing if nothing changed since the last pak, Failed if the response file or manifest couldn't be written.
+	 */
+	static EPakPrepareResult Prepare(const FString& ContentFolder, const TArray<FString>& Filenames, const FString& FullPakFilename, const class FPakCompressionPolicy& Compression, bool bFull, int32 MaxPatches, FString& OutPakFilename, FString& OutResponseFile);
+
+	/** Makes the manifest written by Prepare the current one, once its pak is deployed */
+	static void Commit(const FString& FullPakFilename);
+
+	/** The pak Prepare chose last for FullPakFilename, if it hasn't been committed yet, or else the last deployed one */
+	static FString GetPakToDeploy(const FString& FullPakFilename);
+
+	/** Whether Prepare chose a pak for FullPakFilename that hasn't been committed yet */
+	static bool IsPending(const FString& FullPakFilename);
+
+	/** The paks a client mounts for FullPakFilename once the pak to deploy is deployed: the full pak, then its patches in order */
+	static void GetPaks(const FString& FullPakFilename, TArray<FString>& OutPakFilenames);
+
+	/** Whether PakFilename is a patch pak, named <pak name>_<N>_P.pak */
+	static bool IsPatchPak(const FString& PakFilename);
+
+	/** Forgets what was deployed for every platform, so the next pak of each is a full pak */
+	static void Reset();
+
+	/** SHA1 of a file's contents, or an empty string if it can't be read */
+	static FString HashFile(const FString& Filename);
+
+private:
+	struct FEntry
+	{
+		FString Hash;
+		int64 Size;
+		FDateTime TimeStamp;
+	};
+
+	struct FManifest
+	{
+		/** Pak this manifest describes */
+		FString PakFilename;
+		/** Number of the patch, 0 for a full pak */
+		int32 Patch;
+		/** Files by path relative to the Content folder */
+		TMap<FString, FEntry> Files;
+
+		FManifest() : Patch(0) {}
+	};
+
+	static bool Load(const FString& Filename, FManifest& OutManifest);
+	static bool Save(const FString& Filename, const FManifest& Manifest);
+};
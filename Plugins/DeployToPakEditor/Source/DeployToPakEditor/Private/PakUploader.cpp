@@ -0,0 +1,810 @@
+// Copyright 1998-2016 Epic Games, Inc. All Rights Reserved.
+
+#include "DeployToPakEditorPrivatePCH.h"
+#include "PakUploader.h"
+#include "PakChannels.h"
+#include "DeployProfiler.h"
+#include "SNotificationList.h"
+#include "NotificationManager.h"
+#include "EditorStyleSet.h"
+#include "UnrealEd.h"
+#include "SecureHash.h"
+#include "Async.h"
+
+#define LOCTEXT_NAMESPACE "PakUploader"
+
+DEFINE_LOG_CATEGORY_STATIC(PakUploader, Log, All);
+
+/** Times a part is sent before the upload gives up */
+static const int32 MaxAttempts = 5;
+/** Longest wait between attempts at a part */
+static const float MaxRetryDelay = 30.0f;
+/** Times the parts are queried again when the server reports some missing on completion */
+static const int32 MaxCompleteAttempts = 2;
+/** Seconds between progress lines in a commandlet, which has no notification */
+static const double ProgressLogInterval = 10.0;
+/**
+ * Largest pak sent in a single request, to servers that take neither chunks nor parts. The HTTP module only sends
+ * bodies held in memory, so the whole pak is read in (and copied into the request) to send it.
+ */
+static const int64 MaxWholeUploadBytes = 1024 * 1024 * 1024;
+/** Columns of Saved/Cooked/UploadStats.csv, now and before RepeatedBytes was added */
+static const TCHAR* UploadStatsHeader = TEXT("Date,Pak,Mode,PakBytes,SentBytes,SkippedBytes,Seconds,RepeatedBytes");
+static const TCHAR* UploadStatsHeaderNoRepeats = TEXT("Date,Pak,Mode,PakBytes,SentBytes,SkippedBytes,Seconds");
+
+TArray<TSharedPtr<FPakUploader, ESPMode::ThreadSafe>> FPakUploader::Active;
+
+FPakUploader::FPakUploader(const TArray<FString>& InFilenames, const FString& InFolderURL, const FString& InQuery, const FString& InFullPakFilename, const FString& InTargetPlatform, const FText& InPlatformDisplayName, const FOnPakUploaded& InOnUploaded)
+	: Filenames(InFilenames)
+	, FolderURL(InFolderURL)
+	, Query(InQuery)
+	, FullPakFilename(InFullPakFilename)
+	, TargetPlatform(InTargetPlatform)
+	, PlatformDisplayName(InPlatformDisplayName)
+	, OnUploaded(InOnUploaded)
+	, FileIndex(0)
+	, PreviousBytes(0)
+	, PreviousBytesSent(0)
+	, PreviousBytesRepeated(0)
+	, StartTime(0)
+	, LastLogTime(0)
+	, Mode(EMode::Chunks)
+	, TotalSize(0)
+	, MaxParallel(1)
+	, BytesDone(0)
+	, BytesSkipped(0)
+	, BytesRepeated(0)
+	, FileStartTime(0)
+	, NegotiateAttempts(0)
+	, CompleteAttempts(0)
+	, bFinished(false)
+{
+}
+
+bool FPakUploader::Start(const TArray<FString>& Filenames, const FString& FolderURL, const FString& Query, const FString& FullPakFilename, const FString& TargetPlatform, const FText& PlatformDisplayName, const FOnPakUploaded& OnUploaded)
+{
+	FDeployProfiler::BeginUpload(TargetPlatform);
+	TSharedPtr<FPakUploader, ESPMode::ThreadSafe> Uploader = MakeShareable(new FPakUploader(Filenames, FolderURL, Query, FullPakFilename, TargetPlatform, PlatformDisplayName, OnUploaded));
+	Uploader->MaxParallel = FMath::Max(FDeployToPakEditorModule::Get().GetParallelUploads(), 1);
+	if (Filenames.Num() == 0 || !Uploader->StartFile(0))
+	{
+		FDeployProfiler::EndUpload(TargetPlatform, false, 0);
+		return false;
+	}
+
+	if (!IsRunningCommandlet())
+	{
+		FFormatNamedArguments Arguments;
+		Arguments.Add(TEXT("Platform"), PlatformDisplayName);
+		FNotificationInfo Info(FText::Format(LOCTEXT("UploadHashing", "Hashing pak for {Platform}..."), Arguments));
+		Info.Image = FEditorStyle::GetBrush(TEXT("MainFrame.CookContent"));
+		Info.bFireAndForget = false;
+		Info.ExpireDuration = 5.0f;
+		Info.ButtonDetails.Add(
+			FNotificationButtonInfo(
+				LOCTEXT("UploadCancel", "Cancel"),
+				LOCTEXT("UploadCancelToolTip", "Stops the upload; uploading the same pak again resumes it."),
+				FSimpleDelegate::CreateThreadSafeSP(Uploader.ToSharedRef(), &FPakUploader::Cancel)
+			)
+		);
+		Uploader->NotificationItem = FSlateNotificationManager::Get().AddNotification(Info);
+		if (Uploader->NotificationItem.IsValid())
+		{
+			Uploader->NotificationItem->SetCompletionState(SNotificationItem::CS_Pending);
+		}
+	}
+
+	UE_LOG(PakUploader, Log, TEXT("Uploading %d files to %s, %d requests at a time"), Filenames.Num(), *FolderURL, Uploader->MaxParallel);
+	Uploader->StartTime = FPlatformTime::Seconds();
+	Uploader->TickHandle = FTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateThreadSafeSP(Uploader.ToSharedRef(), &FPakUploader::Tick), 0.5f);
+	Active.Add(Uploader);
+	Uploader->ChunkPak();
+	return true;
+}
+
+bool FPakUploader::StartFile(int32 Index)
+{
+	IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+	FileIndex = Index;
+	Filename = Filenames[Index];
+	URL = FolderURL / FPaths::GetCleanFilename(Filename);
+	TotalSize = PlatformFile.FileSize(*Filename);
+	if (TotalSize <= 0)
+	{
+		UE_LOG(PakUploader, Error, TEXT("Can't upload %s: the file is missing or empty"), *Filename);
+		return false;
+	}
+
+	// The same file gets the same id, so a server without a chunk store can tell which of its parts it has already
+	const FString Identity = FString::Printf(TEXT("%s|%lld|%lld"), *FPaths::GetCleanFilename(Filename), TotalSize, PlatformFile.GetTimeStamp(*Filename).GetTicks());
+	FTCHARToUTF8 IdentityUtf8(*Identity);
+	FSHAHash Hash;
+	FSHA1::HashBuffer(IdentityUtf8.Get(), IdentityUtf8.Length(), Hash.Hash);
+	UploadId = Hash.ToString().Left(16).ToLower();
+
+	Mode = EMode::Chunks;
+	Recipe = FPakChunkRecipe();
+	Parts.Reset();
+	BytesDone = 0;
+	BytesSkipped = 0;
+	BytesRepeated = 0;
+	NegotiateAttempts = 0;
+	CompleteAttempts = 0;
+	FileStartTime = FPlatformTime::Seconds();
+	return true;
+}
+
+void FPakUploader::FinishFile()
+{
+	const double Seconds = FPlatformTime::Seconds() - FileStartTime;
+	const int64 BytesSent = TotalSize - BytesSkipped - BytesRepeated;
+	UE_LOG(PakUploader, Log, TEXT("Uploaded %s in %.1fs: sent %lld of %lld bytes, %lld (%.0f%%) were on the server already, %lld repeated chunks of the pak"),
+		*FPaths::GetCleanFilename(Filename), Seconds, BytesSent, TotalSize, BytesSkipped, 100.0 * BytesSkipped / TotalSize, BytesRepeated);
+	WriteStats(Seconds);
+	PreviousBytes += TotalSize;
+	PreviousBytesSent += BytesSent;
+	PreviousBytesRepeated += BytesRepeated;
+	if (FileIndex + 1 >= Filenames.Num())
+	{
+		Finish(true, LOCTEXT("UploadSucceeded", "Completed uploading Pak file!"));
+		return;
+	}
+	if (!StartFile(FileIndex + 1))
+	{
+		Finish(false, LOCTEXT("UploadFileMissing", "Failed to upload Pak file!"));
+		return;
+	}
+	ChunkPak();
+}
+
+FString FPakUploader::GetPartURL(int32 Index) const
+{
+	if (Mode == EMode::Chunks)
+	{
+		return FString::Printf(TEXT("%s?chunk=%s"), *URL, *Parts[Index].Hash);
+	}
+	return FString::Printf(TEXT("%s?upload=%s&part=%d"), *URL, *UploadId, Index);
+}
+
+void FPakUploader::ChunkPak()
+{
+	TSharedRef<FPakUploader, ESPMode::ThreadSafe> This = AsShared();
+	const FString File = Filename;
+	AsyncTask(ENamedThreads::AnyThread, [This, File]()
+	{
+		const double Start = FPlatformTime::Seconds();
+		// Chunks aren't kept: only their hashes are needed, and the parts the server lacks are read again to send them
+		FPakChunker Chunker(false);
+		FPakChunkRecipe ChunkRecipe;
+		TUniquePtr<FArchive> Reader(IFileManager::Get().CreateFileReader(*File));
+		bool bSucceeded = Reader.IsValid();
+		if (bSucceeded)
+		{
+			TArray<uint8> Buffer;
+			Buffer.SetNumUninitialized(1024 * 1024);
+			for (int64 Remaining = Reader->TotalSize(); Remaining > 0 && bSucceeded; )
+			{
+				const int32 Size = (int32)FMath::Min<int64>(Remaining, Buffer.Num());
+				Reader->Serialize(Buffer.GetData(), Size);
+				bSucceeded = !Reader->IsError() && Chunker.Write(Buffer.GetData(), Size);
+				Remaining -= Size;
+			}
+			bSucceeded = bSucceeded && Chunker.Finish(ChunkRecipe);
+		}
+		UE_LOG(PakUploader, Log, TEXT("Split %s into %d chunks in %.1fs"), *FPaths::GetCleanFilename(File), ChunkRecipe.Chunks.Num(), FPlatformTime::Seconds() - Start);
+		AsyncTask(ENamedThreads::GameThread, [This, bSucceeded, ChunkRecipe]()
+		{
+			This->HandlePakChunked(bSucceeded, ChunkRecipe);
+		});
+	});
+}
+
+void FPakUploader::HandlePakChunked(bool bSucceeded, const FPakChunkRecipe& InRecipe)
+{
+	if (bFinished)
+	{
+		return;
+	}
+	if (!bSucceeded || InRecipe.GetTotalSize() != TotalSize)
+	{
+		Finish(false, LOCTEXT("UploadChunkFailed", "Failed to read the pak; it may have changed during the upload"));
+		return;
+	}
+	Recipe = InRecipe;
+	TArray<int64> Offsets;
+	Recipe.GetOffsets(Offsets);
+	Parts.SetNum(Recipe.Chunks.Num());
+	for (int32 Index = 0; Index < Parts.Num(); Index++)
+	{
+		Parts[Index].Offset = Offsets[Index];
+		Parts[Index].Size = (int32)Recipe.Chunks[Index].Size;
+		Parts[Index].Hash = Recipe.Chunks[Index].Hash.ToString();
+	}
+	NegotiateChunks();
+}
+
+void FPakUploader::NegotiateChunks()
+{
+	TSharedRef<IHttpRequest> Request = FHttpModule::Get().CreateRequest();
+	Request->SetURL(URL + TEXT("?missing"));
+	Request->SetVerb(TEXT("POST"));
+	Request->SetHeader(TEXT("Content-Type"), TEXT("text/plain"));
+	Request->SetContentAsString(Recipe.ToString());
+	Request->OnProcessRequestComplete().BindThreadSafeSP(AsShared(), &FPakUploader::HandleNegotiateComplete);
+	Request->ProcessRequest();
+}
+
+void FPakUploader::HandleNegotiateComplete(FHttpRequestPtr HttpRequest, FHttpResponsePtr HttpResponse, bool bSucceeded)
+{
+	if (bFinished)
+	{
+		return;
+	}
+	const int32 ResponseCode = HttpResponse.IsValid() ? HttpResponse->GetResponseCode() : -1;
+	if (bSucceeded && (ResponseCode == 404 || ResponseCode == 405 || ResponseCode == 501))
+	{
+		UE_LOG(PakUploader, Log, TEXT("%s has no chunk store (%d); uploading %s in parts"), *URL, ResponseCode, *FPaths::GetCleanFilename(Filename));
+		UseParts();
+		return;
+	}
+	if (!bSucceeded || ResponseCode != 200)
+	{
+		if (++NegotiateAttempts >= MaxAttempts)
+		{
+			UE_LOG(PakUploader, Error, TEXT("Couldn't ask %s for missing chunks: %d"), *HttpRequest->GetURL(), ResponseCode);
+			Finish(false, LOCTEXT("UploadNegotiateFailed", "Failed to upload Pak file!"));
+			return;
+		}
+		const float Delay = FMath::Min(FMath::Pow(2.0f, NegotiateAttempts - 1), MaxRetryDelay);
+		TSharedRef<FPakUploader, ESPMode::ThreadSafe> This = AsShared();
+		FTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateLambda([This](float DeltaTime)
+		{
+			if (!This->bFinished)
+			{
+				This->NegotiateChunks();
+			}
+			return false;
+		}), Delay);
+		return;
+	}
+
+	TArray<FString> Lines;
+	HttpResponse->GetContentAsString().ParseIntoArrayLines(Lines);
+	TSet<FString> Missing;
+	for (const FString& Line : Lines)
+	{
+		Missing.Add(Line.Trim().TrimTrailing().ToUpper());
+	}
+	// A chunk that repeats within the pak is sent once
+	TSet<FString> Sending;
+	BytesDone = 0;
+	BytesSkipped = 0;
+	BytesRepeated = 0;
+	int32 MissingChunks = 0;
+	for (FPart& Part : Parts)
+	{
+		Part.Attempts = 0;
+		if (!Missing.Contains(Part.Hash))
+		{
+			Part.State = EPartState::Done;
+			BytesDone += Part.Size;
+			BytesSkipped += Part.Size;
+		}
+		else if (Sending.Contains(Part.Hash))
+		{
+			Part.State = EPartState::Done;
+			BytesDone += Part.Size;
+			BytesRepeated += Part.Size;
+		}
+		else
+		{
+			Sending.Add(Part.Hash);
+			Part.State = EPartState::Pending;
+			MissingChunks++;
+		}
+	}
+	UE_LOG(PakUploader, Log, TEXT("%s: %d of %d chunks (%lld of %lld bytes) to send"),
+		*FPaths::GetCleanFilename(Filename), MissingChunks, Parts.Num(), TotalSize - BytesSkipped - BytesRepeated, TotalSize);
+	if (BytesDone == TotalSize)
+	{
+		CompleteUpload();
+		return;
+	}
+	Pump();
+}
+
+void FPakUploader::UseParts()
+{
+	Mode = EMode::Parts;
+	const int32 PartSize = FMath::Max(FDeployToPakEditorModule::Get().GetUploadChunkMB(), 1) * 1024 * 1024;
+	Parts.Reset();
+	Parts.SetNum((int32)((TotalSize + PartSize - 1) / PartSize));
+	for (int32 Index = 0; Index < Parts.Num(); Index++)
+	{
+		Parts[Index].Offset = (int64)Index * PartSize;
+		Parts[Index].Size = (int32)FMath::Min<int64>(PartSize, TotalSize - Parts[Index].Offset);
+	}
+	BytesDone = 0;
+	BytesSkipped = 0;
+	BytesRepeated = 0;
+	QueryParts();
+}
+
+void FPakUploader::QueryParts()
+{
+	TSharedRef<IHttpRequest> Request = FHttpModule::Get().CreateRequest();
+	Request->SetURL(FString::Printf(TEXT("%s?upload=%s"), *URL, *UploadId));
+	Request->SetVerb(TEXT("GET"));
+	Request->OnProcessRequestComplete().BindThreadSafeSP(AsShared(), &FPakUploader::HandleQueryComplete);
+	Request->ProcessRequest();
+}
+
+void FPakUploader::HandleQueryComplete(FHttpRequestPtr HttpRequest, FHttpResponsePtr HttpResponse, bool bSucceeded)
+{
+	if (bFinished)
+	{
+		return;
+	}
+	// Anything but a list means nothing to resume; a server without part uploads shows itself on the first part
+	if (bSucceeded && HttpResponse.IsValid() && HttpResponse->GetResponseCode() == 200)
+	{
+		TArray<FString> Lines;
+		HttpResponse->GetContentAsString().ParseIntoArrayLines(Lines);
+		for (const FString& Line : Lines)
+		{
+			const int32 Index = FCString::Atoi(*Line);
+			if (Line.IsNumeric() && Parts.IsValidIndex(Index) && Parts[Index].State == EPartState::Pending)
+			{
+				Parts[Index].State = EPartState::Done;
+				BytesDone += Parts[Index].Size;
+			}
+		}
+		BytesSkipped = BytesDone;
+		if (BytesSkipped > 0)
+		{
+			UE_LOG(PakUploader, Log, TEXT("Resuming upload %s of %s: the server has %lld of %lld bytes"), *UploadId, *FPaths::GetCleanFilename(Filename), BytesSkipped, TotalSize);
+		}
+	}
+	if (BytesDone == TotalSize)
+	{
+		CompleteUpload();
+		return;
+	}
+	Pump();
+}
+
+void FPakUploader::Pump()
+{
+	int32 InFlight = 0;
+	for (const FPart& Part : Parts)
+	{
+		InFlight += Part.State == EPartState::Reading || Part.State == EPartState::Sending ? 1 : 0;
+	}
+	for (int32 Index = 0; Index < Parts.Num() && InFlight < MaxParallel; Index++)
+	{
+		if (Parts[Index].State == EPartState::Pending)
+		{
+			ReadPart(Index);
+			InFlight++;
+		}
+	}
+}
+
+void FPakUploader::ReadPart(int32 Index)
+{
+	Parts[Index].State = EPartState::Reading;
+	TSharedRef<FPakUploader, ESPMode::ThreadSafe> This = AsShared();
+	const FString File = Filename;
+	const int64 Offset = Parts[Index].Offset;
+	const int32 Size = Parts[Index].Size;
+	const int64 ExpectedSize = TotalSize;
+	// Reading and hashing a part takes a while for large parts, so keep it off the game thread
+	AsyncTask(ENamedThreads::AnyThread, [This, Index, File, Offset, Size, ExpectedSize]()
+	{
+		TSharedPtr<TArray<uint8>, ESPMode::ThreadSafe> Data;
+		FString Hash;
+		TUniquePtr<FArchive> Reader(IFileManager::Get().CreateFileReader(*File));
+		if (Reader && Reader->TotalSize() == ExpectedSize)
+		{
+			Data = MakeShareable(new TArray<uint8>());
+			Data->SetNumUninitialized(Size);
+			Reader->Seek(Offset);
+			Reader->Serialize(Data->GetData(), Size);
+			if (Reader->IsError())
+			{
+				Data.Reset();
+			}
+			else
+			{
+				FSHAHash PartHash;
+				FSHA1::HashBuffer(Data->GetData(), Size, PartHash.Hash);
+				Hash = PartHash.ToString();
+			}
+		}
+		AsyncTask(ENamedThreads::GameThread, [This, Index, Data, Hash]()
+		{
+			This->SendPart(Index, Data, Hash);
+		});
+	});
+}
+
+void FPakUploader::SendPart(int32 Index, TSharedPtr<TArray<uint8>, ESPMode::ThreadSafe> Data, FString Hash)
+{
+	// The part may have been canceled, or the upload fallen back to a single request, while it was read
+	if (bFinished || !Parts.IsValidIndex(Index) || Parts[Index].State != EPartState::Reading)
+	{
+		return;
+	}
+	if (!Data.IsValid() || (Mode == EMode::Chunks && Hash != Parts[Index].Hash))
+	{
+		Finish(false, LOCTEXT("UploadReadFailed", "Failed to read the pak; it may have changed during the upload"));
+		return;
+	}
+	TSharedRef<IHttpRequest> Request = FHttpModule::Get().CreateRequest();
+	Request->SetURL(GetPartURL(Index));
+	Request->SetVerb(TEXT("PUT"));
+	Request->SetHeader(TEXT("Content-Type"), TEXT("application/octet-stream"));
+	if (Mode == EMode::Parts)
+	{
+		const int64 Offset = Parts[Index].Offset;
+		Request->SetHeader(TEXT("Content-Range"), FString::Printf(TEXT("bytes %lld-%lld/%lld"), Offset, Offset + Data->Num() - 1, TotalSize));
+		Request->SetHeader(TEXT("X-Part-SHA1"), Hash);
+	}
+	Request->SetContent(*Data);
+	Request->OnRequestProgress().BindThreadSafeSP(AsShared(), &FPakUploader::HandlePartProgress, Index);
+	Request->OnProcessRequestComplete().BindThreadSafeSP(AsShared(), &FPakUploader::HandlePartComplete, Index);
+	FPart& Part = Parts[Index];
+	Part.State = EPartState::Sending;
+	Part.BytesSent = 0;
+	Part.Request = Request;
+	Request->ProcessRequest();
+}
+
+void FPakUploader::HandlePartProgress(FHttpRequestPtr HttpRequest, int32 BytesSent, int32 BytesReceived, int32 Index)
+{
+	if (Parts.IsValidIndex(Index) && Parts[Index].Request == HttpRequest)
+	{
+		Parts[Index].BytesSent = BytesSent;
+	}
+}
+
+void FPakUploader::HandlePartComplete(FHttpRequestPtr HttpRequest, FHttpResponsePtr HttpResponse, bool bSucceeded, int32 Index)
+{
+	// Requests canceled by CancelParts no longer belong to their part
+	if (bFinished || !Parts.IsValidIndex(Index) || Parts[Index].Request != HttpRequest)
+	{
+		return;
+	}
+	FPart& Part = Parts[Index];
+	Part.Request.Reset();
+	Part.BytesSent = 0;
+	const int32 ResponseCode = HttpResponse.IsValid() ? HttpResponse->GetResponseCode() : -1;
+	if (bSucceeded && (ResponseCode == 200 || ResponseCode == 201 || ResponseCode == 204))
+	{
+		Part.State = EPartState::Done;
+		BytesDone += Part.Size;
+		if (BytesDone == TotalSize)
+		{
+			CompleteUpload();
+		}
+		else
+		{
+			Pump();
+		}
+		return;
+	}
+	if (bSucceeded && Mode == EMode::Parts && BytesDone == 0 && (ResponseCode == 404 || ResponseCode == 405 || ResponseCode == 501))
+	{
+		UE_LOG(PakUploader, Warning, TEXT("%s doesn't take pak parts (%d); uploading %s in a single request"), *URL, ResponseCode, *FPaths::GetCleanFilename(Filename));
+		CancelParts();
+		UploadWhole();
+		return;
+	}
+	Part.State = EPartState::Reading;
+	RetryPart(Index, ResponseCode);
+}
+
+void FPakUploader::RetryPart(int32 Index, int32 ResponseCode)
+{
+	FPart& Part = Parts[Index];
+	if (++Part.Attempts >= MaxAttempts)
+	{
+		UE_LOG(PakUploader, Error, TEXT("Giving up on part %d of %s after %d attempts (last response %d)"), Index, *FPaths::GetCleanFilename(Filename), Part.Attempts, ResponseCode);
+		Finish(false, LOCTEXT("UploadPartFailed", "Failed to upload the pak; uploading it again resumes where it stopped"));
+		return;
+	}
+	const float Delay = FMath::Min(FMath::Pow(2.0f, Part.Attempts - 1), MaxRetryDelay);
+	UE_LOG(PakUploader, Warning, TEXT("Part %d of %s failed (%d); retrying in %.0fs"), Index, *FPaths::GetCleanFilename(Filename), ResponseCode, Delay);
+	// The part keeps its slot while it waits, so retries don't crowd out the parts after it
+	TSharedRef<FPakUploader, ESPMode::ThreadSafe> This = AsShared();
+	FTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateLambda([This, Index](float DeltaTime)
+	{
+		if (!This->bFinished && This->Parts.IsValidIndex(Index) && This->Parts[Index].State == EPartState::Reading)
+		{
+			This->ReadPart(Index);
+		}
+		return false;
+	}), Delay);
+}
+
+void FPakUploader::CancelParts()
+{
+	for (FPart& Part : Parts)
+	{
+		FHttpRequestPtr Request = Part.Request;
+		Part.Request.Reset();
+		Part.BytesSent = 0;
+		if (Part.State != EPartState::Done)
+		{
+			Part.State = EPartState::Pending;
+		}
+		if (Request.IsValid())
+		{
+			Request->CancelRequest();
+		}
+	}
+}
+
+void FPakUploader::CompleteUpload()
+{
+	TSharedRef<IHttpRequest> Request = FHttpModule::Get().CreateRequest();
+	Request->SetVerb(TEXT("POST"));
+	if (Mode == EMode::Chunks)
+	{
+		Request->SetURL(FString::Printf(TEXT("%s?recipe&%s"), *URL, *Query));
+		Request->SetHeader(TEXT("Content-Type"), TEXT("text/plain"));
+		Request->SetContentAsString(Recipe.ToString());
+	}
+	else
+	{
+		Request->SetURL(FString::Printf(TEXT("%s?upload=%s&parts=%d&%s"), *URL, *UploadId, Parts.Num(), *Query));
+		Request->SetHeader(TEXT("Content-Type"), TEXT("application/octet-stream"));
+	}
+	Request->OnProcessRequestComplete().BindThreadSafeSP(AsShared(), &FPakUploader::HandleCompleteUploadComplete);
+	Request->ProcessRequest();
+}
+
+void FPakUploader::HandleCompleteUploadComplete(FHttpRequestPtr HttpRequest, FHttpResponsePtr HttpResponse, bool bSucceeded)
+{
+	if (bFinished)
+	{
+		return;
+	}
+	const int32 ResponseCode = HttpResponse.IsValid() ? HttpResponse->GetResponseCode() : -1;
+	if (bSucceeded && ResponseCode == 200)
+	{
+		FinishFile();
+		return;
+	}
+	// 409: the server lost some chunks or parts (a restart, a cleanup), so ask again which it has and send the rest
+	if (bSucceeded && ResponseCode == 409 && ++CompleteAttempts <= MaxCompleteAttempts)
+	{
+		UE_LOG(PakUploader, Warning, TEXT("The server is missing parts of %s; sending them again"), *FPaths::GetCleanFilename(Filename));
+		for (FPart& Part : Parts)
+		{
+			Part.State = EPartState::Pending;
+			Part.Attempts = 0;
+		}
+		BytesDone = 0;
+		if (Mode == EMode::Chunks)
+		{
+			NegotiateChunks();
+		}
+		else
+		{
+			QueryParts();
+		}
+		return;
+	}
+	UE_LOG(PakUploader, Error, TEXT("Completing upload of %s failed: %d"), *HttpRequest->GetURL(), ResponseCode);
+	Finish(false, LOCTEXT("UploadCompleteFailed", "Failed to upload Pak file!"));
+}
+
+void FPakUploader::UploadWhole()
+{
+	if (TotalSize > MaxWholeUploadBytes)
+	{
+		UE_LOG(PakUploader, Error, TEXT("%s takes neither chunks nor parts, and %s (%lld bytes) is too large to send in a single request (at most %lld bytes)"),
+			*URL, *FPaths::GetCleanFilename(Filename), TotalSize, MaxWholeUploadBytes);
+		Finish(false, LOCTEXT("UploadWholeTooLarge", "The server doesn't take pak parts and the pak is too large to send whole!"));
+		return;
+	}
+	// The whole pak is the only part now, so progress and Cancel work as before
+	Mode = EMode::Whole;
+	BytesDone = 0;
+	BytesSkipped = 0;
+	BytesRepeated = 0;
+	Parts.Reset();
+	Parts.AddDefaulted();
+	Parts[0].Size = (int32)TotalSize;
+	Parts[0].State = EPartState::Reading;
+	TSharedRef<FPakUploader, ESPMode::ThreadSafe> This = AsShared();
+	const FString File = Filename;
+	const int64 ExpectedSize = TotalSize;
+	AsyncTask(ENamedThreads::AnyThread, [This, File, ExpectedSize]()
+	{
+		TSharedPtr<TArray<uint8>, ESPMode::ThreadSafe> Data = MakeShareable(new TArray<uint8>());
+		if (!FFileHelper::LoadFileToArray(*Data, *File) || Data->Num() != ExpectedSize)
+		{
+			Data.Reset();
+		}
+		AsyncTask(ENamedThreads::GameThread, [This, Data]()
+		{
+			This->SendWhole(Data);
+		});
+	});
+}
+
+void FPakUploader::SendWhole(TSharedPtr<TArray<uint8>, ESPMode::ThreadSafe> Data)
+{
+	if (bFinished)
+	{
+		return;
+	}
+	if (!Data.IsValid())
+	{
+		Finish(false, LOCTEXT("UploadReadWholeFailed", "Failed to read the pak"));
+		return;
+	}
+	TSharedRef<IHttpRequest> Request = FHttpModule::Get().CreateRequest();
+	Request->SetURL(URL + TEXT("?") + Query);
+	Request->SetVerb(TEXT("POST"));
+	Request->SetHeader(TEXT("Content-Type"), TEXT("application/octet-stream"));
+	Request->SetContent(*Data);
+	Request->OnRequestProgress().BindThreadSafeSP(AsShared(), &FPakUploader::HandlePartProgress, 0);
+	Request->OnProcessRequestComplete().BindThreadSafeSP(AsShared(), &FPakUploader::HandleUploadWholeComplete);
+	Parts[0].State = EPartState::Sending;
+	Parts[0].Request = Request;
+	Request->ProcessRequest();
+}
+
+void FPakUploader::HandleUploadWholeComplete(FHttpRequestPtr HttpRequest, FHttpResponsePtr HttpResponse, bool bSucceeded)
+{
+	if (bFinished)
+	{
+		return;
+	}
+	Parts[0].Request.Reset();
+	if (!bSucceeded || (HttpResponse.IsValid() && HttpResponse->GetResponseCode() != 200))
+	{
+		UE_LOG(PakUploader, Error, TEXT("Upload to %s failed: %d"), *HttpRequest->GetURL(), HttpResponse.IsValid() ? HttpResponse->GetResponseCode() : -1);
+		Finish(false, LOCTEXT("UploadWholeFailed", "Failed to upload Pak file!"));
+		return;
+	}
+	BytesDone = TotalSize;
+	FinishFile();
+}
+
+bool FPakUploader::Tick(float DeltaTime)
+{
+	UpdateNotification();
+	return true;
+}
+
+void FPakUploader::UpdateNotification()
+{
+	// Nothing to show while the pak is being split into chunks; a commandlet logs progress now and then instead
+	const double Now = FPlatformTime::Seconds();
+	const bool bLog = !NotificationItem.IsValid() && IsRunningCommandlet() && Now - LastLogTime >= ProgressLogInterval;
+	if ((!NotificationItem.IsValid() && !bLog) || Parts.Num() == 0)
+	{
+		return;
+	}
+	int64 BytesSent = BytesDone;
+	for (const FPart& Part : Parts)
+	{
+		BytesSent += Part.State == EPartState::Sending ? Part.BytesSent : 0;
+	}
+	// Only what actually went over the wire counts towards the rate
+	const int64 BytesTransferred = BytesSent - BytesSkipped - BytesRepeated;
+	const double Seconds = Now - FileStartTime;
+	if (bLog)
+	{
+		LastLogTime = Now;
+		UE_LOG(PakUploader, Display, TEXT("Uploading %s (%d of %d) for %s: %.0f%% of %lld bytes at %.1f MB/s"), *FPaths::GetCleanFilename(Filename), FileIndex + 1, Filenames.Num(),
+			*TargetPlatform, 100.0 * BytesSent / TotalSize, TotalSize, Seconds > 0 ? BytesTransferred / Seconds / (1024 * 1024) : 0);
+		return;
+	}
+	FFormatNamedArguments Arguments;
+	Arguments.Add(TEXT("Platform"), PlatformDisplayName);
+	Arguments.Add(TEXT("Percent"), FText::AsPercent((double)BytesSent / TotalSize));
+	Arguments.Add(TEXT("Total"), FText::AsMemory((uint64)TotalSize));
+	Arguments.Add(TEXT("Rate"), FText::AsMemory(Seconds > 0 ? (uint64)(BytesTransferred / Seconds) : 0));
+	if (Filenames.Num() == 1)
+	{
+		NotificationItem->SetText(FText::Format(LOCTEXT("UploadProgress", "Uploading pak for {Platform}: {Percent} of {Total} at {Rate}/s"), Arguments));
+		return;
+	}
+	Arguments.Add(TEXT("File"), FText::FromString(FPaths::GetCleanFilename(Filename)));
+	Arguments.Add(TEXT("Number"), FText::AsNumber(FileIndex + 1));
+	Arguments.Add(TEXT("Count"), FText::AsNumber(Filenames.Num()));
+	NotificationItem->SetText(FText::Format(LOCTEXT("UploadFileProgress", "Uploading {File} ({Number} of {Count}) for {Platform}: {Percent} of {Total} at {Rate}/s"), Arguments));
+}
+
+void FPakUploader::Cancel()
+{
+	if (bFinished)
+	{
+		return;
+	}
+	UE_LOG(PakUploader, Log, TEXT("Upload of %s canceled; %lld of %lld bytes are on the server"), *FPaths::GetCleanFilename(Filename), BytesDone, TotalSize);
+	Finish(false, LOCTEXT("UploadCanceled", "Pak upload canceled"));
+}
+
+void FPakUploader::CancelUploads(const FString& TargetPlatform)
+{
+	// Canceling removes the upload from Active
+	const TArray<TSharedPtr<FPakUploader, ESPMode::ThreadSafe>> Uploads = Active;
+	for (const TSharedPtr<FPakUploader, ESPMode::ThreadSafe>& Upload : Uploads)
+	{
+		if (Upload->TargetPlatform == TargetPlatform)
+		{
+			Upload->Cancel();
+		}
+	}
+}
+
+void FPakUploader::Finish(bool bSucceeded, const FText& Message)
+{
+	bFinished = true;
+	FTicker::GetCoreTicker().RemoveTicker(TickHandle);
+	CancelParts();
+	const double Seconds = FPlatformTime::Seconds() - StartTime;
+	FDeployProfiler::EndUpload(TargetPlatform, bSucceeded, PreviousBytesSent);
+	FText Text = Message;
+	if (bSucceeded)
+	{
+		const int64 PreviousBytesSkipped = PreviousBytes - PreviousBytesSent - PreviousBytesRepeated;
+		UE_LOG(PakUploader, Log, TEXT("Completed upload of %d files in %.1fs: sent %lld of %lld bytes, %lld (%.0f%%) were on the server already, %lld repeated chunks of the same pak"),
+			Filenames.Num(), Seconds, PreviousBytesSent, PreviousBytes, PreviousBytesSkipped, 100.0 * PreviousBytesSkipped / PreviousBytes, PreviousBytesRepeated);
+		FPakChannels::Commit(FullPakFilename);
+		FDeployProfiler::Finish(TargetPlatform, PlatformDisplayName);
+		if (NotificationItem.IsValid())
+		{
+			GEditor->PlayEditorSound(TEXT("/Engine/EditorSounds/Notifications/CompileSuccess_Cue.CompileSuccess_Cue"));
+		}
+		FFormatNamedArguments Arguments;
+		Arguments.Add(TEXT("Message"), Message);
+		Arguments.Add(TEXT("Sent"), FText::AsMemory((uint64)PreviousBytesSent));
+		Arguments.Add(TEXT("Total"), FText::AsMemory((uint64)PreviousBytes));
+		Arguments.Add(TEXT("OnServer"), FText::AsMemory((uint64)PreviousBytesSkipped));
+		Text = FText::Format(LOCTEXT("UploadSent", "{Message} Sent {Sent} of {Total}, {OnServer} were on the server already"), Arguments);
+	}
+	else if (NotificationItem.IsValid())
+	{
+		GEditor->PlayEditorSound(TEXT("/Engine/EditorSounds/Notifications/CompileFailed_Cue.CompileFailed_Cue"));
+	}
+	if (NotificationItem.IsValid())
+	{
+		NotificationItem->SetText(Text);
+		NotificationItem->SetCompletionState(bSucceeded ? SNotificationItem::CS_Success : SNotificationItem::CS_Fail);
+		NotificationItem->ExpireAndFadeout();
+	}
+	OnUploaded.ExecuteIfBound(bSucceeded, PreviousBytesSent);
+	Active.Remove(AsShared());
+}
+
+void FPakUploader::WriteStats(double Seconds) const
+{
+	static const TCHAR* ModeNames[] = { TEXT("Chunks"), TEXT("Parts"), TEXT("Whole") };
+	const FString CsvFilename = FPaths::ConvertRelativePathToFull(FPaths::GameSavedDir() / TEXT("Cooked") / TEXT("UploadStats.csv"));
+	FString Csv;
+	if (!FFileHelper::LoadFileToString(Csv, *CsvFilename) || Csv.IsEmpty())
+	{
+		Csv = FString(UploadStatsHeader) + LINE_TERMINATOR;
+	}
+	else if (Csv.StartsWith(FString(UploadStatsHeaderNoRepeats) + LINE_TERMINATOR))
+	{
+		// Rows written before the column was added are read as having no repeated bytes
+		Csv = FString(UploadStatsHeader) + Csv.Mid(FCString::Strlen(UploadStatsHeaderNoRepeats));
+	}
+	else if (!Csv.EndsWith(LINE_TERMINATOR))
+	{
+		Csv += LINE_TERMINATOR;
+	}
+	Csv += FString::Printf(TEXT("%s,%s,%s,%lld,%lld,%lld,%.1f,%lld") LINE_TERMINATOR, *FDateTime::Now().ToIso8601(), *FPaths::GetCleanFilename(Filename),
+		ModeNames[(int32)Mode], TotalSize, TotalSize - BytesSkipped - BytesRepeated, BytesSkipped, Seconds, BytesRepeated);
+	FFileHelper::SaveStringToFile(Csv, *CsvFilename);
+}
+
+#undef LOCTEXT_NAMESPACE
@@ -0,0 +1,171 @@
+// Copyright 1998-2016 Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "Engine.h"
+#include "Http.h"
+#include "PakChunks.h"
+
+class SNotificationItem;
+
+/** Called when an upload ends, with whether every file made it and the bytes actually sent */
+DECLARE_DELEGATE_TwoParams(FOnPakUploaded, bool /*bSucceeded*/, int64 /*SentBytes*/);
+
+/**
+ * Uploads the files of a deploy, one after the other under one notification, without ever holding more than a few
+ * parts of a file in memory and sending only what the server lacks.
+ *
+ * The pak is first split into content-defined chunks with the chunker the PakLoader uses for downloads, so a
+ * chunk holds the same bytes whichever pak and offset it comes from. Then, all on <folder url>/<file name>:
+ *
+ *   POST ?missing              - Body: the pak's chunk list (FPakChunkRecipe); answer: hashes of the chunks the server lacks, one per line
+ *   PUT  ?chunk=<sha1>         - One missing chunk
+ *   POST ?recipe&<query>       - Body: the chunk list again; the server assembles the pak (409 if chunks are missing)
+ *
+ * A server without a chunk store (404, 405 or 501 to ?missing) gets the pak in fixed UploadChunkMB parts instead,
+ * resumable under an id derived from the pak's name, size and time stamp:
+ *
+ *   GET  ?upload=<id>                         - Part numbers the server already has, one per line (404 if none)
+ *   PUT  ?upload=<id>&part=<n>                - One part, with Content-Range and X-Part-SHA1 headers
+ *   POST ?upload=<id>&parts=<count>&<query>   - Joins the parts into the pak
+ *
+ * and a server that refuses parts too gets the whole pak, if it is at most 1GB, in a single POST as before.
+ * Either way ParallelUploads chunks or parts are read from disk and sent at once. Bytes skipped because the server
+ * had them are logged and added to Saved/Cooked/UploadStats.csv. In a commandlet there is no notification and
+ * progress goes to the log.
+ */
+class FPakUploader : public TSharedFromThis<FPakUploader, ESPMode::ThreadSafe>
+{
+public:
+	/**
+	 * Starts uploading Filenames, in order, to FolderURL, showing progress in a notification with a Cancel button.
+	 *
+	 * @param Query - Extra query arguments for the final request of each file, without the leading &.
+	 * @param FullPakFilename - Full pak of the platform; the manifests of its paks are committed once every file is uploaded.
+	 * @param TargetPlatform - Platform the paks are for, whose deploy the upload finishes.
+	 * @param OnUploaded - Called when the upload ends, unless Start returns false.
+	 */
+	static bool Start(const TArray<FString>& Filenames, const FString& FolderURL, const FString& Query, const FString& FullPakFilename, const FString& TargetPlatform, const FText& PlatformDisplayName, const FOnPakUploaded& OnUploaded = FOnPakUploaded());
+
+	/** Cancels the uploads under way for TargetPlatform; they finish as failed */
+	static void CancelUploads(const FString& TargetPlatform);
+
+private:
+	enum class EMode
+	{
+		Chunks,
+		Parts,
+		Whole,
+	};
+
+	enum class EPartState
+	{
+		Pending,
+		Reading,
+		Sending,
+		Done,
+	};
+
+	/** A chunk or part of the pak */
+	struct FPart
+	{
+		int64 Offset;
+		int32 Size;
+		/** SHA1 of the chunk; empty for parts, which are hashed as they are read */
+		FString Hash;
+		EPartState State;
+		int32 Attempts;
+		/** Bytes of the part sent so far by its current request */
+		int32 BytesSent;
+		FHttpRequestPtr Request;
+
+		FPart() : Offset(0), Size(0), State(EPartState::Pending), Attempts(0), BytesSent(0) {}
+	};
+
+	FPakUploader(const TArray<FString>& InFilenames, const FString& InFolderURL, const FString& InQuery, const FString& InFullPakFilename, const FString& InTargetPlatform, const FText& InPlatformDisplayName, const FOnPakUploaded& InOnUploaded);
+
+	/** Starts on the file at Index of Filenames; returns false if it can't be read */
+	bool StartFile(int32 Index);
+	/** Moves on to the next file once the server has the current one, or finishes */
+	void FinishFile();
+
+	/** Splits the pak into chunks on a worker thread, then asks the server which it lacks */
+	void ChunkPak();
+	void HandlePakChunked(bool bSucceeded, const FPakChunkRecipe& InRecipe);
+	void NegotiateChunks();
+	void HandleNegotiateComplete(FHttpRequestPtr HttpRequest, FHttpResponsePtr HttpResponse, bool bSucceeded);
+	/** Switches to fixed size parts, for servers without a chunk store */
+	void UseParts();
+	void QueryParts();
+	void HandleQueryComplete(FHttpRequestPtr HttpRequest, FHttpResponsePtr HttpResponse, bool bSucceeded);
+	/** Starts reading parts until ParallelUploads are under way */
+	void Pump();
+	void ReadPart(int32 Index);
+	void SendPart(int32 Index, TSharedPtr<TArray<uint8>, ESPMode::ThreadSafe> Data, FString Hash);
+	void HandlePartProgress(FHttpRequestPtr HttpRequest, int32 BytesSent, int32 BytesReceived, int32 Index);
+	void HandlePartComplete(FHttpRequestPtr HttpRequest, FHttpResponsePtr HttpResponse, bool bSucceeded, int32 Index);
+	/** Sends the part again after a delay, or fails the upload once it has had MaxAttempts */
+	void RetryPart(int32 Index, int32 ResponseCode);
+	/** Cancels the requests under way and returns their parts to Pending */
+	void CancelParts();
+	void CompleteUpload();
+	void HandleCompleteUploadComplete(FHttpRequestPtr HttpRequest, FHttpResponsePtr HttpResponse, bool bSucceeded);
+	/** Reads the whole pak on a worker thread to send it in one request, for servers without part uploads; fails for paks over 1GB */
+	void UploadWhole();
+	void SendWhole(TSharedPtr<TArray<uint8>, ESPMode::ThreadSafe> Data);
+	void HandleUploadWholeComplete(FHttpRequestPtr HttpRequest, FHttpResponsePtr HttpResponse, bool bSucceeded);
+
+	bool Tick(float DeltaTime);
+	void UpdateNotification();
+	void Cancel();
+	void Finish(bool bSucceeded, const FText& Message);
+	/** Adds the upload of the current file to Saved/Cooked/UploadStats.csv */
+	void WriteStats(double Seconds) const;
+
+	FString GetPartURL(int32 Index) const;
+
+	TArray<FString> Filenames;
+	FString FolderURL;
+	FString Query;
+	FString FullPakFilename;
+	FString TargetPlatform;
+	FText PlatformDisplayName;
+	FOnPakUploaded OnUploaded;
+	/** Index in Filenames of the file being uploaded */
+	int32 FileIndex;
+	/** Bytes of the files before the current one, how many of them were sent, and how many repeated a chunk of the same pak */
+	int64 PreviousBytes;
+	int64 PreviousBytesSent;
+	int64 PreviousBytesRepeated;
+	double StartTime;
+	/** When progress was last logged, in a commandlet */
+	double LastLogTime;
+
+	/** The file being uploaded, and the state of its upload */
+	FString Filename;
+	FString URL;
+	EMode Mode;
+	/** Chunks of the pak, as sent to the server in Chunks mode */
+	FPakChunkRecipe Recipe;
+	FString UploadId;
+	int64 TotalSize;
+	int32 MaxParallel;
+	TArray<FPart> Parts;
+	/** Bytes of the parts the server has confirmed or already had */
+	int64 BytesDone;
+	/** Bytes the server already had, so weren't sent */
+	int64 BytesSkipped;
+	/** Bytes of chunks that repeat an earlier chunk of the pak, which are only sent once */
+	int64 BytesRepeated;
+	double FileStartTime;
+	/** Failed attempts at the ?missing request */
+	int32 NegotiateAttempts;
+	/** Times the parts were sent again because the server was missing some on completion */
+	int32 CompleteAttempts;
+	bool bFinished;
+	TSharedPtr<SNotificationItem> NotificationItem;
+	FDelegateHandle TickHandle;
+
+	/** Uploads under way, kept alive until they finish */
+	static TArray<TSharedPtr<FPakUploader, ESPMode::ThreadSafe>> Active;
+};
@@ -39,11 +39,71 @@ public:
 		return Author;
 	}
 
-	const TArray<FAssetChannel>& GetAssets()
+	const TArray<FDeployToPakAsset>& GetAssets()
 	{
 		return EditorSettings.Get() != nullptr ? EditorSettings.Get()->Assets : EmptyAssets;
 	}
 
+	const TArray<FName>& GetDeployPlatforms()
+	{
+		return EditorSettings.Get() != nullptr ? EditorSettings.Get()->DeployPlatforms : EmptyPlatforms;
+	}
+
+	int32 GetMaxParallelJobs()
+	{
+		return EditorSettings.Get() != nullptr ? EditorSettings.Get()->MaxParallelJobs : 0;
+	}
+
+	int32 GetMemoryPerCookMB()
+	{
+		return EditorSettings.Get() != nullptr ? EditorSettings.Get()->MemoryPerCookMB : 4096;
+	}
+
+	int32 GetMaxPatchPaks()
+	{
+		return EditorSettings.Get() != nullptr ? EditorSettings.Get()->MaxPatchPaks : 8;
+	}
+
+	bool GetPakDependenciesOnly()
+	{
+		return EditorSettings.Get() != nullptr ? EditorSettings.Get()->bPakDependenciesOnly : true;
+	}
+
+	bool GetPakPerChannel()
+	{
+		return EditorSettings.Get() != nullptr ? EditorSettings.Get()->bPakPerChannel : true;
+	}
+
+	int32 GetMaxPakSizeMB()
+	{
+		return EditorSettings.Get() != nullptr ? EditorSettings.Get()->MaxPakSizeMB : 0;
+	}
+
+	bool GetCookDependenciesOnly()
+	{
+		return EditorSettings.Get() != nullptr ? EditorSettings.Get()->bCookDependenciesOnly : true;
+	}
+
+	const TArray<FPakCompressionRule>& GetCompressionRules()
+	{
+		return EditorSettings.Get() != nullptr ? EditorSettings.Get()->CompressionRules : EmptyCompressionRules;
+	}
+
+	EPakCompression GetDefaultCompression()
+	{
+		return EditorSettings.Get() != nullptr ? EditorSettings.Get()->DefaultCompression : EPakCompression::Zlib;
+	}
+
+	int32 GetUploadChunkMB()
+	{
+		return EditorSettings.Get() != nullptr ? EditorSettings.Get()->UploadChunkMB : 8;
+	}
+
+	int32 GetParallelUploads()
+	{
+		return EditorSettings.Get() != nullptr ? EditorSettings.Get()->ParallelUploads : 4;
+	}
+
 	static FDeployToPakEditorModule& Get()
 	{
 		return FModuleManager::LoadModuleChecked< FDeployToPakEditorModule >("DeployToPakEditor");
@@ -57,6 +117,8 @@ public:
 private:
 	TSharedPtr<class FUICommandList> PluginCommands;
 	TWeakObjectPtr<UDeployToPakEditorSettings> EditorSettings;
-	TArray<FAssetChannel> EmptyAssets;
+	TArray<FDeployToPakAsset> EmptyAssets;
+	TArray<FName> EmptyPlatforms;
+	TArray<FPakCompressionRule> EmptyCompressionRules;
 	FString Author;
 };
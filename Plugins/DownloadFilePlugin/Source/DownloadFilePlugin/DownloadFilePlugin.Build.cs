@@ -27,6 +27,7 @@ public class DownloadFilePlugin : ModuleRules
 			new string[]
 			{
 				"Core",
+				"PakLoader",
 				// ... add other public dependencies that you statically link with here ...
 			}
 			);
@@ -2,10 +2,13 @@
 
 #include "DownloadFilePluginPrivatePCH.h"
 #include "Http.h"
+#include "PakHttpConnections.h"
 #include "AsyncTaskDownloadFile.h"
+#include "ContentDecoder.h"
 #include "TimerManager.h"
 #include "CoreMisc.h"
 #include "Base64.h"
+#include "Async.h"
 
 #define LOCTEXT_NAMESPACE "FDownloadFilePluginModule"
 DEFINE_LOG_CATEGORY(FileLoader);
@@ -16,6 +19,7 @@ DEFINE_LOG_CATEGORY(FileLoader);
 
 UAsyncTaskDownloadFile::UAsyncTaskDownloadFile(const FObjectInitializer& ObjectInitializer)
 	: Super(ObjectInitializer)
+	, RequestReceived(0)
 {
 	if (HasAnyFlags(RF_ClassDefaultObject) == false)
 	{
@@ -44,12 +48,17 @@ UAsyncTaskDownloadFile* UAsyncTaskDownloadFile::DownloadFile(const FString& URL,
 
 void UAsyncTaskDownloadFile::Start(FString URL)
 {
+	FGameThreadTimer::FScope TimerScope(GameThreadTimer);
 	UE_LOG(FileLoader, Log, TEXT("Download request for: %s"), *URL);
+	Progress.Start();
+	RequestReceived = 0;
 	// Create the Http request and add to pending request list	
-	TSharedRef<IHttpRequest> HttpRequest = FHttpModule::Get().CreateRequest();
+	TSharedRef<IHttpRequest> HttpRequest = FPakHttpConnections::Get().CreateRequest();
 	HttpRequest->OnProcessRequestComplete().BindUObject(this, &UAsyncTaskDownloadFile::HandleFileRequest);
+	HttpRequest->OnRequestProgress().BindUObject(this, &UAsyncTaskDownloadFile::HandleFileRequestProgress);
 	HttpRequest->SetURL(URL);
 	HttpRequest->SetVerb(TEXT("GET"));
+	HttpRequest->SetHeader(TEXT("Accept-Encoding"), FContentDecoder::GetAcceptEncoding());
 	FString ETagFilename;
 	FString DownloadedFilename;
 	GetDownloadFilenames(URL, DownloadedFilename, ETagFilename);
@@ -61,14 +70,108 @@ void UAsyncTaskDownloadFile::Start(FString URL)
 		UE_LOG(FileLoader, Log, TEXT("Setting If-None-Match: %s"), *ETag);
 	}
 	HttpRequest->SetHeader(TEXT("If-None-Match"), ETag);
-	HttpRequest->ProcessRequest();
+	// Background pak prefetches wait for us
+	FDownloadScheduler::Get().BeginForegroundTransfer();
+	FPakHttpConnections::Get().ProcessRequest(HttpRequest);
+}
+
+void UAsyncTaskDownloadFile::HandleFileRequestProgress(FHttpRequestPtr HttpRequest, int32 BytesSent, int32 BytesReceived)
+{
+	const FHttpResponsePtr HttpResponse = HttpRequest->GetResponse();
+	const int64 Total = HttpResponse.IsValid() ? HttpResponse->GetContentLength() : 0;
+	RequestReceived = FDownloadProgress::UnwrapHttpBytes(BytesReceived, RequestReceived);
+	const int64 Received = RequestReceived;
+	if (Progress.Update(Received, Total))
+	{
+		OnProgress.Broadcast(FDownloadProgress::ToBlueprintBytes(Received), FDownloadProgress::ToBlueprintBytes(Total), Progress.GetBytesPerSecond(), Progress.GetSecondsRemaining());
+		if (OnBytesProgress)
+		{
+			OnBytesProgress(Received, Total);
+		}
+	}
+}
+
+bool UAsyncTaskDownloadFile::SaveResponse(const FString& Url, const FHttpResponsePtr& HttpResponse,
+	const FString& DownloadedFilename, const FString& ETagFilename)
+{
+	const FString ETag = HttpResponse->GetHeader("ETag");
+	IFileManager* const FileManager = &IFileManager::Get();
+	//IPlatformFile& PlatformFile = IPlatformFile::GetPlatformPhysical();
+	//FString TmpFilename(DownloadedFilename + ".tmp");
+	//TmpFilename = FPaths::ConvertRelativePathToFull(TmpFilename);
+	FString TmpFilename = FPaths::CreateTempFilename(*FPaths::GameSavedDir());
+	FArchive* const Ar = FileManager->CreateFileWriter(*TmpFilename, 0);
+	bool bIOError = (Ar == nullptr);
+	if (bIOError)
+	{
+		UE_LOG(FileLoader, Error, TEXT("Couldn't create tmp file %s for %s"), *Url, *TmpFilename);
+	}
+	else
+	{
+		// Decode a compressed transfer straight into the file
+		const FString ContentEncoding = HttpResponse->GetHeader(TEXT("Content-Encoding"));
+		int64 BodySize = 0;
+		int64 DecodedSize = 0;
+		const bool bDecoded = FContentDecoder::GetBodySize(Url, *HttpResponse, BodySize)
+			&& FContentDecoder::Decode(ContentEncoding, HttpResponse->GetContent().GetData(), BodySize,
+			[Ar](const uint8* Data, int64 Size) { Ar->Serialize(const_cast<uint8*>(Data), Size); return !Ar->IsError(); }, DecodedSize);
+		Ar->Close();
+		delete Ar;
+		if (bDecoded && ContentEncoding.Len() > 0)
+		{
+			FDownloadStats::Get().RecordDecompression(Url, BodySize, DecodedSize);
+		}
+		int64 Size = FileManager->FileSize(*TmpFilename);
+		bIOError = !bDecoded || (Size != DecodedSize);
+		if (bIOError)
+		{
+			UE_LOG(FileLoader, Error, TEXT("Could only write %lld of %lld bytes to %s for %s"), Size, DecodedSize, *TmpFilename, *Url);
+		}
+		else
+		{
+			bIOError = !FileManager->Move(*DownloadedFilename, *TmpFilename);
+		}
+		if (bIOError)
+		{
+			UE_LOG(FileLoader, Error, TEXT("Couldn't rename tmp file %s to %s for %s"), *TmpFilename, *DownloadedFilename, *Url);
+		}
+		else
+		{
+			if (ETag.Len() > 0)
+			{
+				bIOError = !FFileHelper::SaveStringToFile(ETag, *ETagFilename, FFileHelper::EEncodingOptions::ForceUTF8, FileManager);
+				if (bIOError)
+				{
+					UE_LOG(FileLoader, Error, TEXT("Couldn't create etag file %s for %s"), *ETagFilename, *Url);
+				}
+			}
+			else
+			{
+				UE_LOG(FileLoader, Log, TEXT("No ETag header for %s"), *Url);
+			}
+		}
+	}
+	if (bIOError)
+	{
+		UE_LOG(FileLoader, Error, TEXT("Couldn't save %s as %s"), *Url, *DownloadedFilename);
+	}
+	return !bIOError;
+}
+
+void UAsyncTaskDownloadFile::Finish(const FString& Url)
+{
+	RemoveFromRoot();
+	FDownloadStats::Get().RecordGameThreadTime(Url, GameThreadTimer.GetSeconds());
 }
 
 void UAsyncTaskDownloadFile::HandleFileRequest(FHttpRequestPtr HttpRequest,
 	FHttpResponsePtr HttpResponse, bool bSucceeded)
 {
-	RemoveFromRoot();
+	FGameThreadTimer::FScope TimerScope(GameThreadTimer);
+	FDownloadScheduler::Get().EndForegroundTransfer();
 	const FString Url = HttpRequest->GetURL();
+	FDownloadStats::Get().RecordRequest(Url, HttpResponse.IsValid() ? HttpResponse->GetResponseCode() : -1,
+		HttpResponse.IsValid() ? HttpResponse->GetContent().Num() : 0, HttpRequest->GetElapsedTime(), Progress.GetPeakBytesPerSecond());
 	const bool _304 = HttpResponse.IsValid() && HttpResponse->GetResponseCode() == 304;	
 	if (HttpResponse.IsValid())
 	{
@@ -79,6 +182,7 @@ void UAsyncTaskDownloadFile::HandleFileRequest(FHttpRequestPtr HttpRequest,
 		}
 		if (bCheckForUpdateOnly)
 		{
+			Finish(Url);
 			return;
 		}
 	}
@@ -89,68 +193,42 @@ void UAsyncTaskDownloadFile::HandleFileRequest(FHttpRequestPtr HttpRequest,
 		GetDownloadFilenames(Url, DownloadedFilename, ETagFilename);
 		if (!_304)
 		{
-			const FString ETag = HttpResponse->GetHeader("ETag");
-			UE_LOG(FileLoader, Log, TEXT("Attempting to cache %s as %s"), *Url, *DownloadedFilename);
-			IFileManager* const FileManager = &IFileManager::Get();
-			//IPlatformFile& PlatformFile = IPlatformFile::GetPlatformPhysical();
-			//FString TmpFilename(DownloadedFilename + ".tmp");
-			//TmpFilename = FPaths::ConvertRelativePathToFull(TmpFilename);
-			FString TmpFilename = FPaths::CreateTempFilename(*FPaths::GameSavedDir());
-			FArchive* const Ar = FileManager->CreateFileWriter(*TmpFilename, 0);
-			bool bIOError = (Ar == nullptr);
-			if (bIOError)
+			const int64 Size = HttpResponse->GetContent().Num();
+			Progress.Update(Size, Size, true);
+			OnProgress.Broadcast(FDownloadProgress::ToBlueprintBytes(Size), FDownloadProgress::ToBlueprintBytes(Size), Progress.GetBytesPerSecond(), 0);
+			if (OnBytesProgress)
 			{
-				UE_LOG(FileLoader, Error, TEXT("Couldn't create tmp file %s for %s"), *Url, *TmpFilename);
+				OnBytesProgress(Size, Size);
 			}
-			else
+			UE_LOG(FileLoader, Log, TEXT("Attempting to cache %s as %s"), *Url, *DownloadedFilename);
+			// Write the file on a task thread and report back on the game thread; we stay rooted until then
+			AsyncTask(ENamedThreads::AnyThread, [this, Url, HttpResponse, DownloadedFilename, ETagFilename]()
 			{
-				Ar->Serialize(const_cast<uint8*>(HttpResponse->GetContent().GetData()), HttpResponse->GetContentLength());
-				Ar->Close();
-				delete Ar;
-				int32 Size = FileManager->FileSize(*TmpFilename);
-				bIOError = (Size != HttpResponse->GetContentLength());
-				if (bIOError)
-				{
-					UE_LOG(FileLoader, Error, TEXT("Could only write %d of %d bytes to %s for %s"), Size, HttpResponse->GetContentLength(), *TmpFilename, *Url);
-				}
-				else
-				{
-					bIOError = !FileManager->Move(*DownloadedFilename, *TmpFilename);
-				}
-				if (bIOError)
+				const bool bSaved = SaveResponse(Url, HttpResponse, DownloadedFilename, ETagFilename);
+				AsyncTask(ENamedThreads::GameThread, [this, Url, DownloadedFilename, bSaved]()
 				{
-					UE_LOG(FileLoader, Error, TEXT("Couldn't rename tmp file %s to %s for %s"), *TmpFilename, *DownloadedFilename, *Url);
-				}
-				else
-				{
-					if (ETag.Len() > 0)
 					{
-						bIOError = !FFileHelper::SaveStringToFile(ETag, *ETagFilename, FFileHelper::EEncodingOptions::ForceUTF8, FileManager);
-						if (bIOError)
-						{
-							UE_LOG(FileLoader, Error, TEXT("Couldn't create etag file %s for %s"), *ETagFilename, *Url);
-						}
+						FGameThreadTimer::FScope TimerScope(GameThreadTimer);
+						Finish(Url);
+					}
+					if (bSaved)
+					{
+						OnSuccess.Broadcast(DownloadedFilename);
 					}
 					else
 					{
-						UE_LOG(FileLoader, Log, TEXT("No ETag header for %s"), *Url);
+						OnFail.Broadcast(TEXT("Couldn't save downloaded file"));
 					}
-				}
-			}
-			if (bIOError)
-			{
-				UE_LOG(FileLoader, Error, TEXT("Couldn't save %s as %s"), *Url, *DownloadedFilename);
-				OnFail.Broadcast(TEXT("Couldn't save downloaded file"));
-				return;
-			}
-		}
-		else
-		{
-			UE_LOG(FileLoader, Log, TEXT("Using cached file for %s"), *Url);
+				});
+			});
+			return;
 		}
+		UE_LOG(FileLoader, Log, TEXT("Using cached file for %s"), *Url);
+		Finish(Url);
 		OnSuccess.Broadcast(DownloadedFilename);
 		return;
 	}
 	UE_LOG(FileLoader, Error, TEXT("Error downloading %s: %d"), *Url, HttpResponse.IsValid() ? HttpResponse->GetResponseCode() : -1);
+	Finish(Url);
 	OnFail.Broadcast(TEXT("Couldn't download file"));
 }
@@ -4,6 +4,7 @@
 #include "Engine.h"
 #include "IHttpRequest.h"
 #include "Kismet/BlueprintAsyncActionBase.h"
+#include "DownloadStats.h"
 #include "AsyncTaskDownloadFile.generated.h"
 
 DECLARE_LOG_CATEGORY_EXTERN(FileLoader, Log, All)
@@ -34,6 +35,12 @@ public:
 	UPROPERTY(BlueprintAssignable)
 		FDownloadFileDelegate OnUpdated;
 
+	UPROPERTY(BlueprintAssignable)
+		FDownloadProgressDelegate OnProgress;
+
+	/** Native counterpart of OnProgress, with byte counts past 2GB */
+	TFunction<void(int64 Received, int64 Total)> OnBytesProgress;
+
 public:
 
 	void Start(FString URL);
@@ -48,4 +55,13 @@ private:
 	static void GetDownloadFilenames(const FString& Url, FString& FileFilename, FString& ETagFilename);
 	/** Handles File requests coming from the web */
 	void HandleFileRequest(FHttpRequestPtr HttpRequest, FHttpResponsePtr HttpResponse, bool bSucceeded);
+	void HandleFileRequestProgress(FHttpRequestPtr HttpRequest, int32 BytesSent, int32 BytesReceived);
+	/** Writes the (decoded) body and its ETag to the cache. Called on a task thread. */
+	static bool SaveResponse(const FString& Url, const FHttpResponsePtr& HttpResponse, const FString& DownloadedFilename, const FString& ETagFilename);
+	/** Unroots the task and records how much game thread time it took */
+	void Finish(const FString& Url);
+	FDownloadProgress Progress;
+	/** Bytes received by the request, which the HTTP module reports wrapped at 4GB */
+	int64 RequestReceived;
+	FGameThreadTimer GameThreadTimer;
 };
@@ -1,5 +1,6 @@
 // Copyright 1998-2016 Epic Games, Inc. All Rights Reserved.
 
+using System.IO;
 using UnrealBuildTool;
 
 public class PakLoader : ModuleRules
@@ -42,11 +43,32 @@ public class PakLoader : ModuleRules
                 "SlateCore",
                 "Http",
                 "PakFile",
+                "Json",
 				// ... add private dependencies that you statically link with here ...	
 			}
             );
 
 
+        // gzip Content-Encoding
+        AddEngineThirdPartyPrivateStaticDependencies(Target, "zlib");
+
+        // zstd Content-Encoding is only offered when the library has been dropped into Source/ThirdParty/zstd
+        string ZstdPath = Path.Combine(ModuleDirectory, "..", "ThirdParty", "zstd");
+        if (Directory.Exists(ZstdPath))
+        {
+            PrivateIncludePaths.Add(Path.Combine(ZstdPath, "include"));
+            string ZstdLibPath = Path.Combine(ZstdPath, "lib", Target.Platform.ToString());
+            PublicLibraryPaths.Add(ZstdLibPath);
+            PublicAdditionalLibraries.Add(Target.Platform == UnrealTargetPlatform.Win64 || Target.Platform == UnrealTargetPlatform.Win32
+                ? Path.Combine(ZstdLibPath, "zstd_static.lib")
+                : Path.Combine(ZstdLibPath, "libzstd.a"));
+            Definitions.Add("WITH_ZSTD=1");
+        }
+        else
+        {
+            Definitions.Add("WITH_ZSTD=0");
+        }
+
         DynamicallyLoadedModuleNames.AddRange(
             new string[]
             {
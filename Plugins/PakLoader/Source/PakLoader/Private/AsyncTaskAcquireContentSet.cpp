@@ -0,0 +1,388 @@
+// Copyright 1998-2016 Epic Games, Inc. All Rights Reserved.
+
+#include "PakLoaderPrivatePCH.h"
+#include "PakLoader.h"
+#include "AsyncTaskAcquireContentSet.h"
+#include "PakDownloadCache.h"
+#include "PakHttpConnections.h"
+#include "Http.h"
+#include "Json.h"
+#include "PackageName.h"
+#include "Async.h"
+
+/** Share of a pak's progress reached at the end of each stage */
+static const float DownloadedWeight = 0.7f;
+static const float VerifiedWeight = 0.8f;
+static const float MountedWeight = 0.9f;
+
+//----------------------------------------------------------------------//
+// UAsyncTaskAcquireContentSet
+//----------------------------------------------------------------------//
+
+UAsyncTaskAcquireContentSet::UAsyncTaskAcquireContentSet(const FObjectInitializer& ObjectInitializer)
+	: Super(ObjectInitializer)
+	, bLoadAssets(false)
+	, LastFraction(-1)
+	, MaxDownloads(2)
+	, MaxVerifies(2)
+	, MaxLoads(1)
+{
+	if (HasAnyFlags(RF_ClassDefaultObject) == false)
+	{
+		AddToRoot();
+	}
+}
+
+UAsyncTaskAcquireContentSet* UAsyncTaskAcquireContentSet::AcquireContentSet(const TArray<FString>& URLs, bool LoadAssets)
+{
+	UAsyncTaskAcquireContentSet* AcquireTask = NewObject<UAsyncTaskAcquireContentSet>();
+	AcquireTask->bLoadAssets = LoadAssets;
+	AcquireTask->Start(URLs);
+	return AcquireTask;
+}
+
+UAsyncTaskAcquireContentSet* UAsyncTaskAcquireContentSet::AcquireChannels(const FString& ManifestURL, const TArray<FString>& Channels, bool LoadAssets)
+{
+	UAsyncTaskAcquireContentSet* AcquireTask = NewObject<UAsyncTaskAcquireContentSet>();
+	AcquireTask->bLoadAssets = LoadAssets;
+	AcquireTask->Channels = Channels;
+	AcquireTask->StartFromManifest(ManifestURL);
+	return AcquireTask;
+}
+
+void UAsyncTaskAcquireContentSet::StartFromManifest(const FString& ManifestURL)
+{
+	UE_LOG(PakLoader, Log, TEXT("Acquiring channels %s from %s"), *FString::Join(Channels, TEXT(", ")), *ManifestURL);
+	TSharedRef<IHttpRequest> HttpRequest = FPakHttpConnections::Get().CreateRequest();
+	HttpRequest->OnProcessRequestComplete().BindUObject(this, &UAsyncTaskAcquireContentSet::HandleManifestRequest);
+	HttpRequest->SetURL(ManifestURL);
+	HttpRequest->SetVerb(TEXT("GET"));
+	FPakHttpConnections::Get().ProcessRequest(HttpRequest);
+}
+
+/** Adds the paks of Channel to OutPaks, after those of the channels it requires */
+static bool AddChannelPaks(const TMap<FString, TSharedPtr<FJsonObject>>& ChannelsByName, const FString& Channel, TSet<FString>& Visited, TArray<FString>& OutPaks)
+{
+	if (Visited.Contains(Channel))
+	{
+		return true;
+	}
+	Visited.Add(Channel);
+	const TSharedPtr<FJsonObject>* Found = ChannelsByName.Find(Channel);
+	if (Found == nullptr)
+	{
+		UE_LOG(PakLoader, Error, TEXT("Channel %s isn't in the content manifest"), *Channel);
+		return false;
+	}
+	TArray<FString> Requires;
+	(*Found)->TryGetStringArrayField(TEXT("requires"), Requires);
+	for (const FString& Required : Requires)
+	{
+		if (!AddChannelPaks(ChannelsByName, Required, Visited, OutPaks))
+		{
+			return false;
+		}
+	}
+	TArray<FString> ChannelPaks;
+	(*Found)->TryGetStringArrayField(TEXT("paks"), ChannelPaks);
+	for (const FString& Pak : ChannelPaks)
+	{
+		OutPaks.AddUnique(Pak);
+	}
+	return true;
+}
+
+void UAsyncTaskAcquireContentSet::HandleManifestRequest(FHttpRequestPtr HttpRequest, FHttpResponsePtr HttpResponse, bool bSucceeded)
+{
+	TMap<FString, TSharedPtr<FJsonObject>> ChannelsByName;
+	if (bSucceeded && HttpResponse.IsValid() && HttpResponse->GetResponseCode() == 200)
+	{
+		TSharedPtr<FJsonObject> Manifest;
+		TSharedRef<TJsonReader<>> Reader = TJsonReaderFactory<>::Create(HttpResponse->GetContentAsString());
+		const TArray<TSharedPtr<FJsonValue>>* ChannelValues = nullptr;
+		if (FJsonSerializer::Deserialize(Reader, Manifest) && Manifest.IsValid() && Manifest->TryGetArrayField(TEXT("channels"), ChannelValues))
+		{
+			for (const TSharedPtr<FJsonValue>& Value : *ChannelValues)
+			{
+				const TSharedPtr<FJsonObject>* Channel = nullptr;
+				FString Name;
+				if (Value->TryGetObject(Channel) && (*Channel)->TryGetStringField(TEXT("name"), Name))
+				{
+					ChannelsByName.Add(Name, *Channel);
+				}
+			}
+		}
+	}
+	TArray<FString> PakNames;
+	TSet<FString> Visited;
+	bool bFound = ChannelsByName.Num() > 0;
+	for (int32 Index = 0; Index < Channels.Num() && bFound; Index++)
+	{
+		bFound = AddChannelPaks(ChannelsByName, Channels[Index], Visited, PakNames);
+	}
+	if (!bFound)
+	{
+		UE_LOG(PakLoader, Error, TEXT("Couldn't get channels %s from %s (%d)"), *FString::Join(Channels, TEXT(", ")), *HttpRequest->GetURL(), HttpResponse.IsValid() ? HttpResponse->GetResponseCode() : -1);
+		RemoveFromRoot();
+		OnFail.Broadcast(TEXT("Content manifest missing or without the channels asked for"));
+		return;
+	}
+	// Pak names are relative to the manifest's folder
+	const FString ManifestFolder = HttpRequest->GetURL().Left(HttpRequest->GetURL().Find(TEXT("/"), ESearchCase::CaseSensitive, ESearchDir::FromEnd) + 1);
+	TArray<FString> URLs;
+	for (const FString& PakName : PakNames)
+	{
+		URLs.Add(PakName.Contains(TEXT("://")) ? PakName : ManifestFolder + PakName);
+	}
+	Start(URLs);
+}
+
+void UAsyncTaskAcquireContentSet::Start(const TArray<FString>& URLs)
+{
+	UE_LOG(PakLoader, Log, TEXT("Acquiring a content set of %d paks"), URLs.Num());
+	GConfig->GetInt(TEXT("PakLoader"), TEXT("ContentSetMaxDownloads"), MaxDownloads, GGameIni);
+	GConfig->GetInt(TEXT("PakLoader"), TEXT("ContentSetMaxVerifies"), MaxVerifies, GGameIni);
+	GConfig->GetInt(TEXT("PakLoader"), TEXT("ContentSetMaxLoads"), MaxLoads, GGameIni);
+	MaxDownloads = FMath::Max(MaxDownloads, 1);
+	MaxVerifies = FMath::Max(MaxVerifies, 1);
+	MaxLoads = FMath::Max(MaxLoads, 1);
+	for (const FString& URL : URLs)
+	{
+		FContentSetPak& Pak = Paks[Paks.AddDefaulted()];
+		Pak.URL = URL;
+	}
+	// Nothing is broadcast before the first tick, so the caller gets to bind our delegates
+	FTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateUObject(this, &UAsyncTaskAcquireContentSet::Pump));
+}
+
+int32 UAsyncTaskAcquireContentSet::CountInStage(EContentSetStage Stage) const
+{
+	int32 Count = 0;
+	for (const FContentSetPak& Pak : Paks)
+	{
+		Count += Pak.Stage == Stage ? 1 : 0;
+	}
+	return Count;
+}
+
+bool UAsyncTaskAcquireContentSet::Pump(float DeltaTime)
+{
+	// Later stages go first so a pak that is nearly ready isn't held up by new downloads
+	if (Error.Len() == 0)
+	{
+		for (int32 Index = 0; Index < Paks.Num() && CountInStage(EContentSetStage::Loading) < MaxLoads; Index++)
+		{
+			if (Paks[Index].Stage == EContentSetStage::Mounted)
+			{
+				StartLoad(Index);
+			}
+		}
+		for (int32 Index = 0; Index < Paks.Num(); Index++)
+		{
+			if (Paks[Index].Stage == EContentSetStage::Verified)
+			{
+				// Mounting reads the pak index on the game thread, so only one per tick
+				Mount(Index);
+				break;
+			}
+		}
+		for (int32 Index = 0; Index < Paks.Num() && CountInStage(EContentSetStage::Verifying) < MaxVerifies; Index++)
+		{
+			if (Paks[Index].Stage == EContentSetStage::Downloaded)
+			{
+				StartVerify(Index);
+			}
+		}
+		for (int32 Index = 0; Index < Paks.Num() && CountInStage(EContentSetStage::Downloading) < MaxDownloads; Index++)
+		{
+			if (Paks[Index].Stage == EContentSetStage::Queued)
+			{
+				StartDownload(Index);
+			}
+		}
+	}
+	ReportProgress();
+	// We stay rooted until nothing in flight can call back
+	const int32 InFlight = CountInStage(EContentSetStage::Downloading) + CountInStage(EContentSetStage::Verifying) + CountInStage(EContentSetStage::Loading);
+	if (Error.Len() > 0)
+	{
+		if (InFlight > 0)
+		{
+			return true;
+		}
+		RemoveFromRoot();
+		OnFail.Broadcast(Error);
+		return false;
+	}
+	if (CountInStage(EContentSetStage::Done) < Paks.Num())
+	{
+		return true;
+	}
+	TArray<FString> PakFilenames;
+	for (const FContentSetPak& Pak : Paks)
+	{
+		PakFilenames.Add(Pak.Filename);
+	}
+	UE_LOG(PakLoader, Log, TEXT("Acquired a content set of %d paks, %d assets"), Paks.Num(), LoadedAssets.Num());
+	RemoveFromRoot();
+	OnSuccess.Broadcast(PakFilenames, LoadedAssets);
+	return false;
+}
+
+void UAsyncTaskAcquireContentSet::StartDownload(int32 Index)
+{
+	FContentSetPak& Pak = Paks[Index];
+	Pak.Stage = EContentSetStage::Downloading;
+	UAsyncTaskDownloadPak* DownloadTask = UAsyncTaskDownloadPak::DownloadPak(Pak.URL, false);
+	// Downloads finish on a later tick at the earliest, so binding after starting is safe
+	DownloadTask->OnFinished = [this, Index](bool bSucceeded, const FString& Result)
+	{
+		if (!bSucceeded)
+		{
+			SetFailed(Index, Result);
+			return;
+		}
+		Paks[Index].Filename = Result;
+		Paks[Index].Stage = EContentSetStage::Downloaded;
+	};
+	DownloadTask->OnBytesProgress = [this, Index](int64 Received, int64 Total)
+	{
+		Paks[Index].DownloadFraction = Total > 0 ? (float)((double)Received / Total) : 0;
+	};
+}
+
+void UAsyncTaskAcquireContentSet::StartVerify(int32 Index)
+{
+	FContentSetPak& Pak = Paks[Index];
+	Pak.Stage = EContentSetStage::Verifying;
+	const FString URL = Pak.URL;
+	const FString Filename = Pak.Filename;
+	// Checks that everything the mount will read is on disk, without holding up the game thread
+	AsyncTask(ENamedThreads::AnyThread, [this, Index, URL, Filename]()
+	{
+		bool bComplete = IPlatformFile::GetPlatformPhysical().FileExists(*Filename);
+		FPakCacheEntry Entry;
+		if (!bComplete && FPakDownloadCache::Get().Find(URL, Entry))
+		{
+			TArray<int32> Missing;
+			FPakChunkStore::Get().GetMissingChunks(Entry.Recipe, Missing);
+			bComplete = Missing.Num() == 0;
+		}
+		AsyncTask(ENamedThreads::GameThread, [this, Index, bComplete]()
+		{
+			if (!bComplete)
+			{
+				SetFailed(Index, TEXT("Downloaded file is incomplete"));
+				return;
+			}
+			Paks[Index].Stage = EContentSetStage::Verified;
+		});
+	});
+}
+
+void UAsyncTaskAcquireContentSet::Mount(int32 Index)
+{
+	FContentSetPak& Pak = Paks[Index];
+	FPakLoaderModule& PakLoaderModule = FModuleManager::LoadModuleChecked<FPakLoaderModule>(FName(TEXT("PakLoader")));
+	if (!PakLoaderModule.MountPakFile(Pak.Filename, Pak.PakFile))
+	{
+		SetFailed(Index, TEXT("Couldn't mount downloaded file"));
+		return;
+	}
+	if (!bLoadAssets)
+	{
+		SetDone(Index);
+		return;
+	}
+	PakLoaderModule.GetAssetReferencesFromPak(Pak.PakFile, FPackageName::GetAssetPackageExtension(), Pak.Assets);
+	Pak.Stage = EContentSetStage::Mounted;
+}
+
+void UAsyncTaskAcquireContentSet::StartLoad(int32 Index)
+{
+	FContentSetPak& Pak = Paks[Index];
+	Pak.Stage = EContentSetStage::Loading;
+	if (Pak.Assets.Num() == 0)
+	{
+		SetDone(Index);
+		return;
+	}
+	StreamableManager.RequestAsyncLoad(Pak.Assets, FStreamableDelegate::CreateUObject(this, &UAsyncTaskAcquireContentSet::HandleAssetsLoaded, Index));
+}
+
+void UAsyncTaskAcquireContentSet::HandleAssetsLoaded(int32 Index)
+{
+	FContentSetPak& Pak = Paks[Index];
+	for (const FStringAssetReference& Asset : Pak.Assets)
+	{
+		UObject* Object = Asset.ResolveObject();
+		if (Object == nullptr)
+		{
+			// Blueprints are found by their generated class
+			Object = FStringAssetReference(Asset.ToString() + TEXT("_C")).ResolveObject();
+		}
+		if (Object != nullptr)
+		{
+			LoadedAssets.Add(Object);
+		}
+		else
+		{
+			UE_LOG(PakLoader, Log, TEXT("Couldn't load asset %s from Pak %s"), *Asset.ToString(), *Pak.Filename);
+		}
+	}
+	SetDone(Index);
+}
+
+void UAsyncTaskAcquireContentSet::SetDone(int32 Index)
+{
+	FContentSetPak& Pak = Paks[Index];
+	Pak.Stage = EContentSetStage::Done;
+	UE_LOG(PakLoader, Log, TEXT("Content set pak ready: %s"), *Pak.Filename);
+	OnPakReady.Broadcast(Pak.Filename);
+}
+
+void UAsyncTaskAcquireContentSet::SetFailed(int32 Index, const FString& Message)
+{
+	Paks[Index].Stage = EContentSetStage::Failed;
+	UE_LOG(PakLoader, Error, TEXT("Couldn't acquire %s: %s"), *Paks[Index].URL, *Message);
+	if (Error.Len() == 0)
+	{
+		Error = Message;
+	}
+}
+
+void UAsyncTaskAcquireContentSet::ReportProgress()
+{
+	float Sum = 0;
+	for (const FContentSetPak& Pak : Paks)
+	{
+		switch (Pak.Stage)
+		{
+		case EContentSetStage::Downloading:
+			Sum += DownloadedWeight * Pak.DownloadFraction;
+			break;
+		case EContentSetStage::Downloaded:
+		case EContentSetStage::Verifying:
+			Sum += DownloadedWeight;
+			break;
+		case EContentSetStage::Verified:
+			Sum += VerifiedWeight;
+			break;
+		case EContentSetStage::Mounted:
+		case EContentSetStage::Loading:
+			Sum += MountedWeight;
+			break;
+		case EContentSetStage::Done:
+			Sum += 1;
+			break;
+		default:
+			break;
+		}
+	}
+	const float Fraction = Paks.Num() > 0 ? Sum / Paks.Num() : 1;
+	if (FMath::Abs(Fraction - LastFraction) >= 0.005f || (Fraction == 1 && LastFraction != 1))
+	{
+		LastFraction = Fraction;
+		OnProgress.Broadcast(CountInStage(EContentSetStage::Done), Paks.Num(), Fraction);
+	}
+}
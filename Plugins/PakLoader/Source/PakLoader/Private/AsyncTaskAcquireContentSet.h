@@ -0,0 +1,113 @@
+// Copyright 1998-2016 Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+#include "Engine.h"
+#include "Kismet/BlueprintAsyncActionBase.h"
+#include "Engine/StreamableManager.h"
+#include "IHttpRequest.h"
+#include "AsyncTaskDownloadPak.h"
+
+#include "AsyncTaskAcquireContentSet.generated.h"
+
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(FContentSetDelegate, const TArray<FString>&, PakFilenames, const TArray<UObject*>&, Assets);
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_ThreeParams(FContentSetProgressDelegate, int32, PaksReady, int32, TotalPaks, float, Fraction);
+
+/** Where one pak of a content set is in the pipeline */
+enum class EContentSetStage : uint8
+{
+	Queued,
+	Downloading,
+	Downloaded,
+	Verifying,
+	Verified,
+	Mounted,
+	Loading,
+	Done,
+	Failed
+};
+
+/**
+* Downloads, verifies, mounts and (optionally) loads the assets of a list of paks as a pipeline: while one pak's
+* assets load, the next is being verified and mounted and the ones after it are downloading. Each stage has its
+* own concurrency limit ([PakLoader] ContentSetMaxDownloads, ContentSetMaxVerifies, ContentSetMaxLoads); mounting
+* happens on the game thread, one pak per tick.
+*/
+UCLASS()
+class PAKLOADER_API UAsyncTaskAcquireContentSet : public UBlueprintAsyncActionBase
+{
+	GENERATED_UCLASS_BODY()
+
+public:
+	UFUNCTION(BlueprintCallable, meta = (BlueprintInternalUseOnly = "true"))
+		static UAsyncTaskAcquireContentSet* AcquireContentSet(const TArray<FString>& URLs, bool LoadAssets);
+
+	/**
+	* Acquires the paks of Channels, and of the channels they require, as listed by the content manifest the deploy
+	* editor publishes next to the paks (<pak name>.json); required channels come first, each channel's paks in mount order
+	*/
+	UFUNCTION(BlueprintCallable, meta = (BlueprintInternalUseOnly = "true"))
+		static UAsyncTaskAcquireContentSet* AcquireChannels(const FString& ManifestURL, const TArray<FString>& Channels, bool LoadAssets);
+
+public:
+
+	/** Fired once every pak is mounted (and its assets loaded), with the paks in the order they were asked for */
+	UPROPERTY(BlueprintAssignable)
+		FContentSetDelegate OnSuccess;
+
+	/** Fired with the first error; paks already mounted stay mounted */
+	UPROPERTY(BlueprintAssignable)
+		FDownloadPakDelegate OnFail;
+
+	/** Fired with the local name of each pak as soon as it is ready */
+	UPROPERTY(BlueprintAssignable)
+		FDownloadPakDelegate OnPakReady;
+
+	UPROPERTY(BlueprintAssignable)
+		FContentSetProgressDelegate OnProgress;
+
+public:
+
+	void Start(const TArray<FString>& URLs);
+
+private:
+	struct FContentSetPak
+	{
+		FString URL;
+		FString Filename;
+		EContentSetStage Stage;
+		float DownloadFraction;
+		TSharedPtr<FPakFile> PakFile;
+		TArray<FStringAssetReference> Assets;
+
+		FContentSetPak() : Stage(EContentSetStage::Queued), DownloadFraction(0) {}
+	};
+
+	void StartFromManifest(const FString& ManifestURL);
+	void HandleManifestRequest(FHttpRequestPtr HttpRequest, FHttpResponsePtr HttpResponse, bool bSucceeded);
+
+	/** Moves every pak as far along the pipeline as the stage limits allow */
+	bool Pump(float DeltaTime);
+	void StartDownload(int32 Index);
+	void StartVerify(int32 Index);
+	void Mount(int32 Index);
+	void StartLoad(int32 Index);
+	void HandleAssetsLoaded(int32 Index);
+	void SetDone(int32 Index);
+	void SetFailed(int32 Index, const FString& Message);
+	int32 CountInStage(EContentSetStage Stage) const;
+	void ReportProgress();
+
+	bool bLoadAssets;
+	/** Channels to acquire, for AcquireChannels */
+	TArray<FString> Channels;
+	TArray<FContentSetPak> Paks;
+	FString Error;
+	float LastFraction;
+	int32 MaxDownloads;
+	int32 MaxVerifies;
+	int32 MaxLoads;
+	FStreamableManager StreamableManager;
+
+	UPROPERTY()
+		TArray<UObject*> LoadedAssets;
+};
@@ -0,0 +1,263 @@
+// Copyright 1998-2016 Epic Games, Inc. All Rights Reserved.
+
+#include "PakLoaderPrivatePCH.h"
+#include "Http.h"
+#include "PakHttpConnections.h"
+#include "Json.h"
+#include "AsyncTaskCheckForUpdates.h"
+#include "PakDownloadCache.h"
+#include "PakMirrors.h"
+#include "ContentDecoder.h"
+#include "Async.h"
+
+//----------------------------------------------------------------------//
+// UAsyncTaskCheckForUpdates
+//----------------------------------------------------------------------//
+
+UAsyncTaskCheckForUpdates::UAsyncTaskCheckForUpdates(const FObjectInitializer& ObjectInitializer)
+	: Super(ObjectInitializer)
+	, PendingChecks(0)
+	, NumUpdated(0)
+{
+	if (HasAnyFlags(RF_ClassDefaultObject) == false)
+	{
+		AddToRoot();
+	}
+}
+
+UAsyncTaskCheckForUpdates* UAsyncTaskCheckForUpdates::CheckForUpdates(const FString& CatalogURL, const TArray<FString>& URLs)
+{
+	UAsyncTaskCheckForUpdates* CheckTask = NewObject<UAsyncTaskCheckForUpdates>();
+	CheckTask->URLs = URLs;
+	if (CheckTask->URLs.Num() == 0)
+	{
+		TArray<FPakCacheEntry> Entries;
+		FPakDownloadCache::Get().GetEntries(Entries);
+		for (const FPakCacheEntry& Entry : Entries)
+		{
+			CheckTask->URLs.Add(Entry.Url);
+		}
+	}
+	CheckTask->Start(CatalogURL);
+	return CheckTask;
+}
+
+void UAsyncTaskCheckForUpdates::Start(const FString& CatalogURL)
+{
+	UE_LOG(PakLoader, Log, TEXT("Checking %d paks for updates against %s"), URLs.Num(), *CatalogURL);
+	if (CatalogURL.IsEmpty())
+	{
+		// Deferred so the caller gets to bind OnUpdated and OnComplete, which may fire straight away
+		AsyncTask(ENamedThreads::GameThread, [this]()
+		{
+			HandleCatalogRequest(nullptr, nullptr, false);
+		});
+		return;
+	}
+	TSharedRef<IHttpRequest> HttpRequest = FPakHttpConnections::Get().CreateRequest();
+	HttpRequest->OnProcessRequestComplete().BindUObject(this, &UAsyncTaskCheckForUpdates::HandleCatalogRequest);
+	HttpRequest->SetURL(CatalogURL);
+	HttpRequest->SetVerb(TEXT("GET"));
+	FPakHttpConnections::Get().ProcessRequest(HttpRequest);
+}
+
+/**
+* Returns true if the catalog item describes different content than the cached pak. Sets bOutComparable to false if
+* the item has nothing the cached pak can be compared with, such as only an ETag for a pak that was assembled from
+* a chunk manifest and so has none.
+*/
+static bool IsCatalogItemNewer(const TSharedPtr<FJsonObject>& Item, const FPakCacheEntry& Entry, bool& bOutComparable)
+{
+	bOutComparable = true;
+	FString SHA1;
+	if (Item->TryGetStringField(TEXT("sha1"), SHA1) && SHA1.Len() == 40 && Entry.Recipe.bHasPakHash)
+	{
+		return !SHA1.Equals(Entry.Recipe.PakHash.ToString(), ESearchCase::IgnoreCase);
+	}
+	FString ETag;
+	if (Item->TryGetStringField(TEXT("etag"), ETag) && ETag.Len() > 0 && Entry.ETag.Len() > 0)
+	{
+		return ETag != Entry.ETag;
+	}
+	bOutComparable = false;
+	return true;
+}
+
+void UAsyncTaskCheckForUpdates::HandleCatalogRequest(FHttpRequestPtr HttpRequest, FHttpResponsePtr HttpResponse, bool bSucceeded)
+{
+	TMap<FString, TSharedPtr<FJsonObject>> Items;
+	if (bSucceeded && HttpResponse.IsValid() && HttpResponse->GetResponseCode() == 200)
+	{
+		TSharedPtr<FJsonObject> Catalog;
+		TSharedRef<TJsonReader<>> Reader = TJsonReaderFactory<>::Create(HttpResponse->GetContentAsString());
+		const TArray<TSharedPtr<FJsonValue>>* ItemValues = nullptr;
+		if (FJsonSerializer::Deserialize(Reader, Catalog) && Catalog.IsValid() && Catalog->TryGetArrayField(TEXT("items"), ItemValues))
+		{
+			const FString CatalogFolder = HttpRequest->GetURL().Left(HttpRequest->GetURL().Find(TEXT("/"), ESearchCase::CaseSensitive, ESearchDir::FromEnd) + 1);
+			for (const TSharedPtr<FJsonValue>& Value : *ItemValues)
+			{
+				const TSharedPtr<FJsonObject>* Item = nullptr;
+				FString ItemURL;
+				if (Value->TryGetObject(Item) && (*Item)->TryGetStringField(TEXT("url"), ItemURL))
+				{
+					if (!ItemURL.Contains(TEXT("://")))
+					{
+						ItemURL = CatalogFolder + ItemURL;
+					}
+					Items.Add(ItemURL, *Item);
+				}
+			}
+		}
+		else
+		{
+			UE_LOG(PakLoader, Warning, TEXT("Invalid update catalog %s"), *HttpRequest->GetURL());
+		}
+	}
+	else if (HttpRequest.IsValid())
+	{
+		UE_LOG(PakLoader, Log, TEXT("No update catalog at %s, checking each pak"), *HttpRequest->GetURL());
+	}
+
+	FPakDownloadCache& Cache = FPakDownloadCache::Get();
+	// Hold off completion until every individual check has been issued
+	PendingChecks++;
+	for (const FString& URL : URLs)
+	{
+		const TSharedPtr<FJsonObject>* Item = Items.Find(URL);
+		if (Item == nullptr)
+		{
+			CheckIndividually(URL);
+			continue;
+		}
+		FPakCacheEntry Entry;
+		if (!Cache.Find(URL, Entry))
+		{
+			Updated(URL);
+			continue;
+		}
+		bool bComparable = true;
+		const bool bNewer = IsCatalogItemNewer(*Item, Entry, bComparable);
+		if (!bComparable)
+		{
+			CheckIndividually(URL);
+		}
+		else if (bNewer)
+		{
+			Updated(URL);
+		}
+	}
+	PendingChecks--;
+	FinishIfDone();
+}
+
+void UAsyncTaskCheckForUpdates::CheckIndividually(const FString& URL)
+{
+	FPakCacheEntry Entry;
+	if (!FPakDownloadCache::Get().Find(URL, Entry))
+	{
+		Updated(URL);
+		return;
+	}
+	// A mirror:// URL only names a group: ask the mirror expected to answer first, but report the cached URL
+	TArray<FString> MirrorURLs;
+	FPakMirrors::Get().Resolve(URL, MirrorURLs);
+	float WaitSeconds = 0;
+	const int32 Mirror = FPakMirrors::Get().Choose(MirrorURLs, 0, WaitSeconds);
+	if (Mirror == INDEX_NONE)
+	{
+		UE_LOG(PakLoader, Warning, TEXT("Update check for %s failed: no mirror to ask"), *URL);
+		return;
+	}
+	TSharedRef<IHttpRequest> HttpRequest = FPakHttpConnections::Get().CreateRequest();
+	if (Entry.ETag.IsEmpty() && Entry.Recipe.Chunks.Num() > 0)
+	{
+		// Assembled from a chunk manifest, so there is no ETag to validate; the manifest itself is small
+		HttpRequest->OnProcessRequestComplete().BindUObject(this, &UAsyncTaskCheckForUpdates::HandleChunkManifestRequest, URL);
+		HttpRequest->SetURL(MirrorURLs[Mirror] + TEXT(".chunks"));
+		HttpRequest->SetVerb(TEXT("GET"));
+		HttpRequest->SetHeader(TEXT("Accept-Encoding"), FContentDecoder::GetAcceptEncoding());
+	}
+	else
+	{
+		// HEAD keeps a changed pak from being downloaded just to find out it changed
+		HttpRequest->OnProcessRequestComplete().BindUObject(this, &UAsyncTaskCheckForUpdates::HandleHeadRequest, URL);
+		HttpRequest->SetURL(MirrorURLs[Mirror]);
+		HttpRequest->SetVerb(TEXT("HEAD"));
+		HttpRequest->SetHeader(TEXT("If-None-Match"), Entry.ETag);
+		if (Entry.LastModified.Len() > 0)
+		{
+			HttpRequest->SetHeader(TEXT("If-Modified-Since"), Entry.LastModified);
+		}
+	}
+	PendingChecks++;
+	FPakHttpConnections::Get().ProcessRequest(HttpRequest);
+}
+
+void UAsyncTaskCheckForUpdates::HandleHeadRequest(FHttpRequestPtr HttpRequest, FHttpResponsePtr HttpResponse, bool bSucceeded, FString URL)
+{
+	PendingChecks--;
+	if (bSucceeded && HttpResponse.IsValid())
+	{
+		const int32 ResponseCode = HttpResponse->GetResponseCode();
+		FPakCacheEntry Entry;
+		// Not every server honors validators on HEAD, so compare the ETag as well
+		if (ResponseCode == 200 && (!FPakDownloadCache::Get().Find(URL, Entry) || HttpResponse->GetHeader(TEXT("ETag")) != Entry.ETag))
+		{
+			Updated(URL);
+		}
+		else if (ResponseCode != 200 && ResponseCode != 304)
+		{
+			UE_LOG(PakLoader, Warning, TEXT("Update check for %s failed with %d"), *URL, ResponseCode);
+		}
+	}
+	else
+	{
+		UE_LOG(PakLoader, Warning, TEXT("Update check for %s failed"), *URL);
+	}
+	FinishIfDone();
+}
+
+void UAsyncTaskCheckForUpdates::HandleChunkManifestRequest(FHttpRequestPtr HttpRequest, FHttpResponsePtr HttpResponse, bool bSucceeded, FString URL)
+{
+	PendingChecks--;
+	TArray<uint8> Manifest;
+	int64 ManifestSize = 0;
+	FPakChunkRecipe ServerRecipe;
+	FPakCacheEntry Entry;
+	if (bSucceeded && HttpResponse.IsValid() && HttpResponse->GetResponseCode() == 200
+		&& FContentDecoder::Decode(HttpResponse->GetHeader(TEXT("Content-Encoding")), HttpResponse->GetContent().GetData(), HttpResponse->GetContent().Num(),
+			[&Manifest](const uint8* Data, int64 Size) { Manifest.Append(Data, Size); return true; }, ManifestSize))
+	{
+		Manifest.Add(0);
+		if (!ServerRecipe.FromString(UTF8_TO_TCHAR((const ANSICHAR*)Manifest.GetData())))
+		{
+			UE_LOG(PakLoader, Warning, TEXT("Update check for %s failed: invalid chunk manifest"), *URL);
+		}
+		else if (!FPakDownloadCache::Get().Find(URL, Entry) || !(ServerRecipe == Entry.Recipe))
+		{
+			Updated(URL);
+		}
+	}
+	else
+	{
+		UE_LOG(PakLoader, Warning, TEXT("Update check for %s failed with %d"), *URL, HttpResponse.IsValid() ? HttpResponse->GetResponseCode() : -1);
+	}
+	FinishIfDone();
+}
+
+void UAsyncTaskCheckForUpdates::Updated(const FString& URL)
+{
+	UE_LOG(PakLoader, Log, TEXT("Update available for %s"), *URL);
+	NumUpdated++;
+	OnUpdated.Broadcast(URL);
+}
+
+void UAsyncTaskCheckForUpdates::FinishIfDone()
+{
+	if (PendingChecks == 0)
+	{
+		UE_LOG(PakLoader, Log, TEXT("%d of %d paks have updates"), NumUpdated, URLs.Num());
+		RemoveFromRoot();
+		OnComplete.Broadcast(NumUpdated);
+	}
+}
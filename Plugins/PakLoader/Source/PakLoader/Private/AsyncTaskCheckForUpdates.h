@@ -0,0 +1,63 @@
+// Copyright 1998-2016 Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+#include "Engine.h"
+#include "IHttpRequest.h"
+#include "Kismet/BlueprintAsyncActionBase.h"
+#include "AsyncTaskDownloadPak.h"
+
+#include "AsyncTaskCheckForUpdates.generated.h"
+
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FCheckForUpdatesCompleteDelegate, int32, NumUpdated);
+
+/**
+* Checks many paks for updates in one round trip by fetching a catalog listing the current ETag and/or SHA1
+* of each pak and comparing it with the download cache:
+*
+*   { "items": [ { "url": "http://host/Game-Windows-Content.pak", "etag": "\"5a1f\"", "sha1": "..." }, ... ] }
+*
+* Relative item urls are resolved against the catalog's folder. URLs missing from the catalog (or all of them,
+* if there's no catalog) are checked individually with conditional HEAD requests, sent to the best mirror for
+* mirror:// URLs. Paks assembled from a chunk manifest have no ETag of their own, so their manifest is fetched
+* instead and compared with the cached recipe.
+*/
+UCLASS()
+class PAKLOADER_API UAsyncTaskCheckForUpdates : public UBlueprintAsyncActionBase
+{
+	GENERATED_UCLASS_BODY()
+
+public:
+	/**
+	* Checks URLs (or every cached pak, if URLs is empty) against the catalog at CatalogURL
+	*/
+	UFUNCTION(BlueprintCallable, meta = (BlueprintInternalUseOnly = "true"))
+		static UAsyncTaskCheckForUpdates* CheckForUpdates(const FString& CatalogURL, const TArray<FString>& URLs);
+
+public:
+
+	/** Fired for each URL whose content changed on the server (or isn't cached yet) */
+	UPROPERTY(BlueprintAssignable)
+		FDownloadPakDelegate OnUpdated;
+
+	/** Fired once every URL has been checked */
+	UPROPERTY(BlueprintAssignable)
+		FCheckForUpdatesCompleteDelegate OnComplete;
+
+public:
+
+	void Start(const FString& CatalogURL);
+
+private:
+	/** Handles the catalog listing the current versions of the paks */
+	void HandleCatalogRequest(FHttpRequestPtr HttpRequest, FHttpResponsePtr HttpResponse, bool bSucceeded);
+	/** Handle the per-URL fallback checks; URL is the cached pak's, which for mirrors isn't the one requested */
+	void HandleHeadRequest(FHttpRequestPtr HttpRequest, FHttpResponsePtr HttpResponse, bool bSucceeded, FString URL);
+	void HandleChunkManifestRequest(FHttpRequestPtr HttpRequest, FHttpResponsePtr HttpResponse, bool bSucceeded, FString URL);
+	void CheckIndividually(const FString& URL);
+	void Updated(const FString& URL);
+	void FinishIfDone();
+
+	TArray<FString> URLs;
+	int32 PendingChecks;
+	int32 NumUpdated;
+};
@@ -3,10 +3,17 @@
 #include "PakLoaderPrivatePCH.h"
 #include "PakLoader.h"
 #include "Http.h"
+#include "PakHttpConnections.h"
 #include "AsyncTaskDownloadPak.h"
+#include "PakDownloadCache.h"
+#include "ContentDecoder.h"
+#include "DownloadScheduler.h"
+#include "HttpPakSource.h"
+#include "PakMirrors.h"
 #include "TimerManager.h"
 #include "CoreMisc.h"
 #include "Base64.h"
+#include "Async.h"
 
 //----------------------------------------------------------------------//
 // UAsyncTaskDownloadPak
@@ -15,6 +22,24 @@
 
 UAsyncTaskDownloadPak::UAsyncTaskDownloadPak(const FObjectInitializer& ObjectInitializer)
 	: Super(ObjectInitializer)
+	, bBackground(false)
+	, CachePolicy(EPakCachePolicy::AlwaysRevalidate)
+	, bRevalidating(false)
+	, MirrorIndex(0)
+	, FailedAttempts(0)
+	, PendingRanges(0)
+	, bRangeError(false)
+	, RangeAttempts(0)
+	, RequestReceived(0)
+	, CompletedRangeBytes(0)
+	, TotalRangeBytes(0)
+	, bSliceQueued(false)
+	, bBackgroundRequestInFlight(false)
+	, bPumping(false)
+	, ThrottleReason(EDownloadThrottleReason::None)
+	, ThrottleStart(0)
+	, SliceOffset(0)
+	, SliceTotal(-1)
 {
 	if (HasAnyFlags(RF_ClassDefaultObject) == false)
 	{
@@ -22,52 +47,895 @@ UAsyncTaskDownloadPak::UAsyncTaskDownloadPak(const FObjectInitializer& ObjectIni
 	}
 }
 
-void UAsyncTaskDownloadPak::GetDownloadFilenames(const FString& URL,
-	FString& DownloadedFilename, FString& ETagFilename)
+void UAsyncTaskDownloadPak::GetDownloadFilename(const FString& URL, FString& DownloadedFilename)
 {
-	FString DownloadDir = FPaths::GameSavedDir() + TEXT("DownloadedPaks/");
-	FPaths::NormalizeDirectoryName(DownloadDir);
-	IFileManager::Get().MakeDirectory(*DownloadDir, true);
-	const FString DownloadedFilenameBase = DownloadDir / FBase64::Encode(URL);
-	ETagFilename = DownloadedFilenameBase + ".etag";
-	DownloadedFilename = DownloadedFilenameBase + ".pak";
+	DownloadedFilename = FPakDownloadCache::Get().GetPakFilename(URL);
 }
 
-UAsyncTaskDownloadPak* UAsyncTaskDownloadPak::DownloadPak(const FString& URL, bool CheckForUpdateOnly)
+UAsyncTaskDownloadPak* UAsyncTaskDownloadPak::DownloadPak(const FString& URL, bool CheckForUpdateOnly, EPakCachePolicy CachePolicy)
 {
 	UAsyncTaskDownloadPak* DownloadTask = NewObject<UAsyncTaskDownloadPak>();
 	DownloadTask->bCheckForUpdateOnly = CheckForUpdateOnly;
+	DownloadTask->CachePolicy = CachePolicy;
 	DownloadTask->Start(URL);
 	return DownloadTask;
 }
 
+UAsyncTaskDownloadPak* UAsyncTaskDownloadPak::DownloadPakFromMirrors(const TArray<FString>& MirrorURLs, bool CheckForUpdateOnly, EPakCachePolicy CachePolicy)
+{
+	UAsyncTaskDownloadPak* DownloadTask = NewObject<UAsyncTaskDownloadPak>();
+	DownloadTask->bCheckForUpdateOnly = CheckForUpdateOnly;
+	DownloadTask->CachePolicy = CachePolicy;
+	DownloadTask->MirrorURLs = MirrorURLs;
+	DownloadTask->Start(MirrorURLs.Num() > 0 ? MirrorURLs[0] : FString());
+	return DownloadTask;
+}
+
+UAsyncTaskDownloadPak* UAsyncTaskDownloadPak::PrefetchPak(const FString& URL)
+{
+	UAsyncTaskDownloadPak* DownloadTask = NewObject<UAsyncTaskDownloadPak>();
+	DownloadTask->bCheckForUpdateOnly = false;
+	DownloadTask->bBackground = true;
+	DownloadTask->Start(URL);
+	return DownloadTask;
+}
+
+/** Chunk manifests are opt-in: without them every download costs an extra (failing) request */
+static bool UseChunkManifests()
+{
+	bool bUseChunkManifests = false;
+	GConfig->GetBool(TEXT("PakLoader"), TEXT("bUseChunkManifests"), bUseChunkManifests, GGameIni);
+	return bUseChunkManifests;
+}
+
+/** Reads the expected SHA1 of the body from an X-Content-SHA1 (hex) or RFC 3230 "Digest: SHA=<base64>" header */
+static bool GetExpectedPakHash(const FHttpResponsePtr& HttpResponse, FSHAHash& OutHash)
+{
+	const FString Hex = HttpResponse->GetHeader(TEXT("X-Content-SHA1")).Trim().TrimTrailing();
+	if (Hex.Len() == 40)
+	{
+		OutHash.FromString(Hex);
+		return true;
+	}
+	TArray<FString> Digests;
+	HttpResponse->GetHeader(TEXT("Digest")).ParseIntoArray(Digests, TEXT(","));
+	for (const FString& Digest : Digests)
+	{
+		const FString Trimmed = Digest.Trim().TrimTrailing();
+		TArray<uint8> Bytes;
+		if (Trimmed.StartsWith(TEXT("SHA=")) && FBase64::Decode(Trimmed.Mid(4), Bytes) && Bytes.Num() == sizeof(OutHash.Hash))
+		{
+			FMemory::Memcpy(OutHash.Hash, Bytes.GetData(), sizeof(OutHash.Hash));
+			return true;
+		}
+	}
+	return false;
+}
+
+bool UAsyncTaskDownloadPak::GetCachedPakHash(const FString& URL, FString& OutHash)
+{
+	FPakCacheEntry Entry;
+	if (FPakDownloadCache::Get().Find(URL, Entry) && Entry.Recipe.bHasPakHash)
+	{
+		OutHash = Entry.Recipe.PakHash.ToString();
+		return true;
+	}
+	return false;
+}
+
+/** Adds a finished request to the session stats, and to its mirror's if it went through */
+static void RecordRequest(const FString& URL, const FHttpRequestPtr& HttpRequest, const FHttpResponsePtr& HttpResponse, double PeakBytesPerSecond)
+{
+	const int32 ResponseCode = HttpResponse.IsValid() ? HttpResponse->GetResponseCode() : -1;
+	const int64 Bytes = HttpResponse.IsValid() ? HttpResponse->GetContent().Num() : 0;
+	FDownloadStats::Get().RecordRequest(URL, ResponseCode, Bytes, HttpRequest->GetElapsedTime(), PeakBytesPerSecond);
+	if (ResponseCode >= 200 && ResponseCode < 400)
+	{
+		FPakMirrors::Get().RecordTransfer(HttpRequest->GetURL(), HttpRequest->GetElapsedTime(), Bytes);
+	}
+}
+
+/** Largest number of bytes requested by a single range request for missing chunks */
+static const int64 MaxChunkRangeSize = 8 * 1024 * 1024;
+
+/** How often background downloads ask the scheduler whether they may issue their next request */
+static const float BackgroundPumpInterval = 0.05f;
+
+/** Size assumed when picking a mirror for a whole pak of unknown size */
+static const int64 DefaultPakSize = 16 * 1024 * 1024;
+
+/** A range request is only moved to another mirror after this long, with this much left, to one this many times faster */
+static const double MinSecondsBeforeMove = 2.0;
+static const int64 MinBytesToMove = 512 * 1024;
+static const double MoveSpeedup = 3.0;
+
 void UAsyncTaskDownloadPak::Start(FString URL)
 {
+	FGameThreadTimer::FScope TimerScope(GameThreadTimer);
 	UE_LOG(PakLoader, Log, TEXT("Download request for: %s"), *URL);
+	Progress.Start();
+	PakURL = URL;
+	if (MirrorURLs.Num() == 0)
+	{
+		FPakMirrors::Get().Resolve(URL, MirrorURLs);
+	}
+	if (MirrorURLs.Num() == 0 || URL.Len() == 0)
+	{
+		// Deferred so the caller gets to bind OnFail
+		RunOnIOThread([]() -> FString
+		{
+			return TEXT("No URL to download from");
+		},
+		[=](const FString& Error)
+		{
+			Fail(URL, Error);
+		});
+		return;
+	}
+	FPakCacheEntry Cached;
+	if (CachePolicy == EPakCachePolicy::StaleWhileRevalidate && !bCheckForUpdateOnly && FPakDownloadCache::Get().Find(URL, Cached))
+	{
+		const bool bFresh = Cached.IsFresh();
+		// Also defers OnSuccess until the caller has bound it
+		RunOnIOThread([=]() -> FString
+		{
+			FPakDownloadCache::Get().Touch(URL);
+			return FString();
+		},
+		[=](const FString& Error)
+		{
+			if (bFresh)
+			{
+				UE_LOG(PakLoader, Log, TEXT("Using cached file for %s, fresh until %s"), *URL, *Cached.ExpiresAt.ToString());
+				Succeed(URL);
+				return;
+			}
+			UE_LOG(PakLoader, Log, TEXT("Using cached file for %s while revalidating it"), *URL);
+			FString DownloadedFilename;
+			GetDownloadFilename(URL, DownloadedFilename);
+			bRevalidating = true;
+			bBackground = true;
+			OnSuccess.Broadcast(DownloadedFilename);
+			if (OnFinished)
+			{
+				OnFinished(true, DownloadedFilename);
+			}
+			RequestPak(URL);
+		});
+		return;
+	}
+	RequestPak(URL);
+}
+
+void UAsyncTaskDownloadPak::RequestPak(const FString& URL)
+{
+	if (UseChunkManifests())
+	{
+		SelectMirror(0);
+		TSharedRef<IHttpRequest> HttpRequest = FPakHttpConnections::Get().CreateRequest();
+		HttpRequest->OnProcessRequestComplete().BindUObject(this, &UAsyncTaskDownloadPak::HandleChunkManifestRequest, URL);
+		HttpRequest->SetURL(GetMirrorURL() + TEXT(".chunks"));
+		HttpRequest->SetVerb(TEXT("GET"));
+		HttpRequest->SetHeader(TEXT("Accept-Encoding"), FContentDecoder::GetAcceptEncoding());
+		FPakHttpConnections::Get().ProcessRequest(HttpRequest);
+		return;
+	}
+	StartFullDownload(URL);
+}
+
+void UAsyncTaskDownloadPak::StartFullDownload(const FString& URL)
+{
+	if (bBackground)
+	{
+		SliceChunker.Reset(new FPakChunker());
+		SliceOffset = 0;
+		SliceTotal = -1;
+		bSliceQueued = true;
+		StartBackgroundPump(URL);
+		return;
+	}
+	FPakCacheEntry Entry;
+	const bool bCached = FPakDownloadCache::Get().Find(URL, Entry);
+	SelectMirror(bCached ? Entry.GetSize() : DefaultPakSize);
+	FDownloadScheduler::Get().BeginForegroundTransfer();
 	// Create the Http request and add to pending request list	
-	TSharedRef<IHttpRequest> HttpRequest = FHttpModule::Get().CreateRequest();
+	TSharedRef<IHttpRequest> HttpRequest = FPakHttpConnections::Get().CreateRequest();
 	HttpRequest->OnProcessRequestComplete().BindUObject(this, &UAsyncTaskDownloadPak::HandlePakRequest);
-	HttpRequest->SetURL(URL);
+	HttpRequest->OnRequestProgress().BindUObject(this, &UAsyncTaskDownloadPak::HandlePakRequestProgress);
+	HttpRequest->SetURL(GetMirrorURL());
+	HttpRequest->SetVerb(TEXT("GET"));
+	HttpRequest->SetHeader(TEXT("Accept-Encoding"), FContentDecoder::GetAcceptEncoding());
+	if (bCached)
+	{
+		UE_LOG(PakLoader, Log, TEXT("Setting If-None-Match: %s"), *Entry.ETag);
+		if (Entry.LastModified.Len() > 0)
+		{
+			HttpRequest->SetHeader(TEXT("If-Modified-Since"), Entry.LastModified);
+		}
+	}
+	HttpRequest->SetHeader(TEXT("If-None-Match"), Entry.ETag);
+	RequestReceived = 0;
+	FPakHttpConnections::Get().ProcessRequest(HttpRequest);
+}
+
+bool UAsyncTaskDownloadPak::CommitRecipe(const FString& URL, const FPakChunkRecipe& Recipe, const FString& ETag, const FString& LastModified, const FDateTime& ExpiresAt)
+{
+	// The cache removes a pak materialized from the old version, or keeps it until unmount if it is mounted
+	FPakDownloadCache& Cache = FPakDownloadCache::Get();
+	FPakCacheEntry Entry;
+	Entry.Url = URL;
+	Entry.ETag = ETag;
+	Entry.LastModified = LastModified;
+	Entry.ExpiresAt = ExpiresAt;
+	Entry.Recipe = Recipe;
+	if (!Cache.Commit(Entry))
+	{
+		UE_LOG(PakLoader, Error, TEXT("Couldn't add %s to the download cache index"), *URL);
+		return false;
+	}
+	return true;
+}
+
+void UAsyncTaskDownloadPak::SelectMirror(int64 Bytes)
+{
+	float WaitSeconds = 0;
+	const int32 Best = FPakMirrors::Get().Choose(MirrorURLs, Bytes, WaitSeconds);
+	if (Best != INDEX_NONE)
+	{
+		MirrorIndex = Best;
+	}
+}
+
+bool UAsyncTaskDownloadPak::FailOver(const FString& FailedURL, TFunction<void()> Retry)
+{
+	// A single URL fails straight away, as it always has
+	if (MirrorURLs.Num() < 2)
+	{
+		return false;
+	}
+	FPakMirrors& Mirrors = FPakMirrors::Get();
+	Mirrors.RecordFailure(FailedURL);
+	if (++FailedAttempts >= Mirrors.GetMaxAttempts())
+	{
+		UE_LOG(PakLoader, Error, TEXT("Giving up on %s after %d failed attempts"), *PakURL, FailedAttempts);
+		return false;
+	}
+	float WaitSeconds = 0;
+	const int32 Next = Mirrors.Choose(MirrorURLs, 0, WaitSeconds);
+	UE_LOG(PakLoader, Log, TEXT("Retrying %s on %s in %.1fs"), *PakURL, *MirrorURLs[Next], WaitSeconds);
+	FDownloadStats::Get().RecordRetry(PakURL);
+	if (WaitSeconds <= 0)
+	{
+		Retry();
+		return true;
+	}
+	// We stay rooted until the retry has run
+	FTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateLambda([this, Retry](float DeltaTime)
+	{
+		FGameThreadTimer::FScope TimerScope(GameThreadTimer);
+		Retry();
+		return false;
+	}), WaitSeconds);
+	return true;
+}
+
+void UAsyncTaskDownloadPak::StartBackgroundPump(const FString& URL)
+{
+	BackgroundURL = URL;
+	bPumping = true;
+	if (!PumpHandle.IsValid())
+	{
+		PumpHandle = FTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateUObject(this, &UAsyncTaskDownloadPak::PumpBackgroundRequests), BackgroundPumpInterval);
+	}
+}
+
+void UAsyncTaskDownloadPak::StopBackgroundPump()
+{
+	// The ticker is removed the next time it fires
+	bPumping = false;
+	if (ThrottleReason != EDownloadThrottleReason::None)
+	{
+		FDownloadStats::Get().RecordThrottle(BackgroundURL, ThrottleReason, FPlatformTime::Seconds() - ThrottleStart);
+		ThrottleReason = EDownloadThrottleReason::None;
+	}
+}
+
+bool UAsyncTaskDownloadPak::DeferWhileHitchSensitive(TFunction<void()> Write)
+{
+	if (!FDownloadScheduler::Get().IsHitchSensitive())
+	{
+		return false;
+	}
+	DeferredWrites.Add(MoveTemp(Write));
+	return true;
+}
+
+bool UAsyncTaskDownloadPak::PumpBackgroundRequests(float DeltaTime)
+{
+	FGameThreadTimer::FScope TimerScope(GameThreadTimer);
+	FDownloadScheduler& Scheduler = FDownloadScheduler::Get();
+	if (DeferredWrites.Num() > 0 && !Scheduler.IsHitchSensitive())
+	{
+		TArray<TFunction<void()>> Writes = MoveTemp(DeferredWrites);
+		for (const TFunction<void()>& Write : Writes)
+		{
+			Write();
+		}
+	}
+	if (!bPumping)
+	{
+		PumpHandle.Reset();
+		return false;
+	}
+	if (bBackgroundRequestInFlight || DeferredWrites.Num() > 0 || (QueuedRanges.Num() == 0 && !bSliceQueued))
+	{
+		return true;
+	}
+	const int64 Bytes = bSliceQueued ? Scheduler.GetBackgroundSliceSize()
+		: ServerOffsets[QueuedRanges[0].LastChunk + 1] - ServerOffsets[QueuedRanges[0].FirstChunk];
+	const EDownloadThrottleReason Reason = Scheduler.AcquireBackgroundTransfer(Bytes);
+	if (Reason != ThrottleReason)
+	{
+		const double Now = FPlatformTime::Seconds();
+		if (ThrottleReason != EDownloadThrottleReason::None)
+		{
+			FDownloadStats::Get().RecordThrottle(BackgroundURL, ThrottleReason, Now - ThrottleStart);
+		}
+		ThrottleReason = Reason;
+		ThrottleStart = Now;
+	}
+	if (Reason != EDownloadThrottleReason::None)
+	{
+		return true;
+	}
+	bBackgroundRequestInFlight = true;
+	if (bSliceQueued)
+	{
+		bSliceQueued = false;
+		RequestPakSlice(BackgroundURL);
+	}
+	else
+	{
+		const FPakChunkRange Range = QueuedRanges[0];
+		QueuedRanges.RemoveAt(0);
+		RequestChunkRange(BackgroundURL, Range.FirstChunk, Range.LastChunk);
+	}
+	return true;
+}
+
+void UAsyncTaskDownloadPak::RequestPakSlice(const FString& URL)
+{
+	const int64 SliceSize = FDownloadScheduler::Get().GetBackgroundSliceSize();
+	const int64 SliceEnd = SliceTotal >= 0 ? FMath::Min(SliceOffset + SliceSize, SliceTotal) : SliceOffset + SliceSize;
+	// Picking the mirror per slice moves a background download to whichever mirror is fastest by now
+	SelectMirror(SliceEnd - SliceOffset);
+	TSharedRef<IHttpRequest> HttpRequest = FPakHttpConnections::Get().CreateRequest();
+	HttpRequest->OnProcessRequestComplete().BindUObject(this, &UAsyncTaskDownloadPak::HandlePakSliceRequest, URL);
+	HttpRequest->SetURL(GetMirrorURL());
 	HttpRequest->SetVerb(TEXT("GET"));
-	FString ETagFilename;
+	HttpRequest->SetHeader(TEXT("Accept-Encoding"), TEXT("identity"));
+	HttpRequest->SetHeader(TEXT("Range"), FString::Printf(TEXT("bytes=%lld-%lld"), SliceOffset, SliceEnd - 1));
+	if (SliceOffset == 0)
+	{
+		FPakCacheEntry Entry;
+		if (FPakDownloadCache::Get().Find(URL, Entry))
+		{
+			HttpRequest->SetHeader(TEXT("If-None-Match"), Entry.ETag);
+			if (Entry.LastModified.Len() > 0)
+			{
+				HttpRequest->SetHeader(TEXT("If-Modified-Since"), Entry.LastModified);
+			}
+		}
+	}
+	else if (SliceETag.Len() > 0)
+	{
+		// The whole pak comes back if it changed since the first slice
+		HttpRequest->SetHeader(TEXT("If-Range"), SliceETag);
+	}
+	FPakHttpConnections::Get().ProcessRequest(HttpRequest);
+}
+
+void UAsyncTaskDownloadPak::HandlePakSliceRequest(FHttpRequestPtr HttpRequest,
+	FHttpResponsePtr HttpResponse, bool bSucceeded, FString URL)
+{
+	if (DeferWhileHitchSensitive([=]() { HandlePakSliceRequest(HttpRequest, HttpResponse, bSucceeded, URL); }))
+	{
+		return;
+	}
+	FGameThreadTimer::FScope TimerScope(GameThreadTimer);
+	const int32 ResponseCode = HttpResponse.IsValid() ? HttpResponse->GetResponseCode() : -1;
+	if (ResponseCode == 304 || ResponseCode == 200)
+	{
+		// Not modified, or the whole pak: no different from a foreground download
+		bBackgroundRequestInFlight = false;
+		StopBackgroundPump();
+		HandlePakRequest(HttpRequest, HttpResponse, bSucceeded);
+		return;
+	}
+	RecordRequest(URL, HttpRequest, HttpResponse, Progress.GetPeakBytesPerSecond());
+	int64 First = 0;
+	int64 Last = 0;
+	int64 Total = 0;
+	if (!bSucceeded || ResponseCode < 200 || (ResponseCode >= 300 && ResponseCode != 416))
+	{
+		UE_LOG(PakLoader, Error, TEXT("Error downloading %s: %d"), *HttpRequest->GetURL(), ResponseCode);
+		bBackgroundRequestInFlight = false;
+		if (FailOver(HttpRequest->GetURL(), [this]() { bSliceQueued = true; }))
+		{
+			return;
+		}
+		StopBackgroundPump();
+		Fail(URL, TEXT("Couldn't download file"));
+		return;
+	}
+	if (ResponseCode != 206 || !ParseContentRange(HttpResponse->GetHeader(TEXT("Content-Range")), First, Last, Total)
+		|| First != SliceOffset || HttpResponse->GetContent().Num() != Last - First + 1)
+	{
+		UE_LOG(PakLoader, Warning, TEXT("Unusable range response for %s (%d), downloading the whole file in the foreground"), *URL, ResponseCode);
+		bBackgroundRequestInFlight = false;
+		StopBackgroundPump();
+		FDownloadStats::Get().RecordRetry(URL);
+		bBackground = false;
+		StartFullDownload(URL);
+		return;
+	}
+	if (SliceOffset == 0)
+	{
+		SliceTotal = Total;
+		SliceETag = HttpResponse->GetHeader(TEXT("ETag"));
+		SliceLastModified = HttpResponse->GetHeader(TEXT("Last-Modified"));
+		SliceExpiresAt = GetExpiresAt(HttpResponse);
+		UE_LOG(PakLoader, Log, TEXT("Content changed on server: %s"), *URL);
+		OnUpdated.Broadcast(URL);
+	}
+	const bool bLastSlice = Last + 1 == SliceTotal;
+	FPakChunker* const Chunker = SliceChunker.Get();
+	const FString ETag = SliceETag;
+	const FString LastModified = SliceLastModified;
+	const FDateTime ExpiresAt = SliceExpiresAt;
+	// The next slice isn't requested until this one is stored, so the chunker is only ever used by one thread at a time
+	RunOnIOThread([=]() -> FString
+	{
+		if (!Chunker->Write(HttpResponse->GetContent().GetData(), HttpResponse->GetContent().Num()))
+		{
+			UE_LOG(PakLoader, Error, TEXT("Couldn't store chunks for %s"), *URL);
+			return TEXT("Couldn't save downloaded file");
+		}
+		if (!bLastSlice)
+		{
+			return FString();
+		}
+		FPakChunkRecipe Recipe;
+		FSHAHash ExpectedHash;
+		if (!Chunker->Finish(Recipe))
+		{
+			UE_LOG(PakLoader, Error, TEXT("Couldn't store chunks for %s"), *URL);
+			return TEXT("Couldn't save downloaded file");
+		}
+		if (GetExpectedPakHash(HttpResponse, ExpectedHash) && !(ExpectedHash == Recipe.PakHash))
+		{
+			UE_LOG(PakLoader, Error, TEXT("Integrity check failed for %s: expected %s, got %s"), *URL, *ExpectedHash.ToString(), *Recipe.PakHash.ToString());
+			return TEXT("Downloaded file is corrupt");
+		}
+		UE_LOG(PakLoader, Log, TEXT("Stored %s (sha1 %s) as %d chunks, %lld of %lld bytes were already cached"), *URL, *Recipe.PakHash.ToString(), Recipe.Chunks.Num(), Chunker->GetReusedBytes(), Recipe.GetTotalSize());
+		return CommitRecipe(URL, Recipe, ETag, LastModified, ExpiresAt) ? FString() : TEXT("Couldn't save downloaded file");
+	},
+	[=](const FString& Error)
+	{
+		bBackgroundRequestInFlight = false;
+		if (Error.Len() > 0 || bLastSlice)
+		{
+			StopBackgroundPump();
+		}
+		if (Error.Len() > 0)
+		{
+			Fail(URL, Error);
+			return;
+		}
+		SliceOffset = Last + 1;
+		ReportProgress(SliceOffset, SliceTotal, bLastSlice);
+		if (bLastSlice)
+		{
+			Succeed(URL);
+			return;
+		}
+		bSliceQueued = true;
+	});
+}
+
+void UAsyncTaskDownloadPak::RunOnIOThread(TFunction<FString()> Work, TFunction<void(const FString&)> Then)
+{
+	// We stay rooted until the continuation has run, so capturing this is safe
+	AsyncTask(ENamedThreads::AnyThread, [this, Work, Then]()
+	{
+		const FString Error = Work();
+		AsyncTask(ENamedThreads::GameThread, [this, Then, Error]()
+		{
+			FGameThreadTimer::FScope TimerScope(GameThreadTimer);
+			Then(Error);
+		});
+	});
+}
+
+void UAsyncTaskDownloadPak::Finish(const FString& URL)
+{
+	// Whatever was stored is committed or abandoned by now
+	FPakChunkStore::Get().Unpin(PinnedRecipe);
+	PinnedRecipe = FPakChunkRecipe();
+	SliceChunker.Reset();
+	RemoveFromRoot();
+	FDownloadStats::Get().RecordGameThreadTime(URL, GameThreadTimer.GetSeconds());
+}
+
+void UAsyncTaskDownloadPak::Succeed(const FString& URL)
+{
+	Finish(URL);
+	if (bRevalidating)
+	{
+		UE_LOG(PakLoader, Log, TEXT("Revalidated cached file for %s"), *URL);
+		return;
+	}
 	FString DownloadedFilename;
-	GetDownloadFilenames(URL, DownloadedFilename, ETagFilename);
-	FString ETag;
-	//IPlatformFile& PlatformFile = IPlatformFile::GetPlatformPhysical();
-	IFileManager* const FileManager = &IFileManager::Get();
-	if (FileManager->FileExists(*DownloadedFilename) && FFileHelper::LoadFileToString(ETag, *ETagFilename))
+	GetDownloadFilename(URL, DownloadedFilename);
+	OnSuccess.Broadcast(DownloadedFilename);
+	if (OnFinished)
+	{
+		OnFinished(true, DownloadedFilename);
+	}
+}
+
+void UAsyncTaskDownloadPak::Fail(const FString& URL, const FString& Message)
+{
+	Finish(URL);
+	if (bRevalidating)
+	{
+		// The caller already has the cached pak, which is still the best we have
+		UE_LOG(PakLoader, Warning, TEXT("Couldn't revalidate cached file for %s: %s"), *URL, *Message);
+		return;
+	}
+	OnFail.Broadcast(Message);
+	if (OnFinished)
+	{
+		OnFinished(false, Message);
+	}
+}
+
+void UAsyncTaskDownloadPak::ReportProgress(int64 Received, int64 Total, bool bForce)
+{
+	if (Progress.Update(Received, Total, bForce))
+	{
+		OnProgress.Broadcast(FDownloadProgress::ToBlueprintBytes(Received), FDownloadProgress::ToBlueprintBytes(Total), Progress.GetBytesPerSecond(), Progress.GetSecondsRemaining());
+		if (OnBytesProgress)
+		{
+			OnBytesProgress(Received, FMath::Max<int64>(Total, 0));
+		}
+	}
+}
+
+void UAsyncTaskDownloadPak::HandlePakRequestProgress(FHttpRequestPtr HttpRequest, int32 BytesSent, int32 BytesReceived)
+{
+	const FHttpResponsePtr HttpResponse = HttpRequest->GetResponse();
+	// Unwrap against this request's own count: a retry or fallback starts again from 0
+	RequestReceived = FDownloadProgress::UnwrapHttpBytes(BytesReceived, RequestReceived);
+	ReportProgress(RequestReceived, HttpResponse.IsValid() ? HttpResponse->GetContentLength() : 0);
+}
+
+void UAsyncTaskDownloadPak::HandleChunkRangeProgress(FHttpRequestPtr HttpRequest, int32 BytesSent, int32 BytesReceived, int32 FirstChunk)
+{
+	RangeBytesReceived.Add(FirstChunk, BytesReceived);
+	int64 Received = CompletedRangeBytes;
+	for (const TPair<int32, int32>& Range : RangeBytesReceived)
 	{
-		UE_LOG(PakLoader, Log, TEXT("Setting If-None-Match: %s"), *ETag);
+		Received += Range.Value;
 	}
-	HttpRequest->SetHeader(TEXT("If-None-Match"), ETag);
-	HttpRequest->ProcessRequest();
+	ReportProgress(Received, TotalRangeBytes);
+	MoveSlowRange(FirstChunk, BytesReceived);
+}
+
+void UAsyncTaskDownloadPak::MoveSlowRange(int32 FirstChunk, int32 BytesReceived)
+{
+	const FPakRangeRequest* InFlight = InFlightRanges.Find(FirstChunk);
+	if (MirrorURLs.Num() < 2 || InFlight == nullptr)
+	{
+		return;
+	}
+	const double Elapsed = FPlatformTime::Seconds() - InFlight->StartTime;
+	const int32 LastChunk = InFlight->LastChunk;
+	const int64 Remaining = ServerOffsets[LastChunk + 1] - ServerOffsets[FirstChunk] - BytesReceived;
+	if (Elapsed < MinSecondsBeforeMove || Remaining < MinBytesToMove)
+	{
+		return;
+	}
+	FPakMirrors& Mirrors = FPakMirrors::Get();
+	float WaitSeconds = 0;
+	const int32 Best = Mirrors.Choose(MirrorURLs, Remaining, WaitSeconds, InFlight->Mirror);
+	const double BytesPerSecond = BytesReceived / Elapsed;
+	// An untried mirror counts with the optimistic default throughput, so it gets its chance
+	if (Best == InFlight->Mirror || WaitSeconds > 0 || Mirrors.GetBytesPerSecond(MirrorURLs[Best]) < BytesPerSecond * MoveSpeedup)
+	{
+		return;
+	}
+	UE_LOG(PakLoader, Log, TEXT("Moving chunks %d-%d of %s from %s (%.0f bytes/s) to %s (%.0f bytes/s)"), FirstChunk, LastChunk, *PakURL,
+		*MirrorURLs[InFlight->Mirror], BytesPerSecond, *MirrorURLs[Best], Mirrors.GetBytesPerSecond(MirrorURLs[Best]));
+	// The slow mirror's stats learn from what it managed so far
+	Mirrors.RecordTransfer(MirrorURLs[InFlight->Mirror], Elapsed, BytesReceived);
+	FDownloadStats::Get().RecordRetry(PakURL);
+	const TSharedPtr<IHttpRequest> SlowRequest = InFlight->Request;
+	// Its completion is ignored from here on
+	InFlightRanges.Remove(FirstChunk);
+	RangeBytesReceived.Add(FirstChunk, 0);
+	SlowRequest->CancelRequest();
+	RequestChunkRange(PakURL, FirstChunk, LastChunk, Best);
+}
+
+void UAsyncTaskDownloadPak::HandleChunkManifestRequest(FHttpRequestPtr HttpRequest,
+	FHttpResponsePtr HttpResponse, bool bSucceeded, FString URL)
+{
+	FGameThreadTimer::FScope TimerScope(GameThreadTimer);
+	RecordRequest(URL + TEXT(".chunks"), HttpRequest, HttpResponse, 0);
+	TArray<uint8> Manifest;
+	int64 ManifestSize = 0;
+	const bool bHasManifest = bSucceeded && HttpResponse.IsValid() && HttpResponse->GetResponseCode() == 200
+		&& FContentDecoder::Decode(HttpResponse->GetHeader(TEXT("Content-Encoding")), HttpResponse->GetContent().GetData(), HttpResponse->GetContent().Num(),
+			[&Manifest](const uint8* Data, int64 Size) { Manifest.Append(Data, Size); return true; }, ManifestSize);
+	if (bHasManifest)
+	{
+		Manifest.Add(0);
+	}
+	if (!bSucceeded && FailOver(HttpRequest->GetURL(), [=]() { RequestPak(URL); }))
+	{
+		return;
+	}
+	if (!bHasManifest || !ServerRecipe.FromString(UTF8_TO_TCHAR((const ANSICHAR*)Manifest.GetData())))
+	{
+		UE_LOG(PakLoader, Log, TEXT("No chunk manifest for %s, downloading the whole file"), *URL);
+		StartFullDownload(URL);
+		return;
+	}
+	FPakCacheEntry Cached;
+	const bool bChanged = !(FPakDownloadCache::Get().Find(URL, Cached) && Cached.Recipe == ServerRecipe);
+	if (bChanged)
+	{
+		UE_LOG(PakLoader, Log, TEXT("Content changed on server: %s"), *URL);
+		OnUpdated.Broadcast(URL);
+	}
+	if (bCheckForUpdateOnly)
+	{
+		Finish(URL);
+		return;
+	}
+	// The chunks found present must survive until the recipe is committed, whatever the quota evicts meanwhile
+	FPakChunkStore::Get().Unpin(PinnedRecipe);
+	PinnedRecipe = ServerRecipe;
+	FPakChunkStore::Get().Pin(PinnedRecipe);
+	// Looking for the chunks we already have stats a file per chunk
+	TSharedRef<TArray<int32>, ESPMode::ThreadSafe> Missing = MakeShareable(new TArray<int32>());
+	const FPakChunkRecipe Recipe = ServerRecipe;
+	// The manifest describes the pak, so its lifetime is the pak's
+	const FDateTime ExpiresAt = GetExpiresAt(HttpResponse);
+	RunOnIOThread([=]() -> FString
+	{
+		FPakChunkStore::Get().GetMissingChunks(Recipe, *Missing);
+		if (Missing->Num() > 0)
+		{
+			return FString();
+		}
+		// the manifest's validators aren't the pak's, so none are kept
+		if (bChanged && !CommitRecipe(URL, Recipe, FString(), FString(), ExpiresAt))
+		{
+			return TEXT("Couldn't save downloaded file");
+		}
+		FPakDownloadCache::Get().Revalidate(URL, ExpiresAt);
+		return FString();
+	},
+	[=](const FString& Error)
+	{
+		if (Error.Len() > 0)
+		{
+			Fail(URL, Error);
+		}
+		else if (Missing->Num() == 0)
+		{
+			UE_LOG(PakLoader, Log, TEXT("Using cached chunks for %s"), *URL);
+			Succeed(URL);
+		}
+		else
+		{
+			RequestMissingChunks(URL, *Missing);
+		}
+	});
+}
+
+void UAsyncTaskDownloadPak::RequestMissingChunks(const FString& URL, const TArray<int32>& Missing)
+{
+	// Fetch the missing chunks with one range request per run of adjacent chunks
+	ServerRecipe.GetOffsets(ServerOffsets);
+	PendingRanges = 0;
+	bRangeError = false;
+	RangeBytesReceived.Empty();
+	CompletedRangeBytes = 0;
+	int64 MissingBytes = 0;
+	for (int32 i = 0; i < Missing.Num();)
+	{
+		const int32 FirstChunk = Missing[i];
+		int32 LastChunk = FirstChunk;
+		while (++i < Missing.Num() && Missing[i] == LastChunk + 1 && ServerOffsets[Missing[i] + 1] - ServerOffsets[FirstChunk] <= MaxChunkRangeSize)
+		{
+			LastChunk = Missing[i];
+		}
+		MissingBytes += ServerOffsets[LastChunk + 1] - ServerOffsets[FirstChunk];
+		RangeBytesReceived.Add(FirstChunk, 0);
+		PendingRanges++;
+		if (bBackground)
+		{
+			QueuedRanges.Add({ FirstChunk, LastChunk });
+		}
+		else
+		{
+			RequestChunkRange(URL, FirstChunk, LastChunk);
+		}
+	}
+	TotalRangeBytes = MissingBytes;
+	if (bBackground)
+	{
+		StartBackgroundPump(URL);
+	}
+	UE_LOG(PakLoader, Log, TEXT("Fetching %d of %d chunks (%lld of %lld bytes) for %s"), Missing.Num(), ServerRecipe.Chunks.Num(), MissingBytes, ServerRecipe.GetTotalSize(), *URL);
+}
+
+void UAsyncTaskDownloadPak::RequestChunkRange(const FString& URL, int32 FirstChunk, int32 LastChunk, int32 Mirror)
+{
+	if (!bBackground)
+	{
+		FDownloadScheduler::Get().BeginForegroundTransfer();
+	}
+	if (Mirror == INDEX_NONE)
+	{
+		SelectMirror(ServerOffsets[LastChunk + 1] - ServerOffsets[FirstChunk]);
+	}
+	else
+	{
+		MirrorIndex = Mirror;
+	}
+	const int32 Attempt = ++RangeAttempts;
+	TSharedRef<IHttpRequest> RangeRequest = FPakHttpConnections::Get().CreateRequest();
+	RangeRequest->OnProcessRequestComplete().BindUObject(this, &UAsyncTaskDownloadPak::HandleChunkRangeRequest, URL, FirstChunk, LastChunk, Attempt);
+	RangeRequest->OnRequestProgress().BindUObject(this, &UAsyncTaskDownloadPak::HandleChunkRangeProgress, FirstChunk);
+	RangeRequest->SetURL(GetMirrorURL());
+	RangeRequest->SetVerb(TEXT("GET"));
+	// Ranges address the pak itself, not an encoding of it
+	RangeRequest->SetHeader(TEXT("Accept-Encoding"), TEXT("identity"));
+	RangeRequest->SetHeader(TEXT("Range"), FString::Printf(TEXT("bytes=%lld-%lld"), ServerOffsets[FirstChunk], ServerOffsets[LastChunk + 1] - 1));
+	FPakRangeRequest& InFlight = InFlightRanges.Add(FirstChunk);
+	InFlight.Request = RangeRequest;
+	InFlight.LastChunk = LastChunk;
+	InFlight.Mirror = MirrorIndex;
+	InFlight.StartTime = FPlatformTime::Seconds();
+	InFlight.Attempt = Attempt;
+	FPakHttpConnections::Get().ProcessRequest(RangeRequest);
+}
+
+void UAsyncTaskDownloadPak::HandleChunkRangeRequest(FHttpRequestPtr HttpRequest,
+	FHttpResponsePtr HttpResponse, bool bSucceeded, FString URL, int32 FirstChunk, int32 LastChunk, int32 Attempt)
+{
+	if (bBackground)
+	{
+		if (DeferWhileHitchSensitive([=]() { HandleChunkRangeRequest(HttpRequest, HttpResponse, bSucceeded, URL, FirstChunk, LastChunk, Attempt); }))
+		{
+			return;
+		}
+	}
+	else
+	{
+		FDownloadScheduler::Get().EndForegroundTransfer();
+	}
+	FGameThreadTimer::FScope TimerScope(GameThreadTimer);
+	const FPakRangeRequest* InFlight = InFlightRanges.Find(FirstChunk);
+	if (InFlight == nullptr || InFlight->Attempt != Attempt)
+	{
+		// Cancelled when the range moved to another mirror
+		return;
+	}
+	InFlightRanges.Remove(FirstChunk);
+	RecordRequest(URL, HttpRequest, HttpResponse, Progress.GetPeakBytesPerSecond());
+	const FString RequestURL = HttpRequest->GetURL();
+	const int32 ResponseCode = HttpResponse.IsValid() ? HttpResponse->GetResponseCode() : -1;
+	// A server that ignores Range answers with the whole pak
+	const int64 Base = ResponseCode == 200 ? 0 : ServerOffsets[FirstChunk];
+	const bool bReceived = bSucceeded && (ResponseCode == 206 || ResponseCode == 200)
+		&& HttpResponse->GetContent().Num() >= ServerOffsets[LastChunk + 1] - Base;
+	TArray<FPakChunk> Chunks;
+	TArray<int64> Offsets;
+	for (int32 Index = FirstChunk; Index <= LastChunk; Index++)
+	{
+		Chunks.Add(ServerRecipe.Chunks[Index]);
+		Offsets.Add(ServerOffsets[Index] - Base);
+	}
+	RunOnIOThread([=]() -> FString
+	{
+		bool bOk = bReceived;
+		for (int32 Index = 0; bOk && Index < Chunks.Num(); Index++)
+		{
+			bOk = FPakChunkStore::Get().StoreChunk(Chunks[Index], HttpResponse->GetContent().GetData() + Offsets[Index]);
+		}
+		if (!bOk)
+		{
+			UE_LOG(PakLoader, Error, TEXT("Error fetching chunks %d-%d of %s: %d"), FirstChunk, LastChunk, *RequestURL, ResponseCode);
+			return TEXT("Couldn't download file");
+		}
+		return FString();
+	},
+	[=](const FString& Error)
+	{
+		bBackgroundRequestInFlight = false;
+		if (Error.Len() > 0 && FailOver(RequestURL, [=]()
+			{
+				if (bBackground)
+				{
+					QueuedRanges.Insert({ FirstChunk, LastChunk }, 0);
+				}
+				else
+				{
+					RequestChunkRange(URL, FirstChunk, LastChunk);
+				}
+			}))
+		{
+			RangeBytesReceived.Add(FirstChunk, 0);
+			return;
+		}
+		RangeBytesReceived.Remove(FirstChunk);
+		CompletedRangeBytes += ServerOffsets[LastChunk + 1] - ServerOffsets[FirstChunk];
+		bRangeError |= Error.Len() > 0;
+		if (--PendingRanges > 0)
+		{
+			return;
+		}
+		StopBackgroundPump();
+		if (bRangeError)
+		{
+			UE_LOG(PakLoader, Log, TEXT("Falling back to downloading the whole file for %s"), *URL);
+			FDownloadStats::Get().RecordRetry(URL);
+			StartFullDownload(URL);
+			return;
+		}
+		ReportProgress(TotalRangeBytes, TotalRangeBytes, true);
+		const FPakChunkRecipe Recipe = ServerRecipe;
+		const FString ETag = HttpResponse->GetHeader(TEXT("ETag"));
+		const FString LastModified = HttpResponse->GetHeader(TEXT("Last-Modified"));
+		const FDateTime ExpiresAt = GetExpiresAt(HttpResponse);
+		RunOnIOThread([=]() -> FString
+		{
+			return CommitRecipe(URL, Recipe, ETag, LastModified, ExpiresAt) ? FString() : TEXT("Couldn't save downloaded file");
+		},
+		[=](const FString& CommitError)
+		{
+			if (CommitError.Len() > 0)
+			{
+				Fail(URL, CommitError);
+				return;
+			}
+			Succeed(URL);
+		});
+	});
 }
 
 void UAsyncTaskDownloadPak::HandlePakRequest(FHttpRequestPtr HttpRequest,
 	FHttpResponsePtr HttpResponse, bool bSucceeded)
 {
-	RemoveFromRoot();
-	const FString Url = HttpRequest->GetURL();
+	FGameThreadTimer::FScope TimerScope(GameThreadTimer);
+	if (!bBackground)
+	{
+		FDownloadScheduler::Get().EndForegroundTransfer();
+	}
+	const FString Url = PakURL;
+	RecordRequest(Url, HttpRequest, HttpResponse, Progress.GetPeakBytesPerSecond());
+	const int32 ResponseCode = HttpResponse.IsValid() ? HttpResponse->GetResponseCode() : -1;
+	// An error from one mirror isn't news about the pak, so retry before anything is reported
+	if ((!bSucceeded || (ResponseCode != 200 && ResponseCode != 304)) && FailOver(HttpRequest->GetURL(), [=]() { StartFullDownload(Url); }))
+	{
+		UE_LOG(PakLoader, Warning, TEXT("Error downloading %s: %d"), *HttpRequest->GetURL(), ResponseCode);
+		return;
+	}
 	const bool _304 = HttpResponse.IsValid() && HttpResponse->GetResponseCode() == 304;	
 	if (HttpResponse.IsValid())
 	{
@@ -78,78 +946,94 @@ void UAsyncTaskDownloadPak::HandlePakRequest(FHttpRequestPtr HttpRequest,
 		}
 		if (bCheckForUpdateOnly)
 		{
+			Finish(Url);
 			return;
 		}
 	}
-	if (_304 || (bSucceeded && HttpResponse.IsValid() && HttpResponse->GetResponseCode() == 200 && HttpResponse->GetContentLength() > 0))
+	if (_304)
+	{
+		UE_LOG(PakLoader, Log, TEXT("Using cached file for %s"), *Url);
+		const FDateTime ExpiresAt = GetExpiresAt(HttpResponse);
+		RunOnIOThread([=]() -> FString
+		{
+			FPakDownloadCache::Get().Revalidate(Url, ExpiresAt);
+			return FString();
+		},
+		[=](const FString& Error)
+		{
+			Succeed(Url);
+		});
+		return;
+	}
+	int64 BodySize = 0;
+	if (bSucceeded && HttpResponse.IsValid() && HttpResponse->GetResponseCode() == 200 && HttpResponse->GetContent().Num() > 0
+		&& FContentDecoder::GetBodySize(Url, *HttpResponse, BodySize))
 	{	
 		FString DownloadedFilename;
-		FString ETagFilename;
-		GetDownloadFilenames(Url, DownloadedFilename, ETagFilename);
-		if (!_304)
+		GetDownloadFilename(Url, DownloadedFilename);
+		ReportProgress(BodySize, BodySize, true);
+		UE_LOG(PakLoader, Log, TEXT("Attempting to cache %s as %s"), *Url, *DownloadedFilename);
+		RunOnIOThread([=]() -> FString
 		{
 			const FString ETag = HttpResponse->GetHeader("ETag");
-			UE_LOG(PakLoader, Log, TEXT("Attempting to cache %s as %s"), *Url, *DownloadedFilename);
-			IFileManager* const FileManager = &IFileManager::Get();
-			//IPlatformFile& PlatformFile = IPlatformFile::GetPlatformPhysical();
-			//FString TmpFilename(DownloadedFilename + ".tmp");
-			//TmpFilename = FPaths::ConvertRelativePathToFull(TmpFilename);
-			FString TmpFilename = FPaths::CreateTempFilename(*FPaths::GameSavedDir());
-			FArchive* const Ar = FileManager->CreateFileWriter(*TmpFilename, 0);
-			bool bIOError = (Ar == nullptr);
+			// Split the pak into content-addressed chunks so content shared with other paks is only stored once,
+			// decoding a compressed transfer on the way in
+			FPakChunker Chunker;
+			FPakChunkRecipe Recipe;
+			const FString ContentEncoding = HttpResponse->GetHeader(TEXT("Content-Encoding"));
+			int64 DecodedSize = 0;
+			bool bIOError = !FContentDecoder::Decode(ContentEncoding, HttpResponse->GetContent().GetData(), BodySize,
+				[&Chunker](const uint8* Data, int64 Size) { return Chunker.Write(Data, Size); }, DecodedSize) || !Chunker.Finish(Recipe);
 			if (bIOError)
 			{
-				UE_LOG(PakLoader, Error, TEXT("Couldn't create tmp file %s for %s"), *Url, *TmpFilename);
+				UE_LOG(PakLoader, Error, TEXT("Couldn't decode or store chunks for %s"), *Url);
 			}
 			else
 			{
-				Ar->Serialize(const_cast<uint8*>(HttpResponse->GetContent().GetData()), HttpResponse->GetContentLength());
-				Ar->Close();
-				delete Ar;
-				int32 Size = FileManager->FileSize(*TmpFilename);
-				bIOError = (Size != HttpResponse->GetContentLength());
-				if (bIOError)
+				if (ContentEncoding.Len() > 0)
 				{
-					UE_LOG(PakLoader, Error, TEXT("Could only write %d of %d bytes to %s for %s"), Size, HttpResponse->GetContentLength(), *TmpFilename, *Url);
-				}
-				else
-				{
-					bIOError = !FileManager->Move(*DownloadedFilename, *TmpFilename);
+					FDownloadStats::Get().RecordDecompression(Url, BodySize, DecodedSize);
 				}
+				const int64 Size = Recipe.GetTotalSize();
+				bIOError = (Size != DecodedSize);
 				if (bIOError)
 				{
-					UE_LOG(PakLoader, Error, TEXT("Couldn't rename tmp file %s to %s for %s"), *TmpFilename, *DownloadedFilename, *Url);
+					UE_LOG(PakLoader, Error, TEXT("Could only write %lld of %lld bytes for %s"), Size, DecodedSize, *Url);
 				}
 				else
 				{
-					if (ETag.Len() > 0)
+					FSHAHash ExpectedHash;
+					if (GetExpectedPakHash(HttpResponse, ExpectedHash) && !(ExpectedHash == Recipe.PakHash))
 					{
-						bIOError = !FFileHelper::SaveStringToFile(ETag, *ETagFilename, FFileHelper::EEncodingOptions::ForceUTF8, FileManager);
-						if (bIOError)
-						{
-							UE_LOG(PakLoader, Error, TEXT("Couldn't create etag file %s for %s"), *ETagFilename, *Url);
-						}
+						UE_LOG(PakLoader, Error, TEXT("Integrity check failed for %s: expected %s, got %s"), *Url, *ExpectedHash.ToString(), *Recipe.PakHash.ToString());
+						return TEXT("Downloaded file is corrupt");
 					}
-					else
+					UE_LOG(PakLoader, Log, TEXT("Stored %s (sha1 %s) as %d chunks, %lld of %lld bytes were already cached"), *Url, *Recipe.PakHash.ToString(), Recipe.Chunks.Num(), Chunker.GetReusedBytes(), Size);
+					if (ETag.Len() == 0)
 					{
 						UE_LOG(PakLoader, Log, TEXT("No ETag header for %s"), *Url);
 					}
+					bIOError = !CommitRecipe(Url, Recipe, ETag, HttpResponse->GetHeader(TEXT("Last-Modified")), GetExpiresAt(HttpResponse));
 				}
 			}
 			if (bIOError)
 			{
 				UE_LOG(PakLoader, Error, TEXT("Couldn't save %s as %s"), *Url, *DownloadedFilename);
-				OnFail.Broadcast(TEXT("Couldn't save downloaded file"));
-				return;
+				return TEXT("Couldn't save downloaded file");
 			}
-		}
-		else
+			return FString();
+		},
+		[=](const FString& Error)
 		{
-			UE_LOG(PakLoader, Log, TEXT("Using cached file for %s"), *Url);
-		}
-		OnSuccess.Broadcast(DownloadedFilename);
+			if (Error.Len() > 0)
+			{
+				Fail(Url, Error);
+				return;
+			}
+			Succeed(Url);
+		});
 		return;
 	}
-	UE_LOG(PakLoader, Error, TEXT("Error downloading %s: %d"), *Url, HttpResponse.IsValid() ? HttpResponse->GetResponseCode() : -1);
-	OnFail.Broadcast(TEXT("Couldn't download file"));
+	UE_LOG(PakLoader, Error, TEXT("Error downloading %s: %d"), *HttpRequest->GetURL(), HttpResponse.IsValid() ? HttpResponse->GetResponseCode() : -1);
+	Fail(Url, TEXT("Couldn't download file"));
 }
@@ -0,0 +1,176 @@
+// Copyright 1998-2016 Epic Games, Inc. All Rights Reserved.
+
+#include "PakLoaderPrivatePCH.h"
+#include "PakLoader.h"
+#include "Http.h"
+#include "PakHttpConnections.h"
+#include "AsyncTaskMemoryPak.h"
+#include "PakDownloadCache.h"
+#include "ContentDecoder.h"
+#include "HttpPakSource.h"
+#include "DownloadStats.h"
+#include "Async.h"
+
+//----------------------------------------------------------------------//
+// UAsyncTaskMemoryPak
+//----------------------------------------------------------------------//
+
+UAsyncTaskMemoryPak::UAsyncTaskMemoryPak(const FObjectInitializer& ObjectInitializer)
+	: Super(ObjectInitializer)
+	, bWriteThroughToCache(false)
+{
+	if (HasAnyFlags(RF_ClassDefaultObject) == false)
+	{
+		AddToRoot();
+	}
+}
+
+UAsyncTaskMemoryPak* UAsyncTaskMemoryPak::DownloadPakToMemory(const FString& URL, bool WriteThroughToCache)
+{
+	UAsyncTaskMemoryPak* MemoryTask = NewObject<UAsyncTaskMemoryPak>();
+	MemoryTask->bWriteThroughToCache = WriteThroughToCache;
+	MemoryTask->Start(URL);
+	return MemoryTask;
+}
+
+FString UAsyncTaskMemoryPak::GetPakFilename(const FString& Url)
+{
+	// Named like downloaded paks, so patch paks held in memory are mounted over the paks they patch
+	return FPaths::ConvertRelativePathToFull(FPaths::GameSavedDir() / TEXT("DownloadedPaks/Memory") / FPakDownloadCache::GetName(Url) + TEXT(".pak"));
+}
+
+void UAsyncTaskMemoryPak::Start(const FString& URL)
+{
+	UE_LOG(PakLoader, Log, TEXT("Memory download request for: %s"), *URL);
+	TSharedRef<IHttpRequest> HttpRequest = FPakHttpConnections::Get().CreateRequest();
+	HttpRequest->OnProcessRequestComplete().BindUObject(this, &UAsyncTaskMemoryPak::HandlePakRequest, URL);
+	HttpRequest->SetURL(URL);
+	HttpRequest->SetVerb(TEXT("GET"));
+	HttpRequest->SetHeader(TEXT("Accept-Encoding"), FContentDecoder::GetAcceptEncoding());
+	FPakCacheEntry Entry;
+	if (FPakDownloadCache::Get().Find(URL, Entry))
+	{
+		HttpRequest->SetHeader(TEXT("If-None-Match"), Entry.ETag);
+		if (Entry.LastModified.Len() > 0)
+		{
+			HttpRequest->SetHeader(TEXT("If-Modified-Since"), Entry.LastModified);
+		}
+	}
+	FPakHttpConnections::Get().ProcessRequest(HttpRequest);
+}
+
+void UAsyncTaskMemoryPak::HandlePakRequest(FHttpRequestPtr HttpRequest,
+	FHttpResponsePtr HttpResponse, bool bSucceeded, FString URL)
+{
+	const int32 ResponseCode = HttpResponse.IsValid() ? HttpResponse->GetResponseCode() : -1;
+	FDownloadStats::Get().RecordRequest(URL, ResponseCode, HttpResponse.IsValid() ? HttpResponse->GetContent().Num() : 0, HttpRequest->GetElapsedTime());
+	FPakLoaderModule& PakLoaderModule = FModuleManager::LoadModuleChecked<FPakLoaderModule>(FName(TEXT("PakLoader")));
+	if (ResponseCode == 304)
+	{
+		// Whatever is mounted already is current
+		const FString MemoryFilename = GetPakFilename(URL);
+		const FString CachedFilename = FPakDownloadCache::Get().GetPakFilename(URL);
+		const FDateTime ExpiresAt = GetExpiresAt(HttpResponse);
+		AsyncTask(ENamedThreads::AnyThread, [URL, ExpiresAt]()
+		{
+			FPakDownloadCache::Get().Revalidate(URL, ExpiresAt);
+		});
+		TSharedPtr<FPakFile> PakFile;
+		if (PakLoaderModule.IsPakMounted(MemoryFilename))
+		{
+			Succeed(MemoryFilename);
+		}
+		else if (PakLoaderModule.MountPakFile(CachedFilename, PakFile))
+		{
+			UE_LOG(PakLoader, Log, TEXT("Using cached file for %s"), *URL);
+			Succeed(CachedFilename);
+		}
+		else
+		{
+			Fail(TEXT("Couldn't mount cached file"));
+		}
+		return;
+	}
+	int64 BodySize = 0;
+	if (!bSucceeded || ResponseCode != 200 || HttpResponse->GetContent().Num() == 0 || !FContentDecoder::GetBodySize(URL, *HttpResponse, BodySize))
+	{
+		UE_LOG(PakLoader, Error, TEXT("Error downloading %s: %d"), *URL, ResponseCode);
+		Fail(TEXT("Couldn't download file"));
+		return;
+	}
+	// Decoding is the only real work here, so it too stays off the game thread
+	AsyncTask(ENamedThreads::AnyThread, [this, URL, HttpResponse, BodySize]()
+	{
+		TSharedRef<TArray<uint8>, ESPMode::ThreadSafe> Data = MakeShareable(new TArray<uint8>());
+		const FString ContentEncoding = HttpResponse->GetHeader(TEXT("Content-Encoding"));
+		int64 DecodedSize = 0;
+		Data->Reserve(BodySize);
+		const bool bDecoded = FContentDecoder::Decode(ContentEncoding, HttpResponse->GetContent().GetData(), BodySize,
+			[&Data](const uint8* Bytes, int64 Size) { Data->Append(Bytes, Size); return true; }, DecodedSize);
+		if (bDecoded && ContentEncoding.Len() > 0)
+		{
+			FDownloadStats::Get().RecordDecompression(URL, BodySize, DecodedSize);
+		}
+		AsyncTask(ENamedThreads::GameThread, [this, URL, HttpResponse, Data, bDecoded]()
+		{
+			if (!bDecoded)
+			{
+				UE_LOG(PakLoader, Error, TEXT("Couldn't decode %s"), *URL);
+				Fail(TEXT("Couldn't decode downloaded file"));
+				return;
+			}
+			Mount(URL, HttpResponse, *Data);
+		});
+	});
+}
+
+void UAsyncTaskMemoryPak::Mount(const FString& URL, FHttpResponsePtr HttpResponse, TArray<uint8>& Data)
+{
+	const FString PakFilename = GetPakFilename(URL);
+	FPakLoaderModule& PakLoaderModule = FModuleManager::LoadModuleChecked<FPakLoaderModule>(FName(TEXT("PakLoader")));
+	// An older version mounted under the same name would keep its index and read the new bytes
+	if (PakLoaderModule.IsPakMounted(PakFilename))
+	{
+		PakLoaderModule.UnmountPakFile(PakFilename);
+	}
+	const TSharedRef<FMemoryPakSource, ESPMode::ThreadSafe> Source = MakeShareable(new FMemoryPakSource(MoveTemp(Data)));
+	TSharedPtr<FPakFile> PakFile;
+	if (!PakLoaderModule.MountVirtualPak(PakFilename, Source, PakFile))
+	{
+		Fail(TEXT("Couldn't mount downloaded file"));
+		return;
+	}
+	UE_LOG(PakLoader, Log, TEXT("Mounted %s (%lld bytes) from memory as %s"), *URL, Source->GetSize(), *PakFilename);
+	if (bWriteThroughToCache)
+	{
+		const FString ETag = HttpResponse->GetHeader(TEXT("ETag"));
+		const FString LastModified = HttpResponse->GetHeader(TEXT("Last-Modified"));
+		const FDateTime ExpiresAt = GetExpiresAt(HttpResponse);
+		// The source outlives the write even if the pak is unmounted meanwhile
+		AsyncTask(ENamedThreads::AnyThread, [Source, URL, ETag, LastModified, ExpiresAt]()
+		{
+			FPakChunker Chunker;
+			FPakChunkRecipe Recipe;
+			if (!Chunker.Write(Source->GetData().GetData(), Source->GetSize()) || !Chunker.Finish(Recipe)
+				|| !UAsyncTaskDownloadPak::CommitRecipe(URL, Recipe, ETag, LastModified, ExpiresAt))
+			{
+				UE_LOG(PakLoader, Warning, TEXT("Couldn't write %s through to the download cache"), *URL);
+				return;
+			}
+			UE_LOG(PakLoader, Log, TEXT("Wrote %s through to the download cache (sha1 %s)"), *URL, *Recipe.PakHash.ToString());
+		});
+	}
+	Succeed(PakFilename);
+}
+
+void UAsyncTaskMemoryPak::Succeed(const FString& PakFilename)
+{
+	RemoveFromRoot();
+	OnSuccess.Broadcast(PakFilename);
+}
+
+void UAsyncTaskMemoryPak::Fail(const FString& Message)
+{
+	RemoveFromRoot();
+	OnFail.Broadcast(Message);
+}
@@ -0,0 +1,48 @@
+// Copyright 1998-2016 Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+#include "Engine.h"
+#include "IHttpRequest.h"
+#include "Kismet/BlueprintAsyncActionBase.h"
+#include "AsyncTaskDownloadPak.h"
+
+#include "AsyncTaskMemoryPak.generated.h"
+
+/**
+* Downloads a small pak and mounts it straight from memory, skipping the temp file, move and cache commit
+* that a regular download costs. Optionally writes it through to the download cache in the background,
+* so the next launch can get a 304 and mount the cached copy instead.
+*/
+UCLASS()
+class PAKLOADER_API UAsyncTaskMemoryPak : public UBlueprintAsyncActionBase
+{
+	GENERATED_UCLASS_BODY()
+
+public:
+	UFUNCTION(BlueprintCallable, meta = (BlueprintInternalUseOnly = "true"))
+		static UAsyncTaskMemoryPak* DownloadPakToMemory(const FString& URL, bool WriteThroughToCache);
+
+public:
+
+	/** Fired with the name of the mounted pak */
+	UPROPERTY(BlueprintAssignable)
+		FDownloadPakDelegate OnSuccess;
+
+	UPROPERTY(BlueprintAssignable)
+		FDownloadPakDelegate OnFail;
+
+public:
+
+	void Start(const FString& URL);
+
+	/** Returns the name the pak downloaded from Url is mounted as when it is mounted from memory */
+	static FString GetPakFilename(const FString& Url);
+
+private:
+	bool bWriteThroughToCache;
+	void HandlePakRequest(FHttpRequestPtr HttpRequest, FHttpResponsePtr HttpResponse, bool bSucceeded, FString URL);
+	/** Mounts the decoded pak and, if asked to, starts writing it to the cache */
+	void Mount(const FString& URL, FHttpResponsePtr HttpResponse, TArray<uint8>& Data);
+	void Succeed(const FString& PakFilename);
+	void Fail(const FString& Message);
+};
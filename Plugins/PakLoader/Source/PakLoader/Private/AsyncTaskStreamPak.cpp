@@ -0,0 +1,159 @@
+// Copyright 1998-2016 Epic Games, Inc. All Rights Reserved.
+
+#include "PakLoaderPrivatePCH.h"
+#include "PakLoader.h"
+#include "Http.h"
+#include "PakHttpConnections.h"
+#include "AsyncTaskStreamPak.h"
+#include "DownloadStats.h"
+
+/** Bytes requested from the end of the pak up front: the footer, and for most paks the whole index */
+static const int64 TailSize = 4 * FHttpPakSource::BlockSize;
+
+//----------------------------------------------------------------------//
+// UAsyncTaskStreamPak
+//----------------------------------------------------------------------//
+
+UAsyncTaskStreamPak::UAsyncTaskStreamPak(const FObjectInitializer& ObjectInitializer)
+	: Super(ObjectInitializer)
+{
+	if (HasAnyFlags(RF_ClassDefaultObject) == false)
+	{
+		AddToRoot();
+	}
+}
+
+UAsyncTaskStreamPak* UAsyncTaskStreamPak::StreamPak(const FString& URL)
+{
+	UAsyncTaskStreamPak* StreamTask = NewObject<UAsyncTaskStreamPak>();
+	StreamTask->Start(URL);
+	return StreamTask;
+}
+
+void UAsyncTaskStreamPak::Start(const FString& URL)
+{
+	UE_LOG(PakLoader, Log, TEXT("Stream request for: %s"), *URL);
+	TSharedRef<IHttpRequest> HttpRequest = FPakHttpConnections::Get().CreateRequest();
+	HttpRequest->OnProcessRequestComplete().BindUObject(this, &UAsyncTaskStreamPak::HandleTailRequest, URL);
+	HttpRequest->SetURL(URL);
+	HttpRequest->SetVerb(TEXT("GET"));
+	HttpRequest->SetHeader(TEXT("Accept-Encoding"), TEXT("identity"));
+	HttpRequest->SetHeader(TEXT("Range"), FString::Printf(TEXT("bytes=-%lld"), TailSize));
+	FPakHttpConnections::Get().ProcessRequest(HttpRequest);
+}
+
+void UAsyncTaskStreamPak::HandleTailRequest(FHttpRequestPtr HttpRequest,
+	FHttpResponsePtr HttpResponse, bool bSucceeded, FString URL)
+{
+	const int32 ResponseCode = HttpResponse.IsValid() ? HttpResponse->GetResponseCode() : -1;
+	FDownloadStats::Get().RecordRequest(URL, ResponseCode, HttpResponse.IsValid() ? HttpResponse->GetContent().Num() : 0, HttpRequest->GetElapsedTime());
+	int64 First = 0;
+	int64 Last = 0;
+	int64 Total = 0;
+	if (bSucceeded && ResponseCode == 200)
+	{
+		// No range support, but the pak is small enough to have come back whole
+		First = 0;
+		Total = HttpResponse->GetContent().Num();
+		Last = Total - 1;
+	}
+	else if (!bSucceeded || ResponseCode != 206 || !ParseContentRange(HttpResponse->GetHeader(TEXT("Content-Range")), First, Last, Total)
+		|| HttpResponse->GetContent().Num() != Last - First + 1 || Last != Total - 1)
+	{
+		UE_LOG(PakLoader, Error, TEXT("Couldn't fetch the end of %s: %d"), *URL, ResponseCode);
+		Fail(TEXT("Couldn't stream file"));
+		return;
+	}
+	Source = MakeShareable(new FHttpPakSource(URL, Total, HttpResponse->GetHeader(TEXT("ETag"))));
+	if (!Source->Store(First, HttpResponse->GetContent().GetData(), HttpResponse->GetContent().Num()))
+	{
+		Fail(TEXT("Couldn't save streamed file"));
+		return;
+	}
+
+	FPakInfo Info;
+	const int64 InfoSize = Info.GetSerializedSize();
+	if (Total < InfoSize)
+	{
+		UE_LOG(PakLoader, Error, TEXT("%s is too small to be a pak"), *URL);
+		Fail(TEXT("Not a pak file"));
+		return;
+	}
+	TArray<uint8> InfoBytes;
+	InfoBytes.Append(HttpResponse->GetContent().GetData() + (Total - InfoSize - First), InfoSize);
+	FMemoryReader Reader(InfoBytes);
+	Info.Serialize(Reader);
+	if (Info.Magic != FPakInfo::PakFile_Magic || Info.IndexOffset < 0 || Info.IndexSize < 0 || Info.IndexOffset + Info.IndexSize > Total - InfoSize)
+	{
+		UE_LOG(PakLoader, Error, TEXT("%s doesn't have a valid pak footer"), *URL);
+		Fail(TEXT("Not a pak file"));
+		return;
+	}
+	int64 Start = 0;
+	int64 End = 0;
+	if (!Source->GetMissingSpan(Info.IndexOffset, Info.IndexSize, Start, End))
+	{
+		Mount();
+		return;
+	}
+	TSharedRef<IHttpRequest> IndexRequest = FPakHttpConnections::Get().CreateRequest();
+	IndexRequest->OnProcessRequestComplete().BindUObject(this, &UAsyncTaskStreamPak::HandleIndexRequest, Start, End);
+	IndexRequest->SetURL(URL);
+	IndexRequest->SetVerb(TEXT("GET"));
+	IndexRequest->SetHeader(TEXT("Accept-Encoding"), TEXT("identity"));
+	IndexRequest->SetHeader(TEXT("Range"), FString::Printf(TEXT("bytes=%lld-%lld"), Start, End - 1));
+	IndexRequest->SetHeader(TEXT("If-Range"), Source->GetETag());
+	FPakHttpConnections::Get().ProcessRequest(IndexRequest);
+}
+
+void UAsyncTaskStreamPak::HandleIndexRequest(FHttpRequestPtr HttpRequest,
+	FHttpResponsePtr HttpResponse, bool bSucceeded, int64 Start, int64 End)
+{
+	const int32 ResponseCode = HttpResponse.IsValid() ? HttpResponse->GetResponseCode() : -1;
+	FDownloadStats::Get().RecordRequest(Source->GetUrl(), ResponseCode, HttpResponse.IsValid() ? HttpResponse->GetContent().Num() : 0, HttpRequest->GetElapsedTime());
+	int64 First = 0;
+	int64 Last = 0;
+	int64 Total = 0;
+	if (!bSucceeded || ResponseCode != 206 || !ParseContentRange(HttpResponse->GetHeader(TEXT("Content-Range")), First, Last, Total)
+		|| First != Start || Last != End - 1 || HttpResponse->GetContent().Num() != End - Start)
+	{
+		UE_LOG(PakLoader, Error, TEXT("Couldn't fetch the index of %s: %d"), *Source->GetUrl(), ResponseCode);
+		Fail(TEXT("Couldn't stream file"));
+		return;
+	}
+	if (!Source->Store(Start, HttpResponse->GetContent().GetData(), End - Start))
+	{
+		Fail(TEXT("Couldn't save streamed file"));
+		return;
+	}
+	Mount();
+}
+
+void UAsyncTaskStreamPak::Mount()
+{
+	// Mounting reads the index, which is cached by now; mount outside the HTTP manager's tick all the same,
+	// so OnSuccess listeners don't run inside it
+	FTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateUObject(this, &UAsyncTaskStreamPak::HandleMount));
+}
+
+bool UAsyncTaskStreamPak::HandleMount(float DeltaTime)
+{
+	RemoveFromRoot();
+	const FString PakFilename = FHttpPakSource::GetPakFilename(Source->GetUrl());
+	FPakLoaderModule& PakLoaderModule = FModuleManager::LoadModuleChecked<FPakLoaderModule>(FName(TEXT("PakLoader")));
+	TSharedPtr<FPakFile> PakFile;
+	if (!PakLoaderModule.MountVirtualPak(PakFilename, Source, PakFile))
+	{
+		OnFail.Broadcast(TEXT("Couldn't mount streamed file"));
+		return false;
+	}
+	UE_LOG(PakLoader, Log, TEXT("Streaming %s (%lld bytes) as %s"), *Source->GetUrl(), Source->GetSize(), *PakFilename);
+	OnSuccess.Broadcast(PakFilename);
+	return false;
+}
+
+void UAsyncTaskStreamPak::Fail(const FString& Message)
+{
+	RemoveFromRoot();
+	OnFail.Broadcast(Message);
+}
@@ -0,0 +1,50 @@
+// Copyright 1998-2016 Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+#include "Engine.h"
+#include "IHttpRequest.h"
+#include "Kismet/BlueprintAsyncActionBase.h"
+#include "AsyncTaskDownloadPak.h"
+#include "HttpPakSource.h"
+
+#include "AsyncTaskStreamPak.generated.h"
+
+/**
+* Mounts a pak straight from its URL without downloading it: only the footer and index are fetched up front
+* (with range requests), the rest of the pak is fetched a block at a time as it is read.
+* The server has to support range requests. Only async loading (or other reads off the game thread) can fetch
+* blocks: a game thread read of a block that isn't cached yet fails.
+*/
+UCLASS()
+class PAKLOADER_API UAsyncTaskStreamPak : public UBlueprintAsyncActionBase
+{
+	GENERATED_UCLASS_BODY()
+
+public:
+	UFUNCTION(BlueprintCallable, meta = (BlueprintInternalUseOnly = "true"))
+		static UAsyncTaskStreamPak* StreamPak(const FString& URL);
+
+public:
+
+	/** Fired with the local name of the mounted pak */
+	UPROPERTY(BlueprintAssignable)
+		FDownloadPakDelegate OnSuccess;
+
+	UPROPERTY(BlueprintAssignable)
+		FDownloadPakDelegate OnFail;
+
+public:
+
+	void Start(const FString& URL);
+
+private:
+	/** Handles the tail of the pak, which holds the footer and usually the index */
+	void HandleTailRequest(FHttpRequestPtr HttpRequest, FHttpResponsePtr HttpResponse, bool bSucceeded, FString URL);
+	/** Handles the rest of the index */
+	void HandleIndexRequest(FHttpRequestPtr HttpRequest, FHttpResponsePtr HttpResponse, bool bSucceeded, int64 Start, int64 End);
+	void Mount();
+	bool HandleMount(float DeltaTime);
+	void Fail(const FString& Message);
+
+	FHttpPakSourcePtr Source;
+};
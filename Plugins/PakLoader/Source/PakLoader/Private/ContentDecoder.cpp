@@ -0,0 +1,145 @@
+// Copyright 1998-2016 Epic Games, Inc. All Rights Reserved.
+
+#include "PakLoaderPrivatePCH.h"
+#include "ContentDecoder.h"
+#include "zlib.h"
+#if WITH_ZSTD
+#include "zstd.h"
+#endif
+
+/** Size of the buffer content is decoded into before it's handed to the sink */
+static const int64 DecodeBufferSize = 256 * 1024;
+/** zlib counts input in 32 bit quantities */
+static const int64 MaxInflateInput = 1024 * 1024 * 1024;
+
+const TCHAR* FContentDecoder::GetAcceptEncoding()
+{
+#if WITH_ZSTD
+	return TEXT("zstd, gzip");
+#else
+	return TEXT("gzip");
+#endif
+}
+
+bool FContentDecoder::GetBodySize(const FString& Url, const IHttpResponse& Response, int64& OutSize)
+{
+	OutSize = Response.GetContent().Num();
+	const int64 ContentLength = Response.GetContentLength();
+	if (ContentLength > 0 && ContentLength != OutSize)
+	{
+		UE_LOG(PakLoader, Error, TEXT("Received %lld bytes for %s, but its Content-Length is %lld"), OutSize, *Url, ContentLength);
+		return false;
+	}
+	return true;
+}
+
+static bool Inflate(const uint8* Data, int64 Size, FContentDecoder::FSink Sink, int64& OutDecodedSize)
+{
+	z_stream Stream;
+	FMemory::Memzero(Stream);
+	// 16 + MAX_WBITS: expect a gzip header and trailer
+	if (inflateInit2(&Stream, 16 + MAX_WBITS) != Z_OK)
+	{
+		return false;
+	}
+	TArray<uint8> Buffer;
+	Buffer.SetNumUninitialized(DecodeBufferSize);
+	int64 Consumed = 0;
+	int32 Result = Z_OK;
+	while (Result == Z_OK)
+	{
+		if (Stream.avail_in == 0)
+		{
+			const int64 Chunk = FMath::Min(Size - Consumed, MaxInflateInput);
+			Stream.next_in = const_cast<Bytef*>(Data + Consumed);
+			Stream.avail_in = (uInt)Chunk;
+			Consumed += Chunk;
+		}
+		Stream.next_out = Buffer.GetData();
+		Stream.avail_out = (uInt)DecodeBufferSize;
+		Result = inflate(&Stream, Z_NO_FLUSH);
+		const int64 Produced = DecodeBufferSize - Stream.avail_out;
+		if ((Result == Z_OK || Result == Z_STREAM_END) && Produced > 0)
+		{
+			OutDecodedSize += Produced;
+			if (!Sink(Buffer.GetData(), Produced))
+			{
+				Result = Z_ERRNO;
+			}
+		}
+		// A truncated body leaves zlib waiting for more input
+		if (Result == Z_OK && Stream.avail_in == 0 && Consumed == Size && Produced == 0)
+		{
+			Result = Z_DATA_ERROR;
+		}
+	}
+	inflateEnd(&Stream);
+	return Result == Z_STREAM_END;
+}
+
+#if WITH_ZSTD
+static bool DecompressZstd(const uint8* Data, int64 Size, FContentDecoder::FSink Sink, int64& OutDecodedSize)
+{
+	ZSTD_DStream* const Stream = ZSTD_createDStream();
+	if (Stream == nullptr || ZSTD_isError(ZSTD_initDStream(Stream)))
+	{
+		ZSTD_freeDStream(Stream);
+		return false;
+	}
+	TArray<uint8> Buffer;
+	Buffer.SetNumUninitialized(DecodeBufferSize);
+	ZSTD_inBuffer Input = { Data, (size_t)Size, 0 };
+	size_t Result = 1;
+	bool bOk = true;
+	while (bOk && (Input.pos < Input.size || Result != 0))
+	{
+		ZSTD_outBuffer Output = { Buffer.GetData(), (size_t)DecodeBufferSize, 0 };
+		Result = ZSTD_decompressStream(Stream, &Output, &Input);
+		bOk = !ZSTD_isError(Result);
+		if (bOk && Output.pos > 0)
+		{
+			OutDecodedSize += Output.pos;
+			bOk = Sink(Buffer.GetData(), Output.pos);
+		}
+		else if (bOk && Input.pos == Input.size)
+		{
+			// Truncated frame
+			bOk = Result == 0;
+			break;
+		}
+	}
+	ZSTD_freeDStream(Stream);
+	return bOk && Result == 0;
+}
+#endif
+
+bool FContentDecoder::Decode(const FString& ContentEncoding, const uint8* Data, int64 Size, FSink Sink, int64& OutDecodedSize)
+{
+	OutDecodedSize = 0;
+	const FString Encoding = ContentEncoding.Trim().TrimTrailing().ToLower();
+	if (Encoding == TEXT("gzip") || Encoding == TEXT("x-gzip"))
+	{
+		// Some HTTP stacks decode the body themselves but keep the header
+		if (Size >= 2 && Data[0] == 0x1f && Data[1] == 0x8b)
+		{
+			return Inflate(Data, Size, Sink, OutDecodedSize);
+		}
+	}
+#if WITH_ZSTD
+	else if (Encoding == TEXT("zstd"))
+	{
+		// Frame magic 0xFD2FB528, little endian
+		if (Size >= 4 && Data[0] == 0x28 && Data[1] == 0xb5 && Data[2] == 0x2f && Data[3] == 0xfd)
+		{
+			return DecompressZstd(Data, Size, Sink, OutDecodedSize);
+		}
+	}
+#endif
+	else if (Encoding.Len() > 0 && Encoding != TEXT("identity"))
+	{
+		UE_LOG(PakLoader, Error, TEXT("Unsupported Content-Encoding: %s"), *ContentEncoding);
+		return false;
+	}
+	OutDecodedSize = Size;
+	return Sink(Data, Size);
+}
@@ -0,0 +1,143 @@
+// Copyright 1998-2016 Epic Games, Inc. All Rights Reserved.
+
+#include "PakLoaderPrivatePCH.h"
+#include "DownloadScheduler.h"
+
+const TCHAR* GetThrottleReasonName(EDownloadThrottleReason Reason)
+{
+	switch (Reason)
+	{
+	case EDownloadThrottleReason::Foreground:
+		return TEXT("Foreground");
+	case EDownloadThrottleReason::HitchSensitive:
+		return TEXT("HitchSensitive");
+	case EDownloadThrottleReason::Bandwidth:
+		return TEXT("Bandwidth");
+	case EDownloadThrottleReason::DiskWrite:
+		return TEXT("DiskWrite");
+	default:
+		return TEXT("None");
+	}
+}
+
+FTokenBucket::FTokenBucket()
+	: Rate(0)
+	, Burst(0)
+	, Tokens(0)
+	, LastRefill(0)
+{
+}
+
+void FTokenBucket::SetRate(double BytesPerSecond, double BurstBytes)
+{
+	Rate = BytesPerSecond;
+	Burst = FMath::Max(BurstBytes, 0.0);
+	Tokens = Burst;
+	LastRefill = FPlatformTime::Seconds();
+}
+
+bool FTokenBucket::HasTokens()
+{
+	if (Rate <= 0)
+	{
+		return true;
+	}
+	const double Now = FPlatformTime::Seconds();
+	Tokens = FMath::Min(Burst, Tokens + (Now - LastRefill) * Rate);
+	LastRefill = Now;
+	return Tokens > 0;
+}
+
+void FTokenBucket::Consume(int64 Bytes)
+{
+	if (Rate > 0)
+	{
+		Tokens -= Bytes;
+	}
+}
+
+FDownloadScheduler& FDownloadScheduler::Get()
+{
+	static FDownloadScheduler Scheduler;
+	return Scheduler;
+}
+
+FDownloadScheduler::FDownloadScheduler()
+{
+	int32 MaxKBps = 512;
+	int32 MaxWriteKBps = 2048;
+	int32 SliceKB = 256;
+	GConfig->GetInt(TEXT("PakLoader"), TEXT("BackgroundMaxKBps"), MaxKBps, GGameIni);
+	GConfig->GetInt(TEXT("PakLoader"), TEXT("BackgroundMaxWriteKBps"), MaxWriteKBps, GGameIni);
+	GConfig->GetInt(TEXT("PakLoader"), TEXT("BackgroundSliceKB"), SliceKB, GGameIni);
+	// A second's worth of burst
+	Network.SetRate(MaxKBps * 1024.0, MaxKBps * 1024.0);
+	DiskWrite.SetRate(MaxWriteKBps * 1024.0, MaxWriteKBps * 1024.0);
+	SliceSize = FMath::Max(SliceKB, 16) * 1024LL;
+}
+
+void FDownloadScheduler::BeginForegroundTransfer()
+{
+	ForegroundTransfers.Increment();
+}
+
+void FDownloadScheduler::EndForegroundTransfer()
+{
+	ForegroundTransfers.Decrement();
+}
+
+void FDownloadScheduler::BeginHitchSensitiveSection()
+{
+	HitchSensitiveSections.Increment();
+}
+
+void FDownloadScheduler::EndHitchSensitiveSection()
+{
+	if (HitchSensitiveSections.Decrement() < 0)
+	{
+		UE_LOG(PakLoader, Warning, TEXT("Unbalanced EndHitchSensitiveSection"));
+		HitchSensitiveSections.Reset();
+	}
+}
+
+EDownloadThrottleReason FDownloadScheduler::AcquireBackgroundTransfer(int64 Bytes)
+{
+	if (IsHitchSensitive())
+	{
+		return EDownloadThrottleReason::HitchSensitive;
+	}
+	if (ForegroundTransfers.GetValue() > 0)
+	{
+		return EDownloadThrottleReason::Foreground;
+	}
+	if (!Network.HasTokens())
+	{
+		return EDownloadThrottleReason::Bandwidth;
+	}
+	if (!DiskWrite.HasTokens())
+	{
+		return EDownloadThrottleReason::DiskWrite;
+	}
+	Network.Consume(Bytes);
+	DiskWrite.Consume(Bytes);
+	return EDownloadThrottleReason::None;
+}
+
+//----------------------------------------------------------------------//
+// UDownloadSchedulerLibrary
+//----------------------------------------------------------------------//
+
+UDownloadSchedulerLibrary::UDownloadSchedulerLibrary(const FObjectInitializer& ObjectInitializer)
+	: Super(ObjectInitializer)
+{
+}
+
+void UDownloadSchedulerLibrary::BeginHitchSensitiveSection()
+{
+	FDownloadScheduler::Get().BeginHitchSensitiveSection();
+}
+
+void UDownloadSchedulerLibrary::EndHitchSensitiveSection()
+{
+	FDownloadScheduler::Get().EndHitchSensitiveSection();
+}
@@ -0,0 +1,247 @@
+// Copyright 1998-2016 Epic Games, Inc. All Rights Reserved.
+
+#include "PakLoaderPrivatePCH.h"
+#include "DownloadStats.h"
+
+/** Weight of the newest sample in the smoothed rate */
+static const double RateSmoothing = 0.3;
+/** Rate samples closer together than this are merged */
+static const double MinSampleSeconds = 0.25;
+
+FDownloadProgress::FDownloadProgress()
+	: Interval(0.1)
+{
+	double IntervalSeconds = Interval;
+	if (GConfig->GetDouble(TEXT("PakLoader"), TEXT("ProgressIntervalSeconds"), IntervalSeconds, GGameIni))
+	{
+		Interval = FMath::Max(IntervalSeconds, 0.0);
+	}
+	Start();
+}
+
+void FDownloadProgress::Start()
+{
+	StartTime = FPlatformTime::Seconds();
+	LastEventTime = 0;
+	LastSampleTime = StartTime;
+	LastSampleBytes = 0;
+	Received = 0;
+	Total = 0;
+	BytesPerSecond = 0;
+	PeakBytesPerSecond = 0;
+}
+
+bool FDownloadProgress::Update(int64 InReceived, int64 InTotal, bool bForce)
+{
+	const double Now = FPlatformTime::Seconds();
+	Received = InReceived;
+	Total = InTotal;
+	const double SampleSeconds = Now - LastSampleTime;
+	if (SampleSeconds >= MinSampleSeconds)
+	{
+		const double SampleRate = FMath::Max<int64>(Received - LastSampleBytes, 0) / SampleSeconds;
+		BytesPerSecond = BytesPerSecond > 0 ? FMath::Lerp(BytesPerSecond, SampleRate, RateSmoothing) : SampleRate;
+		PeakBytesPerSecond = FMath::Max(PeakBytesPerSecond, BytesPerSecond);
+		LastSampleTime = Now;
+		LastSampleBytes = Received;
+	}
+	if (bForce || Now - LastEventTime >= Interval)
+	{
+		LastEventTime = Now;
+		return true;
+	}
+	return false;
+}
+
+double FDownloadProgress::GetSecondsRemaining() const
+{
+	if (Total <= 0 || BytesPerSecond <= 0)
+	{
+		return -1;
+	}
+	return FMath::Max<int64>(Total - Received, 0) / BytesPerSecond;
+}
+
+FDownloadStats::FDownloadStats()
+	: NextRecord(0)
+	, MaxRecords(10000)
+	, DroppedRecords(0)
+{
+	GConfig->GetInt(TEXT("PakLoader"), TEXT("MaxStatsRecords"), MaxRecords, GGameIni);
+	MaxRecords = FMath::Max(MaxRecords, 1);
+}
+
+FDownloadStats& FDownloadStats::Get()
+{
+	static FDownloadStats Stats;
+	return Stats;
+}
+
+void FDownloadStats::AddRecord(const FRequestRecord& Record)
+{
+	if (Records.Num() < MaxRecords)
+	{
+		Records.Add(Record);
+		return;
+	}
+	Records[NextRecord] = Record;
+	NextRecord = (NextRecord + 1) % Records.Num();
+	DroppedRecords++;
+}
+
+void FDownloadStats::RecordRequest(const FString& Url, int32 ResponseCode, int64 Bytes, double Seconds, double PeakBytesPerSecond)
+{
+	FRequestRecord Record;
+	Record.Time = FDateTime::UtcNow();
+	Record.Event = TEXT("Request");
+	Record.Url = Url;
+	Record.ResponseCode = ResponseCode;
+	Record.Bytes = Bytes;
+	Record.Seconds = Seconds;
+	// Short requests never produce a rate sample
+	Record.PeakBytesPerSecond = FMath::Max(PeakBytesPerSecond, Seconds > 0 ? Bytes / Seconds : 0.0);
+
+	FScopeLock ScopedLock(&StatsCritical);
+	AddRecord(Record);
+	Session.Requests++;
+	if (ResponseCode == 304)
+	{
+		Session.NotModified++;
+	}
+	else if (ResponseCode < 200 || ResponseCode >= 300)
+	{
+		Session.Failures++;
+	}
+	Session.BytesReceived += Bytes;
+	Session.Seconds += Seconds;
+	Session.PeakBytesPerSecond = FMath::Max<float>(Session.PeakBytesPerSecond, Record.PeakBytesPerSecond);
+}
+
+void FDownloadStats::RecordRetry(const FString& Url)
+{
+	UE_LOG(PakLoader, Verbose, TEXT("Retrying %s"), *Url);
+	FScopeLock ScopedLock(&StatsCritical);
+	Session.Retries++;
+}
+
+void FDownloadStats::RecordThrottle(const FString& Url, EDownloadThrottleReason Reason, double Seconds)
+{
+	UE_LOG(PakLoader, Verbose, TEXT("%s was held back for %.2fs (%s)"), *Url, Seconds, GetThrottleReasonName(Reason));
+	FRequestRecord Record;
+	Record.Time = FDateTime::UtcNow();
+	Record.Event = FString(TEXT("Throttle:")) + GetThrottleReasonName(Reason);
+	Record.Url = Url;
+	Record.ResponseCode = 0;
+	Record.Bytes = 0;
+	Record.Seconds = Seconds;
+	Record.PeakBytesPerSecond = 0;
+
+	FScopeLock ScopedLock(&StatsCritical);
+	AddRecord(Record);
+	Session.ThrottleEvents++;
+	Session.ThrottledSeconds += Seconds;
+}
+
+void FDownloadStats::RecordGameThreadTime(const FString& Url, double Seconds)
+{
+	float BudgetMs = 2.0f;
+	GConfig->GetFloat(TEXT("PakLoader"), TEXT("GameThreadBudgetMs"), BudgetMs, GGameIni);
+	const bool bOverBudget = Seconds * 1000.0 > BudgetMs;
+	if (bOverBudget)
+	{
+		UE_LOG(PakLoader, Warning, TEXT("Download of %s spent %.2fms on the game thread (budget %.2fms)"), *Url, Seconds * 1000.0, BudgetMs);
+	}
+	FRequestRecord Record;
+	Record.Time = FDateTime::UtcNow();
+	Record.Event = TEXT("GameThread");
+	Record.Url = Url;
+	Record.ResponseCode = 0;
+	Record.Bytes = 0;
+	Record.Seconds = Seconds;
+	Record.PeakBytesPerSecond = 0;
+
+	FScopeLock ScopedLock(&StatsCritical);
+	AddRecord(Record);
+	Session.Downloads++;
+	Session.GameThreadSeconds += Seconds;
+	Session.MaxGameThreadSeconds = FMath::Max<float>(Session.MaxGameThreadSeconds, Seconds);
+	Session.OverBudgetDownloads += bOverBudget ? 1 : 0;
+}
+
+void FDownloadStats::RecordDecompression(const FString& Url, int64 CompressedBytes, int64 DecompressedBytes)
+{
+	UE_LOG(PakLoader, Log, TEXT("%s: %lld bytes decoded to %lld"), *Url, CompressedBytes, DecompressedBytes);
+	FScopeLock ScopedLock(&StatsCritical);
+	Session.CompressedBytes += CompressedBytes;
+	Session.DecompressedBytes += DecompressedBytes;
+}
+
+FDownloadSessionStats FDownloadStats::GetSessionStats() const
+{
+	FScopeLock ScopedLock(&StatsCritical);
+	FDownloadSessionStats Result = Session;
+	Result.MegabytesReceived = Result.BytesReceived / (1024.0f * 1024.0f);
+	Result.AverageBytesPerSecond = Result.Seconds > 0 ? Result.BytesReceived / Result.Seconds : 0;
+	Result.NotModifiedRate = Result.Requests > 0 ? float(Result.NotModified) / Result.Requests : 0;
+	Result.CompressedMegabytes = Result.CompressedBytes / (1024.0f * 1024.0f);
+	Result.DecompressedMegabytes = Result.DecompressedBytes / (1024.0f * 1024.0f);
+	return Result;
+}
+
+bool FDownloadStats::DumpToCsv(const FString& Filename) const
+{
+	FString Csv(TEXT("Time,Event,Url,ResponseCode,Bytes,Seconds,BytesPerSecond,PeakBytesPerSecond\n"));
+	{
+		FScopeLock ScopedLock(&StatsCritical);
+		if (DroppedRecords > 0)
+		{
+			UE_LOG(PakLoader, Log, TEXT("Only the last %d download stats records are kept; %lld older ones are not written"), Records.Num(), DroppedRecords);
+		}
+		for (int32 Index = 0; Index < Records.Num(); Index++)
+		{
+			const FRequestRecord& Record = Records[(NextRecord + Index) % Records.Num()];
+			Csv += FString::Printf(TEXT("%s,%s,\"%s\",%d,%lld,%.3f,%.0f,%.0f\n"), *Record.Time.ToIso8601(), *Record.Event, *Record.Url.Replace(TEXT("\""), TEXT("\"\"")),
+				Record.ResponseCode, Record.Bytes, Record.Seconds, Record.Seconds > 0 ? Record.Bytes / Record.Seconds : 0.0, Record.PeakBytesPerSecond);
+		}
+	}
+	if (!FFileHelper::SaveStringToFile(Csv, *Filename))
+	{
+		UE_LOG(PakLoader, Error, TEXT("Couldn't write download stats to %s"), *Filename);
+		return false;
+	}
+	const FDownloadSessionStats Stats = GetSessionStats();
+	UE_LOG(PakLoader, Log, TEXT("%d requests (%d not modified, %d failed, %d retried), %.1f MB in %.1fs, %.0f B/s average, %.0f B/s peak, %.1f MB compressed to %.1f MB, throttled %d times for %.1fs, %d downloads took %.1fms on the game thread (worst %.2fms, %d over budget). Written to %s"),
+		Stats.Requests, Stats.NotModified, Stats.Failures, Stats.Retries, Stats.MegabytesReceived, Stats.Seconds, Stats.AverageBytesPerSecond, Stats.PeakBytesPerSecond,
+		Stats.DecompressedMegabytes, Stats.CompressedMegabytes, Stats.ThrottleEvents, Stats.ThrottledSeconds,
+		Stats.Downloads, Stats.GameThreadSeconds * 1000.0f, Stats.MaxGameThreadSeconds * 1000.0f, Stats.OverBudgetDownloads, *Filename);
+	return true;
+}
+
+//----------------------------------------------------------------------//
+// UDownloadStatsLibrary
+//----------------------------------------------------------------------//
+
+UDownloadStatsLibrary::UDownloadStatsLibrary(const FObjectInitializer& ObjectInitializer)
+	: Super(ObjectInitializer)
+{
+}
+
+FDownloadSessionStats UDownloadStatsLibrary::GetDownloadSessionStats()
+{
+	return FDownloadStats::Get().GetSessionStats();
+}
+
+bool UDownloadStatsLibrary::DumpDownloadSessionStats(const FString& Filename)
+{
+	const FString CsvFilename = Filename.Len() > 0 ? Filename
+		: FPaths::GameLogDir() / FString::Printf(TEXT("DownloadStats-%s.csv"), *FDateTime::Now().ToString());
+	return FDownloadStats::Get().DumpToCsv(CsvFilename);
+}
+
+static FAutoConsoleCommand DumpDownloadStatsCommand(
+	TEXT("PakLoader.DumpDownloadStats"),
+	TEXT("Writes the download requests of this session to a CSV file (optionally named by the first argument)"),
+	FConsoleCommandWithArgsDelegate::CreateStatic([](const TArray<FString>& Args)
+	{
+		UDownloadStatsLibrary::DumpDownloadSessionStats(Args.Num() > 0 ? Args[0] : FString());
+	}));
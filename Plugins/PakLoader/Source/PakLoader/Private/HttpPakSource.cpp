@@ -0,0 +1,306 @@
+// Copyright 1998-2016 Epic Games, Inc. All Rights Reserved.
+
+#include "PakLoaderPrivatePCH.h"
+#include "Http.h"
+#include "PakHttpConnections.h"
+#include "HttpPakSource.h"
+#include "PakDownloadCache.h"
+#include "DownloadStats.h"
+#include "SecureHash.h"
+
+/** Version of the .blocks file */
+static const int32 BlocksVersion = 1;
+
+bool ParseContentRange(const FString& ContentRange, int64& OutFirst, int64& OutLast, int64& OutTotal)
+{
+	FString Unit, RangeAndTotal, Range, Total, First, Last;
+	if (!ContentRange.Trim().Split(TEXT(" "), &Unit, &RangeAndTotal) || !RangeAndTotal.Split(TEXT("/"), &Range, &Total)
+		|| !Range.Split(TEXT("-"), &First, &Last) || !Total.IsNumeric())
+	{
+		return false;
+	}
+	OutFirst = FCString::Atoi64(*First);
+	OutLast = FCString::Atoi64(*Last);
+	OutTotal = FCString::Atoi64(*Total);
+	return Unit == TEXT("bytes") && OutFirst <= OutLast && OutLast < OutTotal;
+}
+
+/** Returns until when the response may be used without revalidation, from its Cache-Control max-age (less its Age) */
+FDateTime GetExpiresAt(const FHttpResponsePtr& HttpResponse)
+{
+	TArray<FString> Directives;
+	HttpResponse->GetHeader(TEXT("Cache-Control")).ParseIntoArray(Directives, TEXT(","));
+	int32 MaxAge = -1;
+	for (const FString& Directive : Directives)
+	{
+		const FString Trimmed = Directive.Trim().TrimTrailing();
+		if (Trimmed.Equals(TEXT("no-cache"), ESearchCase::IgnoreCase) || Trimmed.Equals(TEXT("no-store"), ESearchCase::IgnoreCase))
+		{
+			return FDateTime::MinValue();
+		}
+		if (Trimmed.StartsWith(TEXT("max-age=")))
+		{
+			MaxAge = FCString::Atoi(*Trimmed.Mid(8));
+		}
+	}
+	const int32 Age = FCString::Atoi(*HttpResponse->GetHeader(TEXT("Age")));
+	if (MaxAge <= Age)
+	{
+		return FDateTime::MinValue();
+	}
+	return FDateTime::UtcNow() + FTimespan::FromSeconds(MaxAge - Age);
+}
+
+static FString GetStreamedBaseFilename(const FString& Url)
+{
+	FTCHARToUTF8 Utf8(*Url);
+	FSHAHash Hash;
+	FSHA1::HashBuffer(Utf8.Get(), Utf8.Length(), Hash.Hash);
+	return FPaths::ConvertRelativePathToFull(FPaths::GameSavedDir() / TEXT("DownloadedPaks/Streamed") / Hash.ToString());
+}
+
+FString FHttpPakSource::GetPakFilename(const FString& Url)
+{
+	// Named like downloaded paks, so streamed patch paks are mounted over the paks they patch
+	return FPaths::ConvertRelativePathToFull(FPaths::GameSavedDir() / TEXT("DownloadedPaks/Streamed") / FPakDownloadCache::GetName(Url) + TEXT(".pak"));
+}
+
+FHttpPakSource::FHttpPakSource(const FString& InUrl, int64 InSize, const FString& InETag)
+	: Url(InUrl)
+	, ETag(InETag)
+	, Size(InSize)
+	, Handle(nullptr)
+{
+	const FString BaseFilename = GetStreamedBaseFilename(Url);
+	DataFilename = BaseFilename + TEXT(".sparse");
+	BlocksFilename = BaseFilename + TEXT(".blocks");
+	IFileManager::Get().MakeDirectory(*FPaths::GetPath(BaseFilename), true);
+	const int64 NumBlocks = (Size + BlockSize - 1) / BlockSize;
+
+	// Blocks cached by an earlier session are only reused for the same version of the pak
+	TArray<uint8> Saved;
+	bool bReuse = false;
+	if (ETag.Len() > 0 && FFileHelper::LoadFileToArray(Saved, *BlocksFilename, FILEREAD_Silent))
+	{
+		FMemoryReader Reader(Saved);
+		int32 Version = 0;
+		FString SavedETag;
+		int64 SavedSize = 0;
+		Reader << Version << SavedETag << SavedSize << BlockBits;
+		bReuse = !Reader.IsError() && Version == BlocksVersion && SavedETag == ETag && SavedSize == Size && BlockBits.Num() == (NumBlocks + 7) / 8;
+	}
+	if (!bReuse)
+	{
+		BlockBits.Init(0, (NumBlocks + 7) / 8);
+		IFileManager::Get().Delete(*DataFilename);
+		IFileManager::Get().Delete(*BlocksFilename);
+	}
+	Handle = IPlatformFile::GetPlatformPhysical().OpenWrite(*DataFilename, true, true);
+	if (Handle == nullptr)
+	{
+		UE_LOG(PakLoader, Error, TEXT("Couldn't open %s to cache %s"), *DataFilename, *Url);
+	}
+}
+
+FHttpPakSource::~FHttpPakSource()
+{
+	delete Handle;
+}
+
+bool FHttpPakSource::SaveBlocks() const
+{
+	TArray<uint8> Bytes;
+	FMemoryWriter Writer(Bytes);
+	int32 Version = BlocksVersion;
+	FString SavedETag = ETag;
+	int64 SavedSize = Size;
+	TArray<uint8> SavedBits = BlockBits;
+	Writer << Version << SavedETag << SavedSize << SavedBits;
+	return FFileHelper::SaveArrayToFile(Bytes, *BlocksFilename);
+}
+
+bool FHttpPakSource::Store(int64 Offset, const uint8* Data, int64 Count)
+{
+	FScopeLock ScopedLock(&SourceCritical);
+	if (Handle == nullptr)
+	{
+		return false;
+	}
+	const int64 End = Offset + Count;
+	int64 Block = (Offset + BlockSize - 1) / BlockSize;
+	bool bStored = false;
+	for (; Block * BlockSize < End; Block++)
+	{
+		const int64 BlockStart = Block * BlockSize;
+		const int64 BlockEnd = FMath::Min(BlockStart + BlockSize, Size);
+		if (BlockEnd > End)
+		{
+			break;
+		}
+		if (IsCached(Block))
+		{
+			continue;
+		}
+		if (!Handle->Seek(BlockStart) || !Handle->Write(Data + (BlockStart - Offset), BlockEnd - BlockStart))
+		{
+			UE_LOG(PakLoader, Error, TEXT("Couldn't write block %lld of %s to %s"), Block, *Url, *DataFilename);
+			return false;
+		}
+		BlockBits[Block >> 3] |= 1 << (Block & 7);
+		bStored = true;
+	}
+	return !bStored || SaveBlocks();
+}
+
+bool FHttpPakSource::GetMissingSpan(int64 Offset, int64 Count, int64& OutStart, int64& OutEnd) const
+{
+	FScopeLock ScopedLock(&SourceCritical);
+	const int64 FirstBlock = Offset / BlockSize;
+	const int64 LastBlock = (FMath::Min(Offset + Count, Size) - 1) / BlockSize;
+	int64 FirstMissing = -1;
+	int64 LastMissing = -1;
+	for (int64 Block = FirstBlock; Block <= LastBlock; Block++)
+	{
+		if (!IsCached(Block))
+		{
+			FirstMissing = FirstMissing < 0 ? Block : FirstMissing;
+			LastMissing = Block;
+		}
+	}
+	if (FirstMissing < 0)
+	{
+		return false;
+	}
+	OutStart = FirstMissing * BlockSize;
+	OutEnd = FMath::Min((LastMissing + 1) * BlockSize, Size);
+	return true;
+}
+
+FHttpPakSource::FFetch::FFetch(int64 InStart, int64 InEnd)
+	: Start(InStart)
+	, End(InEnd)
+	, Done(FPlatformProcess::GetSynchEventFromPool(true))
+	, bSucceeded(false)
+{
+}
+
+FHttpPakSource::FFetch::~FFetch()
+{
+	FPlatformProcess::ReturnSynchEventToPool(Done);
+}
+
+void FHttpPakSource::StartFetch(const FFetchPtr& Fetch) const
+{
+	const int64 Start = Fetch->Start;
+	const int64 End = Fetch->End;
+	UE_LOG(PakLoader, Verbose, TEXT("Fetching bytes %lld-%lld of %s"), Start, End - 1, *Url);
+	TSharedRef<IHttpRequest> HttpRequest = FPakHttpConnections::Get().CreateRequest();
+	HttpRequest->SetURL(Url);
+	HttpRequest->SetVerb(TEXT("GET"));
+	HttpRequest->SetHeader(TEXT("Accept-Encoding"), TEXT("identity"));
+	HttpRequest->SetHeader(TEXT("Range"), FString::Printf(TEXT("bytes=%lld-%lld"), Start, End - 1));
+	if (ETag.Len() > 0)
+	{
+		HttpRequest->SetHeader(TEXT("If-Range"), ETag);
+	}
+	// Only Fetch is captured: the source may be gone by the time a request that timed out completes
+	const FString FetchUrl = Url;
+	const int64 PakSize = Size;
+	HttpRequest->OnProcessRequestComplete().BindLambda([Fetch, FetchUrl, PakSize](FHttpRequestPtr Request, FHttpResponsePtr HttpResponse, bool bSucceeded)
+	{
+		const int32 ResponseCode = HttpResponse.IsValid() ? HttpResponse->GetResponseCode() : -1;
+		FDownloadStats::Get().RecordRequest(FetchUrl, ResponseCode, HttpResponse.IsValid() ? HttpResponse->GetContent().Num() : 0, Request->GetElapsedTime());
+		int64 First = 0;
+		int64 Last = 0;
+		int64 Total = 0;
+		if (!bSucceeded || ResponseCode != 206
+			|| !ParseContentRange(HttpResponse->GetHeader(TEXT("Content-Range")), First, Last, Total)
+			|| First != Fetch->Start || Last != Fetch->End - 1 || Total != PakSize || HttpResponse->GetContent().Num() != Fetch->End - Fetch->Start)
+		{
+			// A 200 here means the pak changed on the server since it was mounted
+			UE_LOG(PakLoader, Error, TEXT("Couldn't fetch bytes %lld-%lld of %s: %d"), Fetch->Start, Fetch->End - 1, *FetchUrl, ResponseCode);
+		}
+		else
+		{
+			Fetch->Data = HttpResponse->GetContent();
+			Fetch->bSucceeded = true;
+		}
+		Fetch->Done->Trigger();
+	});
+	FPakHttpConnections::Get().ProcessRequest(HttpRequest);
+}
+
+bool FHttpPakSource::FinishFetch(const FFetchPtr& Fetch)
+{
+	FScopeLock ScopedLock(&SourceCritical);
+	if (InFlight.Remove(Fetch) > 0 && Fetch->bSucceeded && !Store(Fetch->Start, Fetch->Data.GetData(), Fetch->End - Fetch->Start))
+	{
+		return false;
+	}
+	return Fetch->bSucceeded;
+}
+
+bool FHttpPakSource::Read(int64 Offset, uint8* Dest, int64 BytesToRead)
+{
+	if (BytesToRead <= 0)
+	{
+		return true;
+	}
+	// The timeout turns a game thread that is itself waiting on this read into a read error rather than a hang
+	double Timeout = 30;
+	GConfig->GetDouble(TEXT("PakLoader"), TEXT("StreamedPakTimeoutSeconds"), Timeout, GGameIni);
+	for (;;)
+	{
+		FFetchPtr Fetch;
+		bool bStart = false;
+		{
+			FScopeLock ScopedLock(&SourceCritical);
+			if (Handle == nullptr || Offset < 0 || Offset + BytesToRead > Size)
+			{
+				return false;
+			}
+			int64 Start = 0;
+			int64 End = 0;
+			if (!GetMissingSpan(Offset, BytesToRead, Start, End))
+			{
+				return Handle->Seek(Offset) && Handle->Read(Dest, BytesToRead);
+			}
+			if (IsInGameThread())
+			{
+				UE_LOG(PakLoader, Warning, TEXT("Bytes %lld-%lld of %s aren't cached yet and can't be fetched by a read on the game thread"), Start, End - 1, *Url);
+				return false;
+			}
+			// Wait for a request already fetching some of the span rather than fetching its blocks twice
+			for (const FFetchPtr& Other : InFlight)
+			{
+				if (Other->Start < End && Start < Other->End)
+				{
+					Fetch = Other;
+					break;
+				}
+			}
+			if (!Fetch.IsValid())
+			{
+				Fetch = MakeShareable(new FFetch(Start, End));
+				InFlight.Add(Fetch);
+				bStart = true;
+			}
+		}
+		if (bStart)
+		{
+			StartFetch(Fetch);
+		}
+		if (!Fetch->Done->Wait(FTimespan::FromSeconds(Timeout)))
+		{
+			UE_LOG(PakLoader, Error, TEXT("Timed out fetching bytes %lld-%lld of %s"), Fetch->Start, Fetch->End - 1, *Url);
+			FScopeLock ScopedLock(&SourceCritical);
+			// Its completion, whenever it comes, is dropped; the next read fetches the blocks again
+			InFlight.Remove(Fetch);
+			return false;
+		}
+		if (!FinishFetch(Fetch))
+		{
+			return false;
+		}
+	}
+}
@@ -0,0 +1,94 @@
+// Copyright 1998-2016 Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+#include "Engine.h"
+#include "IHttpResponse.h"
+#include "VirtualPakPlatformFile.h"
+
+/** Parses a "bytes <first>-<last>/<total>" Content-Range header */
+bool ParseContentRange(const FString& ContentRange, int64& OutFirst, int64& OutLast, int64& OutTotal);
+
+/** Returns until when the response may be used without revalidation, from its Cache-Control max-age (less its Age) */
+FDateTime GetExpiresAt(const FHttpResponsePtr& HttpResponse);
+
+/**
+* A pak served straight from its URL: reads fetch the blocks they touch with range requests and keep them in a
+* sparse local cache (Saved/DownloadedPaks/Streamed), so only the parts of the pak that are used are ever
+* downloaded, and only once. The cache is dropped when the pak's ETag changes.
+* A read of missing blocks waits for them without holding the source, so other reads go on meanwhile. Responses are
+* delivered by the HTTP manager's tick on the game thread, so only reads made off the game thread can wait:
+* a game thread read of missing blocks fails.
+*/
+class FHttpPakSource : public IVirtualPakSource
+{
+public:
+	/** Granularity of fetches and of the cache, matching the default pak compression block size */
+	static const int64 BlockSize = 64 * 1024;
+
+	FHttpPakSource(const FString& InUrl, int64 InSize, const FString& InETag);
+	virtual ~FHttpPakSource();
+
+	/** Returns the name the pak streamed from Url is mounted as */
+	static FString GetPakFilename(const FString& Url);
+
+	//~ Begin IVirtualPakSource Interface
+	virtual int64 GetSize() const override
+	{
+		return Size;
+	}
+	virtual bool Read(int64 Offset, uint8* Dest, int64 BytesToRead) override;
+	//~ End IVirtualPakSource Interface
+
+	/** Caches the blocks entirely covered by Count bytes of the pak starting at Offset (the last block may end at the end of the pak) */
+	bool Store(int64 Offset, const uint8* Data, int64 Count);
+
+	/** Returns the block-aligned span of [Offset, Offset + Count) that isn't cached yet; false if all of it is */
+	bool GetMissingSpan(int64 Offset, int64 Count, int64& OutStart, int64& OutEnd) const;
+
+	const FString& GetUrl() const
+	{
+		return Url;
+	}
+	const FString& GetETag() const
+	{
+		return ETag;
+	}
+
+private:
+	bool IsCached(int64 Block) const
+	{
+		return (BlockBits[Block >> 3] & (1 << (Block & 7))) != 0;
+	}
+	/** A range request in flight, which every read of its blocks waits for */
+	struct FFetch
+	{
+		FFetch(int64 InStart, int64 InEnd);
+		~FFetch();
+
+		int64 Start;
+		int64 End;
+		/** Triggered once the request completes */
+		FEvent* Done;
+		bool bSucceeded;
+		TArray<uint8> Data;
+	};
+	typedef TSharedPtr<FFetch, ESPMode::ThreadSafe> FFetchPtr;
+
+	/** Starts the range request of Fetch; its completion (on the game thread) only fills in Fetch */
+	void StartFetch(const FFetchPtr& Fetch) const;
+	/** Caches what Fetch received unless a reader already did. Returns false if the fetch failed. */
+	bool FinishFetch(const FFetchPtr& Fetch);
+	bool SaveBlocks() const;
+
+	FString Url;
+	FString ETag;
+	int64 Size;
+	FString DataFilename;
+	FString BlocksFilename;
+	TArray<uint8> BlockBits;
+	IFileHandle* Handle;
+	TArray<FFetchPtr> InFlight;
+	mutable FCriticalSection SourceCritical;
+};
+
+typedef TSharedPtr<FHttpPakSource, ESPMode::ThreadSafe> FHttpPakSourcePtr;
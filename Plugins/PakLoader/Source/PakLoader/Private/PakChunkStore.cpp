@@ -0,0 +1,496 @@
+// Copyright 1998-2016 Epic Games, Inc. All Rights Reserved.
+
+#include "PakLoaderPrivatePCH.h"
+#include "PakChunkStore.h"
+
+//----------------------------------------------------------------------//
+// FPakChunkRecipe
+//----------------------------------------------------------------------//
+
+int64 FPakChunkRecipe::GetTotalSize() const
+{
+	int64 Total = 0;
+	for (const FPakChunk& Chunk : Chunks)
+	{
+		Total += Chunk.Size;
+	}
+	return Total;
+}
+
+void FPakChunkRecipe::GetOffsets(TArray<int64>& Offsets) const
+{
+	Offsets.Reset(Chunks.Num() + 1);
+	int64 Offset = 0;
+	for (const FPakChunk& Chunk : Chunks)
+	{
+		Offsets.Add(Offset);
+		Offset += Chunk.Size;
+	}
+	Offsets.Add(Offset);
+}
+
+FString FPakChunkRecipe::ToString() const
+{
+	FString Result;
+	if (bHasPakHash)
+	{
+		Result += FString::Printf(TEXT("# sha1 %s\n"), *PakHash.ToString());
+	}
+	for (const FPakChunk& Chunk : Chunks)
+	{
+		Result += FString::Printf(TEXT("%s %lld\n"), *Chunk.Hash.ToString(), Chunk.Size);
+	}
+	return Result;
+}
+
+bool FPakChunkRecipe::FromString(const FString& Text)
+{
+	Chunks.Reset();
+	bHasPakHash = false;
+	TArray<FString> Lines;
+	Text.ParseIntoArrayLines(Lines);
+	for (const FString& Line : Lines)
+	{
+		if (Line.StartsWith(TEXT("#")))
+		{
+			const FString Comment = Line.Mid(1).Trim().TrimTrailing();
+			if (Comment.StartsWith(TEXT("sha1 ")) && Comment.Len() == 45)
+			{
+				PakHash.FromString(Comment.Mid(5));
+				bHasPakHash = true;
+			}
+			continue;
+		}
+		FString HashString, SizeString;
+		if (!Line.TrimTrailing().Split(TEXT(" "), &HashString, &SizeString) || HashString.Len() != 40)
+		{
+			Chunks.Reset();
+			return false;
+		}
+		FPakChunk Chunk;
+		Chunk.Hash.FromString(HashString);
+		Chunk.Size = FCString::Atoi64(*SizeString);
+		if (Chunk.Size <= 0)
+		{
+			Chunks.Reset();
+			return false;
+		}
+		Chunks.Add(Chunk);
+	}
+	return Chunks.Num() > 0;
+}
+
+//----------------------------------------------------------------------//
+// FPakChunker
+//----------------------------------------------------------------------//
+
+/**
+* Gear table for the rolling hash. It must never change or chunk boundaries (and the server manifests) stop matching.
+* Built during static initialization, before any thread can chunk: chunkers run on task threads and a lazily filled
+* table would race on first use (function local statics aren't thread safe with every compiler setting the engine uses).
+*/
+struct FGearTable
+{
+	uint64 Table[256];
+
+	FGearTable()
+	{
+		// splitmix64 with a fixed seed
+		uint64 State = 0x50616b4368756e6bULL;
+		for (int32 i = 0; i < 256; i++)
+		{
+			uint64 Z = (State += 0x9E3779B97F4A7C15ULL);
+			Z = (Z ^ (Z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+			Z = (Z ^ (Z >> 27)) * 0x94D049BB133111EBULL;
+			Table[i] = Z ^ (Z >> 31);
+		}
+	}
+};
+
+static const FGearTable GearTable;
+
+static const uint64* GetGearTable()
+{
+	return GearTable.Table;
+}
+
+FPakChunker::FPakChunker(bool bInStore) : bStore(bInStore), RollingHash(0), ReusedBytes(0)
+{
+	Pending.Reserve(MaxChunkSize);
+}
+
+FPakChunker::~FPakChunker()
+{
+	if (bStore)
+	{
+		FPakChunkStore::Get().Unpin(Recipe);
+	}
+}
+
+bool FPakChunker::Write(const uint8* Data, int64 Size)
+{
+	for (int64 Hashed = 0; Hashed < Size; Hashed += MAX_int32)
+	{
+		PakHasher.Update(Data + Hashed, (uint32)FMath::Min<int64>(Size - Hashed, MAX_int32));
+	}
+	const uint64* Gear = GetGearTable();
+	int64 Start = 0;
+	int64 i = 0;
+	while (i < Size)
+	{
+		// The hash only depends on the last 64 bytes, so nothing before that window of MinChunkSize needs hashing
+		const int64 ChunkSize = Pending.Num() + (i - Start);
+		const int64 Skip = (MinChunkSize - 64) - ChunkSize;
+		if (Skip > 0)
+		{
+			i = FMath::Min(i + Skip, Size);
+			continue;
+		}
+		RollingHash = (RollingHash << 1) + Gear[Data[i]];
+		i++;
+		if (((RollingHash & ChunkMask) == 0 && ChunkSize + 1 >= MinChunkSize) || ChunkSize + 1 >= MaxChunkSize)
+		{
+			Pending.Append(Data + Start, (int32)(i - Start));
+			Start = i;
+			if (!EmitChunk())
+			{
+				return false;
+			}
+		}
+	}
+	Pending.Append(Data + Start, (int32)(Size - Start));
+	return true;
+}
+
+bool FPakChunker::EmitChunk()
+{
+	FPakChunk Chunk;
+	FSHA1::HashBuffer(Pending.GetData(), Pending.Num(), Chunk.Hash.Hash);
+	Chunk.Size = Pending.Num();
+	if (bStore)
+	{
+		FPakChunkStore& Store = FPakChunkStore::Get();
+		// Pinned before looking, so a chunk found present can't be evicted before the recipe is committed
+		Store.Pin(Chunk);
+		if (Store.HasChunk(Chunk))
+		{
+			ReusedBytes += Chunk.Size;
+		}
+		else if (!Store.WriteChunk(Chunk, Pending.GetData()))
+		{
+			return false;
+		}
+	}
+	Recipe.Chunks.Add(Chunk);
+	Pending.Reset();
+	RollingHash = 0;
+	return true;
+}
+
+bool FPakChunker::Finish(FPakChunkRecipe& OutRecipe)
+{
+	if (Pending.Num() > 0 && !EmitChunk())
+	{
+		return false;
+	}
+	PakHasher.Final();
+	PakHasher.GetHash(Recipe.PakHash.Hash);
+	Recipe.bHasPakHash = true;
+	OutRecipe = Recipe;
+	return true;
+}
+
+//----------------------------------------------------------------------//
+// FChunkedPakSource
+//----------------------------------------------------------------------//
+
+/**
+* Serves reads of a pak from the chunk files named by its recipe
+*/
+class FChunkedPakSource : public IVirtualPakSource
+{
+	TArray<FString> ChunkFilenames;
+	TArray<int64> Offsets;
+	FCriticalSection ReadCritical;
+	TUniquePtr<IFileHandle> OpenChunk;
+	int32 OpenChunkIndex;
+public:
+	FChunkedPakSource(const FPakChunkStore& Store, const FPakChunkRecipe& Recipe) : OpenChunkIndex(INDEX_NONE)
+	{
+		Recipe.GetOffsets(Offsets);
+		for (const FPakChunk& Chunk : Recipe.Chunks)
+		{
+			ChunkFilenames.Add(Store.GetChunkFilename(Chunk.Hash));
+		}
+	}
+
+	virtual int64 GetSize() const override
+	{
+		return Offsets.Last();
+	}
+
+	virtual bool Read(int64 Offset, uint8* Dest, int64 BytesToRead) override
+	{
+		FScopeLock ScopedLock(&ReadCritical);
+		// find the last chunk starting at or before Offset
+		int32 Lo = 0, Hi = ChunkFilenames.Num() - 1;
+		while (Lo < Hi)
+		{
+			const int32 Mid = (Lo + Hi + 1) / 2;
+			if (Offsets[Mid] <= Offset)
+			{
+				Lo = Mid;
+			}
+			else
+			{
+				Hi = Mid - 1;
+			}
+		}
+		for (int32 Index = Lo; BytesToRead > 0 && Index < ChunkFilenames.Num(); Index++)
+		{
+			if (Index != OpenChunkIndex)
+			{
+				OpenChunk.Reset(IPlatformFile::GetPlatformPhysical().OpenRead(*ChunkFilenames[Index]));
+				OpenChunkIndex = OpenChunk.IsValid() ? Index : INDEX_NONE;
+				if (!OpenChunk.IsValid())
+				{
+					UE_LOG(PakLoader, Error, TEXT("Missing pak chunk %s"), *ChunkFilenames[Index]);
+					return false;
+				}
+			}
+			const int64 InChunk = Offset - Offsets[Index];
+			const int64 Count = FMath::Min(BytesToRead, Offsets[Index + 1] - Offset);
+			if (!OpenChunk->Seek(InChunk) || !OpenChunk->Read(Dest, Count))
+			{
+				return false;
+			}
+			Dest += Count;
+			Offset += Count;
+			BytesToRead -= Count;
+		}
+		return BytesToRead == 0;
+	}
+};
+
+//----------------------------------------------------------------------//
+// FPakChunkStore
+//----------------------------------------------------------------------//
+
+FPakChunkStore& FPakChunkStore::Get()
+{
+	static FPakChunkStore Store;
+	return Store;
+}
+
+FPakChunkStore::FPakChunkStore()
+{
+	ChunkDir = FPaths::ConvertRelativePathToFull(FPaths::GameSavedDir() / TEXT("DownloadedPaks/Chunks"));
+	IFileManager::Get().MakeDirectory(*ChunkDir, true);
+}
+
+FString FPakChunkStore::GetChunkFilename(const FSHAHash& Hash) const
+{
+	const FString Name = Hash.ToString();
+	return ChunkDir / Name.Left(2) / Name + TEXT(".chunk");
+}
+
+bool FPakChunkStore::HasChunk(const FPakChunk& Chunk) const
+{
+	return IFileManager::Get().FileSize(*GetChunkFilename(Chunk.Hash)) == Chunk.Size;
+}
+
+bool FPakChunkStore::StoreChunk(const uint8* Data, int64 Size, FPakChunk& OutChunk)
+{
+	FSHA1::HashBuffer(Data, Size, OutChunk.Hash.Hash);
+	OutChunk.Size = Size;
+	return HasChunk(OutChunk) || WriteChunk(OutChunk, Data);
+}
+
+bool FPakChunkStore::StoreChunk(const FPakChunk& Chunk, const uint8* Data)
+{
+	if (HasChunk(Chunk))
+	{
+		return true;
+	}
+	FSHAHash Actual;
+	FSHA1::HashBuffer(Data, Chunk.Size, Actual.Hash);
+	if (!(Actual == Chunk.Hash))
+	{
+		UE_LOG(PakLoader, Error, TEXT("Pak chunk hash mismatch: expected %s, got %s"), *Chunk.Hash.ToString(), *Actual.ToString());
+		return false;
+	}
+	return WriteChunk(Chunk, Data);
+}
+
+bool FPakChunkStore::WriteChunk(const FPakChunk& Chunk, const uint8* Data)
+{
+	IFileManager* const FileManager = &IFileManager::Get();
+	const FString ChunkFilename = GetChunkFilename(Chunk.Hash);
+	const FString TmpFilename = FPaths::CreateTempFilename(*ChunkDir);
+	FArchive* const Ar = FileManager->CreateFileWriter(*TmpFilename, 0);
+	if (Ar == nullptr)
+	{
+		UE_LOG(PakLoader, Error, TEXT("Couldn't create tmp file %s for chunk %s"), *TmpFilename, *Chunk.Hash.ToString());
+		return false;
+	}
+	Ar->Serialize(const_cast<uint8*>(Data), Chunk.Size);
+	const bool bWriteError = Ar->IsError();
+	Ar->Close();
+	delete Ar;
+	// Another download may have stored the same chunk in the meantime, which is fine
+	if (bWriteError || (!FileManager->Move(*ChunkFilename, *TmpFilename) && !HasChunk(Chunk)))
+	{
+		UE_LOG(PakLoader, Error, TEXT("Couldn't store chunk %s"), *ChunkFilename);
+		FileManager->Delete(*TmpFilename);
+		return false;
+	}
+	FileManager->Delete(*TmpFilename);
+	return true;
+}
+
+bool FPakChunkStore::DeleteChunk(const FPakChunk& Chunk)
+{
+	FScopeLock ScopedLock(&PinsCritical);
+	if (Pins.Contains(Chunk.Hash))
+	{
+		return false;
+	}
+	IFileManager::Get().Delete(*GetChunkFilename(Chunk.Hash));
+	return true;
+}
+
+int32 FPakChunkStore::DeleteUnreferenced(const TSet<FSHAHash>& Referenced)
+{
+	IFileManager& FileManager = IFileManager::Get();
+	int32 Deleted = 0;
+	TArray<FString> ChunkFiles;
+	FileManager.FindFilesRecursive(ChunkFiles, *ChunkDir, TEXT("*.chunk"), true, false);
+	for (const FString& ChunkFilename : ChunkFiles)
+	{
+		const FString Name = FPaths::GetBaseFilename(ChunkFilename);
+		FSHAHash Hash;
+		if (Name.Len() == 40)
+		{
+			Hash.FromString(Name);
+		}
+		// Held while deleting, so a download can't pin the chunk and find it present just before it goes
+		FScopeLock ScopedLock(&PinsCritical);
+		if (Name.Len() != 40 || (!Referenced.Contains(Hash) && !Pins.Contains(Hash)))
+		{
+			Deleted += FileManager.Delete(*ChunkFilename) ? 1 : 0;
+		}
+	}
+	// A chunk write moves its temp file into place right away: older ones were left by a crash
+	TArray<FString> TmpFiles;
+	FileManager.FindFiles(TmpFiles, *(ChunkDir / TEXT("*.tmp")), true, false);
+	const FDateTime Cutoff = FDateTime::UtcNow() - FTimespan::FromMinutes(10);
+	for (const FString& TmpFile : TmpFiles)
+	{
+		const FString TmpFilename = ChunkDir / TmpFile;
+		if (FileManager.GetTimeStamp(*TmpFilename) < Cutoff)
+		{
+			Deleted += FileManager.Delete(*TmpFilename) ? 1 : 0;
+		}
+	}
+	return Deleted;
+}
+
+void FPakChunkStore::Pin(const FPakChunk& Chunk)
+{
+	FScopeLock ScopedLock(&PinsCritical);
+	Pins.FindOrAdd(Chunk.Hash)++;
+}
+
+void FPakChunkStore::Unpin(const FPakChunk& Chunk)
+{
+	FScopeLock ScopedLock(&PinsCritical);
+	int32* Count = Pins.Find(Chunk.Hash);
+	if (Count != nullptr && --(*Count) <= 0)
+	{
+		Pins.Remove(Chunk.Hash);
+	}
+}
+
+void FPakChunkStore::Pin(const FPakChunkRecipe& Recipe)
+{
+	for (const FPakChunk& Chunk : Recipe.Chunks)
+	{
+		Pin(Chunk);
+	}
+}
+
+void FPakChunkStore::Unpin(const FPakChunkRecipe& Recipe)
+{
+	for (const FPakChunk& Chunk : Recipe.Chunks)
+	{
+		Unpin(Chunk);
+	}
+}
+
+void FPakChunkStore::GetMissingChunks(const FPakChunkRecipe& Recipe, TArray<int32>& OutMissing) const
+{
+	OutMissing.Reset();
+	TSet<FSHAHash> Seen;
+	for (int32 i = 0; i < Recipe.Chunks.Num(); i++)
+	{
+		bool bAlreadySeen = false;
+		Seen.Add(Recipe.Chunks[i].Hash, &bAlreadySeen);
+		if (!bAlreadySeen && !HasChunk(Recipe.Chunks[i]))
+		{
+			OutMissing.Add(i);
+		}
+	}
+}
+
+bool FPakChunkStore::Materialize(const FPakChunkRecipe& Recipe, const FString& OutFilename) const
+{
+	IFileManager* const FileManager = &IFileManager::Get();
+	const FString TmpFilename = FPaths::CreateTempFilename(*FPaths::GameSavedDir());
+	FArchive* const Ar = FileManager->CreateFileWriter(*TmpFilename, 0);
+	if (Ar == nullptr)
+	{
+		UE_LOG(PakLoader, Error, TEXT("Couldn't create tmp file %s for %s"), *TmpFilename, *OutFilename);
+		return false;
+	}
+	bool bIOError = false;
+	TArray<uint8> Bytes;
+	FSHA1 PakHasher;
+	for (const FPakChunk& Chunk : Recipe.Chunks)
+	{
+		if (!FFileHelper::LoadFileToArray(Bytes, *GetChunkFilename(Chunk.Hash)) || Bytes.Num() != Chunk.Size)
+		{
+			UE_LOG(PakLoader, Error, TEXT("Missing pak chunk %s for %s"), *Chunk.Hash.ToString(), *OutFilename);
+			bIOError = true;
+			break;
+		}
+		PakHasher.Update(Bytes.GetData(), Bytes.Num());
+		Ar->Serialize(Bytes.GetData(), Bytes.Num());
+	}
+	bIOError |= Ar->IsError();
+	if (!bIOError && Recipe.bHasPakHash)
+	{
+		FSHAHash Actual;
+		PakHasher.Final();
+		PakHasher.GetHash(Actual.Hash);
+		if (!(Actual == Recipe.PakHash))
+		{
+			UE_LOG(PakLoader, Error, TEXT("Materialized %s doesn't match its hash: expected %s, got %s"), *OutFilename, *Recipe.PakHash.ToString(), *Actual.ToString());
+			bIOError = true;
+		}
+	}
+	Ar->Close();
+	delete Ar;
+	if (bIOError || !FileManager->Move(*OutFilename, *TmpFilename))
+	{
+		UE_LOG(PakLoader, Error, TEXT("Couldn't materialize %s"), *OutFilename);
+		FileManager->Delete(*TmpFilename);
+		return false;
+	}
+	UE_LOG(PakLoader, Log, TEXT("Materialized %s from %d chunks"), *OutFilename, Recipe.Chunks.Num());
+	return true;
+}
+
+FVirtualPakSourcePtr FPakChunkStore::CreateView(const FPakChunkRecipe& Recipe) const
+{
+	return MakeShareable(new FChunkedPakSource(*this, Recipe));
+}
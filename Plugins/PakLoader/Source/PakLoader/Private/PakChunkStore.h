@@ -0,0 +1,66 @@
+// Copyright 1998-2016 Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+#include "Engine.h"
+#include "PakChunks.h"
+#include "VirtualPakPlatformFile.h"
+
+/**
+* Local content-addressed store for downloaded paks (Saved/DownloadedPaks/Chunks).
+* Each chunk is stored once no matter how many paks contain it; a pak is kept as a recipe
+* in the download cache index and mounted as a view over its chunks, or materialized
+* from them when the platform file chain can't host the view.
+*/
+class FPakChunkStore
+{
+public:
+	static FPakChunkStore& Get();
+
+	/** Returns the path of the chunk with the given hash */
+	FString GetChunkFilename(const FSHAHash& Hash) const;
+
+	bool HasChunk(const FPakChunk& Chunk) const;
+
+	/** Stores a chunk, verifying its hash. Returns true if the chunk is (now) present. */
+	bool StoreChunk(const FPakChunk& Chunk, const uint8* Data);
+
+	/** Hashes and stores Size bytes as a single chunk */
+	bool StoreChunk(const uint8* Data, int64 Size, FPakChunk& OutChunk);
+
+	/** Writes a chunk whose hash is already known to match Data */
+	bool WriteChunk(const FPakChunk& Chunk, const uint8* Data);
+
+	/** Deletes the chunk unless it is pinned; returns false if it was kept */
+	bool DeleteChunk(const FPakChunk& Chunk);
+
+	/**
+	* Deletes every stored chunk that isn't in Referenced or pinned, and temp files left by chunk writes that never
+	* finished: what failed or interrupted downloads leave behind. Returns the number of files deleted.
+	*/
+	int32 DeleteUnreferenced(const TSet<FSHAHash>& Referenced);
+
+	/**
+	* Keeps chunks from being deleted until they are unpinned, for downloads that counted them as present but haven't
+	* committed their recipe yet. Pins are counted, so every Pin needs an Unpin. Pin before checking for a chunk.
+	*/
+	void Pin(const FPakChunk& Chunk);
+	void Unpin(const FPakChunk& Chunk);
+	void Pin(const FPakChunkRecipe& Recipe);
+	void Unpin(const FPakChunkRecipe& Recipe);
+
+	/** Collects the indices of chunks in Recipe that aren't in the store yet */
+	void GetMissingChunks(const FPakChunkRecipe& Recipe, TArray<int32>& OutMissing) const;
+
+	/** Writes the pak described by Recipe to OutFilename, verifying the pak hash if the recipe has one */
+	bool Materialize(const FPakChunkRecipe& Recipe, const FString& OutFilename) const;
+
+	/** Creates a read-only view of the pak described by Recipe */
+	FVirtualPakSourcePtr CreateView(const FPakChunkRecipe& Recipe) const;
+
+private:
+	FPakChunkStore();
+	FString ChunkDir;
+	mutable FCriticalSection PinsCritical;
+	/** Pin count by chunk hash */
+	TMap<FSHAHash, int32> Pins;
+};
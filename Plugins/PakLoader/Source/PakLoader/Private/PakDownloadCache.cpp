@@ -0,0 +1,548 @@
+// Copyright 1998-2016 Epic Games, Inc. All Rights Reserved.
+
+#include "PakLoaderPrivatePCH.h"
+#include "PakDownloadCache.h"
+#include "PakLoader.h"
+#include "Async.h"
+
+static const uint32 PakCacheIndexMagic = 0x49434B50; // "PKCI"
+static const uint32 PakCacheIndexVersion = 2;
+/** Version 1 entries had no expiry */
+static const uint32 PakCacheIndexVersionNoExpiry = 1;
+/** Marks a materialized pak whose version was replaced while it was mounted, to be deleted once it isn't */
+static const TCHAR* StaleExtension = TEXT(".stale");
+
+static bool IsPakMounted(const FString& PakFilename)
+{
+	FPakLoaderModule* Loader = FModuleManager::GetModulePtr<FPakLoaderModule>(FName(TEXT("PakLoader")));
+	return Loader != nullptr && Loader->IsPakMounted(PakFilename);
+}
+
+FArchive& operator<<(FArchive& Ar, FPakCacheEntry& Entry)
+{
+	return Ar << Entry.Url << Entry.ETag << Entry.LastModified << Entry.Recipe << Entry.LastUse << Entry.ExpiresAt;
+}
+
+FPakDownloadCache& FPakDownloadCache::Get()
+{
+	static FPakDownloadCache Cache;
+	return Cache;
+}
+
+FPakDownloadCache::FPakDownloadCache() : JournalRecords(0)
+{
+	DownloadDir = FPaths::GameSavedDir() + TEXT("DownloadedPaks/");
+	FPaths::NormalizeDirectoryName(DownloadDir);
+	IFileManager::Get().MakeDirectory(*DownloadDir, true);
+	IndexFilename = DownloadDir / TEXT("Index.bin");
+	Load();
+	RemoveStalePaks();
+	RemoveOrphans();
+}
+
+FString FPakDownloadCache::GetName(const FString& Url)
+{
+	FTCHARToUTF8 Utf8Url(*Url);
+	FSHAHash UrlHash;
+	FSHA1::HashBuffer(Utf8Url.Get(), Utf8Url.Length(), UrlHash.Hash);
+	FString Path;
+	FString Query;
+	if (!Url.Split(TEXT("?"), &Path, &Query))
+	{
+		Path = Url;
+	}
+	// Only characters that are safe in a file name on every platform
+	FString BaseName;
+	for (TCHAR Character : FPaths::GetBaseFilename(Path))
+	{
+		if (FChar::IsAlnum(Character) || Character == TEXT('_') || Character == TEXT('-') || Character == TEXT('.'))
+		{
+			BaseName.AppendChar(Character);
+		}
+	}
+	return BaseName.IsEmpty() ? UrlHash.ToString() : UrlHash.ToString() + TEXT("-") + BaseName;
+}
+
+FString FPakDownloadCache::GetPakFilename(const FString& Url) const
+{
+	return DownloadDir / GetName(Url) + TEXT(".pak");
+}
+
+void FPakDownloadCache::Load()
+{
+	FScopeLock ScopedLock(&CacheCritical);
+	TArray<uint8> Bytes;
+	if (!FFileHelper::LoadFileToArray(Bytes, *IndexFilename, FILEREAD_Silent))
+	{
+		UE_LOG(PakLoader, Log, TEXT("Creating download cache index %s"), *IndexFilename);
+		RemoveLegacyFiles();
+		Compact();
+		return;
+	}
+	FMemoryReader Reader(Bytes);
+	uint32 Magic = 0, Version = 0;
+	Reader << Magic << Version;
+	if (Reader.IsError() || Magic != PakCacheIndexMagic || (Version != PakCacheIndexVersion && Version != PakCacheIndexVersionNoExpiry))
+	{
+		UE_LOG(PakLoader, Warning, TEXT("Ignoring unreadable download cache index %s"), *IndexFilename);
+		Compact();
+		return;
+	}
+	bool bTorn = false;
+	while (!bTorn && Reader.Tell() < Reader.TotalSize())
+	{
+		uint32 Size = 0, Crc = 0;
+		Reader << Size << Crc;
+		const int64 PayloadOffset = Reader.Tell();
+		// a crash while appending leaves a partial record at the end, which is dropped
+		bTorn = Reader.IsError() || PayloadOffset + Size > Reader.TotalSize() || FCrc::MemCrc32(Bytes.GetData() + PayloadOffset, Size) != Crc;
+		if (bTorn)
+		{
+			break;
+		}
+		TArray<uint8> Payload(Bytes.GetData() + PayloadOffset, Size);
+		FMemoryReader RecordReader(Payload);
+		uint8 Type = 0;
+		FPakCacheEntry Entry;
+		RecordReader << Type;
+		switch ((ERecordType)Type)
+		{
+		case ERecordType::Put:
+			if (Version == PakCacheIndexVersionNoExpiry)
+			{
+				RecordReader << Entry.Url << Entry.ETag << Entry.LastModified << Entry.Recipe << Entry.LastUse;
+			}
+			else
+			{
+				RecordReader << Entry;
+			}
+			UrlsByName.Add(GetName(Entry.Url), Entry.Url);
+			Entries.Add(Entry.Url, Entry);
+			break;
+		case ERecordType::Remove:
+			RecordReader << Entry.Url;
+			UrlsByName.Remove(GetName(Entry.Url));
+			Entries.Remove(Entry.Url);
+			break;
+		case ERecordType::Touch:
+			RecordReader << Entry.Url << Entry.LastUse;
+			if (FPakCacheEntry* Existing = Entries.Find(Entry.Url))
+			{
+				Existing->LastUse = Entry.LastUse;
+			}
+			break;
+		case ERecordType::Revalidate:
+			RecordReader << Entry.Url << Entry.LastUse << Entry.ExpiresAt;
+			if (FPakCacheEntry* Existing = Entries.Find(Entry.Url))
+			{
+				Existing->LastUse = Entry.LastUse;
+				Existing->ExpiresAt = Entry.ExpiresAt;
+			}
+			break;
+		}
+		bTorn = RecordReader.IsError();
+		Reader.Seek(PayloadOffset + Size);
+		JournalRecords++;
+	}
+	UE_LOG(PakLoader, Log, TEXT("Loaded download cache index: %d paks, %lld bytes"), Entries.Num(), GetTotalSize());
+	if (bTorn)
+	{
+		UE_LOG(PakLoader, Warning, TEXT("Dropping incomplete record at the end of %s"), *IndexFilename);
+		Compact();
+	}
+	else if (Version != PakCacheIndexVersion)
+	{
+		UE_LOG(PakLoader, Log, TEXT("Upgrading download cache index %s to version %u"), *IndexFilename, PakCacheIndexVersion);
+		Compact();
+	}
+}
+
+void FPakDownloadCache::RemoveLegacyFiles()
+{
+	// Paks used to be stored under their Base64-encoded URL with an .etag sidecar
+	TArray<FString> Legacy;
+	IFileManager& FileManager = IFileManager::Get();
+	for (const TCHAR* Pattern : { TEXT("*.etag"), TEXT("*.pak"), TEXT("*.chunks") })
+	{
+		FileManager.FindFiles(Legacy, *(DownloadDir / Pattern), true, false);
+	}
+	for (const FString& Filename : Legacy)
+	{
+		FileManager.Delete(*(DownloadDir / Filename));
+	}
+	if (Legacy.Num() > 0)
+	{
+		UE_LOG(PakLoader, Log, TEXT("Removed %d legacy download cache files"), Legacy.Num());
+	}
+}
+
+void FPakDownloadCache::RemoveStalePaks()
+{
+	TArray<FString> Markers;
+	IFileManager& FileManager = IFileManager::Get();
+	FileManager.FindFiles(Markers, *(DownloadDir / TEXT("*") + StaleExtension), true, false);
+	for (const FString& Marker : Markers)
+	{
+		const FString PakFilename = DownloadDir / FPaths::GetBaseFilename(Marker);
+		if (!IsPakMounted(PakFilename) && (!FileManager.FileExists(*PakFilename) || FileManager.Delete(*PakFilename)))
+		{
+			FileManager.Delete(*(DownloadDir / Marker));
+		}
+	}
+}
+
+void FPakDownloadCache::RemoveOrphans()
+{
+	FScopeLock ScopedLock(&CacheCritical);
+	TSet<FSHAHash> Referenced;
+	for (TMap<FString, FPakCacheEntry>::TConstIterator It(Entries); It; ++It)
+	{
+		for (const FPakChunk& Chunk : It.Value().Recipe.Chunks)
+		{
+			Referenced.Add(Chunk.Hash);
+		}
+	}
+	for (TMap<FString, FPakChunkRecipe>::TConstIterator It(Retired); It; ++It)
+	{
+		for (const FPakChunk& Chunk : It.Value().Chunks)
+		{
+			Referenced.Add(Chunk.Hash);
+		}
+	}
+	const int32 DeletedChunks = FPakChunkStore::Get().DeleteUnreferenced(Referenced);
+
+	// Includes paks materialized under names that are no longer used
+	TArray<FString> Paks;
+	IFileManager& FileManager = IFileManager::Get();
+	FileManager.FindFiles(Paks, *(DownloadDir / TEXT("*.pak")), true, false);
+	int32 DeletedPaks = 0;
+	for (const FString& Pak : Paks)
+	{
+		const FString PakFilename = DownloadDir / Pak;
+		if (!UrlsByName.Contains(FPaths::GetBaseFilename(Pak)) && !IsPakMounted(PakFilename) && FileManager.Delete(*PakFilename))
+		{
+			DeletedPaks++;
+		}
+	}
+	if (DeletedChunks > 0 || DeletedPaks > 0)
+	{
+		UE_LOG(PakLoader, Log, TEXT("Removed %d orphaned chunk files and %d orphaned paks from the download cache"), DeletedChunks, DeletedPaks);
+	}
+}
+
+bool FPakDownloadCache::AppendRecord(ERecordType Type, FPakCacheEntry& Entry)
+{
+	TArray<uint8> Payload;
+	FMemoryWriter Writer(Payload);
+	uint8 TypeByte = (uint8)Type;
+	Writer << TypeByte;
+	switch (Type)
+	{
+	case ERecordType::Put:
+		Writer << Entry;
+		break;
+	case ERecordType::Remove:
+		Writer << Entry.Url;
+		break;
+	case ERecordType::Touch:
+		Writer << Entry.Url << Entry.LastUse;
+		break;
+	case ERecordType::Revalidate:
+		Writer << Entry.Url << Entry.LastUse << Entry.ExpiresAt;
+		break;
+	}
+	FArchive* const Ar = IFileManager::Get().CreateFileWriter(*IndexFilename, FILEWRITE_Append);
+	if (Ar == nullptr)
+	{
+		UE_LOG(PakLoader, Error, TEXT("Couldn't open download cache index %s"), *IndexFilename);
+		return false;
+	}
+	uint32 Size = Payload.Num();
+	uint32 Crc = FCrc::MemCrc32(Payload.GetData(), Payload.Num());
+	*Ar << Size << Crc;
+	Ar->Serialize(Payload.GetData(), Payload.Num());
+	const bool bIOError = Ar->IsError();
+	Ar->Close();
+	delete Ar;
+	JournalRecords++;
+	if (JournalRecords > 2 * Entries.Num() + 64)
+	{
+		Compact();
+	}
+	return !bIOError;
+}
+
+bool FPakDownloadCache::Compact()
+{
+	// Rewrite the index as one Put record per entry, then atomically replace the old one
+	TArray<uint8> Bytes;
+	FMemoryWriter Writer(Bytes);
+	uint32 Magic = PakCacheIndexMagic, Version = PakCacheIndexVersion;
+	Writer << Magic << Version;
+	for (TMap<FString, FPakCacheEntry>::TIterator It(Entries); It; ++It)
+	{
+		TArray<uint8> Payload;
+		FMemoryWriter RecordWriter(Payload);
+		uint8 TypeByte = (uint8)ERecordType::Put;
+		RecordWriter << TypeByte << It.Value();
+		uint32 Size = Payload.Num();
+		uint32 Crc = FCrc::MemCrc32(Payload.GetData(), Payload.Num());
+		Writer << Size << Crc;
+		Writer.Serialize(Payload.GetData(), Payload.Num());
+	}
+	const FString TmpFilename = FPaths::CreateTempFilename(*DownloadDir);
+	if (!FFileHelper::SaveArrayToFile(Bytes, *TmpFilename) || !IFileManager::Get().Move(*IndexFilename, *TmpFilename))
+	{
+		UE_LOG(PakLoader, Error, TEXT("Couldn't write download cache index %s"), *IndexFilename);
+		IFileManager::Get().Delete(*TmpFilename);
+		return false;
+	}
+	JournalRecords = Entries.Num();
+	return true;
+}
+
+bool FPakDownloadCache::Find(const FString& Url, FPakCacheEntry& OutEntry) const
+{
+	FScopeLock ScopedLock(&CacheCritical);
+	const FPakCacheEntry* Entry = Entries.Find(Url);
+	if (Entry != nullptr)
+	{
+		OutEntry = *Entry;
+	}
+	return Entry != nullptr;
+}
+
+bool FPakDownloadCache::FindByFilename(const FString& PakFilename, FPakCacheEntry& OutEntry) const
+{
+	FScopeLock ScopedLock(&CacheCritical);
+	const FString* Url = UrlsByName.Find(FPaths::GetBaseFilename(PakFilename));
+	return Url != nullptr && Find(*Url, OutEntry);
+}
+
+void FPakDownloadCache::GetEntries(TArray<FPakCacheEntry>& OutEntries) const
+{
+	FScopeLock ScopedLock(&CacheCritical);
+	Entries.GenerateValueArray(OutEntries);
+}
+
+bool FPakDownloadCache::Commit(const FPakCacheEntry& InEntry)
+{
+	FScopeLock ScopedLock(&CacheCritical);
+	FPakCacheEntry Entry = InEntry;
+	Entry.LastUse = FDateTime::UtcNow();
+	FPakChunkRecipe OldRecipe;
+	if (const FPakCacheEntry* Old = Entries.Find(Entry.Url))
+	{
+		OldRecipe = Old->Recipe;
+	}
+	const FString PakFilename = GetPakFilename(Entry.Url);
+	const bool bMaterialized = IPlatformFile::GetPlatformPhysical().FileExists(*PakFilename);
+	if (IsPakMounted(PakFilename))
+	{
+		// The mounted pak keeps reading the old version until it is unmounted; a version committed in between was
+		// never mounted, so that one can go straight away
+		if (!Retired.Contains(Entry.Url))
+		{
+			FPakChunkStore::Get().Pin(OldRecipe);
+			Retired.Add(Entry.Url, OldRecipe);
+			OldRecipe = FPakChunkRecipe();
+			if (bMaterialized)
+			{
+				FFileHelper::SaveStringToFile(FString(), *(PakFilename + StaleExtension));
+			}
+		}
+	}
+	// A pak materialized from older chunks would shadow the new recipe
+	else if (bMaterialized && !IFileManager::Get().Delete(*PakFilename))
+	{
+		UE_LOG(PakLoader, Error, TEXT("Couldn't replace cached file %s for %s"), *PakFilename, *Entry.Url);
+		return false;
+	}
+	UrlsByName.Add(GetName(Entry.Url), Entry.Url);
+	Entries.Add(Entry.Url, Entry);
+	const bool bResult = AppendRecord(ERecordType::Put, Entry);
+	// The chunks only the replaced version of the pak used would otherwise stay on disk, uncounted
+	TSet<FSHAHash> Deleted;
+	DeleteUnreferencedChunks(OldRecipe, Deleted);
+	if (IsInGameThread())
+	{
+		EnforceQuota(Entry.Url);
+	}
+	else
+	{
+		const FString KeepUrl = Entry.Url;
+		AsyncTask(ENamedThreads::GameThread, [this, KeepUrl]()
+		{
+			EnforceQuota(KeepUrl);
+		});
+	}
+	return bResult;
+}
+
+void FPakDownloadCache::Touch(const FString& Url)
+{
+	FScopeLock ScopedLock(&CacheCritical);
+	FPakCacheEntry* Entry = Entries.Find(Url);
+	if (Entry != nullptr)
+	{
+		Entry->LastUse = FDateTime::UtcNow();
+		AppendRecord(ERecordType::Touch, *Entry);
+	}
+}
+
+void FPakDownloadCache::Revalidate(const FString& Url, const FDateTime& ExpiresAt)
+{
+	FScopeLock ScopedLock(&CacheCritical);
+	FPakCacheEntry* Entry = Entries.Find(Url);
+	if (Entry != nullptr)
+	{
+		Entry->LastUse = FDateTime::UtcNow();
+		Entry->ExpiresAt = ExpiresAt;
+		AppendRecord(ERecordType::Revalidate, *Entry);
+	}
+}
+
+bool FPakDownloadCache::Remove(const FString& Url)
+{
+	FScopeLock ScopedLock(&CacheCritical);
+	if (!Entries.Contains(Url))
+	{
+		return false;
+	}
+	TSet<FSHAHash> Unreferenced;
+	RemoveLocked(Url, Unreferenced);
+	return true;
+}
+
+void FPakDownloadCache::ReleaseRetired()
+{
+	FScopeLock ScopedLock(&CacheCritical);
+	for (TMap<FString, FPakChunkRecipe>::TIterator It(Retired); It; ++It)
+	{
+		const FString PakFilename = GetPakFilename(It.Key());
+		if (IsPakMounted(PakFilename))
+		{
+			continue;
+		}
+		const FString Marker = PakFilename + StaleExtension;
+		if (IFileManager::Get().FileExists(*Marker) && IFileManager::Get().Delete(*PakFilename))
+		{
+			IFileManager::Get().Delete(*Marker);
+		}
+		const FPakChunkRecipe Recipe = It.Value();
+		It.RemoveCurrent();
+		FPakChunkStore::Get().Unpin(Recipe);
+		TSet<FSHAHash> Deleted;
+		DeleteUnreferencedChunks(Recipe, Deleted);
+		UE_LOG(PakLoader, Log, TEXT("Released the replaced version of %s (%d chunks deleted)"), *PakFilename, Deleted.Num());
+	}
+}
+
+void FPakDownloadCache::RemoveLocked(const FString& Url, TSet<FSHAHash>& OutUnreferenced)
+{
+	FPakCacheEntry Entry = Entries.FindChecked(Url);
+	Entries.Remove(Url);
+	UrlsByName.Remove(GetName(Url));
+	AppendRecord(ERecordType::Remove, Entry);
+	DeleteUnreferencedChunks(Entry.Recipe, OutUnreferenced);
+	const FString PakFilename = GetPakFilename(Url);
+	if (IPlatformFile::GetPlatformPhysical().FileExists(*PakFilename))
+	{
+		IFileManager::Get().Delete(*PakFilename);
+	}
+}
+
+void FPakDownloadCache::DeleteUnreferencedChunks(const FPakChunkRecipe& Recipe, TSet<FSHAHash>& OutDeleted)
+{
+	if (Recipe.Chunks.Num() == 0)
+	{
+		return;
+	}
+	TSet<FSHAHash> Referenced;
+	for (TMap<FString, FPakCacheEntry>::TConstIterator It(Entries); It; ++It)
+	{
+		for (const FPakChunk& Chunk : It.Value().Recipe.Chunks)
+		{
+			Referenced.Add(Chunk.Hash);
+		}
+	}
+	FPakChunkStore& Store = FPakChunkStore::Get();
+	for (const FPakChunk& Chunk : Recipe.Chunks)
+	{
+		// Pinned chunks are kept for the download that pinned them, which is about to reference them
+		if (!Referenced.Contains(Chunk.Hash) && !OutDeleted.Contains(Chunk.Hash) && Store.DeleteChunk(Chunk))
+		{
+			OutDeleted.Add(Chunk.Hash);
+		}
+	}
+}
+
+int64 FPakDownloadCache::GetTotalSize() const
+{
+	FScopeLock ScopedLock(&CacheCritical);
+	TSet<FSHAHash> Counted;
+	int64 Total = 0;
+	for (TMap<FString, FPakCacheEntry>::TConstIterator It(Entries); It; ++It)
+	{
+		for (const FPakChunk& Chunk : It.Value().Recipe.Chunks)
+		{
+			bool bAlreadyCounted = false;
+			Counted.Add(Chunk.Hash, &bAlreadyCounted);
+			if (!bAlreadyCounted)
+			{
+				Total += Chunk.Size;
+			}
+		}
+	}
+	return Total;
+}
+
+void FPakDownloadCache::EnforceQuota(const FString& KeepUrl)
+{
+	check(IsInGameThread());
+	FScopeLock ScopedLock(&CacheCritical);
+	ReleaseRetired();
+	int32 MaxDownloadCacheMB = 2048;
+	GConfig->GetInt(TEXT("PakLoader"), TEXT("MaxDownloadCacheMB"), MaxDownloadCacheMB, GGameIni);
+	if (MaxDownloadCacheMB <= 0)
+	{
+		return;
+	}
+	const int64 Quota = (int64)MaxDownloadCacheMB * 1024 * 1024;
+	int64 TotalSize = GetTotalSize();
+	if (TotalSize <= Quota)
+	{
+		return;
+	}
+	TArray<FPakCacheEntry> ByLastUse;
+	Entries.GenerateValueArray(ByLastUse);
+	ByLastUse.Sort([](const FPakCacheEntry& One, const FPakCacheEntry& Two) -> bool
+	{
+		return One.LastUse < Two.LastUse;
+	});
+	for (const FPakCacheEntry& Entry : ByLastUse)
+	{
+		if (TotalSize <= Quota)
+		{
+			break;
+		}
+		if (Entry.Url == KeepUrl || IsPakMounted(GetPakFilename(Entry.Url)))
+		{
+			continue;
+		}
+		TSet<FSHAHash> Unreferenced;
+		RemoveLocked(Entry.Url, Unreferenced);
+		for (const FPakChunk& Chunk : Entry.Recipe.Chunks)
+		{
+			if (Unreferenced.Remove(Chunk.Hash) > 0)
+			{
+				TotalSize -= Chunk.Size;
+			}
+		}
+		UE_LOG(PakLoader, Log, TEXT("Evicted %s from the download cache (%lld of %lld bytes in use)"), *Entry.Url, TotalSize, Quota);
+	}
+	if (TotalSize > Quota)
+	{
+		UE_LOG(PakLoader, Warning, TEXT("Download cache is over quota (%lld of %lld bytes) but the remaining paks are in use"), TotalSize, Quota);
+	}
+}
@@ -0,0 +1,118 @@
+// Copyright 1998-2016 Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+#include "Engine.h"
+#include "PakChunkStore.h"
+
+/**
+* What the download cache knows about one downloaded pak
+*/
+struct FPakCacheEntry
+{
+	FString Url;
+	/** Validators sent back to the server on the next request */
+	FString ETag;
+	FString LastModified;
+	/** Chunks (and SHA1) of the cached pak */
+	FPakChunkRecipe Recipe;
+	FDateTime LastUse;
+	/** UTC time until which the pak may be used without revalidation (Cache-Control max-age); MinValue if the server gave none */
+	FDateTime ExpiresAt;
+
+	bool IsFresh() const
+	{
+		return FDateTime::UtcNow() < ExpiresAt;
+	}
+
+	int64 GetSize() const
+	{
+		return Recipe.GetTotalSize();
+	}
+
+	friend FArchive& operator<<(FArchive& Ar, FPakCacheEntry& Entry);
+};
+
+/**
+* Index of Saved/DownloadedPaks, kept in a single journaled file (Index.bin) that is read in one go at
+* startup. Changes are appended as checksummed records, so a crash can at worst lose the record being
+* written; the journal is compacted once it has grown well past the number of entries.
+* The cache is bounded by [PakLoader] MaxDownloadCacheMB: least recently used paks are evicted (never
+* ones that are currently mounted) and chunks no longer referenced by any pak are deleted, unless a download
+* in progress has pinned them. A pak downloaded again releases the chunks only its old version used; if the old
+* version is mounted, its chunks (and the file materialized from them) are kept until it is unmounted. The
+* quota is enforced on the game thread, where the mounted paks are known. What failed or interrupted downloads
+* leave behind is swept when the index is loaded.
+*/
+class FPakDownloadCache
+{
+public:
+	static FPakDownloadCache& Get();
+
+	/**
+	* Name, without extension, of the local file of the pak from Url: the SHA1 of the URL, then the file name the URL
+	* ends in, which keeps the <name>_<N>_P suffix patch paks are mounted in order by
+	*/
+	static FString GetName(const FString& Url);
+
+	/** Returns the (possibly virtual) local filename of the pak downloaded from Url */
+	FString GetPakFilename(const FString& Url) const;
+
+	bool Find(const FString& Url, FPakCacheEntry& OutEntry) const;
+	bool FindByFilename(const FString& PakFilename, FPakCacheEntry& OutEntry) const;
+	void GetEntries(TArray<FPakCacheEntry>& OutEntries) const;
+
+	/**
+	* Adds or replaces the entry for Entry.Url and evicts other paks if the cache is over quota. Fails if a pak
+	* materialized from the old version can't be removed.
+	*/
+	bool Commit(const FPakCacheEntry& Entry);
+
+	/** Records that the pak downloaded from Url was just used */
+	void Touch(const FString& Url);
+
+	/** Records that the server confirmed the cached pak is current, and until when it stays fresh */
+	void Revalidate(const FString& Url, const FDateTime& ExpiresAt);
+
+	bool Remove(const FString& Url);
+
+	/** Deletes what the old versions of replaced paks used once those paks are no longer mounted */
+	void ReleaseRetired();
+
+	/** Size of all the chunks referenced by cached paks */
+	int64 GetTotalSize() const;
+
+private:
+	FPakDownloadCache();
+
+	enum class ERecordType : uint8
+	{
+		Put,
+		Remove,
+		Touch,
+		Revalidate
+	};
+
+	void Load();
+	void RemoveLegacyFiles();
+	/** Removes paks that were materialized from a version replaced while they were mounted, left over from an earlier run */
+	void RemoveStalePaks();
+	/** Removes chunks and materialized paks no cached pak refers to, left over from failed or interrupted downloads */
+	void RemoveOrphans();
+	bool AppendRecord(ERecordType Type, FPakCacheEntry& Entry);
+	bool Compact();
+	/** Evicts paks until the cache is within quota; game thread only */
+	void EnforceQuota(const FString& KeepUrl);
+	void RemoveLocked(const FString& Url, TSet<FSHAHash>& OutUnreferenced);
+	/** Deletes the chunks of Recipe no cached pak refers to, adding the ones actually deleted to OutDeleted */
+	void DeleteUnreferencedChunks(const FPakChunkRecipe& Recipe, TSet<FSHAHash>& OutDeleted);
+
+	FString DownloadDir;
+	FString IndexFilename;
+	mutable FCriticalSection CacheCritical;
+	TMap<FString, FPakCacheEntry> Entries;
+	/** Url by local file name */
+	TMap<FString, FString> UrlsByName;
+	/** Recipes of mounted paks that were replaced by a newer version, by Url; their chunks stay pinned until the pak is unmounted */
+	TMap<FString, FPakChunkRecipe> Retired;
+	int32 JournalRecords;
+};
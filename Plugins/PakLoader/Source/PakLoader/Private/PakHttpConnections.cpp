@@ -0,0 +1,161 @@
+// Copyright 1998-2016 Epic Games, Inc. All Rights Reserved.
+
+#include "PakLoaderPrivatePCH.h"
+#include "PakHttpConnections.h"
+#include "PakMirrors.h"
+#include "Http.h"
+
+/** Hosts not used for this long are left to go cold */
+static const double KeepWarmWindowSeconds = 300;
+
+FPakHttpConnections& FPakHttpConnections::Get()
+{
+	static FPakHttpConnections PakHttpConnections;
+	return PakHttpConnections;
+}
+
+FPakHttpConnections::FPakHttpConnections()
+	: KeepWarmSeconds(0)
+{
+}
+
+TSharedRef<IHttpRequest> FPakHttpConnections::CreateRequest()
+{
+	TSharedRef<IHttpRequest> HttpRequest = FHttpModule::Get().CreateRequest();
+	HttpRequest->SetHeader(TEXT("Connection"), TEXT("keep-alive"));
+	return HttpRequest;
+}
+
+bool FPakHttpConnections::ProcessRequest(const TSharedRef<IHttpRequest>& Request)
+{
+	const FString Origin = FPakMirrors::GetOrigin(Request->GetURL());
+	{
+		FScopeLock ScopedLock(&HostsCritical);
+		FHostState& Host = Hosts.FindOrAdd(Origin);
+		Host.Active++;
+		Host.LastUsed = Host.LastActive = FPlatformTime::Seconds();
+	}
+	// Completion is seen through the caller's own delegate, which is passed on unchanged
+	const FHttpRequestCompleteDelegate Complete = Request->OnProcessRequestComplete();
+	Request->OnProcessRequestComplete().BindLambda([this, Complete, Origin](FHttpRequestPtr HttpRequest, FHttpResponsePtr HttpResponse, bool bSucceeded)
+	{
+		HandleRequestComplete(Origin);
+		Complete.ExecuteIfBound(HttpRequest, HttpResponse, bSucceeded);
+	});
+	return Request->ProcessRequest();
+}
+
+void FPakHttpConnections::HandleRequestComplete(const FString& Origin)
+{
+	FScopeLock ScopedLock(&HostsCritical);
+	FHostState& Host = Hosts.FindOrAdd(Origin);
+	Host.Active = FMath::Max(Host.Active - 1, 0);
+	Host.LastActive = FPlatformTime::Seconds();
+}
+
+void FPakHttpConnections::Startup()
+{
+	if (IsRunningCommandlet())
+	{
+		return;
+	}
+	TArray<FString> Urls;
+	GConfig->GetArray(TEXT("PakLoader"), TEXT("PrewarmHosts"), Urls, GGameIni);
+	TArray<FString> Mirrors;
+	if (GConfig->GetSection(TEXT("PakLoader.Mirrors"), Mirrors, GGameIni))
+	{
+		for (const FString& Mirror : Mirrors)
+		{
+			FString Group;
+			FString Base;
+			if (Mirror.Split(TEXT("="), &Group, &Base))
+			{
+				Urls.Add(Base);
+			}
+		}
+	}
+	for (const FString& Url : Urls)
+	{
+		Warm(Url);
+	}
+	GConfig->GetFloat(TEXT("PakLoader"), TEXT("KeepWarmSeconds"), KeepWarmSeconds, GGameIni);
+	if (KeepWarmSeconds > 0)
+	{
+		KeepWarmHandle = FTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateRaw(this, &FPakHttpConnections::KeepWarm), 1.0f);
+	}
+}
+
+void FPakHttpConnections::Shutdown()
+{
+	if (KeepWarmHandle.IsValid())
+	{
+		FTicker::GetCoreTicker().RemoveTicker(KeepWarmHandle);
+		KeepWarmHandle.Reset();
+	}
+}
+
+void FPakHttpConnections::Warm(const FString& Url)
+{
+	const FString Origin = FPakMirrors::GetOrigin(Url);
+	{
+		FScopeLock ScopedLock(&HostsCritical);
+		FHostState& Host = Hosts.FindOrAdd(Origin);
+		if (Host.Active > 0 || Host.bWarming)
+		{
+			return;
+		}
+		Host.bWarming = true;
+		if (Host.LastUsed == 0)
+		{
+			// Counts as a use, so a host warmed at startup stays warm for a while even if nothing is downloaded yet
+			Host.LastUsed = FPlatformTime::Seconds();
+		}
+	}
+	UE_LOG(PakLoader, Verbose, TEXT("Warming up connection to %s"), *Origin);
+	TSharedRef<IHttpRequest> HttpRequest = CreateRequest();
+	HttpRequest->OnProcessRequestComplete().BindRaw(this, &FPakHttpConnections::HandleWarmRequest, Origin);
+	HttpRequest->SetURL(Origin + TEXT("/"));
+	HttpRequest->SetVerb(TEXT("HEAD"));
+	HttpRequest->ProcessRequest();
+}
+
+void FPakHttpConnections::HandleWarmRequest(FHttpRequestPtr HttpRequest, FHttpResponsePtr HttpResponse, bool bSucceeded, FString Origin)
+{
+	{
+		FScopeLock ScopedLock(&HostsCritical);
+		FHostState& Host = Hosts.FindOrAdd(Origin);
+		Host.bWarming = false;
+		Host.LastActive = FPlatformTime::Seconds();
+	}
+	// Any answer at all means the connection is up, whatever the server makes of a HEAD on its root
+	if (!bSucceeded || !HttpResponse.IsValid())
+	{
+		UE_LOG(PakLoader, Warning, TEXT("Couldn't connect to %s"), *Origin);
+		return;
+	}
+	UE_LOG(PakLoader, Log, TEXT("Connected to %s in %.0fms"), *Origin, HttpRequest->GetElapsedTime() * 1000);
+	// Gives mirror selection a latency figure before the first download
+	FPakMirrors::Get().RecordTransfer(Origin, HttpRequest->GetElapsedTime(), 0);
+}
+
+bool FPakHttpConnections::KeepWarm(float DeltaTime)
+{
+	const double Now = FPlatformTime::Seconds();
+	TArray<FString> Idle;
+	{
+		FScopeLock ScopedLock(&HostsCritical);
+		for (const TPair<FString, FHostState>& Host : Hosts)
+		{
+			if (Host.Value.Active == 0 && !Host.Value.bWarming && Now - Host.Value.LastActive >= KeepWarmSeconds
+				&& Now - Host.Value.LastUsed < KeepWarmWindowSeconds)
+			{
+				Idle.Add(Host.Key);
+			}
+		}
+	}
+	for (const FString& Origin : Idle)
+	{
+		Warm(Origin);
+	}
+	return true;
+}
@@ -6,6 +6,9 @@
 #include "CallbackDevice.h"
 #include "PackageName.h"
 #include "StringClassReference.h"
+#include "PakDownloadCache.h"
+#include "VirtualPakPlatformFile.h"
+#include "PakHttpConnections.h"
 
 #define LOCTEXT_NAMESPACE "FPakLoaderModule"
 
@@ -16,13 +19,22 @@ void FPakLoaderModule::StartupModule()
 	// This code will execute after your module is loaded into memory; the exact timing is specified in the .uplugin file per-module
 	StreamableManager = new FStreamableManager();
 	PakPlatformFile = nullptr;
+	VirtualPakPlatformFile = nullptr;
 	UnloadId = 0;
+	FPakHttpConnections::Get().Startup();
+	// Packaged builds mount their own paks at start up; put the virtual pak layer under that pak file before
+	// its readers are busy rather than on the first download
+	if (FPlatformFileManager::Get().FindPlatformFile(FPakPlatformFile::GetTypeName()) != nullptr)
+	{
+		CreatePakPlatformFile();
+	}
 }
 
 void FPakLoaderModule::ShutdownModule()
 {
 	// This function may be called during shutdown to clean up your module.  For modules that support dynamic reloading,
 	// we call this function before unloading the module.
+	FPakHttpConnections::Get().Shutdown();
 	delete StreamableManager;
 	//delete PakPlatformFile; // This should never be deleted as it's in the chain of IPlatformFiles if non-null
 }
@@ -98,7 +110,16 @@ bool FPakLoaderModule::UnmountPakFile(const FString& PakFilePath)
 				Result = PakPlatformFile->Unmount(*PakFilePath);
 				if (Result)
 				{
-					MountedPaks.Remove(PakFilePath);
+					{
+						FScopeLock ScopedLock(&MountedPaksCritical);
+						MountedPaks.Remove(PakFilePath);
+					}
+					if (VirtualPakPlatformFile != nullptr)
+					{
+						VirtualPakPlatformFile->Unregister(PakFilePath);
+					}
+					// A newer version may have been downloaded while this one was mounted
+					FPakDownloadCache::Get().ReleaseRetired();
 					UE_LOG(PakLoader, Log, TEXT("Unmounted: %s"), *PakFilePath);
 				}
 			}
@@ -116,16 +137,20 @@ bool FPakLoaderModule::UnmountPakFile(const FString& PakFilePath)
 }
 
 
-bool FPakLoaderModule::MountPakFile(const FString& PakFilePath, TSharedPtr<FPakFile>& Result)
+void FPakLoaderModule::CreatePakPlatformFile()
 {
-	bSandboxed = false;
 	if (PakPlatformFile == nullptr)
 	{
 		IPlatformFile* File = FPlatformFileManager::Get().FindPlatformFile(FPakPlatformFile::GetTypeName());
+		VirtualPakPlatformFile = new FVirtualPakPlatformFile();
 		if (File != nullptr)
 		{
-			UE_LOG(PakLoader, Log, TEXT("Found existing FPakPlatformFile"));
+			// chunked, streamed and in-memory paks are served by a layer directly below the pak file, so slip it in
+			// between the existing pak file and whatever it reads from
 			PakPlatformFile = static_cast<FPakPlatformFile*>(File);
+			VirtualPakPlatformFile->Initialize(PakPlatformFile->GetLowerLevel(), TEXT(""));
+			PakPlatformFile->SetLowerLevel(VirtualPakPlatformFile);
+			UE_LOG(PakLoader, Log, TEXT("Found existing FPakPlatformFile, inserted %s above %s"), VirtualPakPlatformFile->GetName(), VirtualPakPlatformFile->GetLowerLevel()->GetName());
 		}
 		else
 		{
@@ -137,17 +162,24 @@ bool FPakLoaderModule::MountPakFile(const FString& PakFilePath, TSharedPtr<FPakF
 				// hack: Pak must go below CachedRead
 				IPlatformFile* CachedReadFile = LowerLevel;
 				IPlatformFile* Physical = LowerLevel->GetLowerLevel();
-				PakPlatformFile->Initialize(Physical, TEXT(""));
+				VirtualPakPlatformFile->Initialize(Physical, TEXT(""));
+				PakPlatformFile->Initialize(VirtualPakPlatformFile, TEXT(""));
 				CachedReadFile->Initialize(PakPlatformFile, TEXT(""));
 			}
 			else
 			{
-				PakPlatformFile->Initialize(LowerLevel, TEXT(""));
+				VirtualPakPlatformFile->Initialize(LowerLevel, TEXT(""));
+				PakPlatformFile->Initialize(VirtualPakPlatformFile, TEXT(""));
 				FPlatformFileManager::Get().SetPlatformFile(*PakPlatformFile);
 			}
 			UE_LOG(PakLoader, Log, TEXT("Created new FPakPlatformFile above %s"), LowerLevel->GetName());
 			
 		}
+		if (!ensureMsgf(PakPlatformFile->GetLowerLevel() == VirtualPakPlatformFile, TEXT("The virtual pak layer isn't directly below the pak file")))
+		{
+			// Not reachable through the pak file, so never register anything with it
+			VirtualPakPlatformFile = nullptr;
+		}
 		IPlatformFile* Top = &FPlatformFileManager::Get().GetPlatformFile();
 		static FString SandBoxFile("SandBoxFile");
 		while (Top != nullptr)
@@ -160,20 +192,51 @@ bool FPakLoaderModule::MountPakFile(const FString& PakFilePath, TSharedPtr<FPakF
 			Top = Top->GetLowerLevel();
 		}
 	}
+}
+
+/**
+* Read order for a pak: regular paks get 5, patch paks (<name>_<N>_P.pak, as made by the deploy editor) get 100 + N
+* so their files win over the ones they replace, and later patches win over earlier ones.
+*/
+static uint32 GetPakReadOrder(const FString& PakFilePath)
+{
+	static const uint32 DefaultReadOrder = 5;
+	static const uint32 PatchReadOrder = 100;
+	const FString BaseFilename = FPaths::GetBaseFilename(PakFilePath);
+	if (!BaseFilename.EndsWith(TEXT("_P")))
+	{
+		return DefaultReadOrder;
+	}
+	const FString Name = BaseFilename.LeftChop(2);
+	int32 Separator;
+	if (Name.FindLastChar(TEXT('_'), Separator) && Name.Mid(Separator + 1).IsNumeric())
+	{
+		return PatchReadOrder + FCString::Atoi(*Name.Mid(Separator + 1));
+	}
+	return PatchReadOrder;
+}
+
+bool FPakLoaderModule::MountPakFile(const FString& PakFilePath, TSharedPtr<FPakFile>& Result)
+{
+	bSandboxed = false;
+	CreatePakPlatformFile();
 	FString GameContentDir(FPaths::GameContentDir());
 	FPaths::MakeStandardFilename(GameContentDir);
 	FString Absolute = FPaths::ConvertRelativePathToFull(GameContentDir);
 	UE_LOG(PakLoader, Log, TEXT("GameContentDir: %s, full: %s"), *GameContentDir, *Absolute);
 	IFileManager* const FileManager = &IFileManager::Get();
-	if (!FileManager->FileExists(*PakFilePath))
+	if (!FileManager->FileExists(*PakFilePath) && !MountChunkedPak(PakFilePath))
 	{
 		UE_LOG(PakLoader, Error, TEXT("Pak file doesn't exist :( %s"), *PakFilePath);
 		return false;
 	}
 
-	if (MountedPaks.Contains(PakFilePath) || PakPlatformFile->Mount(*PakFilePath, 5, *GameContentDir))
+	if (MountedPaks.Contains(PakFilePath) || PakPlatformFile->Mount(*PakFilePath, GetPakReadOrder(PakFilePath), *GameContentDir))
 	{
-		MountedPaks.Add(PakFilePath);
+		{
+			FScopeLock ScopedLock(&MountedPaksCritical);
+			MountedPaks.Add(PakFilePath);
+		}
 		TSharedPtr<FPakFile> PakFile(new FPakFile(&FPlatformFileManager::Get().GetPlatformFile(), *PakFilePath, false));
 		PakFile->SetMountPoint(*GameContentDir);
 		UE_LOG(PakLoader, Log, TEXT("Mounted Pak File: %s"), *PakFilePath);
@@ -184,6 +247,56 @@ bool FPakLoaderModule::MountPakFile(const FString& PakFilePath, TSharedPtr<FPakF
 	return false;
 }
 
+bool FPakLoaderModule::MountVirtualPak(const FString& PakFilePath, const FVirtualPakSourcePtr& Source, TSharedPtr<FPakFile>& Result)
+{
+	bSandboxed = false;
+	CreatePakPlatformFile();
+	if (VirtualPakPlatformFile == nullptr)
+	{
+		UE_LOG(PakLoader, Error, TEXT("Can't mount %s: the pak platform file was created without a virtual pak layer"), *PakFilePath);
+		return false;
+	}
+	if (!PakFilePath.EndsWith(TEXT(".pak")))
+	{
+		UE_LOG(PakLoader, Error, TEXT("Can't mount %s: a virtual pak must be named *.pak"), *PakFilePath);
+		return false;
+	}
+	VirtualPakPlatformFile->Register(PakFilePath, Source);
+	if (!MountPakFile(PakFilePath, Result))
+	{
+		VirtualPakPlatformFile->Unregister(PakFilePath);
+		return false;
+	}
+	return true;
+}
+
+bool FPakLoaderModule::MountChunkedPak(const FString& PakFilePath)
+{
+	FPakChunkStore& Store = FPakChunkStore::Get();
+	FPakCacheEntry Entry;
+	if (!FPakDownloadCache::Get().FindByFilename(PakFilePath, Entry))
+	{
+		return false;
+	}
+	FPakDownloadCache::Get().Touch(Entry.Url);
+	const FPakChunkRecipe& Recipe = Entry.Recipe;
+	TArray<int32> Missing;
+	Store.GetMissingChunks(Recipe, Missing);
+	if (Missing.Num() > 0)
+	{
+		UE_LOG(PakLoader, Error, TEXT("%d chunks of %s are missing from the download cache"), Missing.Num(), *PakFilePath);
+		return false;
+	}
+	if (VirtualPakPlatformFile != nullptr)
+	{
+		VirtualPakPlatformFile->Register(PakFilePath, Store.CreateView(Recipe));
+		UE_LOG(PakLoader, Log, TEXT("Mounting %s as a view over %d chunks"), *PakFilePath, Recipe.Chunks.Num());
+		return true;
+	}
+	UE_LOG(PakLoader, Warning, TEXT("No virtual pak layer - writing %s out in full next to its chunks"), *PakFilePath);
+	return Store.Materialize(Recipe, PakFilePath);
+}
+
 bool FPakLoaderModule::GetAssetsFromPak(const FString& PakFilePath,
 	TFunction<void(TSharedPtr<TArray<FStringAssetReference>>)> AssetsLoadedCallback)
 {
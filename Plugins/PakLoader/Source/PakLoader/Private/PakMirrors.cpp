@@ -0,0 +1,152 @@
+// Copyright 1998-2016 Epic Games, Inc. All Rights Reserved.
+
+#include "PakLoaderPrivatePCH.h"
+#include "PakMirrors.h"
+
+/** Requests smaller than this measure latency rather than throughput */
+static const int64 LatencySampleBytes = 64 * 1024;
+/** Weight of a new sample in the smoothed stats */
+static const double SampleWeight = 0.3;
+/** What an untried mirror is assumed to do, optimistic enough that it gets tried */
+static const double DefaultLatency = 0.2;
+static const double DefaultBytesPerSecond = 1024.0 * 1024.0;
+
+FPakMirrors& FPakMirrors::Get()
+{
+	static FPakMirrors PakMirrors;
+	return PakMirrors;
+}
+
+FPakMirrors::FPakMirrors()
+	: BackoffSeconds(1)
+	, MaxBackoffSeconds(60)
+	, MaxAttempts(4)
+{
+	float ConfigBackoff = BackoffSeconds;
+	float ConfigMaxBackoff = MaxBackoffSeconds;
+	GConfig->GetFloat(TEXT("PakLoader"), TEXT("MirrorBackoffSeconds"), ConfigBackoff, GGameIni);
+	GConfig->GetFloat(TEXT("PakLoader"), TEXT("MirrorMaxBackoffSeconds"), ConfigMaxBackoff, GGameIni);
+	GConfig->GetInt(TEXT("PakLoader"), TEXT("MaxMirrorAttempts"), MaxAttempts, GGameIni);
+	BackoffSeconds = FMath::Max(ConfigBackoff, 0.0f);
+	MaxBackoffSeconds = FMath::Max(ConfigMaxBackoff, ConfigBackoff);
+	MaxAttempts = FMath::Max(MaxAttempts, 1);
+}
+
+FString FPakMirrors::GetOrigin(const FString& Url)
+{
+	const int32 SchemeEnd = Url.Find(TEXT("://"));
+	const int32 HostStart = SchemeEnd == INDEX_NONE ? 0 : SchemeEnd + 3;
+	const int32 PathStart = Url.Find(TEXT("/"), ESearchCase::CaseSensitive, ESearchDir::FromStart, HostStart);
+	return PathStart == INDEX_NONE ? Url : Url.Left(PathStart);
+}
+
+void FPakMirrors::Resolve(const FString& Url, TArray<FString>& OutUrls) const
+{
+	OutUrls.Reset();
+	const FString Prefix = TEXT("mirror://");
+	const int32 GroupEnd = Url.StartsWith(Prefix) ? Url.Find(TEXT("/"), ESearchCase::CaseSensitive, ESearchDir::FromStart, Prefix.Len()) : INDEX_NONE;
+	if (GroupEnd == INDEX_NONE)
+	{
+		OutUrls.Add(Url);
+		return;
+	}
+	const FString Group = Url.Mid(Prefix.Len(), GroupEnd - Prefix.Len());
+	const FString Path = Url.Mid(GroupEnd + 1);
+	TArray<FString> Bases;
+	GConfig->GetArray(TEXT("PakLoader.Mirrors"), *Group, Bases, GGameIni);
+	for (const FString& Base : Bases)
+	{
+		OutUrls.Add(Base.EndsWith(TEXT("/")) ? Base + Path : Base + TEXT("/") + Path);
+	}
+	if (OutUrls.Num() == 0)
+	{
+		UE_LOG(PakLoader, Error, TEXT("No mirrors configured for group %s in [PakLoader.Mirrors]"), *Group);
+	}
+}
+
+double FPakMirrors::GetExpectedSeconds(const FMirrorStats& Stats, int64 Bytes) const
+{
+	const double Latency = Stats.Latency > 0 ? Stats.Latency : DefaultLatency;
+	const double BytesPerSecond = Stats.BytesPerSecond > 0 ? Stats.BytesPerSecond : DefaultBytesPerSecond;
+	return Latency + Bytes / BytesPerSecond;
+}
+
+int32 FPakMirrors::Choose(const TArray<FString>& Urls, int64 Bytes, float& OutWaitSeconds, int32 Exclude) const
+{
+	FScopeLock ScopedLock(&MirrorsCritical);
+	const double Now = FPlatformTime::Seconds();
+	int32 Best = INDEX_NONE;
+	double BestSeconds = 0;
+	int32 Soonest = INDEX_NONE;
+	double SoonestBack = 0;
+	for (int32 Index = 0; Index < Urls.Num(); Index++)
+	{
+		if (Index == Exclude && Urls.Num() > 1)
+		{
+			continue;
+		}
+		const FMirrorStats* Found = Mirrors.Find(GetOrigin(Urls[Index]));
+		const FMirrorStats Stats = Found != nullptr ? *Found : FMirrorStats();
+		if (Stats.BackoffUntil > Now)
+		{
+			if (Soonest == INDEX_NONE || Stats.BackoffUntil < SoonestBack)
+			{
+				Soonest = Index;
+				SoonestBack = Stats.BackoffUntil;
+			}
+			continue;
+		}
+		const double Seconds = GetExpectedSeconds(Stats, Bytes);
+		if (Best == INDEX_NONE || Seconds < BestSeconds)
+		{
+			Best = Index;
+			BestSeconds = Seconds;
+		}
+	}
+	OutWaitSeconds = 0;
+	if (Best == INDEX_NONE && Soonest != INDEX_NONE)
+	{
+		OutWaitSeconds = SoonestBack - Now;
+		return Soonest;
+	}
+	return Best;
+}
+
+void FPakMirrors::RecordTransfer(const FString& Url, double Seconds, int64 Bytes)
+{
+	FScopeLock ScopedLock(&MirrorsCritical);
+	FMirrorStats& Stats = Mirrors.FindOrAdd(GetOrigin(Url));
+	Stats.Failures = 0;
+	Stats.BackoffUntil = 0;
+	if (Seconds <= 0)
+	{
+		return;
+	}
+	if (Bytes < LatencySampleBytes)
+	{
+		Stats.Latency = Stats.Latency > 0 ? FMath::Lerp(Stats.Latency, Seconds, SampleWeight) : Seconds;
+	}
+	else
+	{
+		const double BytesPerSecond = Bytes / Seconds;
+		Stats.BytesPerSecond = Stats.BytesPerSecond > 0 ? FMath::Lerp(Stats.BytesPerSecond, BytesPerSecond, SampleWeight) : BytesPerSecond;
+	}
+}
+
+void FPakMirrors::RecordFailure(const FString& Url)
+{
+	FScopeLock ScopedLock(&MirrorsCritical);
+	const FString Origin = GetOrigin(Url);
+	FMirrorStats& Stats = Mirrors.FindOrAdd(Origin);
+	Stats.Failures++;
+	const double Backoff = FMath::Min(BackoffSeconds * FMath::Pow(2.0f, FMath::Min(Stats.Failures - 1, 16)), MaxBackoffSeconds);
+	Stats.BackoffUntil = FPlatformTime::Seconds() + Backoff;
+	UE_LOG(PakLoader, Warning, TEXT("Mirror %s failed %d time(s) in a row, skipping it for %.1fs"), *Origin, Stats.Failures, Backoff);
+}
+
+double FPakMirrors::GetBytesPerSecond(const FString& Url) const
+{
+	FScopeLock ScopedLock(&MirrorsCritical);
+	const FMirrorStats* Stats = Mirrors.Find(GetOrigin(Url));
+	return Stats != nullptr && Stats->BytesPerSecond > 0 ? Stats->BytesPerSecond : DefaultBytesPerSecond;
+}
@@ -0,0 +1,69 @@
+// Copyright 1998-2016 Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+#include "Engine.h"
+
+/**
+* Tracks how each download mirror performs and picks the best one for the next request.
+* Mirrors are told apart by origin (scheme, host and port). Latency is the smoothed time taken by small
+* requests and throughput the smoothed rate of large ones; a mirror that fails is skipped for a backoff
+* that doubles with each consecutive failure ([PakLoader] MirrorBackoffSeconds up to MirrorMaxBackoffSeconds).
+*
+* Mirror groups are listed in [PakLoader.Mirrors], one base URL per line:
+*   +cdn=https://eu.example.com/paks/
+*   +cdn=https://us.example.com/paks/
+* and "mirror://cdn/Level1.pak" then stands for Level1.pak on each of them.
+*/
+class FPakMirrors
+{
+public:
+	static FPakMirrors& Get();
+
+	/** Expands a mirror://<group>/<path> URL into one URL per mirror of the group; any other URL is returned as is */
+	void Resolve(const FString& Url, TArray<FString>& OutUrls) const;
+
+	/**
+	* Returns the index of the URL in Urls expected to deliver Bytes soonest, skipping Exclude (if there is another
+	* choice) and mirrors that are backing off. If they all are, returns the one that comes back first and sets
+	* OutWaitSeconds to how long that takes.
+	*/
+	int32 Choose(const TArray<FString>& Urls, int64 Bytes, float& OutWaitSeconds, int32 Exclude = INDEX_NONE) const;
+
+	/** Adds a completed request (or the part of one received so far) to the stats of its mirror */
+	void RecordTransfer(const FString& Url, double Seconds, int64 Bytes);
+
+	void RecordFailure(const FString& Url);
+
+	/** Smoothed throughput of the mirror serving Url; the optimistic default for a mirror with no throughput samples yet */
+	double GetBytesPerSecond(const FString& Url) const;
+
+	/** Scheme, host and port of Url */
+	static FString GetOrigin(const FString& Url);
+
+	/** How many times a download may fail over before giving up */
+	int32 GetMaxAttempts() const
+	{
+		return MaxAttempts;
+	}
+
+private:
+	FPakMirrors();
+
+	struct FMirrorStats
+	{
+		double Latency;
+		double BytesPerSecond;
+		int32 Failures;
+		double BackoffUntil;
+
+		FMirrorStats() : Latency(0), BytesPerSecond(0), Failures(0), BackoffUntil(0) {}
+	};
+
+	double GetExpectedSeconds(const FMirrorStats& Stats, int64 Bytes) const;
+
+	mutable FCriticalSection MirrorsCritical;
+	TMap<FString, FMirrorStats> Mirrors;
+	double BackoffSeconds;
+	double MaxBackoffSeconds;
+	int32 MaxAttempts;
+};
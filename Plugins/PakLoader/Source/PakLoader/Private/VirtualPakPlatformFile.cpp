@@ -0,0 +1,196 @@
+// Copyright 1998-2016 Epic Games, Inc. All Rights Reserved.
+
+#include "PakLoaderPrivatePCH.h"
+#include "VirtualPakPlatformFile.h"
+
+/**
+* Read-only handle over a virtual pak source
+*/
+class FVirtualPakFileHandle : public IFileHandle
+{
+	FVirtualPakSourcePtr Source;
+	int64 Position;
+public:
+	FVirtualPakFileHandle(const FVirtualPakSourcePtr& InSource) : Source(InSource), Position(0) {}
+
+	virtual int64 Tell() override
+	{
+		return Position;
+	}
+	virtual bool Seek(int64 NewPosition) override
+	{
+		if (NewPosition < 0 || NewPosition > Source->GetSize())
+		{
+			return false;
+		}
+		Position = NewPosition;
+		return true;
+	}
+	virtual bool SeekFromEnd(int64 NewPositionRelativeToEnd = 0) override
+	{
+		return Seek(Source->GetSize() + NewPositionRelativeToEnd);
+	}
+	virtual bool Read(uint8* Destination, int64 BytesToRead) override
+	{
+		if (Position + BytesToRead > Source->GetSize() || !Source->Read(Position, Destination, BytesToRead))
+		{
+			return false;
+		}
+		Position += BytesToRead;
+		return true;
+	}
+	virtual bool Write(const uint8* Data, int64 BytesToWrite) override
+	{
+		return false;
+	}
+	virtual int64 Size() override
+	{
+		return Source->GetSize();
+	}
+};
+
+FString FVirtualPakPlatformFile::MakeKey(const TCHAR* Filename)
+{
+	FString Key = FPaths::ConvertRelativePathToFull(Filename);
+	FPaths::NormalizeFilename(Key);
+	return Key;
+}
+
+void FVirtualPakPlatformFile::Register(const FString& Filename, const FVirtualPakSourcePtr& Source)
+{
+	FScopeLock ScopedLock(&SourcesCritical);
+	Sources.Add(MakeKey(*Filename), Source);
+}
+
+void FVirtualPakPlatformFile::Unregister(const FString& Filename)
+{
+	FScopeLock ScopedLock(&SourcesCritical);
+	Sources.Remove(MakeKey(*Filename));
+}
+
+bool FVirtualPakPlatformFile::IsRegistered(const FString& Filename) const
+{
+	return Find(*Filename).IsValid();
+}
+
+FVirtualPakSourcePtr FVirtualPakPlatformFile::Find(const TCHAR* Filename) const
+{
+	// Only paks are registered: spare other files the path conversion and the lock
+	static const int32 ExtensionLen = 4;
+	const int32 Len = FCString::Strlen(Filename);
+	if (Len < ExtensionLen || FCString::Stricmp(Filename + Len - ExtensionLen, TEXT(".pak")) != 0)
+	{
+		return nullptr;
+	}
+	FScopeLock ScopedLock(&SourcesCritical);
+	if (Sources.Num() == 0)
+	{
+		return nullptr;
+	}
+	const FVirtualPakSourcePtr* Source = Sources.Find(MakeKey(Filename));
+	return Source != nullptr ? *Source : nullptr;
+}
+
+bool FVirtualPakPlatformFile::FileExists(const TCHAR* Filename)
+{
+	return Find(Filename).IsValid() || LowerLevel->FileExists(Filename);
+}
+
+int64 FVirtualPakPlatformFile::FileSize(const TCHAR* Filename)
+{
+	FVirtualPakSourcePtr Source = Find(Filename);
+	return Source.IsValid() ? Source->GetSize() : LowerLevel->FileSize(Filename);
+}
+
+bool FVirtualPakPlatformFile::DeleteFile(const TCHAR* Filename)
+{
+	return Find(Filename).IsValid() ? false : LowerLevel->DeleteFile(Filename);
+}
+
+bool FVirtualPakPlatformFile::IsReadOnly(const TCHAR* Filename)
+{
+	return Find(Filename).IsValid() || LowerLevel->IsReadOnly(Filename);
+}
+
+bool FVirtualPakPlatformFile::MoveFile(const TCHAR* To, const TCHAR* From)
+{
+	return Find(From).IsValid() ? false : LowerLevel->MoveFile(To, From);
+}
+
+bool FVirtualPakPlatformFile::SetReadOnly(const TCHAR* Filename, bool bNewReadOnlyValue)
+{
+	return Find(Filename).IsValid() ? bNewReadOnlyValue : LowerLevel->SetReadOnly(Filename, bNewReadOnlyValue);
+}
+
+FDateTime FVirtualPakPlatformFile::GetTimeStamp(const TCHAR* Filename)
+{
+	return Find(Filename).IsValid() ? FDateTime::MinValue() : LowerLevel->GetTimeStamp(Filename);
+}
+
+void FVirtualPakPlatformFile::SetTimeStamp(const TCHAR* Filename, FDateTime DateTime)
+{
+	if (!Find(Filename).IsValid())
+	{
+		LowerLevel->SetTimeStamp(Filename, DateTime);
+	}
+}
+
+FDateTime FVirtualPakPlatformFile::GetAccessTimeStamp(const TCHAR* Filename)
+{
+	return Find(Filename).IsValid() ? FDateTime::MinValue() : LowerLevel->GetAccessTimeStamp(Filename);
+}
+
+FString FVirtualPakPlatformFile::GetFilenameOnDisk(const TCHAR* Filename)
+{
+	return Find(Filename).IsValid() ? FString(Filename) : LowerLevel->GetFilenameOnDisk(Filename);
+}
+
+IFileHandle* FVirtualPakPlatformFile::OpenRead(const TCHAR* Filename, bool bAllowWrite)
+{
+	FVirtualPakSourcePtr Source = Find(Filename);
+	if (Source.IsValid())
+	{
+		return bAllowWrite ? nullptr : new FVirtualPakFileHandle(Source);
+	}
+	return LowerLevel->OpenRead(Filename, bAllowWrite);
+}
+
+IFileHandle* FVirtualPakPlatformFile::OpenWrite(const TCHAR* Filename, bool bAppend, bool bAllowRead)
+{
+	return Find(Filename).IsValid() ? nullptr : LowerLevel->OpenWrite(Filename, bAppend, bAllowRead);
+}
+
+bool FVirtualPakPlatformFile::DirectoryExists(const TCHAR* Directory)
+{
+	return LowerLevel->DirectoryExists(Directory);
+}
+
+bool FVirtualPakPlatformFile::CreateDirectory(const TCHAR* Directory)
+{
+	return LowerLevel->CreateDirectory(Directory);
+}
+
+bool FVirtualPakPlatformFile::DeleteDirectory(const TCHAR* Directory)
+{
+	return LowerLevel->DeleteDirectory(Directory);
+}
+
+FFileStatData FVirtualPakPlatformFile::GetStatData(const TCHAR* FilenameOrDirectory)
+{
+	FVirtualPakSourcePtr Source = Find(FilenameOrDirectory);
+	if (Source.IsValid())
+	{
+		return FFileStatData(FDateTime::MinValue(), FDateTime::MinValue(), FDateTime::MinValue(), Source->GetSize(), false, true);
+	}
+	return LowerLevel->GetStatData(FilenameOrDirectory);
+}
+
+bool FVirtualPakPlatformFile::IterateDirectory(const TCHAR* Directory, IPlatformFile::FDirectoryVisitor& Visitor)
+{
+	return LowerLevel->IterateDirectory(Directory, Visitor);
+}
+
+bool FVirtualPakPlatformFile::IterateDirectoryStat(const TCHAR* Directory, IPlatformFile::FDirectoryStatVisitor& Visitor)
+{
+	return LowerLevel->IterateDirectoryStat(Directory, Visitor);
+}
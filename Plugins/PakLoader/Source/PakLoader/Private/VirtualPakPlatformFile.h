@@ -0,0 +1,123 @@
+// Copyright 1998-2016 Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+#include "Engine.h"
+
+/**
+* Backing storage for a pak file that doesn't exist as a single file on disk.
+* Read may be called from any thread.
+*/
+class IVirtualPakSource
+{
+public:
+	virtual ~IVirtualPakSource() {}
+	virtual int64 GetSize() const = 0;
+	virtual bool Read(int64 Offset, uint8* Dest, int64 BytesToRead) = 0;
+};
+
+typedef TSharedPtr<IVirtualPakSource, ESPMode::ThreadSafe> FVirtualPakSourcePtr;
+
+/**
+* A pak held entirely in memory, for small paks that aren't worth a round trip through the disk
+*/
+class FMemoryPakSource : public IVirtualPakSource
+{
+public:
+	FMemoryPakSource(TArray<uint8>&& InData) : Data(MoveTemp(InData)) {}
+
+	const TArray<uint8>& GetData() const
+	{
+		return Data;
+	}
+
+	//~ Begin IVirtualPakSource Interface
+	virtual int64 GetSize() const override
+	{
+		return Data.Num();
+	}
+	virtual bool Read(int64 Offset, uint8* Dest, int64 BytesToRead) override
+	{
+		if (Offset < 0 || BytesToRead < 0 || Offset + BytesToRead > Data.Num())
+		{
+			return false;
+		}
+		FMemory::Memcpy(Dest, Data.GetData() + Offset, BytesToRead);
+		return true;
+	}
+	//~ End IVirtualPakSource Interface
+
+private:
+	const TArray<uint8> Data;
+};
+
+/**
+* Platform file layer that sits directly below the FPakPlatformFile, whether the loader created that or found it
+* already mounting the build's own paks, and exposes registered virtual paks as read-only files. Everything else is
+* passed through to the lower level.
+*/
+class FVirtualPakPlatformFile : public IPlatformFile
+{
+public:
+	static const TCHAR* GetTypeName()
+	{
+		return TEXT("VirtualPakFile");
+	}
+
+	FVirtualPakPlatformFile() : LowerLevel(nullptr) {}
+
+	/** Makes Filename (a .pak) readable through this layer. Replaces any previous source for Filename. */
+	void Register(const FString& Filename, const FVirtualPakSourcePtr& Source);
+	void Unregister(const FString& Filename);
+	bool IsRegistered(const FString& Filename) const;
+
+	//~ Begin IPlatformFile Interface
+	virtual bool ShouldBeUsed(IPlatformFile* Inner, const TCHAR* CmdLine) const override
+	{
+		return false;
+	}
+	virtual bool Initialize(IPlatformFile* Inner, const TCHAR* CmdLine) override
+	{
+		LowerLevel = Inner;
+		return LowerLevel != nullptr;
+	}
+	virtual IPlatformFile* GetLowerLevel() override
+	{
+		return LowerLevel;
+	}
+	virtual void SetLowerLevel(IPlatformFile* NewLowerLevel) override
+	{
+		LowerLevel = NewLowerLevel;
+	}
+	virtual const TCHAR* GetName() const override
+	{
+		return GetTypeName();
+	}
+	virtual bool FileExists(const TCHAR* Filename) override;
+	virtual int64 FileSize(const TCHAR* Filename) override;
+	virtual bool DeleteFile(const TCHAR* Filename) override;
+	virtual bool IsReadOnly(const TCHAR* Filename) override;
+	virtual bool MoveFile(const TCHAR* To, const TCHAR* From) override;
+	virtual bool SetReadOnly(const TCHAR* Filename, bool bNewReadOnlyValue) override;
+	virtual FDateTime GetTimeStamp(const TCHAR* Filename) override;
+	virtual void SetTimeStamp(const TCHAR* Filename, FDateTime DateTime) override;
+	virtual FDateTime GetAccessTimeStamp(const TCHAR* Filename) override;
+	virtual FString GetFilenameOnDisk(const TCHAR* Filename) override;
+	virtual IFileHandle* OpenRead(const TCHAR* Filename, bool bAllowWrite = false) override;
+	virtual IFileHandle* OpenWrite(const TCHAR* Filename, bool bAppend = false, bool bAllowRead = false) override;
+	virtual bool DirectoryExists(const TCHAR* Directory) override;
+	virtual bool CreateDirectory(const TCHAR* Directory) override;
+	virtual bool DeleteDirectory(const TCHAR* Directory) override;
+	virtual FFileStatData GetStatData(const TCHAR* FilenameOrDirectory) override;
+	virtual bool IterateDirectory(const TCHAR* Directory, IPlatformFile::FDirectoryVisitor& Visitor) override;
+	virtual bool IterateDirectoryStat(const TCHAR* Directory, IPlatformFile::FDirectoryStatVisitor& Visitor) override;
+	//~ End IPlatformFile Interface
+
+private:
+	static FString MakeKey(const TCHAR* Filename);
+	/** Every file operation below the pak platform file comes through here; anything but a .pak returns right away */
+	FVirtualPakSourcePtr Find(const TCHAR* Filename) const;
+
+	IPlatformFile* LowerLevel;
+	mutable FCriticalSection SourcesCritical;
+	TMap<FString, FVirtualPakSourcePtr> Sources;
+};
@@ -0,0 +1,207 @@
+// Copyright 1998-2016 Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+#include "Engine.h"
+#include "IHttpRequest.h"
+#include "Kismet/BlueprintAsyncActionBase.h"
+#include "PakChunks.h"
+#include "DownloadStats.h"
+
+#include "AsyncTaskDownloadPak.generated.h"
+
+/**
+* Note: adapted from UAsyncTaskDownloadImage
+*/
+
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FDownloadPakDelegate, const FString&, LocalFilename);
+
+/** How DownloadPak treats a pak that is already in the download cache */
+UENUM(BlueprintType)
+enum class EPakCachePolicy : uint8
+{
+	/** Ask the server (conditional GET) before succeeding */
+	AlwaysRevalidate,
+	/**
+	* Succeed with the cached pak straight away. Unless it is still fresh (Cache-Control max-age), revalidate it in the
+	* background; OnUpdated fires and the new content is cached for next time if the server has a newer version.
+	*/
+	StaleWhileRevalidate
+};
+
+/** Chunks FirstChunk..LastChunk of a pak, fetched with one range request */
+struct FPakChunkRange
+{
+	int32 FirstChunk;
+	int32 LastChunk;
+};
+
+/** A range request in flight, kept so a slow one can be moved to a faster mirror */
+struct FPakRangeRequest
+{
+	TSharedPtr<IHttpRequest> Request;
+	int32 LastChunk;
+	int32 Mirror;
+	double StartTime;
+	/** Responses to earlier attempts at the same range are ignored */
+	int32 Attempt;
+};
+
+UCLASS()
+class PAKLOADER_API UAsyncTaskDownloadPak : public UBlueprintAsyncActionBase
+{
+	GENERATED_UCLASS_BODY()
+
+public:
+	/** URL may also name a mirror group as mirror://<group>/<path>, see FPakMirrors */
+	UFUNCTION(BlueprintCallable, meta = (BlueprintInternalUseOnly = "true"))
+		static UAsyncTaskDownloadPak* DownloadPak(const FString& URL, bool CheckForUpdateOnly, EPakCachePolicy CachePolicy = EPakCachePolicy::AlwaysRevalidate);
+
+	/**
+	* Downloads a pak published on several mirrors. Each request goes to the mirror expected to serve it fastest,
+	* failed requests are retried on another one, and a range that is going slowly is moved to a faster mirror.
+	* The pak is cached under the first URL.
+	*/
+	UFUNCTION(BlueprintCallable, meta = (BlueprintInternalUseOnly = "true"))
+		static UAsyncTaskDownloadPak* DownloadPakFromMirrors(const TArray<FString>& MirrorURLs, bool CheckForUpdateOnly, EPakCachePolicy CachePolicy = EPakCachePolicy::AlwaysRevalidate);
+
+	/**
+	* Downloads a pak in the background: requests are issued one at a time when the download scheduler allows,
+	* so prefetching yields to foreground transfers and hitch-sensitive sections and stays within the
+	* background bandwidth and disk write budgets.
+	*/
+	UFUNCTION(BlueprintCallable, meta = (BlueprintInternalUseOnly = "true"))
+		static UAsyncTaskDownloadPak* PrefetchPak(const FString& URL);
+
+public:
+
+	UPROPERTY(BlueprintAssignable)
+		FDownloadPakDelegate OnSuccess;
+
+	UPROPERTY(BlueprintAssignable)
+		FDownloadPakDelegate OnFail;
+
+	UPROPERTY(BlueprintAssignable)
+		FDownloadPakDelegate OnUpdated;
+
+	UPROPERTY(BlueprintAssignable)
+		FDownloadProgressDelegate OnProgress;
+
+	/** Native counterparts of OnSuccess/OnFail and OnProgress, for C++ callers juggling several downloads */
+	TFunction<void(bool bSucceeded, const FString& Result)> OnFinished;
+	TFunction<void(int64 Received, int64 Total)> OnBytesProgress;
+
+public:
+
+	void Start(FString URL);
+
+	static void GetDownloadFilename(const FString& Url, FString& PakFilename);
+
+	/**
+	* Returns the SHA1 (hex) of the cached pak downloaded from Url, computed while it was downloaded
+	* (or taken from the server manifest), so validating the cache never re-reads the pak.
+	*/
+	static bool GetCachedPakHash(const FString& Url, FString& OutHash);
+
+	/** Makes Recipe the cached content of the pak downloaded from URL. Does file I/O, so keep it off the game thread. */
+	static bool CommitRecipe(const FString& URL, const FPakChunkRecipe& Recipe, const FString& ETag, const FString& LastModified, const FDateTime& ExpiresAt);
+private:
+	bool bCheckForUpdateOnly;
+	bool bBackground;
+	EPakCachePolicy CachePolicy;
+	/** OnSuccess was already broadcast with the cached pak; this is the background revalidation */
+	bool bRevalidating;
+	/** The URL the pak is cached under */
+	FString PakURL;
+	/** Where the pak can be downloaded from */
+	TArray<FString> MirrorURLs;
+	int32 MirrorIndex;
+	int32 FailedAttempts;
+	/** Asks the server for the pak (or its chunk manifest) */
+	void RequestPak(const FString& URL);
+	/** Points GetMirrorURL at the mirror expected to serve Bytes soonest */
+	void SelectMirror(int64 Bytes);
+	const FString& GetMirrorURL() const
+	{
+		return MirrorURLs[MirrorIndex];
+	}
+	/**
+	* Records that the request to FailedURL failed and, if another attempt is allowed, runs Retry once a mirror
+	* is available. Returns false if the download should fail instead.
+	*/
+	bool FailOver(const FString& FailedURL, TFunction<void()> Retry);
+	/** Reissues the range request for FirstChunk on a faster mirror if the current one is much slower */
+	void MoveSlowRange(int32 FirstChunk, int32 BytesReceived);
+	/** Requests the whole pak with If-None-Match (a slice at a time in the background) */
+	void StartFullDownload(const FString& URL);
+	/** Handles Pak requests coming from the web */
+	void HandlePakRequest(FHttpRequestPtr HttpRequest, FHttpResponsePtr HttpResponse, bool bSucceeded);
+	/** Handles the "<URL>.chunks" manifest listing the chunks of the pak on the server */
+	void HandleChunkManifestRequest(FHttpRequestPtr HttpRequest, FHttpResponsePtr HttpResponse, bool bSucceeded, FString URL);
+	/** Handles a range request for chunks FirstChunk..LastChunk of ServerRecipe */
+	void HandleChunkRangeRequest(FHttpRequestPtr HttpRequest, FHttpResponsePtr HttpResponse, bool bSucceeded, FString URL, int32 FirstChunk, int32 LastChunk, int32 Attempt);
+	/** Issues the range request for chunks FirstChunk..LastChunk of ServerRecipe, to Mirror or the best one */
+	void RequestChunkRange(const FString& URL, int32 FirstChunk, int32 LastChunk, int32 Mirror = INDEX_NONE);
+	/** Requests the next slice of a background download */
+	void RequestPakSlice(const FString& URL);
+	void HandlePakSliceRequest(FHttpRequestPtr HttpRequest, FHttpResponsePtr HttpResponse, bool bSucceeded, FString URL);
+	/** Issues the next queued background request once the download scheduler allows it */
+	bool PumpBackgroundRequests(float DeltaTime);
+	void StartBackgroundPump(const FString& URL);
+	void StopBackgroundPump();
+	/** Holds a background response back until the current hitch-sensitive section ends. Returns false if there is none. */
+	bool DeferWhileHitchSensitive(TFunction<void()> Write);
+	void HandlePakRequestProgress(FHttpRequestPtr HttpRequest, int32 BytesSent, int32 BytesReceived);
+	void HandleChunkRangeProgress(FHttpRequestPtr HttpRequest, int32 BytesSent, int32 BytesReceived, int32 FirstChunk);
+	/** Broadcasts OnProgress if an event is due */
+	void ReportProgress(int64 Received, int64 Total, bool bForce = false);
+	/** Issues range requests for the Missing chunks of ServerRecipe */
+	void RequestMissingChunks(const FString& URL, const TArray<int32>& Missing);
+	/**
+	* Runs Work (file I/O) on a task thread, then Then on the game thread with the error Work returned (empty on success).
+	* The task stays rooted until it has finished, so it outlives its I/O.
+	*/
+	void RunOnIOThread(TFunction<FString()> Work, TFunction<void(const FString&)> Then);
+	/** Unroots the task and records how much game thread time it took */
+	void Finish(const FString& URL);
+	void Succeed(const FString& URL);
+	void Fail(const FString& URL, const FString& Message);
+
+	FPakChunkRecipe ServerRecipe;
+	/** The server recipe while its chunks are pinned in the chunk store, from the check for missing chunks until Finish */
+	FPakChunkRecipe PinnedRecipe;
+	TArray<int64> ServerOffsets;
+	int32 PendingRanges;
+	bool bRangeError;
+	/** In-flight range requests, by first chunk */
+	TMap<int32, FPakRangeRequest> InFlightRanges;
+	int32 RangeAttempts;
+
+	FDownloadProgress Progress;
+	/** Bytes received by the current full download request, which the HTTP module reports wrapped at 4GB */
+	int64 RequestReceived;
+	/** Game thread time spent on this download */
+	FGameThreadTimer GameThreadTimer;
+	/** Bytes received by each in-flight range request, by first chunk */
+	TMap<int32, int32> RangeBytesReceived;
+	int64 CompletedRangeBytes;
+	int64 TotalRangeBytes;
+
+	/** Background requests waiting for the scheduler */
+	TArray<FPakChunkRange> QueuedRanges;
+	bool bSliceQueued;
+	bool bBackgroundRequestInFlight;
+	TArray<TFunction<void()>> DeferredWrites;
+	FString BackgroundURL;
+	FDelegateHandle PumpHandle;
+	bool bPumping;
+	EDownloadThrottleReason ThrottleReason;
+	double ThrottleStart;
+
+	/** Background download of the whole pak */
+	TUniquePtr<FPakChunker> SliceChunker;
+	int64 SliceOffset;
+	int64 SliceTotal;
+	FString SliceETag;
+	FString SliceLastModified;
+	FDateTime SliceExpiresAt;
+};
@@ -0,0 +1,31 @@
+// Copyright 1998-2016 Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+#include "Engine.h"
+#include "IHttpResponse.h"
+
+/**
+* Decodes HTTP bodies sent with a Content-Encoding (gzip, and zstd when built WITH_ZSTD), a bounded buffer at
+* a time, so the decoded content can be streamed to disk without ever being held in memory as a whole.
+*/
+class PAKLOADER_API FContentDecoder
+{
+public:
+	/** Receives the next Size decoded bytes; returns false to abort decoding */
+	typedef TFunctionRef<bool(const uint8* Data, int64 Size)> FSink;
+
+	/** Value of the Accept-Encoding header for requests whose body can be decoded */
+	static const TCHAR* GetAcceptEncoding();
+
+	/**
+	* Decodes Size bytes of a body sent with the given Content-Encoding into Sink.
+	* Returns false if the encoding is unsupported, the body is corrupt or Sink failed.
+	*/
+	static bool Decode(const FString& ContentEncoding, const uint8* Data, int64 Size, FSink Sink, int64& OutDecodedSize);
+
+	/**
+	* Returns true with the size of Response's body in OutSize, or false (and logs) if the body is truncated:
+	* shorter or longer than a non-zero Content-Length.
+	*/
+	static bool GetBodySize(const FString& Url, const IHttpResponse& Response, int64& OutSize);
+};
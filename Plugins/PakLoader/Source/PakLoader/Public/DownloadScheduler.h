@@ -0,0 +1,115 @@
+// Copyright 1998-2016 Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+#include "Engine.h"
+#include "Kismet/BlueprintFunctionLibrary.h"
+
+#include "DownloadScheduler.generated.h"
+
+/** Why a background transfer is being held back */
+enum class EDownloadThrottleReason : uint8
+{
+	None,
+	/** A foreground transfer is in flight */
+	Foreground,
+	/** Gameplay flagged a hitch-sensitive section */
+	HitchSensitive,
+	/** Background bandwidth budget exhausted */
+	Bandwidth,
+	/** Background disk write budget exhausted */
+	DiskWrite
+};
+
+PAKLOADER_API const TCHAR* GetThrottleReasonName(EDownloadThrottleReason Reason);
+
+/**
+* Token bucket refilled at Rate per second up to Burst. Tokens may go negative, so a request larger than the
+* burst still goes through and the bucket then has to refill before the next one; the average rate holds.
+*/
+class PAKLOADER_API FTokenBucket
+{
+public:
+	FTokenBucket();
+
+	/** BytesPerSecond <= 0 means unlimited */
+	void SetRate(double BytesPerSecond, double BurstBytes);
+
+	bool HasTokens();
+	void Consume(int64 Bytes);
+
+private:
+	double Rate;
+	double Burst;
+	double Tokens;
+	double LastRefill;
+};
+
+/**
+* Decides when background (prefetch) transfers may issue their next request. Background transfers yield to
+* foreground transfers and hitch-sensitive gameplay sections, and are held to [PakLoader] BackgroundMaxKBps
+* of bandwidth and BackgroundMaxWriteKBps of disk writes (0 for no limit).
+*/
+class PAKLOADER_API FDownloadScheduler
+{
+public:
+	static FDownloadScheduler& Get();
+
+	void BeginForegroundTransfer();
+	void EndForegroundTransfer();
+
+	void BeginHitchSensitiveSection();
+	void EndHitchSensitiveSection();
+
+	bool IsHitchSensitive() const
+	{
+		return HitchSensitiveSections.GetValue() > 0;
+	}
+
+	/** Size of the requests background transfers split full downloads into */
+	int64 GetBackgroundSliceSize() const
+	{
+		return SliceSize;
+	}
+
+	/**
+	* Returns why a background request of Bytes can't be issued now, or None after charging it to the
+	* bandwidth and disk write budgets.
+	*/
+	EDownloadThrottleReason AcquireBackgroundTransfer(int64 Bytes);
+
+private:
+	FDownloadScheduler();
+
+	FThreadSafeCounter ForegroundTransfers;
+	FThreadSafeCounter HitchSensitiveSections;
+	FTokenBucket Network;
+	FTokenBucket DiskWrite;
+	int64 SliceSize;
+};
+
+/** Holds background downloads back for the lifetime of the scope */
+struct FScopedHitchSensitiveSection
+{
+	FScopedHitchSensitiveSection()
+	{
+		FDownloadScheduler::Get().BeginHitchSensitiveSection();
+	}
+	~FScopedHitchSensitiveSection()
+	{
+		FDownloadScheduler::Get().EndHitchSensitiveSection();
+	}
+};
+
+UCLASS()
+class PAKLOADER_API UDownloadSchedulerLibrary : public UBlueprintFunctionLibrary
+{
+	GENERATED_UCLASS_BODY()
+
+public:
+	/** Pauses background downloads until the matching EndHitchSensitiveSection */
+	UFUNCTION(BlueprintCallable, Category = "Download")
+		static void BeginHitchSensitiveSection();
+
+	UFUNCTION(BlueprintCallable, Category = "Download")
+		static void EndHitchSensitiveSection();
+};
@@ -0,0 +1,271 @@
+// Copyright 1998-2016 Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+#include "Engine.h"
+#include "Kismet/BlueprintFunctionLibrary.h"
+#include "DownloadScheduler.h"
+
+#include "DownloadStats.generated.h"
+
+/**
+* Progress of a download: TotalBytes is 0 and SecondsRemaining -1 while unknown. Blueprints have no int64, so byte counts
+* are clamped to MAX_int32 (2GB); C++ callers get the full counts from the downloads' native OnBytesProgress.
+*/
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_FourParams(FDownloadProgressDelegate, int32, BytesReceived, int32, TotalBytes, float, BytesPerSecond, float, SecondsRemaining);
+
+/**
+* Aggregate download statistics for the current session
+*/
+USTRUCT(BlueprintType)
+struct PAKLOADER_API FDownloadSessionStats
+{
+	GENERATED_USTRUCT_BODY()
+
+	/** Number of completed HTTP requests (including 304s and failures) */
+	UPROPERTY(BlueprintReadOnly, Category = "Download")
+		int32 Requests;
+
+	/** Requests answered with 304 Not Modified */
+	UPROPERTY(BlueprintReadOnly, Category = "Download")
+		int32 NotModified;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Download")
+		int32 Failures;
+
+	/** Requests that had to be issued again (e.g. a full download after failed range requests) */
+	UPROPERTY(BlueprintReadOnly, Category = "Download")
+		int32 Retries;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Download")
+		float MegabytesReceived;
+
+	/** Time spent in requests */
+	UPROPERTY(BlueprintReadOnly, Category = "Download")
+		float Seconds;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Download")
+		float AverageBytesPerSecond;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Download")
+		float PeakBytesPerSecond;
+
+	/** Fraction of requests answered with 304 Not Modified */
+	UPROPERTY(BlueprintReadOnly, Category = "Download")
+		float NotModifiedRate;
+
+	/** Bytes received with a gzip or zstd Content-Encoding... */
+	UPROPERTY(BlueprintReadOnly, Category = "Download")
+		float CompressedMegabytes;
+
+	/** ...and their size once decoded */
+	UPROPERTY(BlueprintReadOnly, Category = "Download")
+		float DecompressedMegabytes;
+
+	/** Times a background transfer was held back by the download scheduler */
+	UPROPERTY(BlueprintReadOnly, Category = "Download")
+		int32 ThrottleEvents;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Download")
+		float ThrottledSeconds;
+
+	/** Downloads that finished (successfully or not) */
+	UPROPERTY(BlueprintReadOnly, Category = "Download")
+		int32 Downloads;
+
+	/** Game thread time spent on downloads: total, and the worst single download */
+	UPROPERTY(BlueprintReadOnly, Category = "Download")
+		float GameThreadSeconds;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Download")
+		float MaxGameThreadSeconds;
+
+	/** Downloads that went over [PakLoader] GameThreadBudgetMs */
+	UPROPERTY(BlueprintReadOnly, Category = "Download")
+		int32 OverBudgetDownloads;
+
+	int64 BytesReceived;
+	int64 CompressedBytes;
+	int64 DecompressedBytes;
+
+	FDownloadSessionStats()
+		: Requests(0), NotModified(0), Failures(0), Retries(0), MegabytesReceived(0), Seconds(0)
+		, AverageBytesPerSecond(0), PeakBytesPerSecond(0), NotModifiedRate(0), CompressedMegabytes(0), DecompressedMegabytes(0)
+		, ThrottleEvents(0), ThrottledSeconds(0), Downloads(0), GameThreadSeconds(0), MaxGameThreadSeconds(0), OverBudgetDownloads(0)
+		, BytesReceived(0), CompressedBytes(0), DecompressedBytes(0)
+	{
+	}
+};
+
+/**
+* Tracks the progress of one download (which may span several HTTP requests): smoothed rate, ETA, and
+* whether a progress event is due, so listeners are notified at most every [PakLoader] ProgressIntervalSeconds.
+*/
+class PAKLOADER_API FDownloadProgress
+{
+public:
+	FDownloadProgress();
+
+	/** Restarts timing */
+	void Start();
+
+	/** Records that Received of Total bytes (Total <= 0 if unknown) have arrived. Returns true if a progress event is due. */
+	bool Update(int64 Received, int64 Total, bool bForce = false);
+
+	int64 GetReceived() const
+	{
+		return Received;
+	}
+	int64 GetTotal() const
+	{
+		return Total;
+	}
+	double GetBytesPerSecond() const
+	{
+		return BytesPerSecond;
+	}
+	double GetPeakBytesPerSecond() const
+	{
+		return PeakBytesPerSecond;
+	}
+	/** Returns the estimated time until the download completes, or -1 if unknown */
+	double GetSecondsRemaining() const;
+
+	/** Clamps a byte count for FDownloadProgressDelegate */
+	static int32 ToBlueprintBytes(int64 Bytes)
+	{
+		return (int32)FMath::Clamp<int64>(Bytes, 0, MAX_int32);
+	}
+
+	/**
+	* The HTTP module reports the bytes received as an int32, which wraps past 2GB: returns the full count,
+	* given the count (Previous) of the last progress event of the same request.
+	*/
+	static int64 UnwrapHttpBytes(int32 BytesReceived, int64 Previous)
+	{
+		const int64 Low = (uint32)BytesReceived;
+		int64 Result = (Previous & ~(int64)MAX_uint32) + Low;
+		if (Result < Previous)
+		{
+			Result += (int64)MAX_uint32 + 1;
+		}
+		return Result;
+	}
+
+private:
+	double Interval;
+	double StartTime;
+	double LastEventTime;
+	double LastSampleTime;
+	int64 LastSampleBytes;
+	int64 Received;
+	int64 Total;
+	double BytesPerSecond;
+	double PeakBytesPerSecond;
+};
+
+/**
+* Accumulates the game thread time spent on one download across all its callbacks. Scopes may nest.
+*/
+class PAKLOADER_API FGameThreadTimer
+{
+public:
+	FGameThreadTimer() : Seconds(0), StartTime(0), Depth(0) {}
+
+	double GetSeconds() const
+	{
+		return Seconds + (Depth > 0 ? FPlatformTime::Seconds() - StartTime : 0);
+	}
+
+	struct FScope
+	{
+		FScope(FGameThreadTimer& InTimer) : Timer(InTimer)
+		{
+			if (Timer.Depth++ == 0)
+			{
+				Timer.StartTime = FPlatformTime::Seconds();
+			}
+		}
+		~FScope()
+		{
+			if (--Timer.Depth == 0)
+			{
+				Timer.Seconds += FPlatformTime::Seconds() - Timer.StartTime;
+			}
+		}
+		FGameThreadTimer& Timer;
+	};
+
+private:
+	double Seconds;
+	double StartTime;
+	int32 Depth;
+};
+
+/**
+* Session-wide record of every download request, shared by the pak and file downloaders
+*/
+class PAKLOADER_API FDownloadStats
+{
+public:
+	static FDownloadStats& Get();
+
+	/** Records a completed request. ResponseCode is -1 if the request failed without a response. */
+	void RecordRequest(const FString& Url, int32 ResponseCode, int64 Bytes, double Seconds, double PeakBytesPerSecond = 0);
+
+	void RecordRetry(const FString& Url);
+
+	/** Records that a background transfer of Url was held back for Seconds */
+	void RecordThrottle(const FString& Url, EDownloadThrottleReason Reason, double Seconds);
+
+	/** Records the game thread time spent on a finished download and warns when it's over budget */
+	void RecordGameThreadTime(const FString& Url, double Seconds);
+
+	/** Records that a body of CompressedBytes sent with a Content-Encoding decoded to DecompressedBytes */
+	void RecordDecompression(const FString& Url, int64 CompressedBytes, int64 DecompressedBytes);
+
+	FDownloadSessionStats GetSessionStats() const;
+
+	/** Writes one line per request and throttling decision (the last [PakLoader] MaxStatsRecords of them) to Filename */
+	bool DumpToCsv(const FString& Filename) const;
+
+private:
+	FDownloadStats();
+
+	struct FRequestRecord
+	{
+		FDateTime Time;
+		/** "Request", "Throttle:<reason>" or "GameThread" */
+		FString Event;
+		FString Url;
+		int32 ResponseCode;
+		int64 Bytes;
+		double Seconds;
+		double PeakBytesPerSecond;
+	};
+
+	/** Adds Record to the ring, overwriting the oldest once it's full. Called with StatsCritical held. */
+	void AddRecord(const FRequestRecord& Record);
+
+	mutable FCriticalSection StatsCritical;
+	/** Ring of the most recent records: the oldest is at NextRecord once the ring is full */
+	TArray<FRequestRecord> Records;
+	int32 NextRecord;
+	int32 MaxRecords;
+	/** Records overwritten since the session started */
+	int64 DroppedRecords;
+	FDownloadSessionStats Session;
+};
+
+UCLASS()
+class PAKLOADER_API UDownloadStatsLibrary : public UBlueprintFunctionLibrary
+{
+	GENERATED_UCLASS_BODY()
+
+public:
+	UFUNCTION(BlueprintPure, Category = "Download")
+		static FDownloadSessionStats GetDownloadSessionStats();
+
+	/** Writes the requests of this session to Saved/Logs/DownloadStats-<time>.csv, or Filename if given */
+	UFUNCTION(BlueprintCallable, Category = "Download")
+		static bool DumpDownloadSessionStats(const FString& Filename);
+};
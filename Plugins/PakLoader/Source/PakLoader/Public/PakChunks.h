@@ -0,0 +1,101 @@
+// Copyright 1998-2016 Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+#include "Engine.h"
+#include "SecureHash.h"
+
+/**
+* A content-addressed chunk of a downloaded pak: the SHA1 of its bytes and its length.
+*/
+struct FPakChunk
+{
+	FSHAHash Hash;
+	int64 Size;
+
+	FPakChunk() : Size(0) {}
+	FPakChunk(const FSHAHash& InHash, int64 InSize) : Hash(InHash), Size(InSize) {}
+
+	bool operator==(const FPakChunk& Other) const
+	{
+		return Size == Other.Size && Hash == Other.Hash;
+	}
+
+	friend FArchive& operator<<(FArchive& Ar, FPakChunk& Chunk)
+	{
+		return Ar << Chunk.Hash << Chunk.Size;
+	}
+};
+
+/**
+* The ordered list of chunks that make up a pak file.
+* Serialized as one "<sha1> <size>" line per chunk, preceded by a "# sha1 <sha1>" line holding the
+* hash of the whole pak when known. This is also the format of the optional "<URL>.chunks" manifest
+* published next to a pak on the server.
+*/
+struct PAKLOADER_API FPakChunkRecipe
+{
+	TArray<FPakChunk> Chunks;
+	/** SHA1 of the whole pak, valid if bHasPakHash */
+	FSHAHash PakHash;
+	bool bHasPakHash;
+
+	FPakChunkRecipe() : bHasPakHash(false) {}
+
+	int64 GetTotalSize() const;
+	/** Returns the offset of each chunk within the pak (plus the total size as the last entry) */
+	void GetOffsets(TArray<int64>& Offsets) const;
+	FString ToString() const;
+	bool FromString(const FString& Text);
+	bool operator==(const FPakChunkRecipe& Other) const
+	{
+		return Chunks == Other.Chunks && (!bHasPakHash || !Other.bHasPakHash || PakHash == Other.PakHash);
+	}
+
+	friend FArchive& operator<<(FArchive& Ar, FPakChunkRecipe& Recipe)
+	{
+		return Ar << Recipe.Chunks << Recipe.PakHash << Recipe.bHasPakHash;
+	}
+};
+
+/**
+* Splits a stream of bytes into content-defined chunks (gear rolling hash) so that identical
+* assets stored in different paks produce identical chunks regardless of their offset.
+* Completed chunks are written to the chunk store as they are found, and the SHA1 of the whole pak
+* is computed on the same pass so it never has to be re-read for verification. Stored chunks, including
+* ones found already present, stay pinned until the chunker is destroyed, so keep it until the recipe is
+* committed to the download cache. The editor uses the
+* same chunker, without the store, to tell the upload server which chunks a new pak is made of.
+*/
+class PAKLOADER_API FPakChunker
+{
+public:
+	static const int64 MinChunkSize = 256 * 1024;
+	static const int64 MaxChunkSize = 4 * 1024 * 1024;
+	/** Average chunk size is 1MB */
+	static const uint64 ChunkMask = (1 << 20) - 1;
+
+	/** @param bInStore - Whether to write the chunks to the chunk store, or only work out the recipe */
+	explicit FPakChunker(bool bInStore = true);
+	~FPakChunker();
+
+	/** Feeds the next Size bytes of the pak. Returns false if a chunk couldn't be stored. */
+	bool Write(const uint8* Data, int64 Size);
+
+	/** Stores the trailing chunk and returns the recipe (including the pak hash) of everything written. */
+	bool Finish(FPakChunkRecipe& OutRecipe);
+
+	/** Number of bytes that were already present in the store */
+	int64 GetReusedBytes() const
+	{
+		return ReusedBytes;
+	}
+
+private:
+	bool EmitChunk();
+	bool bStore;
+	TArray<uint8> Pending;
+	FSHA1 PakHasher;
+	uint64 RollingHash;
+	int64 ReusedBytes;
+	FPakChunkRecipe Recipe;
+};
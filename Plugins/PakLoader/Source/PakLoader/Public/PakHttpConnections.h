@@ -0,0 +1,58 @@
+// Copyright 1998-2016 Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+#include "Engine.h"
+#include "IHttpRequest.h"
+
+/**
+* Creates and issues the HTTP requests of content downloads, so the connections behind them can be shared and
+* kept warm. The HTTP backend keeps idle keep-alive connections per host and reuses them; this makes sure there
+* is one to reuse:
+*  - at startup every host in [PakLoader] PrewarmHosts (and every mirror in [PakLoader.Mirrors]) gets a HEAD
+*    request, so DNS and the TCP/TLS handshake are done before the first download needs them
+*  - with [PakLoader] KeepWarmSeconds > 0, a host used in the last few minutes that has been idle that long gets
+*    another HEAD before the server drops its connection
+*/
+class PAKLOADER_API FPakHttpConnections
+{
+public:
+	static FPakHttpConnections& Get();
+
+	/** Creates a request that asks for its connection to be kept alive */
+	TSharedRef<IHttpRequest> CreateRequest();
+
+	/** Issues Request (its URL must be set), noting its host as in use until it completes. Safe on any thread. */
+	bool ProcessRequest(const TSharedRef<IHttpRequest>& Request);
+
+	/** Warms up the configured content hosts and starts keeping them warm */
+	void Startup();
+	void Shutdown();
+
+	/** Opens a connection to the host of Url unless one is open or opening */
+	void Warm(const FString& Url);
+
+private:
+	FPakHttpConnections();
+
+	struct FHostState
+	{
+		/** Requests in flight, not counting warm-ups */
+		int32 Active;
+		bool bWarming;
+		/** When the last content request was issued */
+		double LastUsed;
+		/** When the connection last carried anything */
+		double LastActive;
+
+		FHostState() : Active(0), bWarming(false), LastUsed(0), LastActive(0) {}
+	};
+
+	bool KeepWarm(float DeltaTime);
+	void HandleWarmRequest(FHttpRequestPtr HttpRequest, FHttpResponsePtr HttpResponse, bool bSucceeded, FString Origin);
+	void HandleRequestComplete(const FString& Origin);
+
+	FCriticalSection HostsCritical;
+	TMap<FString, FHostState> Hosts;
+	float KeepWarmSeconds;
+	FDelegateHandle KeepWarmHandle;
+};
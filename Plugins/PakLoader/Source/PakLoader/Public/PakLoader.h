@@ -6,6 +6,8 @@
 #include "IPlatformFilePak.h"
 #include "Set.h"
 struct FStreamableManager;
+class FVirtualPakPlatformFile;
+class IVirtualPakSource;
 DECLARE_LOG_CATEGORY_EXTERN(PakLoader, Log, All);
 
 class FPakLoaderModule : public IModuleInterface
@@ -32,14 +34,30 @@ public:
 	virtual bool GetLevelsFromPak(const FString& PakFilePath, TArray<FString>& Levels);
 	/**
 	* Mounts the given Pak file on the Game content folder and then returns a pointer to the FPakFile object.
+	* Patch paks (named <name>_<N>_P.pak) take precedence over other paks, and later patches over earlier ones.
 	*/
 	virtual bool MountPakFile(const FString& PakFilePath, TSharedPtr<FPakFile>& Result);
 
+	/**
+	* Mounts a pak that only exists as Source (e.g. streamed over HTTP) under the name PakFilePath.
+	* Fails if the pak platform file was created before this module could insert its virtual layer.
+	*/
+	virtual bool MountVirtualPak(const FString& PakFilePath, const TSharedPtr<IVirtualPakSource, ESPMode::ThreadSafe>& Source, TSharedPtr<FPakFile>& Result);
+
 	/**
 	* Unmounts the given (previously mounted) Pak file
 	*/
 	virtual bool UnmountPakFile(const FString &PakFilePath);
 
+	/**
+	* Returns true if the given Pak file is currently mounted. Safe to call from any thread.
+	*/
+	bool IsPakMounted(const FString& PakFilePath) const
+	{
+		FScopeLock ScopedLock(&MountedPaksCritical);
+		return MountedPaks.Contains(PakFilePath);
+	}
+
 	virtual void EndPlay();
 
 	void ConvertToSandBoxPath(const FString& InPath, FString* Result)
@@ -56,9 +74,21 @@ public:
 		}
 	}
 private:
+	/** Finds or creates the pak platform file (and our virtual layer below it) */
+	void CreatePakPlatformFile();
+
+	/**
+	* Makes a pak that is only present as chunks in the download cache mountable, either as a view over its chunks or,
+	* when the pak platform file was created before us, by materializing it at PakFilePath.
+	*/
+	bool MountChunkedPak(const FString& PakFilePath);
+
 	FStreamableManager* StreamableManager;
 	FPakPlatformFile* PakPlatformFile;
+	FVirtualPakPlatformFile* VirtualPakPlatformFile;
 	bool bSandboxed;
 	TSet<FString> MountedPaks;
+	/** MountedPaks is only changed on the game thread but the download cache reads it from I/O tasks */
+	mutable FCriticalSection MountedPaksCritical;
 	uint32 UnloadId;
 };
\ No newline at end of file
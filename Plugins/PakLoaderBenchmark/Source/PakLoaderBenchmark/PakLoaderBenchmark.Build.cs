@@ -0,0 +1,60 @@
+// Copyright 1998-2016 Epic Games, Inc. All Rights Reserved.
+
+using UnrealBuildTool;
+
+public class PakLoaderBenchmark : ModuleRules
+{
+    public PakLoaderBenchmark(TargetInfo Target)
+    {
+
+        PublicIncludePaths.AddRange(
+            new string[] {
+                "PakLoaderBenchmark/Public"
+				// ... add public include paths required here ...
+			}
+            );
+
+
+        PrivateIncludePaths.AddRange(
+            new string[] {
+                "PakLoaderBenchmark/Private",
+				// ... add other private include paths required here ...
+			}
+            );
+
+
+        PublicDependencyModuleNames.AddRange(
+            new string[]
+            {
+                "Core",
+				// ... add other public dependencies that you statically link with here ...
+			}
+            );
+
+
+        PrivateDependencyModuleNames.AddRange(
+            new string[]
+            {
+                "CoreUObject",
+                "Engine",
+                "Http",
+                "Sockets",
+                "Networking",
+                "PakLoader",
+                "DownloadFilePlugin",
+				// ... add private dependencies that you statically link with here ...	
+			}
+            );
+
+
+        // gzip Content-Encoding
+        AddEngineThirdPartyPrivateStaticDependencies(Target, "zlib");
+
+        DynamicallyLoadedModuleNames.AddRange(
+            new string[]
+            {
+				// ... add any modules that your module loads dynamically here ...
+			}
+            );
+    }
+}
@@ -0,0 +1,811 @@
+// Copyright 1998-2016 Epic Games, Inc. All Rights Reserved.
+
+#include "PakLoaderBenchmarkPrivatePCH.h"
+#include "ContentTestServer.h"
+#include "Networking.h"
+#include "Sockets.h"
+#include "SocketSubsystem.h"
+#include "SecureHash.h"
+#include "PakChunks.h"
+#include "zlib.h"
+
+/** Bodies are read and sent in blocks of this size, which is also the bandwidth limiter's burst */
+static const int32 SendBlockSize = 16 * 1024;
+/** A request's headers must fit in this */
+static const int32 MaxHeaderBytes = 64 * 1024;
+/** Idle keep-alive connections are closed after this */
+static const double IdleTimeoutSeconds = 30;
+/** Largest request body accepted, whole uploads included */
+static const int64 MaxBodyBytes = 1024 * 1024 * 1024;
+
+void FContentTestServerSettings::ParseCommandLine(const TCHAR* Params)
+{
+	FParse::Value(Params, TEXT("Port="), Port);
+	FParse::Value(Params, TEXT("Latency="), LatencyMs);
+	FParse::Value(Params, TEXT("KBps="), KBps);
+	FParse::Value(Params, TEXT("FailRate="), FailureRate);
+	FParse::Value(Params, TEXT("Seed="), Seed);
+	bCompress = FParse::Param(Params, TEXT("Compress"));
+	bRanges = !FParse::Param(Params, TEXT("NoRanges"));
+	bUploads = bUploads || FParse::Param(Params, TEXT("Uploads"));
+	FailureRate = FMath::Clamp(FailureRate, 0.0f, 1.0f);
+}
+
+static FString UrlDecode(const FString& Encoded)
+{
+	FTCHARToUTF8 Utf8(*Encoded);
+	TArray<ANSICHAR> Decoded;
+	for (int32 Index = 0; Index < Utf8.Length(); Index++)
+	{
+		const ANSICHAR Char = Utf8.Get()[Index];
+		if (Char == '%' && Index + 2 < Utf8.Length() && FChar::IsHexDigit(Utf8.Get()[Index + 1]) && FChar::IsHexDigit(Utf8.Get()[Index + 2]))
+		{
+			Decoded.Add((ANSICHAR)(FParse::HexDigit(Utf8.Get()[Index + 1]) * 16 + FParse::HexDigit(Utf8.Get()[Index + 2])));
+			Index += 2;
+		}
+		else
+		{
+			Decoded.Add(Char);
+		}
+	}
+	Decoded.Add('\0');
+	return UTF8_TO_TCHAR(Decoded.GetData());
+}
+
+static const TCHAR* GetStatusText(int32 Status)
+{
+	switch (Status)
+	{
+	case 100: return TEXT("Continue");
+	case 200: return TEXT("OK");
+	case 201: return TEXT("Created");
+	case 206: return TEXT("Partial Content");
+	case 304: return TEXT("Not Modified");
+	case 400: return TEXT("Bad Request");
+	case 404: return TEXT("Not Found");
+	case 405: return TEXT("Method Not Allowed");
+	case 409: return TEXT("Conflict");
+	case 416: return TEXT("Range Not Satisfiable");
+	case 503: return TEXT("Service Unavailable");
+	default: return TEXT("Internal Server Error");
+	}
+}
+
+/**
+* Parses a single "bytes=" range against a body of Size bytes. Returns false if the header should be
+* ignored (not a byte range, or several ranges, which a server may answer with the whole body).
+*/
+static bool ParseRange(const FString& Value, int64 Size, int64& OutStart, int64& OutEnd, bool& bOutSatisfiable)
+{
+	FString First;
+	FString Last;
+	if (!Value.StartsWith(TEXT("bytes=")) || Value.Contains(TEXT(",")) || !Value.Mid(6).Split(TEXT("-"), &First, &Last))
+	{
+		return false;
+	}
+	First = First.Trim().TrimTrailing();
+	Last = Last.Trim().TrimTrailing();
+	if (First.IsEmpty())
+	{
+		const int64 Suffix = FCString::Atoi64(*Last);
+		OutStart = FMath::Max<int64>(Size - Suffix, 0);
+		OutEnd = Size - 1;
+		bOutSatisfiable = Suffix > 0 && Size > 0;
+		return true;
+	}
+	OutStart = FCString::Atoi64(*First);
+	OutEnd = Last.IsEmpty() ? Size - 1 : FMath::Min(FCString::Atoi64(*Last), Size - 1);
+	bOutSatisfiable = OutStart < Size && OutStart <= OutEnd;
+	return true;
+}
+
+//----------------------------------------------------------------------//
+// FContentTestServer::FConnection
+//----------------------------------------------------------------------//
+
+class FContentTestServer::FConnection : public FRunnable
+{
+public:
+	FConnection(FContentTestServer& InServer, FSocket* InSocket, int32 Index)
+		: Server(InServer)
+		, Socket(InSocket)
+		, Random(InServer.Settings.Seed + Index)
+	{
+	}
+
+	virtual ~FConnection()
+	{
+		ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM)->DestroySocket(Socket);
+	}
+
+	virtual uint32 Run() override
+	{
+		FString Request;
+		while (!Server.IsStopping() && ReadRequest(Request) && HandleRequest(Request))
+		{
+		}
+		Socket->Close();
+		return 0;
+	}
+
+private:
+	/** Reads up to the end of the next request's headers; the body, if any, is left to ReadBody */
+	bool ReadRequest(FString& OutRequest)
+	{
+		const double Deadline = FPlatformTime::Seconds() + IdleTimeoutSeconds;
+		for (;;)
+		{
+			for (int32 Index = 0; Index + 3 < Pending.Num(); Index++)
+			{
+				if (Pending[Index] == '\r' && Pending[Index + 1] == '\n' && Pending[Index + 2] == '\r' && Pending[Index + 3] == '\n')
+				{
+					OutRequest = FString(Index, (const ANSICHAR*)Pending.GetData());
+					Pending.RemoveAt(0, Index + 4, false);
+					return true;
+				}
+			}
+			if (Pending.Num() > MaxHeaderBytes || Server.IsStopping() || FPlatformTime::Seconds() > Deadline)
+			{
+				return false;
+			}
+			if (!Socket->Wait(ESocketWaitConditions::WaitForRead, FTimespan::FromMilliseconds(100)))
+			{
+				continue;
+			}
+			uint8 Buffer[4096];
+			int32 BytesRead = 0;
+			// Readable with nothing to read means the client closed the connection
+			if (!Socket->Recv(Buffer, sizeof(Buffer), BytesRead) || BytesRead <= 0)
+			{
+				return false;
+			}
+			Pending.Append(Buffer, BytesRead);
+		}
+	}
+
+	/** Reads a request body of Length bytes */
+	bool ReadBody(int64 Length, TArray<uint8>& OutBody)
+	{
+		OutBody.Reset(Length);
+		const int32 Buffered = (int32)FMath::Min<int64>(Pending.Num(), Length);
+		OutBody.Append(Pending.GetData(), Buffered);
+		Pending.RemoveAt(0, Buffered, false);
+		double Deadline = FPlatformTime::Seconds() + IdleTimeoutSeconds;
+		while (OutBody.Num() < Length)
+		{
+			if (Server.IsStopping() || FPlatformTime::Seconds() > Deadline)
+			{
+				return false;
+			}
+			if (!Socket->Wait(ESocketWaitConditions::WaitForRead, FTimespan::FromMilliseconds(100)))
+			{
+				continue;
+			}
+			uint8 Buffer[SendBlockSize];
+			int32 BytesRead = 0;
+			if (!Socket->Recv(Buffer, (int32)FMath::Min<int64>(sizeof(Buffer), Length - OutBody.Num()), BytesRead) || BytesRead <= 0)
+			{
+				return false;
+			}
+			OutBody.Append(Buffer, BytesRead);
+			Deadline = FPlatformTime::Seconds() + IdleTimeoutSeconds;
+		}
+		return true;
+	}
+
+	bool Send(const uint8* Data, int64 Size, bool bThrottle)
+	{
+		while (Size > 0)
+		{
+			const int32 Block = (int32)FMath::Min<int64>(Size, SendBlockSize);
+			if (bThrottle)
+			{
+				Server.AcquireBandwidth(Block);
+			}
+			int32 Sent = 0;
+			for (int32 Offset = 0; Offset < Block; Offset += Sent)
+			{
+				if (Server.IsStopping() || !Socket->Send(Data + Offset, Block - Offset, Sent) || Sent <= 0)
+				{
+					return false;
+				}
+			}
+			Data += Block;
+			Size -= Block;
+		}
+		return true;
+	}
+
+	bool SendHeader(int32 Status, const TArray<FString>& Headers, bool bKeepAlive)
+	{
+		FString Header = FString::Printf(TEXT("HTTP/1.1 %d %s\r\n"), Status, GetStatusText(Status));
+		for (const FString& Line : Headers)
+		{
+			Header += Line + TEXT("\r\n");
+		}
+		Header += bKeepAlive ? TEXT("Connection: keep-alive\r\n\r\n") : TEXT("Connection: close\r\n\r\n");
+		FTCHARToUTF8 Utf8(*Header);
+		return Send((const uint8*)Utf8.Get(), Utf8.Length(), false);
+	}
+
+	bool SendEmpty(int32 Status, TArray<FString> Headers, bool bKeepAlive)
+	{
+		Headers.Add(TEXT("Content-Length: 0"));
+		return SendHeader(Status, Headers, bKeepAlive) && bKeepAlive;
+	}
+
+	bool SendText(int32 Status, const FString& Text, bool bKeepAlive)
+	{
+		FTCHARToUTF8 Utf8(*Text);
+		TArray<FString> Headers;
+		Headers.Add(TEXT("Content-Type: text/plain"));
+		Headers.Add(FString::Printf(TEXT("Content-Length: %d"), Utf8.Length()));
+		return SendHeader(Status, Headers, bKeepAlive) && Send((const uint8*)Utf8.Get(), Utf8.Length(), false) && bKeepAlive;
+	}
+
+	/** Answers one request; returns false when the connection should be closed */
+	bool HandleRequest(const FString& Request)
+	{
+		Server.Requests.Increment();
+		TArray<FString> Lines;
+		Request.ParseIntoArray(Lines, TEXT("\r\n"), true);
+		TArray<FString> RequestLine;
+		if (Lines.Num() > 0)
+		{
+			Lines[0].ParseIntoArray(RequestLine, TEXT(" "), true);
+		}
+		if (RequestLine.Num() != 3)
+		{
+			return SendEmpty(400, TArray<FString>(), false);
+		}
+		const FString& Method = RequestLine[0];
+		TMap<FString, FString> Headers;
+		for (int32 Index = 1; Index < Lines.Num(); Index++)
+		{
+			FString Name;
+			FString Value;
+			if (Lines[Index].Split(TEXT(":"), &Name, &Value))
+			{
+				Headers.Add(Name.Trim().TrimTrailing().ToLower(), Value.Trim().TrimTrailing());
+			}
+		}
+		const FString Connection = Headers.FindRef(TEXT("connection")).ToLower();
+		const bool bKeepAlive = RequestLine[2] == TEXT("HTTP/1.1") ? Connection != TEXT("close") : Connection == TEXT("keep-alive");
+		const bool bUpload = Method == TEXT("PUT") || Method == TEXT("POST") || (Method == TEXT("GET") && RequestLine[1].Contains(TEXT("upload=")));
+		if (bUpload && Server.Settings.bUploads)
+		{
+			return HandleUpload(Method, RequestLine[1], Headers, bKeepAlive);
+		}
+		if (Method != TEXT("GET") && Method != TEXT("HEAD"))
+		{
+			// The body wasn't read, so the connection can't be reused
+			return SendEmpty(405, TArray<FString>(), bKeepAlive && !Headers.Contains(TEXT("content-length")));
+		}
+		if (Server.Settings.LatencyMs > 0)
+		{
+			FPlatformProcess::Sleep(Server.Settings.LatencyMs / 1000.0f);
+		}
+		const bool bFail = Random.FRand() < Server.Settings.FailureRate;
+		const bool bDrop = bFail && Random.FRand() < 0.5f;
+		if (bFail && !bDrop)
+		{
+			UE_LOG(PakLoaderBenchmark, Verbose, TEXT("%s %s: injected 503"), *Method, *RequestLine[1]);
+			return SendEmpty(503, TArray<FString>(), bKeepAlive);
+		}
+		FResponseBody Body;
+		if (!Server.FindFile(RequestLine[1], Body))
+		{
+			UE_LOG(PakLoaderBenchmark, Verbose, TEXT("%s %s: 404"), *Method, *RequestLine[1]);
+			return SendEmpty(404, TArray<FString>(), bKeepAlive);
+		}
+		TArray<FString> ResponseHeaders;
+		ResponseHeaders.Add(TEXT("ETag: ") + Body.ETag);
+		ResponseHeaders.Add(TEXT("Last-Modified: ") + Body.LastModified);
+		if (Headers.FindRef(TEXT("if-none-match")) == Body.ETag)
+		{
+			return SendEmpty(304, ResponseHeaders, bKeepAlive);
+		}
+		if (Server.Settings.bRanges)
+		{
+			ResponseHeaders.Add(TEXT("Accept-Ranges: bytes"));
+		}
+		ResponseHeaders.Add(TEXT("Content-Type: application/octet-stream"));
+
+		int32 Status = 200;
+		int64 Start = 0;
+		int64 End = Body.Size - 1;
+		bool bSatisfiable = true;
+		const FString* IfRange = Headers.Find(TEXT("if-range"));
+		if (Server.Settings.bRanges && Headers.Contains(TEXT("range")) && (IfRange == nullptr || *IfRange == Body.ETag)
+			&& ParseRange(Headers.FindRef(TEXT("range")), Body.Size, Start, End, bSatisfiable))
+		{
+			if (!bSatisfiable)
+			{
+				ResponseHeaders.Add(FString::Printf(TEXT("Content-Range: bytes */%lld"), Body.Size));
+				return SendEmpty(416, ResponseHeaders, bKeepAlive);
+			}
+			Status = 206;
+			ResponseHeaders.Add(FString::Printf(TEXT("Content-Range: bytes %lld-%lld/%lld"), Start, End, Body.Size));
+		}
+		TSharedPtr<TArray<uint8>, ESPMode::ThreadSafe> Gzipped;
+		if (Status == 200 && Server.Settings.bCompress && Headers.FindRef(TEXT("accept-encoding")).Contains(TEXT("gzip")))
+		{
+			Gzipped = Server.GetCompressed(Body);
+		}
+		const int64 Length = Gzipped.IsValid() ? Gzipped->Num() : End - Start + 1;
+		if (Gzipped.IsValid())
+		{
+			ResponseHeaders.Add(TEXT("Content-Encoding: gzip"));
+		}
+		ResponseHeaders.Add(FString::Printf(TEXT("Content-Length: %lld"), Length));
+		UE_LOG(PakLoaderBenchmark, Verbose, TEXT("%s %s: %d, %lld bytes%s"), *Method, *RequestLine[1], Status, Length, bDrop ? TEXT(" (dropping halfway)") : TEXT(""));
+		if (!SendHeader(Status, ResponseHeaders, bKeepAlive && !bDrop))
+		{
+			return false;
+		}
+		if (Method == TEXT("HEAD"))
+		{
+			return bKeepAlive;
+		}
+		const int64 ToSend = bDrop ? Length / 2 : Length;
+		if (Gzipped.IsValid())
+		{
+			return Send(Gzipped->GetData(), ToSend, true) && bKeepAlive && !bDrop;
+		}
+		TUniquePtr<IFileHandle> Handle(IPlatformFile::GetPlatformPhysical().OpenRead(*Body.Filename));
+		if (!Handle.IsValid() || !Handle->Seek(Start))
+		{
+			return false;
+		}
+		TArray<uint8> Buffer;
+		Buffer.SetNumUninitialized(SendBlockSize);
+		for (int64 Sent = 0; Sent < ToSend; Sent += SendBlockSize)
+		{
+			const int32 Block = (int32)FMath::Min<int64>(ToSend - Sent, SendBlockSize);
+			if (!Handle->Read(Buffer.GetData(), Block) || !Send(Buffer.GetData(), Block, true))
+			{
+				return false;
+			}
+		}
+		return bKeepAlive && !bDrop;
+	}
+
+	/** Answers the upload requests described at FContentTestServer; returns false when the connection should be closed */
+	bool HandleUpload(const FString& Method, const FString& Target, const TMap<FString, FString>& Headers, bool bKeepAlive)
+	{
+		if (Server.Settings.LatencyMs > 0)
+		{
+			FPlatformProcess::Sleep(Server.Settings.LatencyMs / 1000.0f);
+		}
+		const bool bHasBody = Headers.Contains(TEXT("content-length"));
+		if (Random.FRand() < Server.Settings.FailureRate)
+		{
+			UE_LOG(PakLoaderBenchmark, Verbose, TEXT("%s %s: injected 503"), *Method, *Target);
+			return SendEmpty(503, TArray<FString>(), bKeepAlive && !bHasBody);
+		}
+
+		FString Path;
+		FString QueryString;
+		if (!Target.Split(TEXT("?"), &Path, &QueryString))
+		{
+			Path = Target;
+		}
+		TMap<FString, FString> Query;
+		TArray<FString> Arguments;
+		QueryString.ParseIntoArray(Arguments, TEXT("&"), true);
+		for (const FString& Argument : Arguments)
+		{
+			FString Name;
+			FString Value;
+			if (!Argument.Split(TEXT("="), &Name, &Value))
+			{
+				Name = Argument;
+			}
+			Query.Add(Name, UrlDecode(Value));
+		}
+		const FString UploadId = Query.FindRef(TEXT("upload"));
+		FString Filename;
+		if (!Server.GetLocalPath(Path, Filename) || UploadId.Contains(TEXT("/")) || UploadId.Contains(TEXT("\\")) || UploadId.Contains(TEXT("..")))
+		{
+			return SendEmpty(400, TArray<FString>(), bKeepAlive && !bHasBody);
+		}
+		const FString PartsDir = Server.Settings.RootDir / TEXT(".uploads") / UploadId;
+
+		if (Method == TEXT("GET"))
+		{
+			TArray<FString> PartFiles;
+			IFileManager::Get().FindFiles(PartFiles, *(PartsDir / TEXT("*")), true, false);
+			FString Body;
+			for (const FString& PartFile : PartFiles)
+			{
+				Body += PartFile.IsNumeric() ? PartFile + TEXT("\n") : FString();
+			}
+			UE_LOG(PakLoaderBenchmark, Log, TEXT("Upload %s of %s: %d parts received so far"), *UploadId, *Path, PartFiles.Num());
+			if (Body.IsEmpty())
+			{
+				return SendEmpty(404, TArray<FString>(), bKeepAlive);
+			}
+			return SendText(200, Body, bKeepAlive);
+		}
+
+		const int64 Length = FCString::Atoi64(*Headers.FindRef(TEXT("content-length")));
+		if (!bHasBody || Length < 0 || Length > MaxBodyBytes)
+		{
+			return SendEmpty(400, TArray<FString>(), false);
+		}
+		if (Headers.FindRef(TEXT("expect")).ToLower() == TEXT("100-continue"))
+		{
+			FTCHARToUTF8 Continue(TEXT("HTTP/1.1 100 Continue\r\n\r\n"));
+			if (!Send((const uint8*)Continue.Get(), Continue.Length(), false))
+			{
+				return false;
+			}
+		}
+		TArray<uint8> Body;
+		if (!ReadBody(Length, Body))
+		{
+			UE_LOG(PakLoaderBenchmark, Warning, TEXT("%s %s: connection lost after %d of %lld bytes"), *Method, *Target, Body.Num(), Length);
+			return false;
+		}
+
+		if (Query.Contains(TEXT("missing")) || Query.Contains(TEXT("recipe")) || Query.Contains(TEXT("chunk")))
+		{
+			return HandleChunks(Method, Path, Query, Filename, Body, bKeepAlive);
+		}
+
+		if (Method == TEXT("PUT"))
+		{
+			const FString* Part = Query.Find(TEXT("part"));
+			if (UploadId.IsEmpty() || Part == nullptr || !Part->IsNumeric())
+			{
+				return SendEmpty(400, TArray<FString>(), bKeepAlive);
+			}
+			const FString* ExpectedHash = Headers.Find(TEXT("x-part-sha1"));
+			if (ExpectedHash != nullptr)
+			{
+				FSHAHash Hash;
+				FSHA1::HashBuffer(Body.GetData(), Body.Num(), Hash.Hash);
+				if (Hash.ToString() != ExpectedHash->ToUpper())
+				{
+					UE_LOG(PakLoaderBenchmark, Warning, TEXT("Upload %s part %s: SHA1 mismatch"), *UploadId, **Part);
+					return SendEmpty(400, TArray<FString>(), bKeepAlive);
+				}
+			}
+			// Written aside and moved into place, so a part that is listed is always complete
+			const FString PartFilename = PartsDir / *Part;
+			if (!FFileHelper::SaveArrayToFile(Body, *(PartFilename + TEXT(".tmp"))) || !IFileManager::Get().Move(*PartFilename, *(PartFilename + TEXT(".tmp"))))
+			{
+				return SendEmpty(500, TArray<FString>(), bKeepAlive);
+			}
+			UE_LOG(PakLoaderBenchmark, Verbose, TEXT("Upload %s of %s: part %s, %d bytes"), *UploadId, *Path, **Part, Body.Num());
+			return SendEmpty(201, TArray<FString>(), bKeepAlive);
+		}
+
+		if (UploadId.IsEmpty())
+		{
+			if (!FFileHelper::SaveArrayToFile(Body, *Filename))
+			{
+				return SendEmpty(500, TArray<FString>(), bKeepAlive);
+			}
+			UE_LOG(PakLoaderBenchmark, Log, TEXT("Received %s: %d bytes in one request"), *Path, Body.Num());
+			return SendEmpty(200, TArray<FString>(), bKeepAlive);
+		}
+		const int32 PartCount = FCString::Atoi(*Query.FindRef(TEXT("parts")));
+		for (int32 Part = 0; Part < PartCount; Part++)
+		{
+			if (!FPaths::FileExists(PartsDir / FString::FromInt(Part)))
+			{
+				UE_LOG(PakLoaderBenchmark, Warning, TEXT("Upload %s of %s: part %d of %d is missing"), *UploadId, *Path, Part, PartCount);
+				return SendEmpty(409, TArray<FString>(), bKeepAlive);
+			}
+		}
+		TUniquePtr<FArchive> Writer(IFileManager::Get().CreateFileWriter(*Filename));
+		int64 Joined = 0;
+		for (int32 Part = 0; Writer && Part < PartCount; Part++)
+		{
+			TArray<uint8> PartData;
+			if (!FFileHelper::LoadFileToArray(PartData, *(PartsDir / FString::FromInt(Part))))
+			{
+				Writer.Reset();
+				break;
+			}
+			Writer->Serialize(PartData.GetData(), PartData.Num());
+			Joined += PartData.Num();
+		}
+		if (!Writer || !Writer->Close())
+		{
+			return SendEmpty(500, TArray<FString>(), bKeepAlive);
+		}
+		IFileManager::Get().DeleteDirectory(*PartsDir, false, true);
+		UE_LOG(PakLoaderBenchmark, Log, TEXT("Received %s: %lld bytes in %d parts (%s)"), *Path, Joined, PartCount, *QueryString.Left(200));
+		return SendEmpty(200, TArray<FString>(), bKeepAlive);
+	}
+
+	/**
+	* Answers chunk uploads: POST ?missing lists the chunks of the posted recipe that aren't in RootDir/.chunks,
+	* PUT ?chunk=<sha1> stores one, and POST ?recipe assembles the pak from them and publishes its recipe next to
+	* it as <pak>.chunks, where UAsyncTaskDownloadPak looks for it.
+	*/
+	bool HandleChunks(const FString& Method, const FString& Path, const TMap<FString, FString>& Query, const FString& Filename, TArray<uint8>& Body, bool bKeepAlive)
+	{
+		const FString ChunkDir = Server.Settings.RootDir / TEXT(".chunks");
+		if (Method == TEXT("PUT"))
+		{
+			const FString Hash = Query.FindRef(TEXT("chunk")).ToUpper();
+			FSHAHash BodyHash;
+			FSHA1::HashBuffer(Body.GetData(), Body.Num(), BodyHash.Hash);
+			if (Hash.Len() != 40 || BodyHash.ToString() != Hash)
+			{
+				UE_LOG(PakLoaderBenchmark, Warning, TEXT("Chunk %s of %s: SHA1 mismatch"), *Hash, *Path);
+				return SendEmpty(400, TArray<FString>(), bKeepAlive);
+			}
+			const FString ChunkFilename = ChunkDir / Hash;
+			if (!FFileHelper::SaveArrayToFile(Body, *(ChunkFilename + TEXT(".tmp"))) || !IFileManager::Get().Move(*ChunkFilename, *(ChunkFilename + TEXT(".tmp"))))
+			{
+				return SendEmpty(500, TArray<FString>(), bKeepAlive);
+			}
+			return SendEmpty(201, TArray<FString>(), bKeepAlive);
+		}
+
+		Body.Add(0);
+		FPakChunkRecipe Recipe;
+		if (Method != TEXT("POST") || !Recipe.FromString(UTF8_TO_TCHAR((const ANSICHAR*)Body.GetData())))
+		{
+			return SendEmpty(400, TArray<FString>(), bKeepAlive);
+		}
+		TSet<FString> Missing;
+		FString MissingList;
+		int64 MissingBytes = 0;
+		for (const FPakChunk& Chunk : Recipe.Chunks)
+		{
+			const FString Hash = Chunk.Hash.ToString();
+			if (!Missing.Contains(Hash) && IFileManager::Get().FileSize(*(ChunkDir / Hash)) != Chunk.Size)
+			{
+				Missing.Add(Hash);
+				MissingList += Hash + TEXT("\n");
+				MissingBytes += Chunk.Size;
+			}
+		}
+		if (Query.Contains(TEXT("missing")))
+		{
+			UE_LOG(PakLoaderBenchmark, Log, TEXT("%s: missing %d of %d chunks (%lld of %lld bytes)"), *Path, Missing.Num(), Recipe.Chunks.Num(), MissingBytes, Recipe.GetTotalSize());
+			return SendText(200, MissingList, bKeepAlive);
+		}
+		if (Missing.Num() > 0)
+		{
+			UE_LOG(PakLoaderBenchmark, Warning, TEXT("%s: can't assemble, %d chunks are missing"), *Path, Missing.Num());
+			return SendEmpty(409, TArray<FString>(), bKeepAlive);
+		}
+
+		TUniquePtr<FArchive> Writer(IFileManager::Get().CreateFileWriter(*Filename));
+		FSHA1 PakHasher;
+		for (int32 Index = 0; Writer && Index < Recipe.Chunks.Num(); Index++)
+		{
+			TArray<uint8> ChunkData;
+			if (!FFileHelper::LoadFileToArray(ChunkData, *(ChunkDir / Recipe.Chunks[Index].Hash.ToString())))
+			{
+				Writer.Reset();
+				break;
+			}
+			PakHasher.Update(ChunkData.GetData(), ChunkData.Num());
+			Writer->Serialize(ChunkData.GetData(), ChunkData.Num());
+		}
+		if (!Writer || !Writer->Close())
+		{
+			return SendEmpty(500, TArray<FString>(), bKeepAlive);
+		}
+		PakHasher.Final();
+		FSHAHash PakHash;
+		PakHasher.GetHash(PakHash.Hash);
+		if (Recipe.bHasPakHash && !(PakHash == Recipe.PakHash))
+		{
+			UE_LOG(PakLoaderBenchmark, Warning, TEXT("%s: assembled pak doesn't match the recipe's SHA1"), *Path);
+			IFileManager::Get().Delete(*Filename);
+			return SendEmpty(400, TArray<FString>(), bKeepAlive);
+		}
+		FFileHelper::SaveStringToFile(Recipe.ToString(), *(Filename + TEXT(".chunks")));
+		UE_LOG(PakLoaderBenchmark, Log, TEXT("Received %s: %lld bytes from %d chunks"), *Path, Recipe.GetTotalSize(), Recipe.Chunks.Num());
+		return SendEmpty(200, TArray<FString>(), bKeepAlive);
+	}
+
+	FContentTestServer& Server;
+	FSocket* Socket;
+	FRandomStream Random;
+	/** Bytes received past the end of the last request */
+	TArray<uint8> Pending;
+};
+
+//----------------------------------------------------------------------//
+// FContentTestServer
+//----------------------------------------------------------------------//
+
+FContentTestServer::FContentTestServer(const FContentTestServerSettings& InSettings)
+	: Settings(InSettings)
+	, ListenSocket(nullptr)
+	, BoundPort(0)
+	, Thread(nullptr)
+{
+}
+
+FContentTestServer::~FContentTestServer()
+{
+	Shutdown();
+}
+
+bool FContentTestServer::Start()
+{
+	ListenSocket = FTcpSocketBuilder(TEXT("ContentTestServer"))
+		.AsReusable()
+		.BoundToEndpoint(FIPv4Endpoint(FIPv4Address(127, 0, 0, 1), Settings.Port))
+		.Listening(16)
+		.Build();
+	if (ListenSocket == nullptr)
+	{
+		UE_LOG(PakLoaderBenchmark, Error, TEXT("Couldn't listen on port %d"), Settings.Port);
+		return false;
+	}
+	BoundPort = ListenSocket->GetPortNo();
+	if (Settings.KBps > 0)
+	{
+		Bandwidth.SetRate(Settings.KBps * 1024, SendBlockSize);
+	}
+	Thread = FRunnableThread::Create(this, TEXT("ContentTestServer"));
+	UE_LOG(PakLoaderBenchmark, Log, TEXT("Serving %s at %s (latency %.0fms, %s, failure rate %.2f%s%s%s)"), *Settings.RootDir, *GetBaseURL(),
+		Settings.LatencyMs, Settings.KBps > 0 ? *FString::Printf(TEXT("%.0f KB/s"), Settings.KBps) : TEXT("unlimited bandwidth"),
+		Settings.FailureRate, Settings.bCompress ? TEXT(", gzip") : TEXT(""), Settings.bRanges ? TEXT("") : TEXT(", no ranges"),
+		Settings.bUploads ? TEXT(", uploads") : TEXT(""));
+	return true;
+}
+
+void FContentTestServer::Shutdown()
+{
+	Stop();
+	if (Thread != nullptr)
+	{
+		Thread->WaitForCompletion();
+		delete Thread;
+		Thread = nullptr;
+	}
+	FScopeLock ScopedLock(&ConnectionsCritical);
+	for (FRunnableThread* ConnectionThread : ConnectionThreads)
+	{
+		ConnectionThread->WaitForCompletion();
+		delete ConnectionThread;
+	}
+	ConnectionThreads.Reset();
+	for (FConnection* Connection : Connections)
+	{
+		delete Connection;
+	}
+	Connections.Reset();
+	if (ListenSocket != nullptr)
+	{
+		ListenSocket->Close();
+		ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM)->DestroySocket(ListenSocket);
+		ListenSocket = nullptr;
+	}
+}
+
+FString FContentTestServer::GetBaseURL() const
+{
+	return FString::Printf(TEXT("http://127.0.0.1:%d/"), BoundPort);
+}
+
+uint32 FContentTestServer::Run()
+{
+	while (!IsStopping())
+	{
+		bool bPending = false;
+		if (!ListenSocket->WaitForPendingConnection(bPending, FTimespan::FromMilliseconds(100)))
+		{
+			FPlatformProcess::Sleep(0.01f);
+			continue;
+		}
+		FSocket* Socket = bPending ? ListenSocket->Accept(TEXT("ContentTestServer connection")) : nullptr;
+		if (Socket == nullptr)
+		{
+			continue;
+		}
+		Socket->SetNonBlocking(false);
+		FScopeLock ScopedLock(&ConnectionsCritical);
+		FConnection* Connection = new FConnection(*this, Socket, Connections.Num());
+		Connections.Add(Connection);
+		ConnectionThreads.Add(FRunnableThread::Create(Connection, *FString::Printf(TEXT("ContentTestConnection%d"), Connections.Num())));
+	}
+	return 0;
+}
+
+void FContentTestServer::Stop()
+{
+	Stopping.Set(1);
+}
+
+bool FContentTestServer::GetLocalPath(const FString& Path, FString& OutFilename) const
+{
+	FString RelativePath;
+	if (!Path.Split(TEXT("?"), &RelativePath, nullptr))
+	{
+		RelativePath = Path;
+	}
+	RelativePath = UrlDecode(RelativePath);
+	if (RelativePath.Contains(TEXT("..")))
+	{
+		return false;
+	}
+	OutFilename = Settings.RootDir / RelativePath;
+	return true;
+}
+
+bool FContentTestServer::FindFile(const FString& Path, FResponseBody& OutBody) const
+{
+	IPlatformFile& PlatformFile = IPlatformFile::GetPlatformPhysical();
+	if (!GetLocalPath(Path, OutBody.Filename) || !PlatformFile.FileExists(*OutBody.Filename))
+	{
+		return false;
+	}
+	OutBody.Size = PlatformFile.FileSize(*OutBody.Filename);
+	const FDateTime TimeStamp = PlatformFile.GetTimeStamp(*OutBody.Filename);
+	OutBody.ETag = FString::Printf(TEXT("\"%llx-%llx\""), TimeStamp.GetTicks(), OutBody.Size);
+	OutBody.LastModified = TimeStamp.ToHttpDate();
+	return true;
+}
+
+TSharedPtr<TArray<uint8>, ESPMode::ThreadSafe> FContentTestServer::GetCompressed(const FResponseBody& Body)
+{
+	{
+		FScopeLock ScopedLock(&CompressedCritical);
+		if (const TSharedPtr<TArray<uint8>, ESPMode::ThreadSafe>* Found = Compressed.Find(Body.ETag))
+		{
+			return *Found;
+		}
+	}
+	TArray<uint8> Data;
+	if (Body.Size > MAX_int32 || !FFileHelper::LoadFileToArray(Data, *Body.Filename))
+	{
+		return nullptr;
+	}
+	z_stream Stream;
+	FMemory::Memzero(Stream);
+	// 16 + MAX_WBITS: write a gzip header and trailer
+	if (deflateInit2(&Stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 16 + MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+	{
+		return nullptr;
+	}
+	TSharedPtr<TArray<uint8>, ESPMode::ThreadSafe> Result = MakeShareable(new TArray<uint8>());
+	Result->SetNumUninitialized(deflateBound(&Stream, Data.Num()));
+	Stream.next_in = Data.GetData();
+	Stream.avail_in = Data.Num();
+	Stream.next_out = Result->GetData();
+	Stream.avail_out = Result->Num();
+	const bool bCompressed = deflate(&Stream, Z_FINISH) == Z_STREAM_END;
+	Result->SetNum(Stream.total_out);
+	deflateEnd(&Stream);
+	if (!bCompressed)
+	{
+		return nullptr;
+	}
+	UE_LOG(PakLoaderBenchmark, Log, TEXT("Compressed %s: %lld -> %d bytes"), *Body.Filename, Body.Size, Result->Num());
+	FScopeLock ScopedLock(&CompressedCritical);
+	Compressed.Add(Body.ETag, Result);
+	return Result;
+}
+
+void FContentTestServer::AcquireBandwidth(int64 Bytes)
+{
+	if (Settings.KBps <= 0)
+	{
+		return;
+	}
+	while (!IsStopping())
+	{
+		{
+			FScopeLock ScopedLock(&BandwidthCritical);
+			if (Bandwidth.HasTokens())
+			{
+				Bandwidth.Consume(Bytes);
+				return;
+			}
+		}
+		FPlatformProcess::Sleep(0.001f);
+	}
+}
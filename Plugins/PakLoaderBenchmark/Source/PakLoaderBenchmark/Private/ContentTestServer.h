@@ -0,0 +1,125 @@
+// Copyright 1998-2016 Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+#include "Engine.h"
+#include "DownloadScheduler.h"
+
+class FSocket;
+
+/** How the test server behaves */
+struct FContentTestServerSettings
+{
+	/** Directory whose files are served; URL paths are relative to it */
+	FString RootDir;
+	/** Port on 127.0.0.1 to listen on, 0 for any free one */
+	int32 Port;
+	/** Added before each response, as a stand-in for the round trip to a distant server */
+	float LatencyMs;
+	/** Bandwidth shared by all connections, 0 for unlimited */
+	float KBps;
+	/** Fraction of requests that fail, half with a 503 and half by dropping the connection halfway through the body */
+	float FailureRate;
+	/** gzip full responses to clients that accept it */
+	bool bCompress;
+	/** Honor Range requests; a server that doesn't answers them with the whole file */
+	bool bRanges;
+	/** Seeds failure injection, so runs with the same settings fail the same way */
+	int32 Seed;
+	/** Accept pak uploads, whole or in parts, into RootDir; see FContentTestServer */
+	bool bUploads;
+
+	FContentTestServerSettings()
+		: Port(0)
+		, LatencyMs(0)
+		, KBps(0)
+		, FailureRate(0)
+		, bCompress(false)
+		, bRanges(true)
+		, Seed(0)
+		, bUploads(false)
+	{
+	}
+
+	/** Reads -Latency=, -KBps=, -FailRate=, -Compress, -NoRanges, -Uploads, -Port= and -Seed= */
+	void ParseCommandLine(const TCHAR* Params);
+};
+
+/**
+* Minimal HTTP/1.1 server standing in for a content server: serves a directory with ETags, If-None-Match,
+* single byte ranges (with If-Range), gzip Content-Encoding and keep-alive, and injects latency, bandwidth
+* limits and failures as configured. Each connection gets its own thread. Meant for benchmarks on localhost,
+* not for serving anything real.
+*
+* With bUploads it also stands in for the pak upload server: a POST without an upload id stores its body as the
+* file, and uploads in parts (see FPakUploader in DeployToPakEditor) keep their parts under RootDir/.uploads/<id>:
+* GET ?upload=<id> lists the parts received, PUT ?upload=<id>&part=<n> stores one, checking X-Part-SHA1, and
+* POST ?upload=<id>&parts=<count> joins them into the file, or answers 409 if some are missing. Chunk uploads keep
+* each chunk once under RootDir/.chunks: POST ?missing answers which chunks of a recipe it lacks, PUT ?chunk=<sha1>
+* stores one and POST ?recipe assembles the file and publishes the recipe as <file>.chunks.
+*/
+class FContentTestServer : public FRunnable
+{
+public:
+	explicit FContentTestServer(const FContentTestServerSettings& InSettings);
+	virtual ~FContentTestServer();
+
+	/** Starts listening; returns false if the port couldn't be bound */
+	bool Start();
+	/** Closes every connection and stops listening */
+	void Shutdown();
+
+	/** Base URL the served directory is found at, e.g. http://127.0.0.1:1234/ */
+	FString GetBaseURL() const;
+
+	int32 GetRequestCount() const
+	{
+		return Requests.GetValue();
+	}
+
+	// FRunnable interface
+	virtual uint32 Run() override;
+	virtual void Stop() override;
+
+private:
+	class FConnection;
+	friend class FConnection;
+
+	struct FResponseBody
+	{
+		FString Filename;
+		FString ETag;
+		FString LastModified;
+		int64 Size;
+	};
+
+	/** Maps a URL path to a file under RootDir; false if it would lead outside it */
+	bool GetLocalPath(const FString& Path, FString& OutFilename) const;
+	/** Looks up a URL path under RootDir; false if it doesn't name a file there */
+	bool FindFile(const FString& Path, FResponseBody& OutBody) const;
+	/** Returns the gzipped file, compressing and caching it the first time; null if it can't be read */
+	TSharedPtr<TArray<uint8>, ESPMode::ThreadSafe> GetCompressed(const FResponseBody& Body);
+	/** Blocks until Bytes may be sent without going over the bandwidth limit */
+	void AcquireBandwidth(int64 Bytes);
+	bool IsStopping() const
+	{
+		return Stopping.GetValue() != 0;
+	}
+
+	FContentTestServerSettings Settings;
+	FSocket* ListenSocket;
+	int32 BoundPort;
+	FRunnableThread* Thread;
+	FThreadSafeCounter Stopping;
+	FThreadSafeCounter Requests;
+
+	FCriticalSection ConnectionsCritical;
+	TArray<FConnection*> Connections;
+	TArray<FRunnableThread*> ConnectionThreads;
+
+	FCriticalSection BandwidthCritical;
+	FTokenBucket Bandwidth;
+
+	FCriticalSection CompressedCritical;
+	/** gzipped files by ETag */
+	TMap<FString, TSharedPtr<TArray<uint8>, ESPMode::ThreadSafe>> Compressed;
+};
@@ -0,0 +1,18 @@
+// Copyright 1998-2016 Epic Games, Inc. All Rights Reserved.
+
+#include "PakLoaderBenchmarkPrivatePCH.h"
+
+DEFINE_LOG_CATEGORY(PakLoaderBenchmark);
+
+void FPakLoaderBenchmarkModule::StartupModule()
+{
+	// This code will execute after your module is loaded into memory; the exact timing is specified in the .uplugin file per-module
+}
+
+void FPakLoaderBenchmarkModule::ShutdownModule()
+{
+	// This function may be called during shutdown to clean up your module.  For modules that support dynamic reloading,
+	// we call this function before unloading the module.
+}
+
+IMPLEMENT_MODULE(FPakLoaderBenchmarkModule, PakLoaderBenchmark)
@@ -0,0 +1,309 @@
+// Copyright 1998-2016 Epic Games, Inc. All Rights Reserved.
+
+#include "PakLoaderBenchmarkPrivatePCH.h"
+#include "PakLoaderBenchmarkCommandlet.h"
+#include "ContentTestServer.h"
+#include "AsyncTaskDownloadPak.h"
+#include "AsyncTaskDownloadFile.h"
+#include "DownloadStats.h"
+
+static const TCHAR* DownloadPakClient = TEXT("DownloadPak");
+static const TCHAR* DownloadFileClient = TEXT("DownloadFile");
+
+/** How often memory use is sampled while a download runs */
+static const double MemorySampleInterval = 0.01;
+
+UPakLoaderBenchmarkCommandlet::UPakLoaderBenchmarkCommandlet(const FObjectInitializer& ObjectInitializer)
+	: Super(ObjectInitializer)
+	, bRunFinished(false)
+	, bRunSucceeded(false)
+	, RunStartTime(0)
+	, FirstByteTime(0)
+	, RunBytes(0)
+{
+	LogToConsole = true;
+}
+
+int32 UPakLoaderBenchmarkCommandlet::Main(const FString& Params)
+{
+	FContentTestServerSettings Settings;
+	Settings.ParseCommandLine(*Params);
+	int32 Runs = 3;
+	float Timeout = 300;
+	FParse::Value(*Params, TEXT("Runs="), Runs);
+	FParse::Value(*Params, TEXT("Timeout="), Timeout);
+	if (FParse::Param(*Params, TEXT("Serve")))
+	{
+		return Serve(Settings, Params);
+	}
+	FString Dir;
+	if (!FParse::Value(*Params, TEXT("Dir="), Dir))
+	{
+		int32 SizeMB = 32;
+		FParse::Value(*Params, TEXT("SizeMB="), SizeMB);
+		Dir = FPaths::GameSavedDir() / TEXT("PakLoaderBenchmark/Content");
+		if (!CreateTestPak(Dir / FString::Printf(TEXT("Benchmark%dMB.pak"), SizeMB), SizeMB))
+		{
+			return 1;
+		}
+	}
+	Settings.RootDir = FPaths::ConvertRelativePathToFull(Dir);
+	TArray<FString> Files;
+	IFileManager::Get().FindFiles(Files, *(Settings.RootDir / TEXT("*.pak")), true, false);
+	if (Files.Num() == 0)
+	{
+		UE_LOG(PakLoaderBenchmark, Error, TEXT("No .pak files in %s"), *Settings.RootDir);
+		return 1;
+	}
+
+	FContentTestServer Server(Settings);
+	if (!Server.Start())
+	{
+		return 1;
+	}
+	const FString RunId = FGuid::NewGuid().ToString();
+	TArray<FRunResult> Results;
+	for (const FString& File : Files)
+	{
+		for (const TCHAR* Client : { DownloadPakClient, DownloadFileClient })
+		{
+			for (int32 Index = 0; Index < Runs; Index++)
+			{
+				const FString URL = FString::Printf(TEXT("%s%s?run=%s-%s-%d"), *Server.GetBaseURL(), *File, *RunId, Client, Index);
+				FRunResult& Result = Results[Results.AddDefaulted()];
+				Result.File = File;
+				Run(Server, Client, URL, Timeout, Result);
+			}
+		}
+	}
+	Server.Shutdown();
+
+	FString Output = FPaths::GameSavedDir() / TEXT("PakLoaderBenchmark") / FDateTime::Now().ToString() + TEXT(".csv");
+	FParse::Value(*Params, TEXT("Output="), Output);
+	Report(Results, Output);
+	int32 Failures = 0;
+	for (const FRunResult& Result : Results)
+	{
+		Failures += Result.bSucceeded ? 0 : 1;
+	}
+	// Failures are expected when they are being injected
+	return Failures > 0 && Settings.FailureRate == 0 ? 1 : 0;
+}
+
+int32 UPakLoaderBenchmarkCommandlet::Serve(FContentTestServerSettings Settings, const FString& Params)
+{
+	FString Dir = FPaths::GameSavedDir() / TEXT("PakLoaderBenchmark/Uploads");
+	FParse::Value(*Params, TEXT("Dir="), Dir);
+	float Seconds = 0;
+	FParse::Value(*Params, TEXT("Seconds="), Seconds);
+	Settings.RootDir = FPaths::ConvertRelativePathToFull(Dir);
+	Settings.bUploads = true;
+	IFileManager::Get().MakeDirectory(*Settings.RootDir, true);
+
+	FContentTestServer Server(Settings);
+	if (!Server.Start())
+	{
+		return 1;
+	}
+	UE_LOG(PakLoaderBenchmark, Display, TEXT("Set Pak File Upload Folder URL to %s to upload paks here"), *Server.GetBaseURL().Mid(7).LeftChop(1));
+	const double EndTime = FPlatformTime::Seconds() + Seconds;
+	while (!GIsRequestingExit && (Seconds <= 0 || FPlatformTime::Seconds() < EndTime))
+	{
+		FPlatformProcess::Sleep(0.1f);
+	}
+	UE_LOG(PakLoaderBenchmark, Display, TEXT("Served %d requests"), Server.GetRequestCount());
+	Server.Shutdown();
+	return 0;
+}
+
+void UPakLoaderBenchmarkCommandlet::Run(const FContentTestServer& Server, const FString& Client, const FString& URL, double Timeout, FRunResult& OutResult)
+{
+	OutResult.Client = Client;
+	bRunFinished = false;
+	bRunSucceeded = false;
+	RunResult.Empty();
+	FirstByteTime = 0;
+	RunBytes = 0;
+	const FDownloadSessionStats StatsBefore = FDownloadStats::Get().GetSessionStats();
+	const int32 RequestsBefore = Server.GetRequestCount();
+	const uint64 BaselineMemory = FPlatformMemory::GetStats().UsedPhysical;
+	uint64 PeakMemory = BaselineMemory;
+	RunStartTime = FPlatformTime::Seconds();
+
+	if (Client == DownloadPakClient)
+	{
+		UAsyncTaskDownloadPak* DownloadTask = UAsyncTaskDownloadPak::DownloadPak(URL, false);
+		DownloadTask->OnSuccess.AddDynamic(this, &UPakLoaderBenchmarkCommandlet::HandleSuccess);
+		DownloadTask->OnFail.AddDynamic(this, &UPakLoaderBenchmarkCommandlet::HandleFail);
+		DownloadTask->OnProgress.AddDynamic(this, &UPakLoaderBenchmarkCommandlet::HandleProgress);
+		DownloadTask->OnBytesProgress = [this](int64 Received, int64 Total) { HandleBytesProgress(Received, Total); };
+	}
+	else
+	{
+		UAsyncTaskDownloadFile* DownloadTask = UAsyncTaskDownloadFile::DownloadFile(URL, false);
+		DownloadTask->OnSuccess.AddDynamic(this, &UPakLoaderBenchmarkCommandlet::HandleSuccess);
+		DownloadTask->OnFail.AddDynamic(this, &UPakLoaderBenchmarkCommandlet::HandleFail);
+		DownloadTask->OnProgress.AddDynamic(this, &UPakLoaderBenchmarkCommandlet::HandleProgress);
+		DownloadTask->OnBytesProgress = [this](int64 Received, int64 Total) { HandleBytesProgress(Received, Total); };
+	}
+
+	// There is no engine loop in a commandlet: tick what the downloads rely on (the HTTP manager is a ticker)
+	double LastTime = RunStartTime;
+	double LastSample = 0;
+	while (!bRunFinished && LastTime - RunStartTime < Timeout)
+	{
+		const double Now = FPlatformTime::Seconds();
+		FTicker::GetCoreTicker().Tick(Now - LastTime);
+		FTaskGraphInterface::Get().ProcessThreadUntilIdle(ENamedThreads::GameThread);
+		LastTime = Now;
+		if (Now - LastSample >= MemorySampleInterval)
+		{
+			PeakMemory = FMath::Max<uint64>(PeakMemory, FPlatformMemory::GetStats().UsedPhysical);
+			LastSample = Now;
+		}
+		FPlatformProcess::Sleep(0.001f);
+	}
+	if (!bRunFinished)
+	{
+		RunResult = TEXT("Timed out");
+	}
+
+	const FDownloadSessionStats StatsAfter = FDownloadStats::Get().GetSessionStats();
+	OutResult.bSucceeded = bRunSucceeded;
+	OutResult.Seconds = FPlatformTime::Seconds() - RunStartTime;
+	OutResult.FirstByteSeconds = FirstByteTime > 0 ? FirstByteTime - RunStartTime : -1;
+	// A downloaded pak may only exist as chunks in the download cache, so the size comes from the last progress report
+	OutResult.Bytes = bRunSucceeded ? RunBytes : 0;
+	OutResult.PeakMemoryBytes = PeakMemory - BaselineMemory;
+	OutResult.GameThreadSeconds = StatsAfter.GameThreadSeconds - StatsBefore.GameThreadSeconds;
+	OutResult.Requests = Server.GetRequestCount() - RequestsBefore;
+	UE_LOG(PakLoaderBenchmark, Log, TEXT("%s %s: %s in %.2fs, %.2f MB/s, first byte %.0fms, peak memory +%.1f MB, game thread %.1fms, %d requests"),
+		*Client, *OutResult.File, bRunSucceeded ? TEXT("done") : *RunResult, OutResult.Seconds,
+		OutResult.Seconds > 0 ? OutResult.Bytes / OutResult.Seconds / (1024 * 1024) : 0, OutResult.FirstByteSeconds * 1000,
+		OutResult.PeakMemoryBytes / (1024.0 * 1024.0), OutResult.GameThreadSeconds * 1000, OutResult.Requests);
+}
+
+void UPakLoaderBenchmarkCommandlet::HandleSuccess(const FString& Filename)
+{
+	bRunFinished = true;
+	bRunSucceeded = true;
+	RunResult = Filename;
+}
+
+void UPakLoaderBenchmarkCommandlet::HandleFail(const FString& Message)
+{
+	bRunFinished = true;
+	RunResult = Message;
+}
+
+void UPakLoaderBenchmarkCommandlet::HandleProgress(int32 BytesReceived, int32 TotalBytes, float BytesPerSecond, float SecondsRemaining)
+{
+	if (FirstByteTime == 0 && BytesReceived > 0)
+	{
+		FirstByteTime = FPlatformTime::Seconds();
+	}
+}
+
+void UPakLoaderBenchmarkCommandlet::HandleBytesProgress(int64 Received, int64 Total)
+{
+	RunBytes = FMath::Max(Received, Total);
+}
+
+bool UPakLoaderBenchmarkCommandlet::CreateTestPak(const FString& Filename, int32 SizeMB)
+{
+	const int64 Size = (int64)FMath::Max(SizeMB, 1) * 1024 * 1024;
+	IPlatformFile& PlatformFile = IPlatformFile::GetPlatformPhysical();
+	if (PlatformFile.FileSize(*Filename) == Size)
+	{
+		return true;
+	}
+	PlatformFile.CreateDirectoryTree(*FPaths::GetPath(Filename));
+	TUniquePtr<IFileHandle> Handle(PlatformFile.OpenWrite(*Filename));
+	if (!Handle.IsValid())
+	{
+		UE_LOG(PakLoaderBenchmark, Error, TEXT("Couldn't create %s"), *Filename);
+		return false;
+	}
+	// Alternating noise and repetitive blocks, so compression and chunk reuse have something to work with
+	FRandomStream Random(SizeMB);
+	TArray<uint8> Block;
+	Block.SetNumUninitialized(64 * 1024);
+	for (int64 Written = 0; Written < Size; Written += Block.Num())
+	{
+		const bool bNoise = (Written / Block.Num()) % 2 == 0;
+		for (int32 Index = 0; Index < Block.Num(); Index++)
+		{
+			Block[Index] = bNoise ? (uint8)Random.RandHelper(256) : (uint8)('a' + Index % 26);
+		}
+		if (!Handle->Write(Block.GetData(), Block.Num()))
+		{
+			UE_LOG(PakLoaderBenchmark, Error, TEXT("Couldn't write %s"), *Filename);
+			return false;
+		}
+	}
+	UE_LOG(PakLoaderBenchmark, Log, TEXT("Created test pak %s (%d MB)"), *Filename, SizeMB);
+	return true;
+}
+
+void UPakLoaderBenchmarkCommandlet::Report(const TArray<FRunResult>& Results, const FString& CsvFilename)
+{
+	FString Csv = TEXT("Client,File,Succeeded,Bytes,Seconds,MBps,FirstByteMs,PeakMemoryMB,GameThreadMs,Requests\n");
+	for (const FRunResult& Result : Results)
+	{
+		Csv += FString::Printf(TEXT("%s,%s,%d,%lld,%.3f,%.3f,%.1f,%.2f,%.2f,%d\n"), *Result.Client, *Result.File, Result.bSucceeded ? 1 : 0,
+			Result.Bytes, Result.Seconds, Result.Seconds > 0 ? Result.Bytes / Result.Seconds / (1024 * 1024) : 0, Result.FirstByteSeconds * 1000,
+			Result.PeakMemoryBytes / (1024.0 * 1024.0), Result.GameThreadSeconds * 1000, Result.Requests);
+	}
+	if (FFileHelper::SaveStringToFile(Csv, *CsvFilename))
+	{
+		UE_LOG(PakLoaderBenchmark, Log, TEXT("Wrote %s"), *CsvFilename);
+	}
+	else
+	{
+		UE_LOG(PakLoaderBenchmark, Error, TEXT("Couldn't write %s"), *CsvFilename);
+	}
+
+	// Medians over the successful runs of each client and file
+	UE_LOG(PakLoaderBenchmark, Display, TEXT("%-14s %-28s %5s %9s %9s %11s %10s %10s"), TEXT("Client"), TEXT("File"), TEXT("Fail"),
+		TEXT("Seconds"), TEXT("MB/s"), TEXT("FirstByte"), TEXT("PeakMB"), TEXT("GameMs"));
+	TArray<FString> Seen;
+	for (const FRunResult& First : Results)
+	{
+		const FString Key = First.Client + TEXT("/") + First.File;
+		if (Seen.Contains(Key))
+		{
+			continue;
+		}
+		Seen.Add(Key);
+		TArray<double> Seconds;
+		TArray<double> Throughput;
+		TArray<double> FirstByte;
+		TArray<double> GameThread;
+		int64 PeakMemory = 0;
+		int32 Failures = 0;
+		for (const FRunResult& Result : Results)
+		{
+			if (Result.Client != First.Client || Result.File != First.File)
+			{
+				continue;
+			}
+			if (!Result.bSucceeded)
+			{
+				Failures++;
+				continue;
+			}
+			Seconds.Add(Result.Seconds);
+			Throughput.Add(Result.Seconds > 0 ? Result.Bytes / Result.Seconds / (1024 * 1024) : 0);
+			FirstByte.Add(Result.FirstByteSeconds * 1000);
+			GameThread.Add(Result.GameThreadSeconds * 1000);
+			PeakMemory = FMath::Max(PeakMemory, Result.PeakMemoryBytes);
+		}
+		auto Median = [](TArray<double>& Values) -> double
+		{
+			Values.Sort();
+			return Values.Num() > 0 ? Values[Values.Num() / 2] : 0;
+		};
+		UE_LOG(PakLoaderBenchmark, Display, TEXT("%-14s %-28s %5d %9.2f %9.2f %9.0fms %10.1f %10.1f"), *First.Client, *First.File, Failures,
+			Median(Seconds), Median(Throughput), Median(FirstByte), PeakMemory / (1024.0 * 1024.0), Median(GameThread));
+	}
+}
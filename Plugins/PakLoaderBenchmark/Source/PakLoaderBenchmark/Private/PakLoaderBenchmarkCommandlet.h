@@ -0,0 +1,76 @@
+// Copyright 1998-2016 Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+#include "Engine.h"
+#include "Commandlets/Commandlet.h"
+
+#include "PakLoaderBenchmarkCommandlet.generated.h"
+
+class FContentTestServer;
+struct FContentTestServerSettings;
+
+/**
+* Benchmarks UAsyncTaskDownloadPak and UAsyncTaskDownloadFile against a local FContentTestServer and reports
+* throughput, time to first byte, peak memory and game thread time per download, so download changes can be
+* measured without touching real servers:
+*
+*   UE4Editor-Cmd <Project> -run=PakLoaderBenchmark [-Dir=<dir of .pak files>] [-SizeMB=32] [-Runs=3]
+*     [-Latency=<ms>] [-KBps=<n>] [-FailRate=<0..1>] [-Compress] [-NoRanges] [-Timeout=<s>] [-Output=<csv>]
+*
+* Without -Dir a test pak of -SizeMB is generated. Every run downloads under a fresh URL, so none is served from
+* the download caches. Results go to the log and, one row per run, to a CSV in Saved/PakLoaderBenchmark.
+*
+* With -Serve the server just runs, accepting uploads into -Dir (Saved/PakLoaderBenchmark/Uploads by default), for
+* -Seconds or until the process is stopped, as a local stand-in for the pak upload server:
+*
+*   UE4Editor-Cmd <Project> -run=PakLoaderBenchmark -Serve -Port=8080 [-Dir=<dir>] [-Seconds=<s>] [-FailRate=<0..1>] [-KBps=<n>]
+*/
+UCLASS()
+class UPakLoaderBenchmarkCommandlet : public UCommandlet
+{
+	GENERATED_UCLASS_BODY()
+
+public:
+	virtual int32 Main(const FString& Params) override;
+
+private:
+	struct FRunResult
+	{
+		FString Client;
+		FString File;
+		bool bSucceeded;
+		int64 Bytes;
+		double Seconds;
+		double FirstByteSeconds;
+		int64 PeakMemoryBytes;
+		double GameThreadSeconds;
+		int32 Requests;
+	};
+
+	/** Downloads URL with the given client, ticking until it finishes or Timeout passes */
+	void Run(const FContentTestServer& Server, const FString& Client, const FString& URL, double Timeout, FRunResult& OutResult);
+	/** Runs the test server with uploads enabled instead of benchmarking */
+	int32 Serve(FContentTestServerSettings Settings, const FString& Params);
+	static bool CreateTestPak(const FString& Filename, int32 SizeMB);
+	static void Report(const TArray<FRunResult>& Results, const FString& CsvFilename);
+
+	UFUNCTION()
+		void HandleSuccess(const FString& Filename);
+
+	UFUNCTION()
+		void HandleFail(const FString& Message);
+
+	UFUNCTION()
+		void HandleProgress(int32 BytesReceived, int32 TotalBytes, float BytesPerSecond, float SecondsRemaining);
+
+	/** Native progress callback, with byte counts past 2GB */
+	void HandleBytesProgress(int64 Received, int64 Total);
+
+	bool bRunFinished;
+	bool bRunSucceeded;
+	FString RunResult;
+	double RunStartTime;
+	double FirstByteTime;
+	/** Size of the download as of its last progress report */
+	int64 RunBytes;
+};